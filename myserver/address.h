@@ -0,0 +1,196 @@
+#ifndef __MYSERVER_ADDRESS_H__
+#define __MYSERVER_ADDRESS_H__
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+namespace myserver {
+
+class IPAddress;
+
+// 网络地址的基类
+class Address {
+public:
+    typedef std::shared_ptr<Address> ptr;
+
+    /**
+     * @brief 通过 sockaddr 指针创建对应类型的 Address
+     * @param[in] addr sockaddr 指针
+     * @param[in] addrlen sockaddr 的长度
+     * @return 返回和 sockaddr 相匹配的 Address，失败返回 nullptr
+     */
+    static Address::ptr Create(const sockaddr* addr, socklen_t addrlen);
+
+    /**
+     * @brief 通过 host 地址返回所有对应条件的 Address
+     * @param[out] result 保存满足条件的 Address
+     * @param[in] host 域名、服务器名等。举例: www.example.com[:80] / [::1]:80 (方括号内可为IPv6地址)
+     * @param[in] family 协议族(AF_INET, AF_INET6, AF_UNIX)
+     * @param[in] type socket类型 SOCK_STREAM、SOCK_DGRAM 等
+     * @param[in] protocol 协议, IPPROTO_TCP、IPPROTO_UDP 等
+     * @return 返回是否转换成功
+     */
+    static bool Lookup(std::vector<Address::ptr>& result, const std::string& host,
+            int family = AF_INET, int type = 0, int protocol = 0);
+
+    // 通过 host 地址返回对应条件的任意一个 Address
+    static Address::ptr LookupAny(const std::string& host,
+            int family = AF_INET, int type = 0, int protocol = 0);
+
+    // 通过 host 地址返回对应条件的任意一个 IPAddress
+    static std::shared_ptr<IPAddress> LookupAnyIPAddress(const std::string& host,
+            int family = AF_INET, int type = 0, int protocol = 0);
+
+    virtual ~Address() {}
+
+    int getFamily() const;
+
+    virtual const sockaddr* getAddr() const = 0;
+    virtual sockaddr* getAddr() = 0;
+    virtual socklen_t getAddrLen() const = 0;
+
+    // 可读性输出地址
+    virtual std::ostream& insert(std::ostream& os) const = 0;
+    std::string toString() const;
+
+    bool operator<(const Address& rhs) const;
+    bool operator==(const Address& rhs) const;
+    bool operator!=(const Address& rhs) const;
+};
+
+// IP地址的基类
+class IPAddress : public Address {
+public:
+    typedef std::shared_ptr<IPAddress> ptr;
+
+    /**
+     * @brief 通过数字形式的IP地址创建 IPAddress，不做域名解析
+     * @param[in] address 点分十进制的IPv4地址或IPv6地址字符串
+     * @param[in] port 端口号
+     * @return 成功返回 IPAddress，失败返回 nullptr
+     */
+    static IPAddress::ptr Create(const char* address, uint16_t port = 0);
+
+    // 获取该地址的广播地址
+    virtual IPAddress::ptr broadcastAddress(uint32_t prefix_len) = 0;
+    // 获取该地址的网段
+    virtual IPAddress::ptr networkAddress(uint32_t prefix_len) = 0;
+    // 获取子网掩码地址
+    virtual IPAddress::ptr subnetMask(uint32_t prefix_len) = 0;
+
+    virtual uint32_t getPort() const = 0;
+    virtual void setPort(uint16_t v) = 0;
+};
+
+// IPv4地址
+class IPv4Address : public IPAddress {
+public:
+    typedef std::shared_ptr<IPv4Address> ptr;
+
+    /**
+     * @brief 使用点分十进制地址创建 IPv4Address
+     * @param[in] address 点分十进制地址, 如: 192.168.1.1
+     * @param[in] port 端口号
+     * @return 成功返回 IPv4Address，失败返回 nullptr
+     */
+    static IPv4Address::ptr Create(const char* address, uint16_t port = 0);
+
+    IPv4Address(const sockaddr_in& address);
+    // address 为主机字节序的二进制地址
+    IPv4Address(uint32_t address = INADDR_ANY, uint16_t port = 0);
+
+    const sockaddr* getAddr() const override;
+    sockaddr* getAddr() override;
+    socklen_t getAddrLen() const override;
+    std::ostream& insert(std::ostream& os) const override;
+
+    IPAddress::ptr broadcastAddress(uint32_t prefix_len) override;
+    IPAddress::ptr networkAddress(uint32_t prefix_len) override;
+    IPAddress::ptr subnetMask(uint32_t prefix_len) override;
+    uint32_t getPort() const override;
+    void setPort(uint16_t v) override;
+private:
+    sockaddr_in m_addr;
+};
+
+// IPv6地址
+class IPv6Address : public IPAddress {
+public:
+    typedef std::shared_ptr<IPv6Address> ptr;
+
+    /**
+     * @brief 通过IPv6地址字符串创建 IPv6Address
+     * @param[in] address IPv6地址字符串
+     * @param[in] port 端口号
+     */
+    static IPv6Address::ptr Create(const char* address, uint16_t port = 0);
+
+    IPv6Address();
+    IPv6Address(const sockaddr_in6& address);
+    // address 为网络字节序的16字节地址
+    IPv6Address(const uint8_t address[16], uint16_t port = 0);
+
+    const sockaddr* getAddr() const override;
+    sockaddr* getAddr() override;
+    socklen_t getAddrLen() const override;
+    std::ostream& insert(std::ostream& os) const override;
+
+    IPAddress::ptr broadcastAddress(uint32_t prefix_len) override;
+    IPAddress::ptr networkAddress(uint32_t prefix_len) override;
+    IPAddress::ptr subnetMask(uint32_t prefix_len) override;
+    uint32_t getPort() const override;
+    void setPort(uint16_t v) override;
+private:
+    sockaddr_in6 m_addr;
+};
+
+// UnixSocket地址
+class UnixAddress : public Address {
+public:
+    typedef std::shared_ptr<UnixAddress> ptr;
+
+    UnixAddress();
+    /**
+     * @brief 通过路径构造 UnixAddress
+     * @param[in] path 路径，以'\0'开头时为抽象命名空间地址；长度不超过 UNIX_PATH_MAX
+     */
+    UnixAddress(const std::string& path);
+
+    const sockaddr* getAddr() const override;
+    sockaddr* getAddr() override;
+    socklen_t getAddrLen() const override;
+    void setAddrLen(uint32_t v);
+    std::string getPath() const;
+    std::ostream& insert(std::ostream& os) const override;
+private:
+    sockaddr_un m_addr;
+    socklen_t m_length;
+};
+
+// 未知地址
+class UnknownAddress : public Address {
+public:
+    typedef std::shared_ptr<UnknownAddress> ptr;
+    UnknownAddress(int family);
+    UnknownAddress(const sockaddr& addr);
+    const sockaddr* getAddr() const override;
+    sockaddr* getAddr() override;
+    socklen_t getAddrLen() const override;
+    std::ostream& insert(std::ostream& os) const override;
+private:
+    sockaddr m_addr;
+};
+
+// 流式输出 Address
+std::ostream& operator<<(std::ostream& os, const Address& addr);
+
+}
+
+#endif
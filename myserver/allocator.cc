@@ -0,0 +1,274 @@
+#include "allocator.h"
+#include <stdlib.h>
+#include <atomic>
+#include <set>
+#include "mutex.h"
+
+namespace myserver {
+
+namespace {
+
+struct FreeObject {
+    FreeObject* next;
+};
+
+// 中心空闲链表：各线程之间通过它成批交换对象
+struct CentralList {
+    Spinlock mutex;
+    FreeObject* head = nullptr;
+    std::atomic<uint32_t> count;
+    char pad[64];
+    CentralList() : count(0) {}
+};
+
+// 线程本地缓存，只由所属线程修改；计数使用原子量以便统计时跨线程读取
+struct ThreadCache {
+    FreeObject* heads[SlabAllocator::NUM_CLASSES];
+    std::atomic<uint32_t> counts[SlabAllocator::NUM_CLASSES];
+    std::atomic<int64_t> live;      // 本线程分配数 - 本线程释放数
+
+    ThreadCache() : live(0) {
+        for(int i = 0; i < SlabAllocator::NUM_CLASSES; ++i) {
+            heads[i] = nullptr;
+            counts[i].store(0, std::memory_order_relaxed);
+        }
+    }
+};
+
+struct Central {
+    CentralList lists[SlabAllocator::NUM_CLASSES];
+    std::atomic<uint64_t> reserved;         // 已申请的slab字节数
+    std::atomic<uint64_t> large_allocs;     // 直接走malloc的次数
+    std::atomic<int64_t> retired_live;      // 已退出线程及无缓存路径的存活对象数
+    Mutex registry_mutex;
+    std::set<ThreadCache*> caches;          // 存活线程的缓存，用于汇总统计
+
+    Central() : reserved(0), large_allocs(0), retired_live(0) {}
+};
+
+// 有意不析构：进程退出阶段仍可能有对象被释放
+Central& GetCentral() {
+    static Central* s_central = new Central;
+    return *s_central;
+}
+
+// 一次与中心链表交换的对象数
+inline uint32_t BatchSize(int cls) {
+    uint32_t n = 32 * 1024 / SlabAllocator::ClassSize(cls);
+    return n < 4 ? 4 : (n > 64 ? 64 : n);
+}
+
+const size_t CHUNK_SIZE = 64 * 1024;
+
+/**
+ * @brief 从中心链表取最多 n 个对象，中心链表为空时切分新的slab
+ * @return 取到的对象链表，个数写入 got (至少为1)
+ */
+FreeObject* FetchFromCentral(int cls, uint32_t n, uint32_t& got) {
+    Central& central = GetCentral();
+    CentralList& list = central.lists[cls];
+    size_t size = SlabAllocator::ClassSize(cls);
+    Spinlock::Lock lock(list.mutex);
+    if(!list.head) {
+        size_t chunk = CHUNK_SIZE;
+        if(chunk < size * n) {
+            chunk = size * n;
+        }
+        char* mem = static_cast<char*>(malloc(chunk));
+        if(!mem) {
+            throw std::bad_alloc();
+        }
+        central.reserved.fetch_add(chunk, std::memory_order_relaxed);
+        uint32_t objs = chunk / size;
+        for(uint32_t i = 0; i < objs; ++i) {
+            FreeObject* o = reinterpret_cast<FreeObject*>(mem + i * size);
+            o->next = list.head;
+            list.head = o;
+        }
+        list.count.fetch_add(objs, std::memory_order_relaxed);
+    }
+    FreeObject* head = list.head;
+    FreeObject* tail = head;
+    got = 1;
+    while(got < n && tail->next) {
+        tail = tail->next;
+        ++got;
+    }
+    list.head = tail->next;
+    tail->next = nullptr;
+    list.count.fetch_sub(got, std::memory_order_relaxed);
+    return head;
+}
+
+void ReleaseToCentral(int cls, FreeObject* head, FreeObject* tail, uint32_t n) {
+    CentralList& list = GetCentral().lists[cls];
+    Spinlock::Lock lock(list.mutex);
+    tail->next = list.head;
+    list.head = head;
+    list.count.fetch_add(n, std::memory_order_relaxed);
+}
+
+// 将线程缓存中 cls 级别的前 n 个对象归还中心链表
+void Scavenge(ThreadCache* c, int cls, uint32_t n) {
+    FreeObject* head = c->heads[cls];
+    if(!head || !n) {
+        return;
+    }
+    FreeObject* tail = head;
+    uint32_t k = 1;
+    while(k < n && tail->next) {
+        tail = tail->next;
+        ++k;
+    }
+    c->heads[cls] = tail->next;
+    c->counts[cls].store(c->counts[cls].load(std::memory_order_relaxed) - k, std::memory_order_relaxed);
+    ReleaseToCentral(cls, head, tail, k);
+}
+
+static thread_local ThreadCache* t_cache = nullptr;
+static thread_local bool t_cache_dead = false;
+
+// 线程退出时归还缓存并注销
+struct CacheHolder {
+    ThreadCache* cache = nullptr;
+    ~CacheHolder() {
+        t_cache = nullptr;
+        t_cache_dead = true;
+        if(!cache) {
+            return;
+        }
+        Central& central = GetCentral();
+        for(int i = 0; i < SlabAllocator::NUM_CLASSES; ++i) {
+            Scavenge(cache, i, cache->counts[i].load(std::memory_order_relaxed));
+        }
+        {
+            Mutex::Lock lock(central.registry_mutex);
+            central.caches.erase(cache);
+            central.retired_live.fetch_add(cache->live.load(std::memory_order_relaxed),
+                                           std::memory_order_relaxed);
+        }
+        delete cache;
+    }
+};
+
+static thread_local CacheHolder t_holder;
+
+// 返回当前线程缓存；线程退出阶段返回 nullptr，调用方直接操作中心链表
+inline ThreadCache* GetCache() {
+    if(t_cache) {
+        return t_cache;
+    }
+    if(t_cache_dead) {
+        return nullptr;
+    }
+    ThreadCache* c = new ThreadCache;
+    {
+        Central& central = GetCentral();
+        Mutex::Lock lock(central.registry_mutex);
+        central.caches.insert(c);
+    }
+    t_holder.cache = c;
+    t_cache = c;
+    return c;
+}
+
+}
+
+int SlabAllocator::SizeClass(size_t size) {
+    if(size <= 256) {
+        return size ? (size + 15) / 16 - 1 : 0;
+    }
+    if(size > MAX_SIZE) {
+        return -1;
+    }
+    // (256, 4096] 每个2的幂区间均分4级
+    size_t s = size - 1;
+    int lg = 63 - __builtin_clzll(s);
+    size_t base = (size_t)1 << lg;
+    return 16 + (lg - 8) * 4 + (s - base) / (base / 4);
+}
+
+size_t SlabAllocator::ClassSize(int cls) {
+    if(cls < 16) {
+        return (cls + 1) * 16;
+    }
+    size_t base = (size_t)1 << (8 + (cls - 16) / 4);
+    return base + ((cls - 16) % 4 + 1) * (base / 4);
+}
+
+void* SlabAllocator::Allocate(size_t size) {
+    int cls = SizeClass(size);
+    if(cls < 0) {
+        GetCentral().large_allocs.fetch_add(1, std::memory_order_relaxed);
+        void* p = malloc(size);
+        if(!p) {
+            throw std::bad_alloc();
+        }
+        return p;
+    }
+    ThreadCache* c = GetCache();
+    if(!c) {
+        uint32_t got;
+        GetCentral().retired_live.fetch_add(1, std::memory_order_relaxed);
+        return FetchFromCentral(cls, 1, got);
+    }
+    FreeObject* o = c->heads[cls];
+    if(!o) {
+        uint32_t got;
+        o = FetchFromCentral(cls, BatchSize(cls), got);
+        c->counts[cls].store(got, std::memory_order_relaxed);
+    }
+    c->heads[cls] = o->next;
+    c->counts[cls].store(c->counts[cls].load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+    c->live.store(c->live.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return o;
+}
+
+void SlabAllocator::Deallocate(void* p, size_t size) {
+    if(!p) {
+        return;
+    }
+    int cls = SizeClass(size);
+    if(cls < 0) {
+        free(p);
+        return;
+    }
+    FreeObject* o = static_cast<FreeObject*>(p);
+    ThreadCache* c = GetCache();
+    if(!c) {
+        GetCentral().retired_live.fetch_sub(1, std::memory_order_relaxed);
+        ReleaseToCentral(cls, o, o, 1);
+        return;
+    }
+    o->next = c->heads[cls];
+    c->heads[cls] = o;
+    uint32_t n = c->counts[cls].load(std::memory_order_relaxed) + 1;
+    c->counts[cls].store(n, std::memory_order_relaxed);
+    c->live.store(c->live.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+    uint32_t batch = BatchSize(cls);
+    if(n > 2 * batch) {
+        Scavenge(c, cls, batch);
+    }
+}
+
+AllocatorStats SlabAllocator::GetStats() {
+    Central& central = GetCentral();
+    AllocatorStats stats;
+    for(int i = 0; i < NUM_CLASSES; ++i) {
+        stats.cached_bytes += (uint64_t)central.lists[i].count.load(std::memory_order_relaxed)
+                              * ClassSize(i);
+    }
+    Mutex::Lock lock(central.registry_mutex);
+    stats.live_objects = central.retired_live.load(std::memory_order_relaxed);
+    for(auto c : central.caches) {
+        stats.live_objects += c->live.load(std::memory_order_relaxed);
+        for(int i = 0; i < NUM_CLASSES; ++i) {
+            stats.cached_bytes += (uint64_t)c->counts[i].load(std::memory_order_relaxed) * ClassSize(i);
+        }
+    }
+    stats.reserved_bytes = central.reserved.load(std::memory_order_relaxed);
+    stats.large_allocs = central.large_allocs.load(std::memory_order_relaxed);
+    return stats;
+}
+
+}
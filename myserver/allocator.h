@@ -0,0 +1,137 @@
+#ifndef __MYSERVER_ALLOCATOR_H__
+#define __MYSERVER_ALLOCATOR_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <new>
+#include <utility>
+#include <limits>
+
+namespace myserver {
+
+// 分配器统计信息
+struct AllocatorStats {
+    int64_t live_objects = 0;       // 已分配未释放的对象数(仅统计走slab的分配)
+    uint64_t cached_bytes = 0;      // 线程缓存与中心空闲链表中缓存的字节数
+    uint64_t reserved_bytes = 0;    // 向系统申请的slab总字节数(不归还系统)
+    uint64_t large_allocs = 0;      // 超过最大尺寸级别、直接走malloc的分配次数
+};
+
+/**
+ * @brief 按尺寸级别划分的slab分配器
+ * @details 16B~4KB 共32个尺寸级别，对齐16字节。每个线程持有各级别的本地空闲链表，
+ *          分配/释放在本地完成无需加锁；本地链表过长时成批归还到该级别的中心空闲链表，
+ *          为空时再成批取回，因此其它线程释放的对象经中心链表回流复用。
+ *          释放时需传入分配时的大小(同STL分配器约定)；超过4KB的请求直接转发malloc/free。
+ *          线程退出时其缓存全部归还中心链表，slab内存本身不归还系统
+ */
+class SlabAllocator {
+public:
+    enum {
+        MAX_SIZE = 4096,
+        NUM_CLASSES = 32,
+        ALIGNMENT = 16
+    };
+
+    static void* Allocate(size_t size);
+    static void Deallocate(void* p, size_t size);
+
+    // 返回尺寸级别序号，超过 MAX_SIZE 返回 -1
+    static int SizeClass(size_t size);
+    static size_t ClassSize(int cls);
+
+    static AllocatorStats GetStats();
+};
+
+/**
+ * @brief 基于 SlabAllocator 的STL分配器
+ * @details 可用于容器，也可用于 std::allocate_shared 将对象与控制块合并为一次slab分配
+ */
+template<class T>
+class SlabStlAllocator {
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template<class U>
+    struct rebind {
+        typedef SlabStlAllocator<U> other;
+    };
+
+    SlabStlAllocator() {}
+    template<class U>
+    SlabStlAllocator(const SlabStlAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        if(n > std::numeric_limits<size_t>::max() / sizeof(T)) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(SlabAllocator::Allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n) {
+        SlabAllocator::Deallocate(p, n * sizeof(T));
+    }
+
+    template<class U, class... Args>
+    void construct(U* p, Args&&... args) {
+        new ((void*)p) U(std::forward<Args>(args)...);
+    }
+
+    template<class U>
+    void destroy(U* p) {
+        p->~U();
+    }
+
+    size_t max_size() const {
+        return std::numeric_limits<size_t>::max() / sizeof(T);
+    }
+};
+
+template<class T, class U>
+bool operator==(const SlabStlAllocator<T>&, const SlabStlAllocator<U>&) { return true; }
+template<class T, class U>
+bool operator!=(const SlabStlAllocator<T>&, const SlabStlAllocator<U>&) { return false; }
+
+/**
+ * @brief 定长对象池，对象内存取自 sizeof(T) 对应的slab尺寸级别
+ */
+template<class T>
+class ObjectPool {
+public:
+    static_assert(alignof(T) <= SlabAllocator::ALIGNMENT, "ObjectPool: over-aligned type");
+
+    template<class... Args>
+    static T* New(Args&&... args) {
+        void* p = SlabAllocator::Allocate(sizeof(T));
+        try {
+            return new (p) T(std::forward<Args>(args)...);
+        } catch(...) {
+            SlabAllocator::Deallocate(p, sizeof(T));
+            throw;
+        }
+    }
+
+    static void Delete(T* p) {
+        if(p) {
+            p->~T();
+            SlabAllocator::Deallocate(p, sizeof(T));
+        }
+    }
+
+    // 对象与引用计数控制块合并为一次slab分配
+    template<class... Args>
+    static std::shared_ptr<T> MakeShared(Args&&... args) {
+        return std::allocate_shared<T>(SlabStlAllocator<T>(), std::forward<Args>(args)...);
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,636 @@
+#include "bytearray.h"
+#include <string.h>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+#include "endianness.h"
+#include "log.h"
+
+namespace myserver {
+
+static myserver::Logger::ptr g_logger = LOGGER_NAME("system");
+
+ByteArray::Node::Node(size_t s)
+    :ptr(new char[s])
+    ,next(nullptr)
+    ,size(s) {
+}
+
+ByteArray::Node::Node()
+    :ptr(nullptr)
+    ,next(nullptr)
+    ,size(0) {
+}
+
+ByteArray::Node::~Node() {
+    if(ptr) {
+        delete[] ptr;
+    }
+}
+
+ByteArray::ByteArray(size_t base_size)
+    :m_baseSize(base_size)
+    ,m_position(0)
+    ,m_capacity(base_size)
+    ,m_size(0)
+    ,m_endian(MYSERVER_BIG_ENDIAN)
+    ,m_root(new Node(base_size))
+    ,m_cur(m_root)
+    ,m_tail(m_root) {
+}
+
+ByteArray::~ByteArray() {
+    Node* tmp = m_root;
+    while(tmp) {
+        m_cur = tmp;
+        tmp = tmp->next;
+        delete m_cur;
+    }
+}
+
+bool ByteArray::isLittleEndian() const {
+    return m_endian == MYSERVER_LITTLE_ENDIAN;
+}
+
+void ByteArray::setIsLittleEndian(bool val) {
+    m_endian = val ? MYSERVER_LITTLE_ENDIAN : MYSERVER_BIG_ENDIAN;
+}
+
+// 当前块剩余空间足够时直接拷贝，否则走跨块的 write/read
+template<class T>
+void ByteArray::writeFixed(T value) {
+    if(m_endian != MYSERVER_BYTE_ORDER) {
+        value = byteswap(value);
+    }
+    size_t npos = m_position % m_baseSize;
+    if(m_cur && npos + sizeof(T) < m_cur->size) {
+        memcpy(m_cur->ptr + npos, &value, sizeof(T));
+        m_position += sizeof(T);
+        if(m_position > m_size) {
+            m_size = m_position;
+        }
+        return;
+    }
+    write(&value, sizeof(T));
+}
+
+template<class T>
+T ByteArray::readFixed() {
+    T v;
+    size_t npos = m_position % m_baseSize;
+    if(sizeof(T) <= getReadSize() && npos + sizeof(T) < m_cur->size) {
+        memcpy(&v, m_cur->ptr + npos, sizeof(T));
+        m_position += sizeof(T);
+    } else {
+        read(&v, sizeof(T));
+    }
+    if(m_endian != MYSERVER_BYTE_ORDER) {
+        v = byteswap(v);
+    }
+    return v;
+}
+
+void ByteArray::writeFint8(int8_t value) {
+    writeFixed(value);
+}
+
+void ByteArray::writeFuint8(uint8_t value) {
+    writeFixed(value);
+}
+
+void ByteArray::writeFint16(int16_t value) {
+    writeFixed(value);
+}
+
+void ByteArray::writeFuint16(uint16_t value) {
+    writeFixed(value);
+}
+
+void ByteArray::writeFint32(int32_t value) {
+    writeFixed(value);
+}
+
+void ByteArray::writeFuint32(uint32_t value) {
+    writeFixed(value);
+}
+
+void ByteArray::writeFint64(int64_t value) {
+    writeFixed(value);
+}
+
+void ByteArray::writeFuint64(uint64_t value) {
+    writeFixed(value);
+}
+
+static uint32_t EncodeZigzag32(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static uint64_t EncodeZigzag64(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int32_t DecodeZigzag32(uint32_t v) {
+    return (int32_t)((v >> 1) ^ (~(v & 1) + 1));
+}
+
+static int64_t DecodeZigzag64(uint64_t v) {
+    return (int64_t)((v >> 1) ^ (~(v & 1) + 1));
+}
+
+void ByteArray::writeInt32(int32_t value) {
+    writeUint32(EncodeZigzag32(value));
+}
+
+void ByteArray::writeUint32(uint32_t value) {
+    uint8_t tmp[5];
+    uint8_t i = 0;
+    while(value >= 0x80) {
+        tmp[i++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    tmp[i++] = value;
+    write(tmp, i);
+}
+
+void ByteArray::writeInt64(int64_t value) {
+    writeUint64(EncodeZigzag64(value));
+}
+
+void ByteArray::writeUint64(uint64_t value) {
+    uint8_t tmp[10];
+    uint8_t i = 0;
+    while(value >= 0x80) {
+        tmp[i++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    tmp[i++] = value;
+    write(tmp, i);
+}
+
+void ByteArray::writeFloat(float value) {
+    uint32_t v;
+    memcpy(&v, &value, sizeof(value));
+    writeFuint32(v);
+}
+
+void ByteArray::writeDouble(double value) {
+    uint64_t v;
+    memcpy(&v, &value, sizeof(value));
+    writeFuint64(v);
+}
+
+void ByteArray::writeStringF16(const std::string& value) {
+    writeFuint16(value.size());
+    write(value.c_str(), value.size());
+}
+
+void ByteArray::writeStringF32(const std::string& value) {
+    writeFuint32(value.size());
+    write(value.c_str(), value.size());
+}
+
+void ByteArray::writeStringF64(const std::string& value) {
+    writeFuint64(value.size());
+    write(value.c_str(), value.size());
+}
+
+void ByteArray::writeStringVint(const std::string& value) {
+    writeUint64(value.size());
+    write(value.c_str(), value.size());
+}
+
+void ByteArray::writeStringWithoutLength(const std::string& value) {
+    write(value.c_str(), value.size());
+}
+
+int8_t ByteArray::readFint8() {
+    return readFixed<int8_t>();
+}
+
+uint8_t ByteArray::readFuint8() {
+    return readFixed<uint8_t>();
+}
+
+int16_t ByteArray::readFint16() {
+    return readFixed<int16_t>();
+}
+
+uint16_t ByteArray::readFuint16() {
+    return readFixed<uint16_t>();
+}
+
+int32_t ByteArray::readFint32() {
+    return readFixed<int32_t>();
+}
+
+uint32_t ByteArray::readFuint32() {
+    return readFixed<uint32_t>();
+}
+
+int64_t ByteArray::readFint64() {
+    return readFixed<int64_t>();
+}
+
+uint64_t ByteArray::readFuint64() {
+    return readFixed<uint64_t>();
+}
+
+// 当前块内剩余字节足够容纳最长编码时直接在块内解码，避免逐字节调用 readFuint8
+template<class T>
+bool ByteArray::readVarintFast(T& result) {
+    const size_t MAX_LEN = (sizeof(T) * 8 + 6) / 7;
+    size_t npos = m_position % m_baseSize;
+    if(getReadSize() < MAX_LEN || npos + MAX_LEN >= m_cur->size) {
+        return false;
+    }
+    const uint8_t* p = (const uint8_t*)m_cur->ptr + npos;
+    size_t n = 0;
+    result = 0;
+    for(int i = 0; i < (int)sizeof(T) * 8; i += 7) {
+        uint8_t b = p[n++];
+        result |= ((T)(b & 0x7F)) << i;
+        if(b < 0x80) {
+            break;
+        }
+    }
+    m_position += n;
+    return true;
+}
+
+int32_t ByteArray::readInt32() {
+    return DecodeZigzag32(readUint32());
+}
+
+uint32_t ByteArray::readUint32() {
+    uint32_t result = 0;
+    if(readVarintFast(result)) {
+        return result;
+    }
+    for(int i = 0; i < 32; i += 7) {
+        uint8_t b = readFuint8();
+        if(b < 0x80) {
+            result |= ((uint32_t)b) << i;
+            break;
+        }
+        result |= (((uint32_t)(b & 0x7F)) << i);
+    }
+    return result;
+}
+
+int64_t ByteArray::readInt64() {
+    return DecodeZigzag64(readUint64());
+}
+
+uint64_t ByteArray::readUint64() {
+    uint64_t result = 0;
+    if(readVarintFast(result)) {
+        return result;
+    }
+    for(int i = 0; i < 64; i += 7) {
+        uint8_t b = readFuint8();
+        if(b < 0x80) {
+            result |= ((uint64_t)b) << i;
+            break;
+        }
+        result |= (((uint64_t)(b & 0x7F)) << i);
+    }
+    return result;
+}
+
+float ByteArray::readFloat() {
+    uint32_t v = readFuint32();
+    float value;
+    memcpy(&value, &v, sizeof(v));
+    return value;
+}
+
+double ByteArray::readDouble() {
+    uint64_t v = readFuint64();
+    double value;
+    memcpy(&value, &v, sizeof(v));
+    return value;
+}
+
+std::string ByteArray::readStringF16() {
+    uint16_t len = readFuint16();
+    if(len > getReadSize()) {
+        throw std::out_of_range("not enough len");
+    }
+    std::string buff;
+    buff.resize(len);
+    read(&buff[0], len);
+    return buff;
+}
+
+std::string ByteArray::readStringF32() {
+    uint32_t len = readFuint32();
+    if(len > getReadSize()) {
+        throw std::out_of_range("not enough len");
+    }
+    std::string buff;
+    buff.resize(len);
+    read(&buff[0], len);
+    return buff;
+}
+
+std::string ByteArray::readStringF64() {
+    uint64_t len = readFuint64();
+    if(len > getReadSize()) {
+        throw std::out_of_range("not enough len");
+    }
+    std::string buff;
+    buff.resize(len);
+    read(&buff[0], len);
+    return buff;
+}
+
+std::string ByteArray::readStringVint() {
+    uint64_t len = readUint64();
+    if(len > getReadSize()) {
+        throw std::out_of_range("not enough len");
+    }
+    std::string buff;
+    buff.resize(len);
+    read(&buff[0], len);
+    return buff;
+}
+
+void ByteArray::clear() {
+    m_position = m_size = 0;
+    m_capacity = m_baseSize;
+    Node* tmp = m_root->next;
+    while(tmp) {
+        m_cur = tmp;
+        tmp = tmp->next;
+        delete m_cur;
+    }
+    m_cur = m_tail = m_root;
+    m_root->next = nullptr;
+}
+
+void ByteArray::write(const void* buf, size_t size) {
+    if(size == 0) {
+        return;
+    }
+    addCapacity(size);
+
+    size_t npos = m_position % m_baseSize;
+    size_t ncap = m_cur->size - npos;
+    size_t bpos = 0;
+
+    while(size > 0) {
+        if(ncap >= size) {
+            memcpy(m_cur->ptr + npos, (const char*)buf + bpos, size);
+            if(m_cur->size == (npos + size)) {
+                m_cur = m_cur->next;
+            }
+            m_position += size;
+            bpos += size;
+            size = 0;
+        } else {
+            memcpy(m_cur->ptr + npos, (const char*)buf + bpos, ncap);
+            m_position += ncap;
+            bpos += ncap;
+            size -= ncap;
+            m_cur = m_cur->next;
+            ncap = m_cur->size;
+            npos = 0;
+        }
+    }
+
+    if(m_position > m_size) {
+        m_size = m_position;
+    }
+}
+
+void ByteArray::read(void* buf, size_t size) {
+    if(size > getReadSize()) {
+        throw std::out_of_range("not enough len");
+    }
+    if(size == 0) {
+        return;
+    }
+
+    size_t npos = m_position % m_baseSize;
+    size_t ncap = m_cur->size - npos;
+    size_t bpos = 0;
+    while(size > 0) {
+        if(ncap >= size) {
+            memcpy((char*)buf + bpos, m_cur->ptr + npos, size);
+            if(m_cur->size == (npos + size)) {
+                m_cur = m_cur->next;
+            }
+            m_position += size;
+            bpos += size;
+            size = 0;
+        } else {
+            memcpy((char*)buf + bpos, m_cur->ptr + npos, ncap);
+            m_position += ncap;
+            bpos += ncap;
+            size -= ncap;
+            m_cur = m_cur->next;
+            ncap = m_cur->size;
+            npos = 0;
+        }
+    }
+}
+
+void ByteArray::read(void* buf, size_t size, size_t position) const {
+    if(position > m_size || size > m_size - position) {
+        throw std::out_of_range("not enough len");
+    }
+    if(size == 0) {
+        return;
+    }
+
+    Node* cur = m_root;
+    for(size_t i = position / m_baseSize; i > 0; --i) {
+        cur = cur->next;
+    }
+    size_t npos = position % m_baseSize;
+    size_t ncap = cur->size - npos;
+    size_t bpos = 0;
+    while(size > 0) {
+        if(ncap >= size) {
+            memcpy((char*)buf + bpos, cur->ptr + npos, size);
+            size = 0;
+        } else {
+            memcpy((char*)buf + bpos, cur->ptr + npos, ncap);
+            bpos += ncap;
+            size -= ncap;
+            cur = cur->next;
+            ncap = cur->size;
+            npos = 0;
+        }
+    }
+}
+
+void ByteArray::setPosition(size_t v) {
+    if(v > m_capacity) {
+        throw std::out_of_range("set_position out of range");
+    }
+    m_position = v;
+    if(m_position > m_size) {
+        m_size = m_position;
+    }
+    // 恰好位于块边界时指向下一块(容量用尽时为 nullptr，由 addCapacity 补上)
+    m_cur = m_root;
+    for(size_t i = v / m_baseSize; i > 0; --i) {
+        m_cur = m_cur->next;
+    }
+}
+
+bool ByteArray::writeToFile(const std::string& name) const {
+    std::ofstream ofs;
+    ofs.open(name, std::ios::trunc | std::ios::binary);
+    if(!ofs) {
+        LOG_ERROR(g_logger) << "writeToFile name=" << name
+            << " error, errno=" << errno << " errstr=" << strerror(errno);
+        return false;
+    }
+
+    std::vector<iovec> iovs;
+    getReadBuffers(iovs, getReadSize());
+    for(auto& i : iovs) {
+        ofs.write((const char*)i.iov_base, i.iov_len);
+    }
+    return (bool)ofs;
+}
+
+bool ByteArray::readFromFile(const std::string& name) {
+    std::ifstream ifs;
+    ifs.open(name, std::ios::binary);
+    if(!ifs) {
+        LOG_ERROR(g_logger) << "readFromFile name=" << name
+            << " error, errno=" << errno << " errstr=" << strerror(errno);
+        return false;
+    }
+
+    std::unique_ptr<char[]> buff(new char[m_baseSize]);
+    while(!ifs.eof()) {
+        ifs.read(buff.get(), m_baseSize);
+        write(buff.get(), ifs.gcount());
+    }
+    return true;
+}
+
+void ByteArray::addCapacity(size_t size) {
+    size_t old_cap = getCapacity();
+    if(old_cap >= size) {
+        return;
+    }
+
+    size = size - old_cap;
+    size_t count = (size + m_baseSize - 1) / m_baseSize;
+    Node* first = nullptr;
+    for(size_t i = 0; i < count; ++i) {
+        m_tail->next = new Node(m_baseSize);
+        if(first == nullptr) {
+            first = m_tail->next;
+        }
+        m_tail = m_tail->next;
+        m_capacity += m_baseSize;
+    }
+
+    if(old_cap == 0) {
+        m_cur = first;
+    }
+}
+
+std::string ByteArray::toString() const {
+    std::string str;
+    str.resize(getReadSize());
+    if(str.empty()) {
+        return str;
+    }
+    read(&str[0], str.size(), m_position);
+    return str;
+}
+
+std::string ByteArray::toHexString() const {
+    std::string str = toString();
+    std::stringstream ss;
+
+    for(size_t i = 0; i < str.size(); ++i) {
+        if(i > 0 && i % 32 == 0) {
+            ss << std::endl;
+        }
+        ss << std::setw(2) << std::setfill('0') << std::hex
+           << (int)(uint8_t)str[i] << " ";
+    }
+
+    return ss.str();
+}
+
+uint64_t ByteArray::getReadBuffers(std::vector<iovec>& buffers, uint64_t len) const {
+    return getReadBuffers(buffers, len, m_position);
+}
+
+uint64_t ByteArray::getReadBuffers(std::vector<iovec>& buffers, uint64_t len, uint64_t position) const {
+    if(position > m_size) {
+        return 0;
+    }
+    len = len > m_size - position ? m_size - position : len;
+    if(len == 0) {
+        return 0;
+    }
+
+    uint64_t size = len;
+    size_t npos = position % m_baseSize;
+    Node* cur = m_root;
+    for(size_t i = position / m_baseSize; i > 0; --i) {
+        cur = cur->next;
+    }
+
+    size_t ncap = cur->size - npos;
+    struct iovec iov;
+    while(len > 0) {
+        if(ncap >= len) {
+            iov.iov_base = cur->ptr + npos;
+            iov.iov_len = len;
+            len = 0;
+        } else {
+            iov.iov_base = cur->ptr + npos;
+            iov.iov_len = ncap;
+            len -= ncap;
+            cur = cur->next;
+            ncap = cur->size;
+            npos = 0;
+        }
+        buffers.push_back(iov);
+    }
+    return size;
+}
+
+uint64_t ByteArray::getWriteBuffers(std::vector<iovec>& buffers, uint64_t len) {
+    if(len == 0) {
+        return 0;
+    }
+    addCapacity(len);
+    uint64_t size = len;
+
+    size_t npos = m_position % m_baseSize;
+    size_t ncap = m_cur->size - npos;
+    struct iovec iov;
+    Node* cur = m_cur;
+    while(len > 0) {
+        if(ncap >= len) {
+            iov.iov_base = cur->ptr + npos;
+            iov.iov_len = len;
+            len = 0;
+        } else {
+            iov.iov_base = cur->ptr + npos;
+            iov.iov_len = ncap;
+            len -= ncap;
+            cur = cur->next;
+            ncap = cur->size;
+            npos = 0;
+        }
+        buffers.push_back(iov);
+    }
+    return size;
+}
+
+}
@@ -0,0 +1,160 @@
+#ifndef __MYSERVER_BYTEARRAY_H__
+#define __MYSERVER_BYTEARRAY_H__
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+namespace myserver {
+
+/**
+ * @brief 二进制序列化缓冲区
+ * @details 由定长内存块组成的单向链表，写入时按需追加新块，不搬移已写入的数据。
+ *          支持定长整数(可选字节序)、varint/zigzag 变长整数、浮点数、带长度前缀的字符串，
+ *          并能导出 iovec 数组直接用于 readv/writev。
+ *          读写共用同一个位置游标 position，写完后 setPosition(0) 即可从头读取
+ */
+class ByteArray {
+public:
+    typedef std::shared_ptr<ByteArray> ptr;
+
+    // 内存块
+    struct Node {
+        Node(size_t s);
+        Node();
+        ~Node();
+
+        char* ptr;          // 内存块地址
+        Node* next;         // 下一个内存块
+        size_t size;        // 内存块大小
+    };
+
+    /**
+     * @brief 构造函数
+     * @param[in] base_size 每个内存块的大小
+     */
+    ByteArray(size_t base_size = 4096);
+    ~ByteArray();
+
+    // 定长写入，Fint 按 m_endian 指定的字节序写入
+    void writeFint8(int8_t value);
+    void writeFuint8(uint8_t value);
+    void writeFint16(int16_t value);
+    void writeFuint16(uint16_t value);
+    void writeFint32(int32_t value);
+    void writeFuint32(uint32_t value);
+    void writeFint64(int64_t value);
+    void writeFuint64(uint64_t value);
+
+    // 变长写入：有符号数先做 zigzag 编码，再按 varint 每字节7位写入
+    void writeInt32(int32_t value);
+    void writeUint32(uint32_t value);
+    void writeInt64(int64_t value);
+    void writeUint64(uint64_t value);
+
+    void writeFloat(float value);
+    void writeDouble(double value);
+
+    // 字符串写入，长度前缀分别为 uint16_t / uint32_t / uint64_t / varint
+    void writeStringF16(const std::string& value);
+    void writeStringF32(const std::string& value);
+    void writeStringF64(const std::string& value);
+    void writeStringVint(const std::string& value);
+    void writeStringWithoutLength(const std::string& value);
+
+    // 读取，可读数据不足时抛出 std::out_of_range
+    int8_t readFint8();
+    uint8_t readFuint8();
+    int16_t readFint16();
+    uint16_t readFuint16();
+    int32_t readFint32();
+    uint32_t readFuint32();
+    int64_t readFint64();
+    uint64_t readFuint64();
+
+    int32_t readInt32();
+    uint32_t readUint32();
+    int64_t readInt64();
+    uint64_t readUint64();
+
+    float readFloat();
+    double readDouble();
+
+    std::string readStringF16();
+    std::string readStringF32();
+    std::string readStringF64();
+    std::string readStringVint();
+
+    // 清空数据，只保留第一个内存块
+    void clear();
+
+    // 在当前位置写入 size 字节，position 后移
+    void write(const void* buf, size_t size);
+    // 从当前位置读取 size 字节，position 后移
+    void read(void* buf, size_t size);
+    // 从指定位置读取 size 字节，不改变 position
+    void read(void* buf, size_t size, size_t position) const;
+
+    size_t getPosition() const { return m_position; }
+    // 设置当前位置，超过总容量时抛出 std::out_of_range
+    void setPosition(size_t v);
+
+    // 将可读数据写入文件 / 从文件读取全部内容追加写入
+    bool writeToFile(const std::string& name) const;
+    bool readFromFile(const std::string& name);
+
+    size_t getBaseSize() const { return m_baseSize; }
+    // 当前位置到数据末尾的可读字节数
+    size_t getReadSize() const { return m_size - m_position; }
+    // 数据总长度
+    size_t getSize() const { return m_size; }
+
+    bool isLittleEndian() const;
+    void setIsLittleEndian(bool val);
+
+    // 可读数据转为字符串 / 十六进制字符串，不改变 position
+    std::string toString() const;
+    std::string toHexString() const;
+
+    /**
+     * @brief 获取从当前位置开始最多 len 字节可读数据的 iovec 数组，用于 writev
+     * @return 实际导出的字节数
+     */
+    uint64_t getReadBuffers(std::vector<iovec>& buffers, uint64_t len = ~0ull) const;
+    // 从指定位置开始导出可读数据
+    uint64_t getReadBuffers(std::vector<iovec>& buffers, uint64_t len, uint64_t position) const;
+
+    /**
+     * @brief 获取从当前位置开始 len 字节可写空间的 iovec 数组，用于 readv
+     * @details 容量不足时先扩容；数据写入后需调用 setPosition 前移位置
+     * @return len
+     */
+    uint64_t getWriteBuffers(std::vector<iovec>& buffers, uint64_t len);
+private:
+    // 保证至少还有 size 字节可写容量
+    void addCapacity(size_t size);
+    size_t getCapacity() const { return m_capacity - m_position; }
+
+    template<class T>
+    void writeFixed(T value);
+    template<class T>
+    T readFixed();
+    template<class T>
+    bool readVarintFast(T& result);
+private:
+    size_t m_baseSize;          // 内存块大小
+    size_t m_position;          // 当前读写位置
+    size_t m_capacity;          // 总容量
+    size_t m_size;              // 数据长度
+    int8_t m_endian;            // 字节序，默认大端(网络字节序)
+    Node* m_root;               // 第一个内存块
+    Node* m_cur;                // position 所在的内存块
+    Node* m_tail;               // 最后一个内存块
+};
+
+}
+
+#endif
@@ -0,0 +1,232 @@
+#include "clock.h"
+#include <pthread.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include "mutex.h"
+
+namespace myserver {
+
+namespace detail {
+
+std::atomic<uint64_t> g_clock_coarse_ms(0);
+std::atomic<uint64_t> g_clock_coarse_wall_ms(0);
+std::atomic<uint64_t> g_clock_start_ms(0);
+std::atomic<int> g_clock_use_tsc(-1);
+
+}
+
+namespace {
+
+// TSC 换算参数：ns = ns0 + (ticks - ts0) * nsPerTick
+struct TscCalibration {
+    uint64_t ts0;
+    uint64_t ns0;
+    double nsPerTick;
+};
+
+uint64_t ConvertTicks(const TscCalibration& c, uint64_t ticks) {
+    return c.ns0 + (int64_t)((double)(int64_t)(ticks - c.ts0) * c.nsPerTick);
+}
+
+uint64_t ReadClockNs(clockid_t id) {
+    struct timespec ts;
+    clock_gettime(id, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+bool DetectStableTsc() {
+#if defined(__x86_64__) || defined(__i386__)
+    std::ifstream ifs("/proc/cpuinfo");
+    std::string line;
+    while(std::getline(ifs, line)) {
+        if(line.compare(0, 5, "flags") == 0) {
+            line.push_back(' ');
+            return line.find(" constant_tsc ") != std::string::npos
+                && line.find(" nonstop_tsc ") != std::string::npos;
+        }
+    }
+#endif
+    return false;
+}
+
+// 校准只在 TSC 稳定时进行，直接读 TSC
+uint64_t ReadTsc() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return ReadClockNs(CLOCK_MONOTONIC);
+#endif
+}
+
+// 同时读取 TSC 与 CLOCK_MONOTONIC：取若干次中两次 TSC 读数间隔最短的一次，减小被打断带来的误差
+void SamplePair(uint64_t& ts, uint64_t& ns) {
+    uint64_t best = (uint64_t)-1;
+    for(int i = 0; i < 5; ++i) {
+        uint64_t t0 = ReadTsc();
+        uint64_t n = ReadClockNs(CLOCK_MONOTONIC);
+        uint64_t t1 = ReadTsc();
+        if(t1 - t0 < best) {
+            best = t1 - t0;
+            ts = t0 + (t1 - t0) / 2;
+            ns = n;
+        }
+    }
+}
+
+// 首次使用时以 1ms 的区间粗略校准，之后由 clock_ticker 以更长的区间修正
+SeqLock<TscCalibration>& GetCalibration() {
+    static SeqLock<TscCalibration>* s_calibration = []() {
+        TscCalibration c;
+        SamplePair(c.ts0, c.ns0);
+        uint64_t ts = 0;
+        uint64_t ns = 0;
+        while(ReadClockNs(CLOCK_MONOTONIC) - c.ns0 < 1000 * 1000) {
+        }
+        SamplePair(ts, ns);
+        c.nsPerTick = ts > c.ts0 ? (double)(ns - c.ns0) / (ts - c.ts0) : 1.0;
+        return new SeqLock<TscCalibration>(c);
+    }();
+    return *s_calibration;
+}
+
+// 频率按首次校准的采样点到现在的区间估计；换算锚点移到当前时刻按旧参数换算的值，
+// 只改变之后的斜率，NowNs 不会跳变或回退。与 CLOCK_MONOTONIC 的偏差在之后 1 秒内
+// 逐渐追平(调整量不超过 0.1%)
+void Recalibrate() {
+    SeqLock<TscCalibration>& calibration = GetCalibration();
+    TscCalibration c = calibration.load();
+    static const TscCalibration s_base = c;
+    uint64_t ts = 0;
+    uint64_t ns = 0;
+    SamplePair(ts, ns);
+    if(ts > s_base.ts0 && ns > s_base.ns0) {
+        uint64_t now = ConvertTicks(c, ts);
+        double slew = (double)(int64_t)(ns - now) / 1e9;
+        slew = std::max(-1e-3, std::min(1e-3, slew));
+        c.nsPerTick = (double)(ns - s_base.ns0) / (ts - s_base.ts0) * (1.0 + slew);
+        c.ts0 = ts;
+        c.ns0 = now;
+        calibration.store(c);
+    }
+}
+
+void UpdateCoarse() {
+    uint64_t ms = ReadClockNs(CLOCK_MONOTONIC) / 1000000;
+    uint64_t start = 0;
+    detail::g_clock_start_ms.compare_exchange_strong(start, ms, std::memory_order_relaxed);
+    detail::g_clock_coarse_ms.store(ms, std::memory_order_relaxed);
+    detail::g_clock_coarse_wall_ms.store(ReadClockNs(CLOCK_REALTIME) / 1000000, std::memory_order_relaxed);
+}
+
+std::atomic<bool> s_ticker_started(false);
+
+// 不使用 myserver::Thread：日志宏在静态初始化期间就可能调用到这里
+void* TickerMain(void* arg) {
+    pthread_setname_np(pthread_self(), "clock_ticker");
+    struct timespec interval = {0, 1000 * 1000};
+    for(uint64_t n = 1; ; ++n) {
+        nanosleep(&interval, nullptr);
+        UpdateCoarse();
+        // 校准区间越长越精确：10ms、100ms 后各修正一次，之后每秒一次
+        if((n == 10 || n == 100 || n % 1000 == 0) && Clock::IsTscStable()) {
+            Recalibrate();
+        }
+    }
+    return nullptr;
+}
+
+// fork 出的子进程中没有 clock_ticker，清零后由下一次读取重新启动
+void OnForkChild() {
+    s_ticker_started.store(false, std::memory_order_relaxed);
+    detail::g_clock_coarse_ms.store(0, std::memory_order_relaxed);
+    detail::g_clock_coarse_wall_ms.store(0, std::memory_order_relaxed);
+}
+
+struct ClockIniter {
+    ClockIniter() {
+        // 尽早记录进程启动时间
+        UpdateCoarse();
+        detail::g_clock_coarse_ms.store(0, std::memory_order_relaxed);
+        detail::g_clock_coarse_wall_ms.store(0, std::memory_order_relaxed);
+        pthread_atfork(nullptr, nullptr, &OnForkChild);
+    }
+};
+
+ClockIniter __clock_init;
+
+}
+
+namespace detail {
+
+uint64_t ClockStartTicker(bool wall) {
+    bool expected = false;
+    if(s_ticker_started.compare_exchange_strong(expected, true)) {
+        UpdateCoarse();
+        pthread_t thread;
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        if(pthread_create(&thread, &attr, &TickerMain, nullptr)) {
+            s_ticker_started.store(false);
+        }
+        pthread_attr_destroy(&attr);
+    }
+    uint64_t ms = ReadClockNs(wall ? CLOCK_REALTIME : CLOCK_MONOTONIC) / 1000000;
+    if(!wall) {
+        uint64_t start = 0;
+        g_clock_start_ms.compare_exchange_strong(start, ms, std::memory_order_relaxed);
+    }
+    return ms;
+}
+
+int ClockDetectTsc() {
+    static int s_use_tsc = DetectStableTsc() ? 1 : 0;
+    g_clock_use_tsc.store(s_use_tsc, std::memory_order_relaxed);
+    return s_use_tsc;
+}
+
+}
+
+// TSC 不稳定时 Ticks() 本身就是单调时钟纳秒，无需换算
+uint64_t Clock::TicksToNs(uint64_t ticks) {
+    if(!IsTscStable()) {
+        return ticks;
+    }
+    return ConvertTicks(GetCalibration().load(), ticks);
+}
+
+uint64_t Clock::TicksToDuration(uint64_t ticks) {
+    if(!IsTscStable()) {
+        return ticks;
+    }
+    return (uint64_t)((double)ticks * GetCalibration().load().nsPerTick);
+}
+
+uint64_t Clock::DurationToTicks(uint64_t ns) {
+    if(!IsTscStable()) {
+        return ns;
+    }
+    return (uint64_t)((double)ns / GetCalibration().load().nsPerTick);
+}
+
+uint64_t Clock::NowNs() {
+    if(!IsTscStable()) {
+        return ReadClockNs(CLOCK_MONOTONIC);
+    }
+    // 先取校准参数：首次调用时校准耗时约 1ms，不能先读 TSC
+    TscCalibration c = GetCalibration().load();
+    return ConvertTicks(c, Ticks());
+}
+
+uint64_t Clock::WallMs() {
+    return ReadClockNs(CLOCK_REALTIME) / 1000000;
+}
+
+bool Clock::IsTscStable() {
+    int use_tsc = detail::g_clock_use_tsc.load(std::memory_order_relaxed);
+    return (use_tsc < 0 ? detail::ClockDetectTsc() : use_tsc) == 1;
+}
+
+}
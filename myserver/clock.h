@@ -0,0 +1,91 @@
+#ifndef __MYSERVER_CLOCK_H__
+#define __MYSERVER_CLOCK_H__
+
+#include <stdint.h>
+#include <time.h>
+#include <atomic>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace myserver {
+
+namespace detail {
+
+// 由 clock_ticker 线程每毫秒更新，0 表示线程尚未启动
+extern std::atomic<uint64_t> g_clock_coarse_ms;
+extern std::atomic<uint64_t> g_clock_coarse_wall_ms;
+extern std::atomic<uint64_t> g_clock_start_ms;
+
+// 启动 clock_ticker 线程，返回当前精确值
+uint64_t ClockStartTicker(bool wall);
+
+// Ticks() 的时间源：1 为 TSC，0 为 CLOCK_MONOTONIC，-1 表示尚未检测
+extern std::atomic<int> g_clock_use_tsc;
+// 检测 TSC 是否可用并写入 g_clock_use_tsc
+int ClockDetectTsc();
+
+}
+
+/**
+ * @brief 时钟
+ * @details 三类时间源：
+ *          1. 精确单调时钟：x86 上读取 TSC，按 CLOCK_MONOTONIC 校准换算为纳秒
+ *             (首次使用时校准，之后 clock_ticker 每秒修正一次)，用于测量耗时；
+ *             TSC 频率不恒定或休眠时停止(IsTscStable 为 false)时改用 CLOCK_MONOTONIC；
+ *          2. 粗粒度时钟：clock_ticker 线程每毫秒更新一次的单调/墙上毫秒数，
+ *             读取只是一次原子 load，用于日志时间戳与超时判断；
+ *          3. 进程启动至今的毫秒数，同样由 clock_ticker 更新
+ */
+class Clock {
+public:
+    // 原始计数：TSC 稳定的 x86 上为 TSC，否则为单调时钟纳秒
+    static uint64_t Ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+        int use_tsc = detail::g_clock_use_tsc.load(std::memory_order_relaxed);
+        if(use_tsc < 0) {
+            use_tsc = detail::ClockDetectTsc();
+        }
+        if(use_tsc) {
+            return __rdtsc();
+        }
+#endif
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+    // 把 Ticks() 的返回值换算为单调时钟纳秒
+    static uint64_t TicksToNs(uint64_t ticks);
+    // 两次 Ticks() 之差与纳秒时长互相换算
+    static uint64_t TicksToDuration(uint64_t ticks);
+    static uint64_t DurationToTicks(uint64_t ns);
+
+    // 精确单调时钟
+    static uint64_t NowNs();
+    static uint64_t NowUs() { return NowNs() / 1000; }
+    static uint64_t NowMs() { return NowNs() / 1000000; }
+    // 精确墙上时间(毫秒)
+    static uint64_t WallMs();
+
+    // 粗粒度单调时钟(毫秒)，误差约 1ms
+    static uint64_t CoarseMs() {
+        uint64_t ms = detail::g_clock_coarse_ms.load(std::memory_order_relaxed);
+        return ms ? ms : detail::ClockStartTicker(false);
+    }
+    // 粗粒度墙上时间(毫秒)，误差约 1ms
+    static uint64_t CoarseWallMs() {
+        uint64_t ms = detail::g_clock_coarse_wall_ms.load(std::memory_order_relaxed);
+        return ms ? ms : detail::ClockStartTicker(true);
+    }
+    // 进程启动至今的毫秒数
+    static uint64_t ElapsedMs() {
+        return CoarseMs() - detail::g_clock_start_ms.load(std::memory_order_relaxed);
+    }
+
+    // TSC 是否恒定频率且不随 CPU 休眠停止，否则 Ticks 与 NowNs 退化为 clock_gettime
+    static bool IsTscStable();
+};
+
+}
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef __MYSERVER_ENDIANNESS_H__
+#define __MYSERVER_ENDIANNESS_H__
+
+#define MYSERVER_LITTLE_ENDIAN 1
+#define MYSERVER_BIG_ENDIAN 2
+
+#include <byteswap.h>
+#include <endian.h>
+#include <stdint.h>
+#include <type_traits>
+
+namespace myserver {
+
+// 整数类型字节序转换(浮点数需先按位拷贝到同宽度整数)
+
+// 8字节类型的字节序转换
+template<class T>
+typename std::enable_if<sizeof(T) == sizeof(uint64_t), T>::type
+byteswap(T value) {
+    return (T)bswap_64((uint64_t)value);
+}
+
+// 4字节类型的字节序转换
+template<class T>
+typename std::enable_if<sizeof(T) == sizeof(uint32_t), T>::type
+byteswap(T value) {
+    return (T)bswap_32((uint32_t)value);
+}
+
+// 2字节类型的字节序转换
+template<class T>
+typename std::enable_if<sizeof(T) == sizeof(uint16_t), T>::type
+byteswap(T value) {
+    return (T)bswap_16((uint16_t)value);
+}
+
+// 1字节类型无需转换
+template<class T>
+typename std::enable_if<sizeof(T) == sizeof(uint8_t), T>::type
+byteswap(T value) {
+    return value;
+}
+
+#if BYTE_ORDER == BIG_ENDIAN
+#define MYSERVER_BYTE_ORDER MYSERVER_BIG_ENDIAN
+#else
+#define MYSERVER_BYTE_ORDER MYSERVER_LITTLE_ENDIAN
+#endif
+
+#if MYSERVER_BYTE_ORDER == MYSERVER_BIG_ENDIAN
+
+// 只在小端机器上执行byteswap, 在大端机器上什么都不做
+template<class T>
+T byteswapOnLittleEndian(T t) {
+    return t;
+}
+
+// 只在大端机器上执行byteswap, 在小端机器上什么都不做
+template<class T>
+T byteswapOnBigEndian(T t) {
+    return byteswap(t);
+}
+
+#else
+
+template<class T>
+T byteswapOnLittleEndian(T t) {
+    return byteswap(t);
+}
+
+template<class T>
+T byteswapOnBigEndian(T t) {
+    return t;
+}
+
+#endif
+
+}
+
+#endif
@@ -0,0 +1,293 @@
+#include "fatal_signal.h"
+#include <dlfcn.h>
+#include <errno.h>
+#include <execinfo.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+
+namespace myserver {
+
+static const int MAX_FLUSHABLES = 32;
+static const int MAX_FRAMES = 64;
+static const size_t REPORT_SIZE = 16 * 1024;
+static const size_t ALTSTACK_SIZE = 64 * 1024;
+
+static const int s_signals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+
+// 静态存储零初始化，信号处理函数中无需任何构造
+static std::atomic<CrashFlushable*> s_flushables[MAX_FLUSHABLES];
+static std::atomic<bool> s_installed(false);
+static std::atomic<bool> s_handling(false);
+static char s_report[REPORT_SIZE];
+static char s_altstack[ALTSTACK_SIZE];
+
+/**
+ * @brief 信号处理函数中使用的定长缓冲格式化，不分配内存，超出部分截断
+ */
+class ReportWriter {
+public:
+    ReportWriter(char* buf, size_t size)
+        :m_buf(buf)
+        ,m_size(size) {
+    }
+
+    void append(const char* str) {
+        if(!str) {
+            str = "?";
+        }
+        while(*str && m_len < m_size) {
+            m_buf[m_len++] = *str++;
+        }
+    }
+
+    void appendDec(uint64_t v) {
+        char tmp[24];
+        int n = 0;
+        do {
+            tmp[n++] = '0' + v % 10;
+            v /= 10;
+        } while(v);
+        while(n && m_len < m_size) {
+            m_buf[m_len++] = tmp[--n];
+        }
+    }
+
+    void appendHex(uint64_t v) {
+        char tmp[24];
+        int n = 0;
+        do {
+            tmp[n++] = "0123456789abcdef"[v & 0xf];
+            v >>= 4;
+        } while(v);
+        append("0x");
+        while(n && m_len < m_size) {
+            m_buf[m_len++] = tmp[--n];
+        }
+    }
+
+    size_t size() const { return m_len; }
+private:
+    char* m_buf;
+    size_t m_size;
+    size_t m_len = 0;
+};
+
+static void WriteAll(int fd, const char* data, size_t len) {
+    while(len > 0) {
+        ssize_t rt = write(fd, data, len);
+        if(rt < 0 && errno == EINTR) {
+            continue;
+        }
+        if(rt <= 0) {
+            return;
+        }
+        data += rt;
+        len -= rt;
+    }
+}
+
+static const char* SignalName(int sig) {
+    switch(sig) {
+        case SIGSEGV: return "SIGSEGV";
+        case SIGBUS: return "SIGBUS";
+        case SIGFPE: return "SIGFPE";
+        case SIGILL: return "SIGILL";
+        case SIGABRT: return "SIGABRT";
+        default: return "UNKNOWN";
+    }
+}
+
+/**
+ * @brief 生成崩溃报告
+ * @details 线程名称通过 prctl(PR_GET_NAME) 读取(myserver::Thread 启动时已设置)，
+ *          不访问 thread_local 的 ThreadContext，避免在信号处理函数中触发其初始化。
+ *          调用栈由 backtrace 回溯，dladdr 查找符号(依赖 -rdynamic)，名称保持 mangled 形式，
+ *          __cxa_demangle 会分配内存，不能在这里使用
+ */
+static size_t BuildReport(int sig, siginfo_t* info) {
+    ReportWriter w(s_report, sizeof(s_report));
+    char name[17] = {0};
+    if(prctl(PR_GET_NAME, name, 0, 0, 0)) {
+        name[0] = '\0';
+    }
+
+    w.append("*** fatal signal ");
+    w.append(SignalName(sig));
+    w.append(" (");
+    w.appendDec(sig);
+    w.append(")");
+    if(sig != SIGABRT && info) {
+        w.append(" addr=");
+        w.appendHex((uintptr_t)info->si_addr);
+    }
+    w.append(" pid=");
+    w.appendDec(getpid());
+    w.append(" tid=");
+    w.appendDec(syscall(SYS_gettid));
+    w.append(" thread=");
+    w.append(name);
+    w.append(" ***\n");
+
+    void* frames[MAX_FRAMES];
+    int n = backtrace(frames, MAX_FRAMES);
+    for(int i = 0; i < n; ++i) {
+        w.append("    #");
+        w.appendDec(i);
+        w.append(" ");
+        w.appendHex((uintptr_t)frames[i]);
+        Dl_info dl;
+        if(dladdr(frames[i], &dl)) {
+            w.append(" ");
+            w.append(dl.dli_fname);
+            if(dl.dli_sname) {
+                w.append("(");
+                w.append(dl.dli_sname);
+                w.append("+");
+                w.appendHex((uintptr_t)frames[i] - (uintptr_t)dl.dli_saddr);
+                w.append(")");
+            }
+            // 模块内偏移，未导出的符号可用 addr2line -e 模块 偏移 查找
+            w.append(" [+");
+            w.appendHex((uintptr_t)frames[i] - (uintptr_t)dl.dli_fbase);
+            w.append("]");
+        }
+        w.append("\n");
+    }
+    return w.size();
+}
+
+/**
+ * @brief 写出 stdout 的 stdio 缓冲
+ * @details fflush 不是异步信号安全的，这里直接读取 glibc FILE 的写缓冲区间交给 write，
+ *          并清空区间避免重复输出；非 glibc 平台跳过
+ */
+static void FlushStdout() {
+#ifdef __GLIBC__
+    char* base = stdout->_IO_write_base;
+    char* ptr = stdout->_IO_write_ptr;
+    if(base && ptr > base) {
+        WriteAll(STDOUT_FILENO, base, ptr - base);
+        stdout->_IO_write_ptr = base;
+    }
+#endif
+}
+
+static void FatalSignalAction(int sig, siginfo_t* info, void* ucontext) {
+    int saved_errno = errno;
+    if(s_handling.exchange(true)) {
+        // 其他线程正在写报告，等待其结束进程，超时后按默认处理退出
+        struct timespec ts = {1, 0};
+        nanosleep(&ts, nullptr);
+    } else {
+        size_t len = BuildReport(sig, info);
+        FlushStdout();
+        for(int i = 0; i < MAX_FLUSHABLES; ++i) {
+            CrashFlushable* f = s_flushables[i].load(std::memory_order_acquire);
+            if(f) {
+                f->crashFlush(s_report, len);
+            }
+        }
+        WriteAll(STDERR_FILENO, s_report, len);
+    }
+
+    // 恢复默认处理后重新触发；处理函数返回前该信号被屏蔽，返回后立即以默认方式终止
+    signal(sig, SIG_DFL);
+    raise(sig);
+    errno = saved_errno;
+}
+
+void* FatalSignalHandler::InstallThreadStack() {
+    stack_t old_ss;
+    if(sigaltstack(nullptr, &old_ss) || !(old_ss.ss_flags & SS_DISABLE)) {
+        return nullptr;
+    }
+    void* stack = mmap(nullptr, ALTSTACK_SIZE, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(stack == MAP_FAILED) {
+        return nullptr;
+    }
+    stack_t ss;
+    memset(&ss, 0, sizeof(ss));
+    ss.ss_sp = stack;
+    ss.ss_size = ALTSTACK_SIZE;
+    if(sigaltstack(&ss, nullptr)) {
+        munmap(stack, ALTSTACK_SIZE);
+        return nullptr;
+    }
+    return stack;
+}
+
+void FatalSignalHandler::RemoveThreadStack(void* stack) {
+    if(!stack) {
+        return;
+    }
+    stack_t ss;
+    memset(&ss, 0, sizeof(ss));
+    ss.ss_flags = SS_DISABLE;
+    sigaltstack(&ss, nullptr);
+    munmap(stack, ALTSTACK_SIZE);
+}
+
+void FatalSignalHandler::Install() {
+    if(s_installed.exchange(true)) {
+        return;
+    }
+    // backtrace 首次调用会加载 libgcc_s(分配内存)，提前调用一次
+    void* warm[1];
+    backtrace(warm, 1);
+
+    // 为当前线程(通常是主线程)设置备用信号栈，其他线程见 InstallThreadStack
+    stack_t old_ss;
+    if(sigaltstack(nullptr, &old_ss) == 0 && (old_ss.ss_flags & SS_DISABLE)) {
+        stack_t ss;
+        memset(&ss, 0, sizeof(ss));
+        ss.ss_sp = s_altstack;
+        ss.ss_size = sizeof(s_altstack);
+        sigaltstack(&ss, nullptr);
+    }
+
+    for(int sig : s_signals) {
+        struct sigaction old_sa;
+        if(sigaction(sig, nullptr, &old_sa)) {
+            continue;
+        }
+        if((old_sa.sa_flags & SA_SIGINFO) || old_sa.sa_handler != SIG_DFL) {
+            continue;
+        }
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sigemptyset(&sa.sa_mask);
+        sa.sa_sigaction = &FatalSignalAction;
+        sa.sa_flags = SA_SIGINFO | SA_ONSTACK;
+        sigaction(sig, &sa, nullptr);
+    }
+}
+
+bool FatalSignalHandler::AddFlushable(CrashFlushable* flushable) {
+    for(int i = 0; i < MAX_FLUSHABLES; ++i) {
+        CrashFlushable* expected = nullptr;
+        if(s_flushables[i].compare_exchange_strong(expected, flushable)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void FatalSignalHandler::RemoveFlushable(CrashFlushable* flushable) {
+    for(int i = 0; i < MAX_FLUSHABLES; ++i) {
+        CrashFlushable* expected = flushable;
+        if(s_flushables[i].compare_exchange_strong(expected, nullptr)) {
+            return;
+        }
+    }
+}
+
+}
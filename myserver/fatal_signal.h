@@ -0,0 +1,49 @@
+#ifndef __MYSERVER_FATAL_SIGNAL_H__
+#define __MYSERVER_FATAL_SIGNAL_H__
+
+#include <stddef.h>
+
+namespace myserver {
+
+/**
+ * @brief 崩溃时需要写出缓冲的日志输出
+ * @details crashFlush 在致命信号处理函数中调用，实现只能使用异步信号安全的调用(write 等)，
+ *          不能加锁、分配内存或使用 iostream；缓冲可能处于写入一半的状态，尽力写出即可
+ */
+class CrashFlushable {
+public:
+    virtual ~CrashFlushable() { }
+    /**
+     * @brief 写出尚未落盘的缓冲，再把崩溃报告追加到同一输出
+     * @param[in] report 崩溃报告(信号、线程名称、调用栈)
+     */
+    virtual void crashFlush(const char* report, size_t len) = 0;
+};
+
+/**
+ * @brief 致命信号处理
+ * @details 捕获 SIGSEGV/SIGBUS/SIGFPE/SIGILL/SIGABRT：生成包含信号、线程名称与符号化调用栈的报告，
+ *          写出 stdout 的 stdio 缓冲与各 CrashFlushable 的缓冲并追加报告，报告同时写到 stderr，
+ *          最后恢复默认处理并重新触发信号(保留 core dump 与退出状态)。
+ *          由 LoggerManager 构造时安装，已被使用者设置处理函数的信号不会被覆盖；
+ *          正常路径上没有任何开销
+ */
+class FatalSignalHandler {
+public:
+    static void Install();
+    /**
+     * @brief 为当前线程设置备用信号栈，栈溢出时仍能执行处理函数
+     * @details 备用信号栈是线程级的，Install 只设置调用线程；myserver::Thread 启动时自动调用。
+     *          已设置时不变并返回 nullptr
+     * @return 分配的栈，线程退出前交给 RemoveThreadStack 释放
+     */
+    static void* InstallThreadStack();
+    static void RemoveThreadStack(void* stack);
+    // 登记/注销需要在崩溃时写出的输出，最多 32 个
+    static bool AddFlushable(CrashFlushable* flushable);
+    static void RemoveFlushable(CrashFlushable* flushable);
+};
+
+}
+
+#endif
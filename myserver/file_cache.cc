@@ -0,0 +1,249 @@
+#include "file_cache.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include "config.h"
+#include "log.h"
+
+namespace myserver {
+
+static myserver::ConfigVar<uint32_t>::ptr g_file_cache_capacity =
+    myserver::Config::Lookup("file_cache.capacity", (uint32_t)1024,
+            "max cached open files");
+
+static myserver::Logger::ptr g_logger = LOGGER_NAME("system");
+
+// 修改、截断(IN_MODIFY)、属性与链接数变化(IN_ATTRIB)、删除、移走时失效
+static const uint32_t WATCH_MASK = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE
+                                 | IN_DELETE_SELF | IN_MOVE_SELF;
+
+CachedFile::~CachedFile() {
+    if(fd >= 0) {
+        ::close(fd);
+    }
+}
+
+FileCache::FileCache(size_t capacity)
+    :m_capacity(capacity ? capacity : g_file_cache_capacity->getValue())
+    ,m_eventSeq(0)
+    ,m_clearSeq(0)
+    ,m_pending(0)
+    ,m_inotifyFd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+    ,m_wakeFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+    ,m_hits(0)
+    ,m_misses(0)
+    ,m_invalidations(0)
+    ,m_evictions(0) {
+    if(m_inotifyFd < 0) {
+        // 没有 inotify 时仍可缓存，但文件变化不会被感知
+        LOG_ERROR(g_logger) << "inotify_init1 fail errno=" << errno
+            << " errstr=" << strerror(errno);
+    } else {
+        m_thread.reset(new Thread(std::bind(&FileCache::run, this), "file_cache"));
+    }
+}
+
+FileCache::~FileCache() {
+    if(m_thread) {
+        uint64_t one = 1;
+        if(write(m_wakeFd, &one, sizeof(one)) != sizeof(one)) {
+            LOG_ERROR(g_logger) << "FileCache wake fail errno=" << errno;
+        }
+        m_thread->join();
+    }
+    clear();
+    if(m_inotifyFd >= 0) {
+        ::close(m_inotifyFd);
+    }
+    if(m_wakeFd >= 0) {
+        ::close(m_wakeFd);
+    }
+}
+
+CachedFile::ptr FileCache::open(const std::string& path, int* err) {
+    uint64_t seq;
+    {
+        MutexType::Lock lock(m_mutex);
+        auto it = m_items.find(path);
+        if(it != m_items.end()) {
+            m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+            m_hits.fetch_add(1, std::memory_order_relaxed);
+            return it->second.file;
+        }
+        m_misses.fetch_add(1, std::memory_order_relaxed);
+        ++m_pending;
+        seq = m_eventSeq;
+    }
+
+    // 先注册监视再打开：之后到达的事件序号都大于 seq，插入前据此判断打开的内容是否可能已过期
+    int wd = m_inotifyFd >= 0 ? inotify_add_watch(m_inotifyFd, path.c_str(), WATCH_MASK) : -1;
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    int e = 0;
+    if(fd < 0) {
+        e = errno;
+    } else if(fstat(fd, &st) != 0) {
+        e = errno;
+    } else if(!S_ISREG(st.st_mode)) {
+        e = EISDIR;
+    }
+
+    MutexType::Lock lock(m_mutex);
+    bool stale = m_clearSeq > seq;
+    if(wd >= 0) {
+        auto eit = m_wdEvents.find(wd);
+        stale = stale || (eit != m_wdEvents.end() && eit->second > seq);
+    }
+    if(--m_pending == 0) {
+        m_wdEvents.clear();
+    }
+    if(e) {
+        if(fd >= 0) {
+            ::close(fd);
+        }
+        // wd 可能与已缓存的硬链接共享
+        if(wd >= 0 && m_watches.find(wd) == m_watches.end()) {
+            inotify_rm_watch(m_inotifyFd, wd);
+        }
+        if(err) {
+            *err = e;
+        }
+        return nullptr;
+    }
+
+    CachedFile::ptr file(new CachedFile(path, fd, st));
+    auto it = m_items.find(path);
+    if(wd < 0 || stale || it != m_items.end()) {
+        // 无法监视或可能已过期的文件不缓存；路径已被其它线程并发缓存时保留已有条目
+        if(wd >= 0 && m_watches.find(wd) == m_watches.end()) {
+            inotify_rm_watch(m_inotifyFd, wd);
+        }
+        return file;
+    }
+    while(m_items.size() >= m_capacity && !m_lru.empty()) {
+        eraseLocked(m_items.find(m_lru.back()));
+        m_evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+    m_lru.push_front(path);
+    Item& item = m_items[path];
+    item.file = file;
+    item.wd = wd;
+    item.lru = m_lru.begin();
+    m_watches[wd].push_back(path);
+    return file;
+}
+
+void FileCache::eraseLocked(std::unordered_map<std::string, Item>::iterator it) {
+    if(it == m_items.end()) {
+        return;
+    }
+    int wd = it->second.wd;
+    if(wd >= 0) {
+        auto wit = m_watches.find(wd);
+        if(wit != m_watches.end()) {
+            auto& paths = wit->second;
+            for(auto p = paths.begin(); p != paths.end(); ++p) {
+                if(*p == it->first) {
+                    paths.erase(p);
+                    break;
+                }
+            }
+            if(paths.empty()) {
+                m_watches.erase(wit);
+                inotify_rm_watch(m_inotifyFd, wd);
+            }
+        }
+    }
+    m_lru.erase(it->second.lru);
+    m_items.erase(it);
+}
+
+void FileCache::invalidate(const std::string& path) {
+    MutexType::Lock lock(m_mutex);
+    m_clearSeq = ++m_eventSeq;
+    eraseLocked(m_items.find(path));
+}
+
+void FileCache::clear() {
+    MutexType::Lock lock(m_mutex);
+    m_clearSeq = ++m_eventSeq;
+    clearLocked();
+}
+
+void FileCache::clearLocked() {
+    while(!m_items.empty()) {
+        eraseLocked(m_items.begin());
+    }
+}
+
+FileCacheStats FileCache::getStats() {
+    FileCacheStats stats;
+    stats.hits = m_hits.load(std::memory_order_relaxed);
+    stats.misses = m_misses.load(std::memory_order_relaxed);
+    stats.invalidations = m_invalidations.load(std::memory_order_relaxed);
+    stats.evictions = m_evictions.load(std::memory_order_relaxed);
+    MutexType::Lock lock(m_mutex);
+    stats.size = m_items.size();
+    return stats;
+}
+
+void FileCache::run() {
+    pollfd fds[2];
+    fds[0].fd = m_inotifyFd;
+    fds[0].events = POLLIN;
+    fds[1].fd = m_wakeFd;
+    fds[1].events = POLLIN;
+    alignas(struct inotify_event) char buf[4096];
+    while(true) {
+        int rt = poll(fds, 2, -1);
+        if(rt < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            LOG_ERROR(g_logger) << "FileCache poll errno=" << errno << " errstr=" << strerror(errno);
+            break;
+        }
+        if(fds[1].revents) {
+            break;
+        }
+        ssize_t n;
+        while((n = read(m_inotifyFd, buf, sizeof(buf))) > 0) {
+            MutexType::Lock lock(m_mutex);
+            for(char* p = buf; p < buf + n;) {
+                const struct inotify_event* ev = (const struct inotify_event*)p;
+                p += sizeof(struct inotify_event) + ev->len;
+                if(ev->mask & IN_Q_OVERFLOW) {
+                    // 事件已丢失，无法判断哪些文件变化，整个缓存失效
+                    m_clearSeq = ++m_eventSeq;
+                    m_invalidations.fetch_add(m_items.size(), std::memory_order_relaxed);
+                    clearLocked();
+                    continue;
+                }
+                ++m_eventSeq;
+                if(m_pending) {
+                    m_wdEvents[ev->wd] = m_eventSeq;
+                }
+                auto wit = m_watches.find(ev->wd);
+                if(wit == m_watches.end()) {
+                    continue;
+                }
+                // 拷贝一份，eraseLocked 会修改 m_watches
+                std::vector<std::string> paths = wit->second;
+                if(ev->mask & IN_IGNORED) {
+                    // 监视已被内核移除，先摘掉映射，eraseLocked 不再对其 inotify_rm_watch
+                    m_watches.erase(wit);
+                }
+                for(auto& path : paths) {
+                    eraseLocked(m_items.find(path));
+                    m_invalidations.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        }
+    }
+}
+
+}
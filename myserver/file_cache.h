@@ -0,0 +1,110 @@
+#ifndef __MYSERVER_FILE_CACHE_H__
+#define __MYSERVER_FILE_CACHE_H__
+
+#include <sys/stat.h>
+#include <memory>
+#include <string>
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+#include "mutex.h"
+#include "thread.h"
+#include "noncopyable.h"
+
+namespace myserver {
+
+/**
+ * @brief 已打开的只读文件
+ * @details 由 FileCache 共享持有，最后一个引用释放时关闭fd；
+ *          被淘汰或失效的文件在仍被引用期间(如正在 sendfile)保持可用
+ */
+struct CachedFile : Noncopyable {
+    typedef std::shared_ptr<CachedFile> ptr;
+
+    CachedFile(const std::string& p, int f, const struct stat& s)
+        :path(p), fd(f), st(s) {}
+    ~CachedFile();
+
+    std::string path;
+    int fd;
+    struct stat st;
+};
+
+// 文件缓存统计信息
+struct FileCacheStats {
+    uint64_t hits = 0;              // 命中次数
+    uint64_t misses = 0;            // 未命中(需要 open + fstat)次数
+    uint64_t invalidations = 0;     // 因 inotify 事件失效的次数
+    uint64_t evictions = 0;         // LRU 淘汰次数
+    uint64_t size = 0;              // 当前缓存的文件数
+};
+
+/**
+ * @brief 打开的fd与 stat 结果的 LRU 缓存
+ * @details 命中时不再调用 open / stat，直接返回已打开的文件。
+ *          每个缓存的文件注册一个 inotify 监视，文件被修改、截断、删除或移走时
+ *          由后台线程立即将其移出缓存，下次访问重新打开；inotify 队列溢出(事件丢失)时清空整个缓存。
+ *          未命中时 inotify_add_watch / open / fstat 在锁外进行，不阻塞其它线程的命中；
+ *          期间该监视上若有事件或缓存被清空，打开的文件照常返回但不放入缓存。
+ *          容量默认取配置 file_cache.capacity，只缓存普通文件
+ */
+class FileCache : Noncopyable {
+public:
+    typedef std::shared_ptr<FileCache> ptr;
+    typedef Mutex MutexType;
+
+    /**
+     * @brief 构造函数
+     * @param[in] capacity 最多缓存的文件数，0 表示使用配置 file_cache.capacity
+     */
+    FileCache(size_t capacity = 0);
+    ~FileCache();
+
+    /**
+     * @brief 打开文件
+     * @param[out] err 失败时的 errno，非普通文件为 EISDIR
+     * @return 失败返回 nullptr
+     */
+    CachedFile::ptr open(const std::string& path, int* err = nullptr);
+
+    // 移除指定文件
+    void invalidate(const std::string& path);
+    void clear();
+
+    size_t getCapacity() const { return m_capacity; }
+    FileCacheStats getStats();
+private:
+    struct Item {
+        CachedFile::ptr file;
+        int wd;                     // inotify 监视描述符，-1 表示未监视
+        std::list<std::string>::iterator lru;
+    };
+
+    // 调用方持有锁
+    void eraseLocked(std::unordered_map<std::string, Item>::iterator it);
+    void clearLocked();
+    // inotify 事件处理线程
+    void run();
+private:
+    size_t m_capacity;
+    MutexType m_mutex;
+    std::unordered_map<std::string, Item> m_items;
+    std::list<std::string> m_lru;                   // 表头为最近使用
+    std::unordered_map<int, std::vector<std::string> > m_watches;  // wd -> 路径(硬链接可能共享同一监视)
+    uint64_t m_eventSeq;            // 事件序号，每个 inotify 事件及每次清空/移除加1
+    uint64_t m_clearSeq;            // 最近一次清空或移除时的 m_eventSeq
+    uint32_t m_pending;             // 正在锁外打开的未命中数
+    std::unordered_map<int, uint64_t> m_wdEvents;   // 有未命中在进行时记录 wd -> 最近事件序号
+    int m_inotifyFd;
+    int m_wakeFd;
+    Thread::ptr m_thread;
+    std::atomic<uint64_t> m_hits;
+    std::atomic<uint64_t> m_misses;
+    std::atomic<uint64_t> m_invalidations;
+    std::atomic<uint64_t> m_evictions;
+};
+
+}
+
+#endif
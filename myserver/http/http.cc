@@ -0,0 +1,293 @@
+#include "http.h"
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <sstream>
+#include "http_parser.h"
+#include "file_cache.h"
+
+namespace myserver {
+namespace http {
+
+HttpMethod StringToHttpMethod(const std::string& m) {
+    return CharsToHttpMethod(m.c_str(), m.size());
+}
+
+HttpMethod CharsToHttpMethod(const char* m, size_t len) {
+#define XX(num, name, string) \
+    if(len == sizeof(#string) - 1 && memcmp(#string, m, len) == 0) { \
+        return HttpMethod::name; \
+    }
+    HTTP_METHOD_MAP(XX);
+#undef XX
+    return HttpMethod::INVALID_METHOD;
+}
+
+static const char* s_method_string[] = {
+#define XX(num, name, string) #string,
+    HTTP_METHOD_MAP(XX)
+#undef XX
+};
+
+const char* HttpMethodToString(const HttpMethod& m) {
+    uint32_t idx = (uint32_t)m;
+    if(idx >= (sizeof(s_method_string) / sizeof(s_method_string[0]))) {
+        return "<unknown>";
+    }
+    return s_method_string[idx];
+}
+
+const char* HttpStatusToString(const HttpStatus& s) {
+    switch(s) {
+#define XX(code, name, msg) \
+        case HttpStatus::name: \
+            return #msg;
+        HTTP_STATUS_MAP(XX);
+#undef XX
+        default:
+            return "<unknown>";
+    }
+}
+
+template<class Headers>
+static typename Headers::const_iterator FindHeader(const Headers& headers, const std::string& key) {
+    for(auto it = headers.begin(); it != headers.end(); ++it) {
+        if(strcasecmp(it->first.c_str(), key.c_str()) == 0) {
+            return it;
+        }
+    }
+    return headers.end();
+}
+
+template<class Headers>
+static void SetHeader(Headers& headers, const std::string& key, const std::string& val) {
+    for(auto& i : headers) {
+        if(strcasecmp(i.first.c_str(), key.c_str()) == 0) {
+            i.second = val;
+            return;
+        }
+    }
+    headers.push_back(std::make_pair(key, val));
+}
+
+template<class Headers>
+static void DelHeader(Headers& headers, const std::string& key) {
+    for(auto it = headers.begin(); it != headers.end();) {
+        if(strcasecmp(it->first.c_str(), key.c_str()) == 0) {
+            it = headers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+static void AppendVersion(std::string& out, uint8_t version) {
+    out.append("HTTP/");
+    out.push_back('0' + (version >> 4));
+    out.push_back('.');
+    out.push_back('0' + (version & 0x0F));
+}
+
+HttpRequest::HttpRequest(uint8_t version, bool close)
+    :m_method(HttpMethod::GET)
+    ,m_version(version)
+    ,m_close(close)
+    ,m_path("/") {
+}
+
+void HttpRequest::init(const HttpParser& parser, const char* base) {
+    const HttpParser::Span& method = parser.getMethod();
+    m_method = CharsToHttpMethod(method.data(base), method.length);
+    m_version = parser.getVersion();
+    m_close = !parser.isKeepAlive();
+    m_path.assign(parser.getPath().data(base), parser.getPath().length);
+    m_query.assign(parser.getQuery().data(base), parser.getQuery().length);
+    m_fragment.assign(parser.getFragment().data(base), parser.getFragment().length);
+    m_body.assign(parser.getBody().data(base), parser.getBody().length);
+    m_headers.resize(parser.getHeaderCount());
+    for(size_t i = 0; i < m_headers.size(); ++i) {
+        const HttpParser::Header& h = parser.getHeader(i);
+        m_headers[i].first.assign(h.name.data(base), h.name.length);
+        m_headers[i].second.assign(h.value.data(base), h.value.length);
+    }
+}
+
+std::string HttpRequest::getHeader(const std::string& key, const std::string& def) const {
+    auto it = FindHeader(m_headers, key);
+    return it == m_headers.end() ? def : it->second;
+}
+
+bool HttpRequest::hasHeader(const std::string& key, std::string* val) const {
+    auto it = FindHeader(m_headers, key);
+    if(it == m_headers.end()) {
+        return false;
+    }
+    if(val) {
+        *val = it->second;
+    }
+    return true;
+}
+
+void HttpRequest::setHeader(const std::string& key, const std::string& val) {
+    SetHeader(m_headers, key, val);
+}
+
+void HttpRequest::delHeader(const std::string& key) {
+    DelHeader(m_headers, key);
+}
+
+std::ostream& HttpRequest::dump(std::ostream& os) const {
+    std::string line = HttpMethodToString(m_method);
+    line.push_back(' ');
+    line.append(m_path);
+    if(!m_query.empty()) {
+        line.append("?").append(m_query);
+    }
+    if(!m_fragment.empty()) {
+        line.append("#").append(m_fragment);
+    }
+    line.push_back(' ');
+    AppendVersion(line, m_version);
+    os << line << "\r\n";
+    if(m_version == 0x11 ? m_close : !m_close) {
+        os << "Connection: " << (m_close ? "close" : "keep-alive") << "\r\n";
+    }
+    for(auto& i : m_headers) {
+        if(strcasecmp(i.first.c_str(), "connection") == 0
+                || strcasecmp(i.first.c_str(), "content-length") == 0) {
+            continue;
+        }
+        os << i.first << ": " << i.second << "\r\n";
+    }
+    if(!m_body.empty()) {
+        os << "Content-Length: " << m_body.size() << "\r\n\r\n" << m_body;
+    } else {
+        os << "\r\n";
+    }
+    return os;
+}
+
+std::string HttpRequest::toString() const {
+    std::stringstream ss;
+    dump(ss);
+    return ss.str();
+}
+
+HttpResponse::HttpResponse(uint8_t version, bool close)
+    :m_status(HttpStatus::OK)
+    ,m_version(version)
+    ,m_close(close)
+    ,m_fileOffset(0)
+    ,m_fileLength(0) {
+}
+
+void HttpResponse::reset(uint8_t version, bool close) {
+    m_status = HttpStatus::OK;
+    m_version = version;
+    m_close = close;
+    m_body.clear();
+    m_reason.clear();
+    m_headers.clear();
+    m_file.reset();
+    m_fileOffset = m_fileLength = 0;
+}
+
+void HttpResponse::init(const HttpParser& parser, const char* base) {
+    reset(parser.getVersion(), !parser.isKeepAlive());
+    m_status = (HttpStatus)parser.getStatus();
+    m_reason.assign(parser.getReason().data(base), parser.getReason().length);
+    m_body.assign(parser.getBody().data(base), parser.getBody().length);
+    m_headers.resize(parser.getHeaderCount());
+    for(size_t i = 0; i < m_headers.size(); ++i) {
+        const HttpParser::Header& h = parser.getHeader(i);
+        m_headers[i].first.assign(h.name.data(base), h.name.length);
+        m_headers[i].second.assign(h.value.data(base), h.value.length);
+    }
+}
+
+std::string HttpResponse::getHeader(const std::string& key, const std::string& def) const {
+    auto it = FindHeader(m_headers, key);
+    return it == m_headers.end() ? def : it->second;
+}
+
+void HttpResponse::setHeader(const std::string& key, const std::string& val) {
+    SetHeader(m_headers, key, val);
+}
+
+void HttpResponse::delHeader(const std::string& key) {
+    DelHeader(m_headers, key);
+}
+
+void HttpResponse::setFile(std::shared_ptr<CachedFile> file, uint64_t offset, uint64_t length) {
+    m_file = file;
+    m_fileOffset = offset;
+    m_fileLength = length;
+}
+
+void HttpResponse::encodeHeader(std::string& out) const {
+    AppendVersion(out, m_version);
+    char buf[32];
+    int n = snprintf(buf, sizeof(buf), " %d ", (int)m_status);
+    out.append(buf, n);
+    out.append(m_reason.empty() ? HttpStatusToString(m_status) : m_reason.c_str());
+    out.append("\r\n");
+    for(auto& i : m_headers) {
+        if(strcasecmp(i.first.c_str(), "connection") == 0
+                || strcasecmp(i.first.c_str(), "content-length") == 0) {
+            continue;
+        }
+        out.append(i.first).append(": ").append(i.second).append("\r\n");
+    }
+    // HTTP/1.1 默认长连接，HTTP/1.0 默认短连接，只在与默认不同时输出
+    if(m_version == 0x11 ? m_close : !m_close) {
+        out.append(m_close ? "Connection: close\r\n" : "Connection: keep-alive\r\n");
+    }
+    int code = (int)m_status;
+    if(code < 200 || code == 204) {
+        out.append("\r\n");
+        return;
+    }
+    n = snprintf(buf, sizeof(buf), "Content-Length: %llu\r\n\r\n",
+                 (unsigned long long)getContentLength());
+    out.append(buf, n);
+}
+
+std::ostream& HttpResponse::dump(std::ostream& os) const {
+    std::string header;
+    encodeHeader(header);
+    os << header;
+    if(!m_file) {
+        return os << m_body;
+    }
+    char buf[4096];
+    uint64_t off = m_fileOffset;
+    uint64_t end = m_fileOffset + m_fileLength;
+    while(off < end) {
+        ssize_t n = pread(m_file->fd, buf, std::min<uint64_t>(sizeof(buf), end - off), off);
+        if(n <= 0) {
+            break;
+        }
+        os.write(buf, n);
+        off += n;
+    }
+    return os;
+}
+
+std::string HttpResponse::toString() const {
+    std::stringstream ss;
+    dump(ss);
+    return ss.str();
+}
+
+std::ostream& operator<<(std::ostream& os, const HttpRequest& req) {
+    return req.dump(os);
+}
+
+std::ostream& operator<<(std::ostream& os, const HttpResponse& rsp) {
+    return rsp.dump(os);
+}
+
+}
+}
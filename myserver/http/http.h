@@ -0,0 +1,208 @@
+#ifndef __MYSERVER_HTTP_H__
+#define __MYSERVER_HTTP_H__
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <stdint.h>
+
+namespace myserver {
+
+struct CachedFile;
+
+namespace http {
+
+class HttpParser;
+
+/* Request Methods */
+#define HTTP_METHOD_MAP(XX)         \
+  XX(0,  DELETE,      DELETE)       \
+  XX(1,  GET,         GET)          \
+  XX(2,  HEAD,        HEAD)         \
+  XX(3,  POST,        POST)         \
+  XX(4,  PUT,         PUT)          \
+  XX(5,  CONNECT,     CONNECT)      \
+  XX(6,  OPTIONS,     OPTIONS)      \
+  XX(7,  TRACE,       TRACE)        \
+  XX(8,  PATCH,       PATCH)
+
+/* Status Codes */
+#define HTTP_STATUS_MAP(XX)                                                 \
+  XX(100, CONTINUE,                        Continue)                        \
+  XX(101, SWITCHING_PROTOCOLS,             Switching Protocols)             \
+  XX(200, OK,                              OK)                              \
+  XX(201, CREATED,                         Created)                         \
+  XX(202, ACCEPTED,                        Accepted)                        \
+  XX(204, NO_CONTENT,                      No Content)                      \
+  XX(206, PARTIAL_CONTENT,                 Partial Content)                 \
+  XX(301, MOVED_PERMANENTLY,               Moved Permanently)               \
+  XX(302, FOUND,                           Found)                           \
+  XX(304, NOT_MODIFIED,                    Not Modified)                    \
+  XX(307, TEMPORARY_REDIRECT,              Temporary Redirect)              \
+  XX(400, BAD_REQUEST,                     Bad Request)                     \
+  XX(401, UNAUTHORIZED,                    Unauthorized)                    \
+  XX(403, FORBIDDEN,                       Forbidden)                       \
+  XX(404, NOT_FOUND,                       Not Found)                       \
+  XX(405, METHOD_NOT_ALLOWED,              Method Not Allowed)              \
+  XX(408, REQUEST_TIMEOUT,                 Request Timeout)                 \
+  XX(411, LENGTH_REQUIRED,                 Length Required)                 \
+  XX(413, PAYLOAD_TOO_LARGE,               Payload Too Large)               \
+  XX(414, URI_TOO_LONG,                    URI Too Long)                    \
+  XX(416, RANGE_NOT_SATISFIABLE,           Range Not Satisfiable)           \
+  XX(429, TOO_MANY_REQUESTS,               Too Many Requests)               \
+  XX(431, REQUEST_HEADER_FIELDS_TOO_LARGE, Request Header Fields Too Large) \
+  XX(500, INTERNAL_SERVER_ERROR,           Internal Server Error)           \
+  XX(501, NOT_IMPLEMENTED,                 Not Implemented)                 \
+  XX(502, BAD_GATEWAY,                     Bad Gateway)                     \
+  XX(503, SERVICE_UNAVAILABLE,             Service Unavailable)             \
+  XX(504, GATEWAY_TIMEOUT,                 Gateway Timeout)                 \
+  XX(505, HTTP_VERSION_NOT_SUPPORTED,      HTTP Version Not Supported)
+
+// HTTP 方法
+enum class HttpMethod {
+#define XX(num, name, string) name = num,
+    HTTP_METHOD_MAP(XX)
+#undef XX
+    INVALID_METHOD
+};
+
+// HTTP 状态码
+enum class HttpStatus {
+#define XX(code, name, desc) name = code,
+    HTTP_STATUS_MAP(XX)
+#undef XX
+};
+
+// 将字符串方法名转成HTTP方法枚举
+HttpMethod StringToHttpMethod(const std::string& m);
+HttpMethod CharsToHttpMethod(const char* m, size_t len);
+// 将HTTP方法枚举转换成字符串
+const char* HttpMethodToString(const HttpMethod& m);
+// 将HTTP状态码转换成原因短语
+const char* HttpStatusToString(const HttpStatus& s);
+
+/**
+ * @brief HTTP请求
+ * @details 服务端每个连接复用同一个对象，init 时复用已有字符串的容量，稳定后解析请求不再分配内存
+ */
+class HttpRequest {
+public:
+    typedef std::shared_ptr<HttpRequest> ptr;
+    typedef std::vector<std::pair<std::string, std::string> > Headers;
+
+    /**
+     * @brief 构造函数
+     * @param[in] version 版本，0x11 = HTTP/1.1
+     * @param[in] close 是否 Connection: close
+     */
+    HttpRequest(uint8_t version = 0x11, bool close = true);
+
+    // 从解析结果填充，base 为消息首字节地址
+    void init(const HttpParser& parser, const char* base);
+
+    HttpMethod getMethod() const { return m_method; }
+    uint8_t getVersion() const { return m_version; }
+    const std::string& getPath() const { return m_path; }
+    const std::string& getQuery() const { return m_query; }
+    const std::string& getFragment() const { return m_fragment; }
+    const std::string& getBody() const { return m_body; }
+    const Headers& getHeaders() const { return m_headers; }
+    bool isClose() const { return m_close; }
+
+    void setMethod(HttpMethod v) { m_method = v; }
+    void setVersion(uint8_t v) { m_version = v; }
+    void setPath(const std::string& v) { m_path = v; }
+    void setQuery(const std::string& v) { m_query = v; }
+    void setFragment(const std::string& v) { m_fragment = v; }
+    void setBody(const std::string& v) { m_body = v; }
+    void setClose(bool v) { m_close = v; }
+
+    // 按名称(忽略大小写)获取头部，不存在返回 def
+    std::string getHeader(const std::string& key, const std::string& def = "") const;
+    bool hasHeader(const std::string& key, std::string* val = nullptr) const;
+    // 设置头部，已存在则覆盖
+    void setHeader(const std::string& key, const std::string& val);
+    void delHeader(const std::string& key);
+
+    // 按请求报文格式输出
+    std::ostream& dump(std::ostream& os) const;
+    std::string toString() const;
+private:
+    HttpMethod m_method;
+    uint8_t m_version;
+    bool m_close;
+    std::string m_path;
+    std::string m_query;
+    std::string m_fragment;
+    std::string m_body;
+    Headers m_headers;
+};
+
+/**
+ * @brief HTTP响应
+ * @details Content-Length 与 Connection 由 encodeHeader 根据 body 与 isClose 生成，不需要手动设置。
+ *          消息体可以是内存中的 body，也可以是文件的一段(setFile)，后者由服务器用 sendfile 发送
+ */
+class HttpResponse {
+public:
+    typedef std::shared_ptr<HttpResponse> ptr;
+    typedef std::vector<std::pair<std::string, std::string> > Headers;
+
+    HttpResponse(uint8_t version = 0x11, bool close = true);
+
+    // 恢复为 200 OK 的空响应，保留字符串容量
+    void reset(uint8_t version, bool close);
+    // 从解析结果填充(客户端使用)，base 为消息首字节地址
+    void init(const HttpParser& parser, const char* base);
+
+    HttpStatus getStatus() const { return m_status; }
+    uint8_t getVersion() const { return m_version; }
+    std::string& getBody() { return m_body; }
+    const std::string& getBody() const { return m_body; }
+    const std::string& getReason() const { return m_reason; }
+    const Headers& getHeaders() const { return m_headers; }
+    bool isClose() const { return m_close; }
+
+    void setStatus(HttpStatus v) { m_status = v; }
+    void setVersion(uint8_t v) { m_version = v; }
+    void setBody(const std::string& v) { m_body = v; }
+    void setReason(const std::string& v) { m_reason = v; }
+    void setClose(bool v) { m_close = v; }
+
+    std::string getHeader(const std::string& key, const std::string& def = "") const;
+    void setHeader(const std::string& key, const std::string& val);
+    void delHeader(const std::string& key);
+
+    // 以文件 [offset, offset + length) 作为消息体，设置后忽略 body
+    void setFile(std::shared_ptr<CachedFile> file, uint64_t offset, uint64_t length);
+    const std::shared_ptr<CachedFile>& getFile() const { return m_file; }
+    uint64_t getFileOffset() const { return m_fileOffset; }
+    uint64_t getFileLength() const { return m_fileLength; }
+    // 消息体长度
+    uint64_t getContentLength() const { return m_file ? m_fileLength : m_body.size(); }
+
+    // 把状态行与头部(含结尾空行)追加到 out
+    void encodeHeader(std::string& out) const;
+
+    std::ostream& dump(std::ostream& os) const;
+    std::string toString() const;
+private:
+    HttpStatus m_status;
+    uint8_t m_version;
+    bool m_close;
+    std::string m_body;
+    std::string m_reason;
+    Headers m_headers;
+    std::shared_ptr<CachedFile> m_file;
+    uint64_t m_fileOffset;
+    uint64_t m_fileLength;
+};
+
+std::ostream& operator<<(std::ostream& os, const HttpRequest& req);
+std::ostream& operator<<(std::ostream& os, const HttpResponse& rsp);
+
+}
+}
+
+#endif
@@ -0,0 +1,345 @@
+#include "http_connection.h"
+#include <errno.h>
+#include <string.h>
+#include <sstream>
+#include <functional>
+#include "clock.h"
+#include "log.h"
+
+namespace myserver {
+namespace http {
+
+static myserver::Logger::ptr g_logger = LOGGER_NAME("system");
+
+static const char* ErrorToString(HttpResult::Error e) {
+    switch(e) {
+#define XX(name) case HttpResult::Error::name: return #name;
+        XX(OK);
+        XX(INVALID_HOST);
+        XX(CONNECT_FAIL);
+        XX(SEND_FAIL);
+        XX(RECV_FAIL);
+        XX(CONNECTION_CLOSED);
+        XX(TIMEOUT);
+        XX(PARSE_FAIL);
+        XX(POOL_EXHAUSTED);
+#undef XX
+        default:
+            return "UNKNOWN";
+    }
+}
+
+std::string HttpResult::toString() const {
+    std::stringstream ss;
+    ss << "[HttpResult result=" << ErrorToString(result)
+       << " error=" << error
+       << " response=" << (response ? response->toString() : "nullptr")
+       << "]";
+    return ss.str();
+}
+
+HttpConnection::HttpConnection(Socket::ptr sock)
+    :m_sock(sock)
+    ,m_parser(HttpParser::RESPONSE)
+    ,m_buf(4096)
+    ,m_createTime(Clock::NowMs())
+    ,m_lastUsed(m_createTime)
+    ,m_requests(0)
+    ,m_closed(false) {
+}
+
+HttpResult::ptr HttpConnection::fail(HttpResult::Error err, const std::string& msg) {
+    m_closed = true;
+    m_sock->close();
+    return std::make_shared<HttpResult>(err, nullptr, msg);
+}
+
+HttpResult::ptr HttpConnection::request(const HttpRequest& req, uint64_t timeout_ms) {
+    if(m_closed) {
+        return std::make_shared<HttpResult>(HttpResult::Error::CONNECTION_CLOSED, nullptr, "connection closed");
+    }
+    uint64_t deadline = Clock::NowMs() + timeout_ms;
+    m_out = req.toString();
+    size_t sent = 0;
+    while(sent < m_out.size()) {
+        uint64_t now = Clock::NowMs();
+        if(now >= deadline) {
+            return fail(HttpResult::Error::TIMEOUT, "send timeout");
+        }
+        m_sock->setSendTimeout(deadline - now);
+        int n = m_sock->send(&m_out[sent], m_out.size() - sent);
+        if(n <= 0) {
+            if(errno == ETIMEDOUT) {
+                return fail(HttpResult::Error::TIMEOUT, "send timeout");
+            }
+            // 复用的连接已被对端关闭
+            if(errno == EPIPE || errno == ECONNRESET) {
+                return fail(HttpResult::Error::CONNECTION_CLOSED, strerror(errno));
+            }
+            return fail(HttpResult::Error::SEND_FAIL, strerror(errno));
+        }
+        sent += n;
+    }
+
+    m_parser.reset();
+    m_parser.setNoBody(req.getMethod() == HttpMethod::HEAD);
+    size_t len = 0;
+    while(true) {
+        if(len > 0) {
+            HttpParser::Result rt = m_parser.execute(&m_buf[0], len);
+            if(rt == HttpParser::DONE) {
+                break;
+            }
+            if(rt == HttpParser::ERROR) {
+                return fail(HttpResult::Error::PARSE_FAIL, m_parser.getErrorString());
+            }
+        }
+        if(len == m_buf.size()) {
+            m_buf.resize(m_buf.size() * 2);
+        }
+        uint64_t now = Clock::NowMs();
+        if(now >= deadline) {
+            return fail(HttpResult::Error::TIMEOUT, "recv timeout");
+        }
+        m_sock->setRecvTimeout(deadline - now);
+        int n = m_sock->recv(&m_buf[len], m_buf.size() - len);
+        if(n == 0) {
+            // 没有 Content-Length 的响应以连接关闭结束
+            if(m_parser.finish(len) == HttpParser::DONE) {
+                m_closed = true;
+                break;
+            }
+            return fail(len ? HttpResult::Error::RECV_FAIL : HttpResult::Error::CONNECTION_CLOSED,
+                        "peer closed");
+        }
+        if(n < 0) {
+            if(errno == ETIMEDOUT) {
+                return fail(HttpResult::Error::TIMEOUT, "recv timeout");
+            }
+            return fail(len == 0 && errno == ECONNRESET ? HttpResult::Error::CONNECTION_CLOSED
+                        : HttpResult::Error::RECV_FAIL, strerror(errno));
+        }
+        len += n;
+    }
+
+    HttpResponse::ptr rsp = std::make_shared<HttpResponse>();
+    rsp->init(m_parser, &m_buf[0]);
+    // 响应之后还有多余的数据说明连接状态已不可信
+    if(!m_parser.isKeepAlive() || m_parser.getConsumed() != len) {
+        m_closed = true;
+    }
+    ++m_requests;
+    m_lastUsed = Clock::NowMs();
+    return std::make_shared<HttpResult>(HttpResult::Error::OK, rsp, "ok");
+}
+
+bool HttpConnection::checkAlive() {
+    if(m_closed) {
+        return false;
+    }
+    char c;
+    m_sock->setRecvTimeout(0);
+    int rt = m_sock->recv(&c, 1, MSG_PEEK);
+    return rt < 0 && errno == ETIMEDOUT;
+}
+
+HttpConnectionPool::HttpConnectionPool(const std::string& host, uint16_t port, uint32_t max_size,
+                                       uint64_t max_idle_ms, uint32_t max_request)
+    :m_host(host)
+    ,m_port(port)
+    ,m_maxSize(max_size)
+    ,m_maxIdle(max_idle_ms)
+    ,m_maxRequest(max_request)
+    ,m_slots(max_size)
+    ,m_total(0)
+    ,m_created(0)
+    ,m_reused(0)
+    ,m_discarded(0) {
+    IPAddress::ptr addr = Address::LookupAnyIPAddress(host);
+    if(addr) {
+        addr->setPort(port);
+        m_addr = addr;
+    } else {
+        LOG_ERROR(g_logger) << "HttpConnectionPool invalid host=" << host;
+    }
+}
+
+HttpConnectionPool::~HttpConnectionPool() {
+    MutexType::Lock lock(m_mutex);
+    for(auto i : m_idle) {
+        delete i;
+    }
+    m_idle.clear();
+}
+
+HttpConnection* HttpConnectionPool::connect(uint64_t timeout_ms, HttpResult::Error& err) {
+    if(!m_addr) {
+        err = HttpResult::Error::INVALID_HOST;
+        return nullptr;
+    }
+    Socket::ptr sock = Socket::CreateTCP(m_addr);
+    if(!sock->connect(m_addr, timeout_ms)) {
+        LOG_DEBUG(g_logger) << "HttpConnectionPool connect fail addr=" << *m_addr
+            << " errno=" << errno << " errstr=" << strerror(errno);
+        err = errno == ETIMEDOUT ? HttpResult::Error::TIMEOUT : HttpResult::Error::CONNECT_FAIL;
+        return nullptr;
+    }
+    ++m_created;
+    return new HttpConnection(sock);
+}
+
+HttpConnection::ptr HttpConnectionPool::getConnection(uint64_t timeout_ms, HttpResult::Error* err,
+                                                      bool fresh) {
+    uint64_t deadline = Clock::NowMs() + timeout_ms;
+    if(!m_slots.waitFor(timeout_ms)) {
+        if(err) {
+            *err = HttpResult::Error::POOL_EXHAUSTED;
+        }
+        return nullptr;
+    }
+
+    HttpConnection* conn = nullptr;
+    std::vector<HttpConnection*> invalid;
+    while(!fresh) {
+        HttpConnection* c = nullptr;
+        {
+            uint64_t now = Clock::NowMs();
+            MutexType::Lock lock(m_mutex);
+            // 栈底是最久未用的连接，先清理超时的
+            while(!m_idle.empty() && m_idle.front()->getLastUsed() + m_maxIdle <= now) {
+                invalid.push_back(m_idle.front());
+                m_idle.pop_front();
+            }
+            if(m_idle.empty()) {
+                break;
+            }
+            c = m_idle.back();
+            m_idle.pop_back();
+        }
+        // 检查在锁外进行
+        if(c->checkAlive()) {
+            conn = c;
+            break;
+        }
+        invalid.push_back(c);
+    }
+    if(!invalid.empty()) {
+        m_discarded += invalid.size();
+        m_total -= invalid.size();
+        // 被清理的连接没有占用信号量，只有取到的连接占用本次获取的名额
+        for(auto i : invalid) {
+            delete i;
+        }
+    }
+
+    if(conn) {
+        ++m_reused;
+    } else {
+        uint64_t now = Clock::NowMs();
+        HttpResult::Error e = HttpResult::Error::TIMEOUT;
+        conn = now < deadline ? connect(deadline - now, e) : nullptr;
+        if(!conn) {
+            m_slots.notify();
+            if(err) {
+                *err = e;
+            }
+            return nullptr;
+        }
+        ++m_total;
+    }
+    if(err) {
+        *err = HttpResult::Error::OK;
+    }
+    return HttpConnection::ptr(conn, std::bind(&HttpConnectionPool::ReleasePtr,
+                std::placeholders::_1, this));
+}
+
+void HttpConnectionPool::ReleasePtr(HttpConnection* conn, HttpConnectionPool* pool) {
+    if(conn->isClosed() || (pool->m_maxRequest && conn->getRequestCount() >= pool->m_maxRequest)) {
+        if(!conn->isClosed()) {
+            ++pool->m_discarded;
+        }
+        delete conn;
+        --pool->m_total;
+    } else {
+        MutexType::Lock lock(pool->m_mutex);
+        pool->m_idle.push_back(conn);
+    }
+    pool->m_slots.notify();
+}
+
+HttpResult::ptr HttpConnectionPool::doGet(const std::string& uri, uint64_t timeout_ms,
+                                          const HttpRequest::Headers& headers, const std::string& body) {
+    return doRequest(HttpMethod::GET, uri, timeout_ms, headers, body);
+}
+
+HttpResult::ptr HttpConnectionPool::doPost(const std::string& uri, uint64_t timeout_ms,
+                                           const HttpRequest::Headers& headers, const std::string& body) {
+    return doRequest(HttpMethod::POST, uri, timeout_ms, headers, body);
+}
+
+HttpResult::ptr HttpConnectionPool::doRequest(HttpMethod method, const std::string& uri, uint64_t timeout_ms,
+                                              const HttpRequest::Headers& headers, const std::string& body) {
+    HttpRequest::ptr req = std::make_shared<HttpRequest>();
+    req->setMethod(method);
+    size_t pos = uri.find('?');
+    req->setPath(uri.substr(0, pos));
+    if(pos != std::string::npos) {
+        req->setQuery(uri.substr(pos + 1));
+    }
+    for(auto& i : headers) {
+        req->setHeader(i.first, i.second);
+    }
+    req->setBody(body);
+    return doRequest(req, timeout_ms);
+}
+
+HttpResult::ptr HttpConnectionPool::doRequest(HttpRequest::ptr req, uint64_t timeout_ms) {
+    if(!req->hasHeader("Host")) {
+        req->setHeader("Host", m_host);
+    }
+    req->setClose(false);
+    bool idempotent = req->getMethod() != HttpMethod::POST && req->getMethod() != HttpMethod::PATCH
+            && req->getMethod() != HttpMethod::CONNECT;
+    uint64_t deadline = Clock::NowMs() + timeout_ms;
+    HttpResult::ptr result;
+    for(int i = 0; i < 2; ++i) {
+        uint64_t now = Clock::NowMs();
+        if(now >= deadline) {
+            break;
+        }
+        HttpResult::Error err;
+        // 重试时空闲栈中的其它连接可能同样已失效，直接新建
+        HttpConnection::ptr conn = getConnection(deadline - now, &err, i > 0);
+        if(!conn) {
+            return std::make_shared<HttpResult>(err, nullptr, "get connection fail host="
+                    + m_host + ":" + std::to_string(m_port));
+        }
+        bool reused = conn->getRequestCount() > 0;
+        now = Clock::NowMs();
+        result = conn->request(*req, deadline > now ? deadline - now : 0);
+        // 只有复用的连接在发出请求前就被关闭时才重试
+        if(result->result != HttpResult::Error::CONNECTION_CLOSED || !reused || !idempotent) {
+            return result;
+        }
+        LOG_DEBUG(g_logger) << "HttpConnectionPool retry on new connection host=" << m_host
+            << ":" << m_port << " error=" << result->error;
+    }
+    return result ? result : std::make_shared<HttpResult>(HttpResult::Error::TIMEOUT, nullptr, "timeout");
+}
+
+HttpConnectionPoolStats HttpConnectionPool::getStats() {
+    HttpConnectionPoolStats stats;
+    {
+        MutexType::Lock lock(m_mutex);
+        stats.idle = m_idle.size();
+    }
+    stats.total = m_total;
+    stats.created = m_created;
+    stats.reused = m_reused;
+    stats.discarded = m_discarded;
+    return stats;
+}
+
+}
+}
@@ -0,0 +1,172 @@
+#ifndef __MYSERVER_HTTP_CONNECTION_H__
+#define __MYSERVER_HTTP_CONNECTION_H__
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include "socket.h"
+#include "mutex.h"
+#include "noncopyable.h"
+#include "http.h"
+#include "http_parser.h"
+
+namespace myserver {
+namespace http {
+
+// HTTP 客户端请求结果
+struct HttpResult {
+    typedef std::shared_ptr<HttpResult> ptr;
+
+    enum class Error {
+        OK = 0,
+        INVALID_HOST,           // 地址解析失败
+        CONNECT_FAIL,           // 连接失败
+        SEND_FAIL,              // 发送失败
+        RECV_FAIL,              // 接收失败
+        CONNECTION_CLOSED,      // 收到任何响应数据之前对端已关闭连接
+        TIMEOUT,                // 超时
+        PARSE_FAIL,             // 响应格式错误
+        POOL_EXHAUSTED          // 连接池在超时前没有可用连接
+    };
+
+    HttpResult(Error _result, HttpResponse::ptr _response, const std::string& _error)
+        :result(_result)
+        ,response(_response)
+        ,error(_error) {}
+
+    std::string toString() const;
+
+    Error result;
+    HttpResponse::ptr response;
+    std::string error;
+};
+
+/**
+ * @brief HTTP/1.1 客户端连接
+ * @details 阻塞式地发送一个请求并读取完整响应，同一连接上的请求串行执行。
+ *          接收缓冲区在请求之间复用
+ */
+class HttpConnection : Noncopyable {
+public:
+    typedef std::shared_ptr<HttpConnection> ptr;
+
+    HttpConnection(Socket::ptr sock);
+
+    /**
+     * @brief 发送请求并读取响应
+     * @param[in] timeout_ms 发送与接收的总超时(毫秒)
+     */
+    HttpResult::ptr request(const HttpRequest& req, uint64_t timeout_ms);
+
+    /**
+     * @brief 检查空闲连接是否可用
+     * @details 只做一次非阻塞的 MSG_PEEK 读取：对端已关闭、出错或收到了未请求的数据都视为不可用
+     */
+    bool checkAlive();
+
+    Socket::ptr getSocket() const { return m_sock; }
+    uint64_t getCreateTime() const { return m_createTime; }
+    uint64_t getLastUsed() const { return m_lastUsed; }
+    uint32_t getRequestCount() const { return m_requests; }
+    // 连接已不能继续使用(对端要求关闭、出错或超时)
+    bool isClosed() const { return m_closed; }
+private:
+    HttpResult::ptr fail(HttpResult::Error err, const std::string& msg);
+private:
+    Socket::ptr m_sock;
+    HttpParser m_parser;
+    std::vector<char> m_buf;        // 接收缓冲区
+    std::string m_out;              // 发送缓冲区
+    uint64_t m_createTime;          // 创建时间(毫秒)
+    uint64_t m_lastUsed;            // 最后一次完成请求的时间(毫秒)
+    uint32_t m_requests;            // 已完成的请求数
+    bool m_closed;
+};
+
+// 连接池统计信息
+struct HttpConnectionPoolStats {
+    uint64_t total = 0;             // 当前连接数(使用中 + 空闲)
+    uint64_t idle = 0;              // 当前空闲连接数
+    uint64_t created = 0;           // 累计新建连接数
+    uint64_t reused = 0;            // 累计复用空闲连接的次数
+    uint64_t discarded = 0;         // 空闲超时、请求数达到上限或检查不通过而关闭的连接数
+};
+
+/**
+ * @brief 单个 host:port 的 HTTP 长连接池
+ * @details 归还的长连接放入空闲栈，后进先出地复用，栈底超过最大空闲时间的连接在取连接时关闭；
+ *          复用前用 checkAlive 做一次非阻塞检查。同时存在的连接数不超过 max_size，
+ *          达到上限时 getConnection 等待其他连接归还直到超时。
+ *          复用的连接在发送前已被对端关闭时，幂等请求自动在新连接上重试一次。
+ *          getConnection 返回的连接析构时自动归还，必须在连接池析构前释放
+ */
+class HttpConnectionPool : Noncopyable {
+public:
+    typedef std::shared_ptr<HttpConnectionPool> ptr;
+    typedef Mutex MutexType;
+
+    /**
+     * @brief 构造函数
+     * @param[in] host 主机名或IP，同时作为默认的 Host 头
+     * @param[in] port 端口
+     * @param[in] max_size 最大连接数(使用中 + 空闲)
+     * @param[in] max_idle_ms 空闲连接最长保留时间(毫秒)
+     * @param[in] max_request 每个连接最多处理的请求数，0 表示不限
+     */
+    HttpConnectionPool(const std::string& host, uint16_t port, uint32_t max_size,
+                       uint64_t max_idle_ms, uint32_t max_request);
+    ~HttpConnectionPool();
+
+    /**
+     * @brief 取得一个连接
+     * @param[in] timeout_ms 等待可用连接与建立连接的超时(毫秒)
+     * @param[out] err 失败原因
+     * @param[in] fresh 为 true 时不复用空闲连接，总是新建
+     * @return 失败返回 nullptr
+     */
+    HttpConnection::ptr getConnection(uint64_t timeout_ms, HttpResult::Error* err = nullptr,
+                                      bool fresh = false);
+
+    HttpResult::ptr doGet(const std::string& uri, uint64_t timeout_ms,
+                          const HttpRequest::Headers& headers = HttpRequest::Headers(),
+                          const std::string& body = "");
+    HttpResult::ptr doPost(const std::string& uri, uint64_t timeout_ms,
+                           const HttpRequest::Headers& headers = HttpRequest::Headers(),
+                           const std::string& body = "");
+    HttpResult::ptr doRequest(HttpMethod method, const std::string& uri, uint64_t timeout_ms,
+                              const HttpRequest::Headers& headers = HttpRequest::Headers(),
+                              const std::string& body = "");
+    // 请求未设置 Host 时使用构造时的 host；连接是否保持由连接池决定
+    HttpResult::ptr doRequest(HttpRequest::ptr req, uint64_t timeout_ms);
+
+    const std::string& getHost() const { return m_host; }
+    uint16_t getPort() const { return m_port; }
+    HttpConnectionPoolStats getStats();
+private:
+    // 连接归还时调用
+    static void ReleasePtr(HttpConnection* conn, HttpConnectionPool* pool);
+    // 新建连接
+    HttpConnection* connect(uint64_t timeout_ms, HttpResult::Error& err);
+private:
+    std::string m_host;
+    uint16_t m_port;
+    uint32_t m_maxSize;
+    uint64_t m_maxIdle;
+    uint32_t m_maxRequest;
+    Address::ptr m_addr;
+
+    MutexType m_mutex;
+    std::deque<HttpConnection*> m_idle;     // 表尾为最近归还的连接
+    Semaphore m_slots;                      // 剩余可建立的连接数
+    std::atomic<uint64_t> m_total;
+    std::atomic<uint64_t> m_created;
+    std::atomic<uint64_t> m_reused;
+    std::atomic<uint64_t> m_discarded;
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,713 @@
+#include "http_parser.h"
+#include <string.h>
+#include <strings.h>
+#include <atomic>
+#include "config.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MYSERVER_HTTP_SIMD 1
+#endif
+
+namespace myserver {
+namespace http {
+
+static myserver::ConfigVar<uint32_t>::ptr g_http_parser_max_header_size =
+    myserver::Config::Lookup("http.parser.max_header_size", (uint32_t)(8 * 1024),
+            "http parser max header size");
+
+static myserver::ConfigVar<uint64_t>::ptr g_http_parser_max_body_size =
+    myserver::Config::Lookup("http.parser.max_body_size", (uint64_t)(64 * 1024 * 1024),
+            "http parser max body size");
+
+static std::atomic<uint32_t> s_max_header_size(8 * 1024);
+static std::atomic<uint64_t> s_max_body_size(64 * 1024 * 1024);
+
+struct HttpParserIniter {
+    HttpParserIniter() {
+        s_max_header_size = g_http_parser_max_header_size->getValue();
+        s_max_body_size = g_http_parser_max_body_size->getValue();
+        g_http_parser_max_header_size->addListener(0x48545001,
+            [](const uint32_t& old_value, const uint32_t& new_value) {
+            s_max_header_size = new_value;
+        });
+        g_http_parser_max_body_size->addListener(0x48545002,
+            [](const uint64_t& old_value, const uint64_t& new_value) {
+            s_max_body_size = new_value;
+        });
+    }
+};
+
+static HttpParserIniter __http_parser_init;
+
+/**
+ * 行扫描：返回 [p, end) 中第一个控制字符(< 0x20 或 0x7f)的位置，不存在返回 end。
+ * CR、LF 与非法字符都是控制字符，因此一次扫描即可同时完成找行尾与字符校验，
+ * 命中 HT 时由调用方跳过后继续扫描
+ */
+typedef const char* (*FindCtlFunc)(const char* p, const char* end);
+
+static inline bool IsCtl(unsigned char c) {
+    return c < 0x20 || c == 0x7f;
+}
+
+static const char* FindCtlScalar(const char* p, const char* end) {
+    while(p < end && !IsCtl((unsigned char)*p)) {
+        ++p;
+    }
+    return p;
+}
+
+#ifdef MYSERVER_HTTP_SIMD
+
+static const char* FindCtlSSE2(const char* p, const char* end) {
+    const __m128i limit = _mm_set1_epi8(0x1f);
+    const __m128i del = _mm_set1_epi8(0x7f);
+    while(end - p >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)p);
+        // min(v, 0x1f) == v 即 v <= 0x1f (无符号比较)
+        __m128i ctl = _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(v, limit), v),
+                                   _mm_cmpeq_epi8(v, del));
+        int mask = _mm_movemask_epi8(ctl);
+        if(mask) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 16;
+    }
+    return FindCtlScalar(p, end);
+}
+
+__attribute__((target("avx2")))
+static const char* FindCtlAVX2(const char* p, const char* end) {
+    const __m256i limit = _mm256_set1_epi8(0x1f);
+    const __m256i del = _mm256_set1_epi8(0x7f);
+    while(end - p >= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)p);
+        __m256i ctl = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(v, limit), v),
+                                      _mm256_cmpeq_epi8(v, del));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(ctl);
+        if(mask) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 32;
+    }
+    return FindCtlSSE2(p, end);
+}
+
+#endif
+
+static bool CpuSupports(HttpParser::ScanMode mode) {
+#ifdef MYSERVER_HTTP_SIMD
+    // 静态初始化(BestScanMode)时 libgcc 的 CPU 检测可能尚未执行，需先初始化
+    __builtin_cpu_init();
+#endif
+    switch(mode) {
+        case HttpParser::SCAN_SCALAR:
+            return true;
+#ifdef MYSERVER_HTTP_SIMD
+        case HttpParser::SCAN_SSE2:
+            return __builtin_cpu_supports("sse2");
+        case HttpParser::SCAN_AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+static FindCtlFunc ScanFunc(HttpParser::ScanMode mode) {
+    switch(mode) {
+#ifdef MYSERVER_HTTP_SIMD
+        case HttpParser::SCAN_SSE2:
+            return &FindCtlSSE2;
+        case HttpParser::SCAN_AVX2:
+            return &FindCtlAVX2;
+#endif
+        default:
+            return &FindCtlScalar;
+    }
+}
+
+static HttpParser::ScanMode BestScanMode() {
+    if(CpuSupports(HttpParser::SCAN_AVX2)) {
+        return HttpParser::SCAN_AVX2;
+    }
+    if(CpuSupports(HttpParser::SCAN_SSE2)) {
+        return HttpParser::SCAN_SSE2;
+    }
+    return HttpParser::SCAN_SCALAR;
+}
+
+static std::atomic<int> s_scan_mode(BestScanMode());
+static std::atomic<FindCtlFunc> s_find_ctl(ScanFunc(BestScanMode()));
+
+HttpParser::ScanMode HttpParser::SetScanMode(ScanMode mode) {
+    if(mode == SCAN_AUTO || !CpuSupports(mode)) {
+        mode = BestScanMode();
+    }
+    s_scan_mode = mode;
+    s_find_ctl = ScanFunc(mode);
+    return mode;
+}
+
+HttpParser::ScanMode HttpParser::GetScanMode() {
+    return (ScanMode)s_scan_mode.load();
+}
+
+const char* HttpParser::ScanModeName(ScanMode mode) {
+    switch(mode) {
+        case SCAN_SCALAR: return "scalar";
+        case SCAN_SSE2: return "sse2";
+        case SCAN_AVX2: return "avx2";
+        default: return "auto";
+    }
+}
+
+// RFC 7230 token 字符表
+struct TokenTable {
+    bool table[256];
+
+    TokenTable() {
+        for(int c = 0; c < 256; ++c) {
+            table[c] = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z')
+                || (c >= 'A' && c <= 'Z') || (c && strchr("!#$%&'*+-.^_`|~", c));
+        }
+    }
+};
+
+static const TokenTable s_token_table;
+
+static inline bool IsTokenChar(unsigned char c) {
+    return s_token_table.table[c];
+}
+
+static int HexValue(char c) {
+    if(c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c |= 0x20;
+    if(c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+static HttpParser::Span MakeSpan(size_t begin, size_t end) {
+    HttpParser::Span s;
+    s.offset = begin;
+    s.length = end - begin;
+    return s;
+}
+
+bool HttpParser::Span::equals(const char* base, const char* str, bool ignore_case) const {
+    size_t n = strlen(str);
+    if(n != length) {
+        return false;
+    }
+    return ignore_case ? strncasecmp(base + offset, str, n) == 0
+                       : memcmp(base + offset, str, n) == 0;
+}
+
+HttpParser::HttpParser(Type type)
+    :m_type(type) {
+    reset();
+}
+
+void HttpParser::reset() {
+    m_state = STATE_START_LINE;
+    m_error = OK;
+    m_pos = 0;
+    m_scan = 0;
+    m_maxHeaderSize = s_max_header_size.load(std::memory_order_relaxed);
+    m_maxBodySize = s_max_body_size.load(std::memory_order_relaxed);
+    m_method = m_uri = m_path = m_query = m_fragment = m_reason = Span();
+    m_version = 0;
+    m_status = 0;
+    m_headerCount = 0;
+    m_headerSize = 0;
+    m_body = Span();
+    m_contentLength = 0;
+    m_chunkRemain = 0;
+    m_hasContentLength = false;
+    m_chunked = false;
+    m_keepAlive = false;
+    m_noBody = false;
+}
+
+const char* HttpParser::getErrorString() const {
+    switch(m_error) {
+#define XX(name) case name: return #name;
+        XX(OK);
+        XX(INVALID_REQUEST_LINE);
+        XX(INVALID_STATUS_LINE);
+        XX(INVALID_VERSION);
+        XX(INVALID_HEADER);
+        XX(INVALID_CHAR);
+        XX(TOO_MANY_HEADERS);
+        XX(HEADER_TOO_LARGE);
+        XX(INVALID_CONTENT_LENGTH);
+        XX(BODY_TOO_LARGE);
+        XX(INVALID_CHUNK);
+        XX(UNSUPPORTED_TRANSFER_ENCODING);
+#undef XX
+        default:
+            return "UNKNOWN";
+    }
+}
+
+const HttpParser::Header* HttpParser::findHeader(const char* base, const char* name) const {
+    for(size_t i = 0; i < m_headerCount; ++i) {
+        if(m_headers[i].name.equals(base, name, true)) {
+            return &m_headers[i];
+        }
+    }
+    return nullptr;
+}
+
+HttpParser::Result HttpParser::fail(Error e) {
+    m_error = e;
+    return ERROR;
+}
+
+HttpParser::Result HttpParser::nextLine(const char* data, size_t len,
+                                        size_t& line_end, size_t& next) {
+    FindCtlFunc find = s_find_ctl.load(std::memory_order_relaxed);
+    const char* end = data + len;
+    const char* p = data + (m_scan > m_pos ? m_scan : m_pos);
+    while(true) {
+        p = find(p, end);
+        if(p == end) {
+            m_scan = len;
+            return NEED_MORE;
+        }
+        if(*p == '\n') {
+            line_end = p - data;
+            next = line_end + 1;
+            break;
+        }
+        if(*p == '\r') {
+            if(p + 1 == end) {
+                m_scan = p - data;
+                return NEED_MORE;
+            }
+            if(p[1] != '\n') {
+                return fail(INVALID_CHAR);
+            }
+            line_end = p - data;
+            next = line_end + 2;
+            break;
+        }
+        if(*p == '\t') {
+            ++p;
+            continue;
+        }
+        return fail(INVALID_CHAR);
+    }
+    m_scan = next;
+    return DONE;
+}
+
+// 解析 HTTP/1.x，成功返回 0x10 / 0x11
+static uint8_t ParseVersion(const char* p, size_t n) {
+    if(n != 8 || memcmp(p, "HTTP/1.", 7) != 0) {
+        return 0;
+    }
+    if(p[7] == '1') {
+        return 0x11;
+    } else if(p[7] == '0') {
+        return 0x10;
+    }
+    return 0;
+}
+
+HttpParser::Result HttpParser::parseRequestLine(const char* data, size_t begin, size_t end) {
+    const char* p = data + begin;
+    size_t n = end - begin;
+    const char* sp1 = (const char*)memchr(p, ' ', n);
+    const char* sp2 = (const char*)memrchr(p, ' ', n);
+    if(!sp1 || sp1 == sp2 || sp1 == p || sp2 == sp1 + 1) {
+        return fail(INVALID_REQUEST_LINE);
+    }
+    for(const char* i = p; i < sp1; ++i) {
+        if(!IsTokenChar(*i)) {
+            return fail(INVALID_REQUEST_LINE);
+        }
+    }
+    m_version = ParseVersion(sp2 + 1, p + n - sp2 - 1);
+    if(!m_version) {
+        return fail(INVALID_VERSION);
+    }
+    m_method = MakeSpan(begin, sp1 - data);
+    size_t uri_begin = sp1 + 1 - data;
+    size_t uri_end = sp2 - data;
+    m_uri = MakeSpan(uri_begin, uri_end);
+
+    // path[?query][#fragment]
+    const char* u = data + uri_begin;
+    size_t ulen = uri_end - uri_begin;
+    if(memchr(u, ' ', ulen)) {
+        return fail(INVALID_REQUEST_LINE);
+    }
+    const char* hash = (const char*)memchr(u, '#', ulen);
+    size_t path_end = hash ? hash - data : uri_end;
+    const char* q = (const char*)memchr(u, '?', path_end - uri_begin);
+    if(q) {
+        m_path = MakeSpan(uri_begin, q - data);
+        m_query = MakeSpan(q + 1 - data, path_end);
+    } else {
+        m_path = MakeSpan(uri_begin, path_end);
+    }
+    if(hash) {
+        m_fragment = MakeSpan(hash + 1 - data, uri_end);
+    }
+    return DONE;
+}
+
+HttpParser::Result HttpParser::parseStatusLine(const char* data, size_t begin, size_t end) {
+    const char* p = data + begin;
+    size_t n = end - begin;
+    const char* sp1 = (const char*)memchr(p, ' ', n);
+    if(!sp1) {
+        return fail(INVALID_STATUS_LINE);
+    }
+    m_version = ParseVersion(p, sp1 - p);
+    if(!m_version) {
+        return fail(INVALID_VERSION);
+    }
+    const char* s = sp1 + 1;
+    if(p + n - s < 3) {
+        return fail(INVALID_STATUS_LINE);
+    }
+    m_status = 0;
+    for(int i = 0; i < 3; ++i) {
+        if(s[i] < '0' || s[i] > '9') {
+            return fail(INVALID_STATUS_LINE);
+        }
+        m_status = m_status * 10 + (s[i] - '0');
+    }
+    if(s + 3 < p + n) {
+        if(s[3] != ' ') {
+            return fail(INVALID_STATUS_LINE);
+        }
+        m_reason = MakeSpan(s + 4 - data, end);
+    }
+    return DONE;
+}
+
+HttpParser::Result HttpParser::parseHeaderLine(const char* data, size_t begin, size_t end) {
+    const char* p = data + begin;
+    // 不支持 obs-fold 续行
+    if(*p == ' ' || *p == '\t') {
+        return fail(INVALID_HEADER);
+    }
+    const char* colon = (const char*)memchr(p, ':', end - begin);
+    if(!colon || colon == p) {
+        return fail(INVALID_HEADER);
+    }
+    for(const char* i = p; i < colon; ++i) {
+        if(!IsTokenChar(*i)) {
+            return fail(INVALID_HEADER);
+        }
+    }
+    if(m_headerCount >= MAX_HEADERS) {
+        return fail(TOO_MANY_HEADERS);
+    }
+    size_t vb = colon + 1 - data;
+    size_t ve = end;
+    while(vb < ve && (data[vb] == ' ' || data[vb] == '\t')) {
+        ++vb;
+    }
+    while(ve > vb && (data[ve - 1] == ' ' || data[ve - 1] == '\t')) {
+        --ve;
+    }
+    Header& h = m_headers[m_headerCount++];
+    h.name = MakeSpan(begin, colon - data);
+    h.value = MakeSpan(vb, ve);
+    return DONE;
+}
+
+// 逗号分隔的列表中最后一项是否为 token(忽略大小写)
+static bool LastTokenIs(const char* p, size_t n, const char* token) {
+    while(n && (p[n - 1] == ' ' || p[n - 1] == '\t')) {
+        --n;
+    }
+    size_t tl = strlen(token);
+    if(n < tl || strncasecmp(p + n - tl, token, tl) != 0) {
+        return false;
+    }
+    return n == tl || p[n - tl - 1] == ',' || p[n - tl - 1] == ' ' || p[n - tl - 1] == '\t';
+}
+
+// 逗号分隔的列表中是否包含 token(忽略大小写)
+static bool ContainsToken(const char* p, size_t n, const char* token) {
+    size_t tl = strlen(token);
+    size_t i = 0;
+    while(i < n) {
+        while(i < n && (p[i] == ' ' || p[i] == '\t' || p[i] == ',')) {
+            ++i;
+        }
+        size_t b = i;
+        while(i < n && p[i] != ',') {
+            ++i;
+        }
+        size_t e = i;
+        while(e > b && (p[e - 1] == ' ' || p[e - 1] == '\t')) {
+            --e;
+        }
+        if(e - b == tl && strncasecmp(p + b, token, tl) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+HttpParser::Result HttpParser::onHeadersComplete(const char* data) {
+    bool has_te = false;
+    bool conn_close = false;
+    bool conn_keepalive = false;
+    for(size_t i = 0; i < m_headerCount; ++i) {
+        const Header& h = m_headers[i];
+        const char* v = h.value.data(data);
+        if(h.name.equals(data, "content-length", true)) {
+            if(h.value.empty()) {
+                return fail(INVALID_CONTENT_LENGTH);
+            }
+            uint64_t cl = 0;
+            for(size_t k = 0; k < h.value.length; ++k) {
+                if(v[k] < '0' || v[k] > '9' || cl > (UINT64_MAX - 9) / 10) {
+                    return fail(INVALID_CONTENT_LENGTH);
+                }
+                cl = cl * 10 + (v[k] - '0');
+            }
+            // 重复且不一致的 Content-Length 可能是请求走私
+            if(m_hasContentLength && cl != m_contentLength) {
+                return fail(INVALID_CONTENT_LENGTH);
+            }
+            m_hasContentLength = true;
+            m_contentLength = cl;
+        } else if(h.name.equals(data, "transfer-encoding", true)) {
+            has_te = true;
+            m_chunked = LastTokenIs(v, h.value.length, "chunked");
+        } else if(h.name.equals(data, "connection", true)) {
+            conn_close |= ContainsToken(v, h.value.length, "close");
+            conn_keepalive |= ContainsToken(v, h.value.length, "keep-alive");
+        }
+    }
+    m_keepAlive = m_version == 0x11 ? !conn_close : conn_keepalive && !conn_close;
+
+    // HEAD 的响应以及 1xx / 204 / 304 响应没有消息体，忽略 Content-Length 与 Transfer-Encoding
+    if(m_type == RESPONSE && (m_noBody || (m_status >= 100 && m_status < 200)
+                || m_status == 204 || m_status == 304)) {
+        m_body = MakeSpan(m_pos, m_pos);
+        m_state = STATE_DONE;
+        return DONE;
+    }
+
+    if(has_te) {
+        // 同时出现 Transfer-Encoding 与 Content-Length 时拒绝
+        if(m_hasContentLength) {
+            return fail(INVALID_CONTENT_LENGTH);
+        }
+        if(!m_chunked) {
+            if(m_type == REQUEST) {
+                return fail(UNSUPPORTED_TRANSFER_ENCODING);
+            }
+            m_keepAlive = false;
+            m_state = STATE_BODY_UNTIL_CLOSE;
+            m_body = MakeSpan(m_pos, m_pos);
+            return DONE;
+        }
+        m_state = STATE_CHUNK_SIZE;
+        m_body = MakeSpan(m_pos, m_pos);
+        return DONE;
+    }
+
+    m_body = MakeSpan(m_pos, m_pos);
+    if(m_hasContentLength) {
+        if(m_contentLength > m_maxBodySize) {
+            return fail(BODY_TOO_LARGE);
+        }
+        m_state = m_contentLength ? STATE_BODY_IDENTITY : STATE_DONE;
+    } else if(m_type == RESPONSE) {
+        m_keepAlive = false;
+        m_state = STATE_BODY_UNTIL_CLOSE;
+    } else {
+        m_state = STATE_DONE;
+    }
+    return DONE;
+}
+
+HttpParser::Result HttpParser::execute(char* data, size_t len) {
+    if(m_error != OK) {
+        return ERROR;
+    }
+    if(len > UINT32_MAX) {
+        return fail(BODY_TOO_LARGE);
+    }
+    size_t line_end = 0;
+    size_t next = 0;
+    while(true) {
+        switch(m_state) {
+            case STATE_START_LINE:
+            case STATE_HEADER: {
+                Result rt = nextLine(data, len, line_end, next);
+                if(rt == NEED_MORE && len > m_maxHeaderSize) {
+                    return fail(HEADER_TOO_LARGE);
+                }
+                if(rt != DONE) {
+                    return rt;
+                }
+                if(next > m_maxHeaderSize) {
+                    return fail(HEADER_TOO_LARGE);
+                }
+                size_t begin = m_pos;
+                m_pos = next;
+                if(m_state == STATE_START_LINE) {
+                    // 忽略起始行之前的空行
+                    if(line_end == begin) {
+                        continue;
+                    }
+                    rt = m_type == REQUEST ? parseRequestLine(data, begin, line_end)
+                                           : parseStatusLine(data, begin, line_end);
+                    if(rt != DONE) {
+                        return rt;
+                    }
+                    m_state = STATE_HEADER;
+                } else if(line_end == begin) {
+                    m_headerSize = m_pos;
+                    rt = onHeadersComplete(data);
+                    if(rt != DONE) {
+                        return rt;
+                    }
+                } else {
+                    rt = parseHeaderLine(data, begin, line_end);
+                    if(rt != DONE) {
+                        return rt;
+                    }
+                }
+                break;
+            }
+            case STATE_BODY_IDENTITY: {
+                uint64_t need = m_contentLength - m_body.length;
+                uint64_t avail = len - m_pos;
+                if(avail < need) {
+                    m_body.length += avail;
+                    m_pos = len;
+                    return NEED_MORE;
+                }
+                m_body.length += need;
+                m_pos += need;
+                m_state = STATE_DONE;
+                break;
+            }
+            case STATE_BODY_UNTIL_CLOSE: {
+                if(len - m_body.offset > m_maxBodySize) {
+                    return fail(BODY_TOO_LARGE);
+                }
+                m_body.length = len - m_body.offset;
+                m_pos = len;
+                return NEED_MORE;
+            }
+            case STATE_CHUNK_SIZE: {
+                Result rt = nextLine(data, len, line_end, next);
+                if(rt != DONE) {
+                    // 块大小行不应很长
+                    if(rt == NEED_MORE && len - m_pos > 1024) {
+                        return fail(INVALID_CHUNK);
+                    }
+                    return rt;
+                }
+                uint64_t size = 0;
+                size_t i = m_pos;
+                for(; i < line_end; ++i) {
+                    int v = HexValue(data[i]);
+                    if(v < 0) {
+                        break;
+                    }
+                    if(size >> 60) {
+                        return fail(INVALID_CHUNK);
+                    }
+                    size = size * 16 + v;
+                }
+                // 至少一位十六进制数字，其后只允许空白或 ;扩展
+                if(i == m_pos || (i < line_end && data[i] != ';' && data[i] != ' ' && data[i] != '\t')) {
+                    return fail(INVALID_CHUNK);
+                }
+                if(m_body.length + size > m_maxBodySize) {
+                    return fail(BODY_TOO_LARGE);
+                }
+                m_pos = next;
+                m_chunkRemain = size;
+                m_state = size ? STATE_CHUNK_DATA : STATE_TRAILER;
+                break;
+            }
+            case STATE_CHUNK_DATA: {
+                uint64_t avail = len - m_pos;
+                uint64_t n = avail < m_chunkRemain ? avail : m_chunkRemain;
+                // 原地解码：块数据前移，与之前的块连成一段
+                size_t dst = m_body.offset + m_body.length;
+                if(dst != m_pos) {
+                    memmove(data + dst, data + m_pos, n);
+                }
+                m_body.length += n;
+                m_pos += n;
+                m_chunkRemain -= n;
+                if(m_chunkRemain) {
+                    return NEED_MORE;
+                }
+                m_state = STATE_CHUNK_DATA_END;
+                break;
+            }
+            case STATE_CHUNK_DATA_END: {
+                if(len - m_pos < 1 || (data[m_pos] == '\r' && len - m_pos < 2)) {
+                    return NEED_MORE;
+                }
+                if(data[m_pos] == '\n') {
+                    m_pos += 1;
+                } else if(data[m_pos] == '\r' && data[m_pos + 1] == '\n') {
+                    m_pos += 2;
+                } else {
+                    return fail(INVALID_CHUNK);
+                }
+                m_scan = m_pos;
+                m_state = STATE_CHUNK_SIZE;
+                break;
+            }
+            case STATE_TRAILER: {
+                // 尾部字段直接跳过，以空行结束
+                Result rt = nextLine(data, len, line_end, next);
+                if(rt != DONE) {
+                    if(rt == NEED_MORE && len - m_pos > m_maxHeaderSize) {
+                        return fail(HEADER_TOO_LARGE);
+                    }
+                    return rt;
+                }
+                bool empty = line_end == m_pos;
+                m_pos = next;
+                if(empty) {
+                    m_contentLength = m_body.length;
+                    m_state = STATE_DONE;
+                }
+                break;
+            }
+            case STATE_DONE:
+                return DONE;
+        }
+    }
+}
+
+HttpParser::Result HttpParser::finish(size_t len) {
+    if(m_state == STATE_BODY_UNTIL_CLOSE) {
+        m_body.length = len - m_body.offset;
+        m_pos = len;
+        m_state = STATE_DONE;
+        return DONE;
+    }
+    if(m_state == STATE_DONE) {
+        return DONE;
+    }
+    return m_error != OK ? ERROR : NEED_MORE;
+}
+
+}
+}
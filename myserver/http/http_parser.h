@@ -0,0 +1,196 @@
+#ifndef __MYSERVER_HTTP_PARSER_H__
+#define __MYSERVER_HTTP_PARSER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace myserver {
+namespace http {
+
+/**
+ * @brief 可重入的 HTTP/1.1 请求/响应解析器
+ * @details 解析结果只记录相对接收缓冲区起始地址的偏移(Span)，解析过程不分配内存、不拷贝字符串。
+ *          调用方把同一条消息目前收到的全部数据(从消息首字节开始)传给 execute，
+ *          数据不完整时返回 NEED_MORE，收到更多数据后用更长的缓冲区再次调用即可从上次位置继续；
+ *          缓冲区可以重新分配，Span 仍然有效。
+ *          chunked 编码的消息体在缓冲区内原地解码为连续数据，因此 execute 需要可写的缓冲区。
+ *          行扫描(查找 CR/LF 及非法控制字符)按 CPU 支持情况使用 AVX2 / SSE2 / 标量实现
+ */
+class HttpParser {
+public:
+    // 解析器类型
+    enum Type {
+        REQUEST = 0,
+        RESPONSE = 1
+    };
+
+    // execute 的返回值
+    enum Result {
+        DONE = 0,           // 一条完整消息解析完毕
+        NEED_MORE = 1,      // 数据不完整
+        ERROR = 2           // 格式错误或超出限制，见 getError
+    };
+
+    // 错误码
+    enum Error {
+        OK = 0,
+        INVALID_REQUEST_LINE,
+        INVALID_STATUS_LINE,
+        INVALID_VERSION,
+        INVALID_HEADER,
+        INVALID_CHAR,
+        TOO_MANY_HEADERS,
+        HEADER_TOO_LARGE,
+        INVALID_CONTENT_LENGTH,
+        BODY_TOO_LARGE,
+        INVALID_CHUNK,
+        UNSUPPORTED_TRANSFER_ENCODING
+    };
+
+    // 行扫描实现
+    enum ScanMode {
+        SCAN_AUTO = 0,      // 按CPU支持情况自动选择
+        SCAN_SCALAR,
+        SCAN_SSE2,
+        SCAN_AVX2
+    };
+
+    // 缓冲区内的一段数据
+    struct Span {
+        uint32_t offset = 0;
+        uint32_t length = 0;
+
+        bool empty() const { return length == 0; }
+        const char* data(const char* base) const { return base + offset; }
+        std::string toString(const char* base) const { return std::string(base + offset, length); }
+        // 与字符串比较，ignore_case 时忽略ASCII大小写
+        bool equals(const char* base, const char* str, bool ignore_case = false) const;
+    };
+
+    struct Header {
+        Span name;
+        Span value;
+    };
+
+    enum {
+        MAX_HEADERS = 64
+    };
+
+    HttpParser(Type type = REQUEST);
+
+    // 重置状态，用于解析同一连接上的下一条消息
+    void reset();
+
+    /**
+     * @brief 解析数据
+     * @param[in,out] data 消息首字节地址，chunked 消息体会被原地解码
+     * @param[in] len 目前收到的数据长度，每次调用不得小于上一次
+     * @return DONE / NEED_MORE / ERROR
+     * @details DONE 之后 getConsumed() 为该消息在原始数据中占用的字节数，之后的数据属于下一条消息
+     */
+    Result execute(char* data, size_t len);
+
+    /**
+     * @brief 通知连接已关闭
+     * @details 没有 Content-Length 且非 chunked 的响应以连接关闭作为消息结束
+     * @return 消息因此完整时返回 DONE
+     */
+    Result finish(size_t len);
+
+    bool isFinished() const { return m_state == STATE_DONE; }
+    bool hasError() const { return m_error != OK; }
+    Error getError() const { return m_error; }
+    const char* getErrorString() const;
+    // 首部(起始行 + 头部 + 空行)是否已完整
+    bool isHeaderComplete() const { return m_state >= STATE_BODY_IDENTITY; }
+
+    Type getType() const { return m_type; }
+    const Span& getMethod() const { return m_method; }
+    const Span& getUri() const { return m_uri; }
+    const Span& getPath() const { return m_path; }
+    const Span& getQuery() const { return m_query; }
+    const Span& getFragment() const { return m_fragment; }
+    // 0x11 = HTTP/1.1, 0x10 = HTTP/1.0
+    uint8_t getVersion() const { return m_version; }
+    uint32_t getStatus() const { return m_status; }
+    const Span& getReason() const { return m_reason; }
+
+    size_t getHeaderCount() const { return m_headerCount; }
+    const Header& getHeader(size_t i) const { return m_headers[i]; }
+    // 按名称(忽略大小写)查找头部，不存在返回 nullptr
+    const Header* findHeader(const char* base, const char* name) const;
+
+    const Span& getBody() const { return m_body; }
+    uint64_t getContentLength() const { return m_contentLength; }
+    bool isChunked() const { return m_chunked; }
+    bool isKeepAlive() const { return m_keepAlive; }
+    // 首部长度
+    size_t getHeaderSize() const { return m_headerSize; }
+    size_t getConsumed() const { return m_pos; }
+
+    // 首部与消息体长度上限，默认取配置 http.parser.max_header_size / http.parser.max_body_size
+    void setMaxHeaderSize(size_t v) { m_maxHeaderSize = v; }
+    void setMaxBodySize(uint64_t v) { m_maxBodySize = v; }
+    // 响应对应 HEAD 请求，首部之后没有消息体；reset 后清除
+    void setNoBody(bool v) { m_noBody = v; }
+
+    // 设置全局行扫描实现，返回实际生效的实现(CPU不支持时回退)
+    static ScanMode SetScanMode(ScanMode mode);
+    static ScanMode GetScanMode();
+    static const char* ScanModeName(ScanMode mode);
+private:
+    enum State {
+        STATE_START_LINE = 0,
+        STATE_HEADER,
+        STATE_BODY_IDENTITY,
+        STATE_BODY_UNTIL_CLOSE,
+        STATE_CHUNK_SIZE,
+        STATE_CHUNK_DATA,
+        STATE_CHUNK_DATA_END,
+        STATE_TRAILER,
+        STATE_DONE
+    };
+
+    Result fail(Error e);
+    // 在 [m_pos, len) 内查找一行，成功时 line_end 指向行内容末尾，next 为下一行起点
+    Result nextLine(const char* data, size_t len, size_t& line_end, size_t& next);
+    Result parseRequestLine(const char* data, size_t begin, size_t end);
+    Result parseStatusLine(const char* data, size_t begin, size_t end);
+    Result parseHeaderLine(const char* data, size_t begin, size_t end);
+    Result onHeadersComplete(const char* data);
+private:
+    Type m_type;
+    State m_state;
+    Error m_error;
+    size_t m_pos;                   // 已解析到的位置
+    size_t m_scan;                  // 当前行已扫描到的位置，避免重复扫描
+    size_t m_maxHeaderSize;
+    uint64_t m_maxBodySize;
+
+    Span m_method;
+    Span m_uri;
+    Span m_path;
+    Span m_query;
+    Span m_fragment;
+    Span m_reason;
+    uint8_t m_version;
+    uint32_t m_status;
+
+    Header m_headers[MAX_HEADERS];
+    size_t m_headerCount;
+    size_t m_headerSize;
+
+    Span m_body;
+    uint64_t m_contentLength;
+    uint64_t m_chunkRemain;         // 当前块剩余字节数
+    bool m_hasContentLength;
+    bool m_chunked;
+    bool m_keepAlive;
+    bool m_noBody;
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,468 @@
+#include "http_server.h"
+#include <errno.h>
+#include <string.h>
+#include <sys/sendfile.h>
+#include <unistd.h>
+#include <algorithm>
+#include "clock.h"
+#include "config.h"
+#include "log.h"
+#include "metrics.h"
+#include "slow_scope.h"
+#include "trace.h"
+
+namespace myserver {
+namespace http {
+
+static myserver::ConfigVar<uint32_t>::ptr g_http_server_buffer_size =
+    myserver::Config::Lookup("http.server.buffer_size", (uint32_t)(4 * 1024),
+            "http server initial connection buffer size");
+
+static myserver::ConfigVar<uint32_t>::ptr g_http_server_sendfile_min_size =
+    myserver::Config::Lookup("http.server.sendfile_min_size", (uint32_t)(16 * 1024),
+            "http server file bodies smaller than this are copied and sent with the header");
+
+static myserver::Logger::ptr g_logger = LOGGER_NAME("system");
+
+static myserver::Counter::ptr g_requests =
+    myserver::Metrics::GetCounter("http.server.requests", "http requests dispatched");
+static myserver::Counter::ptr g_parse_errors =
+    myserver::Metrics::GetCounter("http.server.parse_errors", "malformed http requests");
+
+// 一次 sendmsg 最多聚合的缓冲区数
+static const size_t MAX_IOV = 64;
+
+// io_uring 后端下输出积压时最多缓存的输入，超过后暂停接收
+static const size_t URING_MAX_PENDING_INPUT = 256 * 1024;
+
+HttpServer::OutBuf& HttpServer::Connection::nextOut() {
+    if(outEnd == out.size()) {
+        out.push_back(OutBuf());
+    }
+    return out[outEnd++];
+}
+
+HttpServer::HttpServer(bool keepalive, size_t worker_count)
+    :TcpServer(worker_count)
+    ,m_isKeepalive(keepalive)
+    ,m_dispatch(new ServletDispatch) {
+    for(size_t i = 0; i < getWorkerCount(); ++i) {
+        m_conns.push_back(std::unique_ptr<WorkerConns>(new WorkerConns));
+    }
+}
+
+HttpServer::~HttpServer() {
+    stop();
+}
+
+void HttpServer::setName(const std::string& v) {
+    TcpServer::setName(v);
+    m_dispatch->setDefault(std::make_shared<NotFoundServlet>(v));
+}
+
+void HttpServer::stop() {
+    TcpServer::stop();
+    // 工作线程已退出，可以安全地关闭连接
+    for(auto& w : m_conns) {
+        w->conns.clear();
+        w->byId.clear();
+        w->polled.clear();
+        w->count = 0;
+    }
+}
+
+std::vector<size_t> HttpServer::getConnectionCounts() const {
+    std::vector<size_t> counts;
+    for(auto& w : m_conns) {
+        counts.push_back(w->count.load(std::memory_order_relaxed));
+    }
+    return counts;
+}
+
+void HttpServer::handleClient(Socket::ptr client) {
+    std::unique_ptr<Connection> conn(new Connection);
+    conn->sock = client;
+    conn->request.reset(new HttpRequest);
+    conn->response.reset(new HttpResponse);
+    conn->in.resize(g_http_server_buffer_size->getValue());
+    conn->deadline = Clock::CoarseMs() + getReadTimeout();
+    // 读写由 poll 驱动，socket 操作只尝试一次不等待
+    client->setRecvTimeout(0);
+    client->setSendTimeout(0);
+
+    WorkerConns& w = *m_conns[GetWorkerIndex()];
+    IoUring* ring = GetWorkerUring();
+    if(ring) {
+        conn->id = ++w.nextId;
+        conn->fixed = ring->updateFile(client->getSocket(), client->getSocket());
+        w.byId[conn->id] = conn.get();
+        armRecv(*ring, *conn);
+    } else if(!onRead(*conn)) {
+        // 新连接上通常已有请求到达，先读一次
+        return;
+    }
+    w.conns.push_back(std::move(conn));
+    w.count = w.conns.size();
+}
+
+int HttpServer::onPollPrepare(size_t worker, std::vector<pollfd>& fds) {
+    WorkerConns& w = *m_conns[worker];
+    uint64_t now = Clock::CoarseMs();
+    uint64_t next = (uint64_t)-1;
+    w.polled.clear();
+    for(size_t i = 0; i < w.conns.size();) {
+        Connection& conn = *w.conns[i];
+        if(conn.dead || conn.deadline <= now) {
+            if(!conn.dead) {
+                LOG_DEBUG(g_logger) << "http connection timeout: " << *conn.sock;
+                closeConn(w, conn);
+            }
+            w.conns[i] = std::move(w.conns.back());
+            w.conns.pop_back();
+            continue;
+        }
+        next = std::min(next, conn.deadline);
+        // io_uring 后端由 multishot recv 读取，只需等待可写
+        if(conn.id && !conn.hasOutput()) {
+            ++i;
+            continue;
+        }
+        w.polled.push_back(i);
+        pollfd pfd;
+        pfd.fd = conn.sock->getSocket();
+        // 有未写完的输出时只等可写，不再读入新请求
+        pfd.events = conn.hasOutput() ? POLLOUT : POLLIN;
+        pfd.revents = 0;
+        fds.push_back(pfd);
+        ++i;
+    }
+    w.count = w.conns.size();
+    return next == (uint64_t)-1 ? -1 : (int)std::min<uint64_t>(next - now, INT32_MAX);
+}
+
+void HttpServer::onPollEvents(size_t worker, pollfd* fds, size_t size) {
+    WorkerConns& w = *m_conns[worker];
+    // handleClient 新加入的连接不在 polled 中，本轮不处理
+    for(size_t i = 0; i < size; ++i) {
+        Connection& conn = *w.conns[w.polled[i]];
+        short ev = fds[i].revents;
+        if(!ev || conn.dead) {
+            continue;
+        }
+        bool ok = true;
+        if(conn.hasOutput()) {
+            ok = (ev & (POLLERR | POLLHUP)) == 0 && flush(conn);
+            if(ok && !conn.hasOutput()) {
+                // 输出排空后继续处理缓冲区里剩余的请求
+                ok = !conn.closing;
+                if(ok) {
+                    processInput(conn);
+                    ok = flush(conn) && (conn.hasOutput() || !conn.closing);
+                }
+            }
+            if(ok && conn.recvPaused && !conn.hasOutput()) {
+                // 取消仍未结束时由 recv 的最后一个完成事件重新提交
+                conn.recvPaused = false;
+                if(!conn.recvArmed) {
+                    armRecv(*GetWorkerUring(), conn);
+                }
+            }
+            conn.deadline = Clock::CoarseMs() + getReadTimeout();
+        } else {
+            ok = onRead(conn);
+        }
+        if(!ok) {
+            // 下一轮 onPollPrepare 时移除
+            closeConn(w, conn);
+        }
+    }
+}
+
+void HttpServer::onUringCompletion(size_t worker, const IoUring::Completion& c) {
+    WorkerConns& w = *m_conns[worker];
+    IoUring& ring = *GetWorkerUring();
+    uint16_t bid = 0;
+    bool has_buf = c.getBufferId(bid);
+    auto it = w.byId.find(c.data);
+    if(it == w.byId.end()) {
+        // 连接关闭前已在途的完成事件
+        if(has_buf) {
+            ring.recycleBuffer(bid);
+        }
+        return;
+    }
+    Connection& conn = *it->second;
+    if(!c.hasMore()) {
+        conn.recvArmed = false;
+    }
+    bool ok = true;
+    if(c.res > 0 && has_buf) {
+        size_t len = c.res;
+        if(conn.in.size() - conn.inEnd < len) {
+            if(conn.inBegin > 0) {
+                memmove(&conn.in[0], &conn.in[conn.inBegin], conn.inEnd - conn.inBegin);
+                conn.inEnd -= conn.inBegin;
+                conn.inBegin = 0;
+            }
+            while(conn.in.size() - conn.inEnd < len) {
+                conn.in.resize(conn.in.size() * 2);
+            }
+        }
+        memcpy(&conn.in[conn.inEnd], ring.getBuffer(bid), len);
+        conn.inEnd += len;
+        ring.recycleBuffer(bid);
+        conn.deadline = Clock::CoarseMs() + getReadTimeout();
+        if(!conn.hasOutput()) {
+            processInput(conn);
+            ok = flush(conn) && (conn.hasOutput() || !conn.closing);
+        } else if(!conn.recvPaused && conn.inEnd - conn.inBegin >= URING_MAX_PENDING_INPUT) {
+            // 对端只发不收，停止接收直到输出排空
+            conn.recvPaused = true;
+            io_uring_sqe* sqe = conn.recvArmed ? ring.getSqe() : nullptr;
+            if(sqe) {
+                IoUring::PrepCancel(sqe, MakeUringData(conn.id), 0);
+            }
+        }
+    } else if(c.res == 0) {
+        ok = false;
+    } else if(c.res < 0 && c.res != -ENOBUFS && c.res != -ECANCELED) {
+        LOG_DEBUG(g_logger) << "http io_uring recv fail errno=" << -c.res
+            << " errstr=" << strerror(-c.res) << " " << *conn.sock;
+        ok = false;
+    }
+    if(!ok) {
+        closeConn(w, conn);
+        return;
+    }
+    // 缓冲区用尽或内核结束了 multishot 时重新提交
+    if(!conn.recvArmed && !conn.recvPaused && !conn.closing) {
+        armRecv(ring, conn);
+    }
+}
+
+void HttpServer::armRecv(IoUring& ring, Connection& conn) {
+    io_uring_sqe* sqe = ring.getSqe();
+    if(!sqe) {
+        LOG_ERROR(g_logger) << "http io_uring submission queue full " << *conn.sock;
+        return;
+    }
+    IoUring::PrepRecvMultishot(sqe, conn.sock->getSocket(), conn.fixed, URING_BUFFER_GROUP,
+                               MakeUringData(conn.id));
+    conn.recvArmed = true;
+}
+
+void HttpServer::closeConn(WorkerConns& w, Connection& conn) {
+    if(conn.dead) {
+        return;
+    }
+    conn.dead = true;
+    if(conn.id) {
+        w.byId.erase(conn.id);
+        IoUring* ring = GetWorkerUring();
+        if(ring) {
+            // recv 持有文件引用，不取消的话 close 后连接也不会真正关闭
+            io_uring_sqe* sqe = conn.recvArmed ? ring->getSqe() : nullptr;
+            if(sqe) {
+                IoUring::PrepCancel(sqe, MakeUringData(conn.id), 0);
+            }
+            if(conn.fixed) {
+                ring->updateFile(conn.sock->getSocket(), -1);
+            }
+        }
+    }
+    conn.sock->close();
+}
+
+bool HttpServer::onRead(Connection& conn) {
+    while(true) {
+        if(conn.inEnd == conn.in.size()) {
+            if(conn.inBegin > 0) {
+                // 前面的消息已处理完，把未完成的消息移到缓冲区起点，Span 为相对消息起点的偏移不受影响
+                memmove(&conn.in[0], &conn.in[conn.inBegin], conn.inEnd - conn.inBegin);
+                conn.inEnd -= conn.inBegin;
+                conn.inBegin = 0;
+            } else {
+                conn.in.resize(conn.in.size() * 2);
+            }
+        }
+        size_t avail = conn.in.size() - conn.inEnd;
+        int n = conn.sock->recv(&conn.in[conn.inEnd], avail);
+        if(n == 0) {
+            return false;
+        }
+        if(n < 0) {
+            if(errno == ETIMEDOUT) {
+                break;
+            }
+            LOG_DEBUG(g_logger) << "http recv fail errno=" << errno
+                << " errstr=" << strerror(errno) << " " << *conn.sock;
+            return false;
+        }
+        conn.inEnd += n;
+        processInput(conn);
+        if(conn.hasOutput() || conn.closing || (size_t)n < avail) {
+            break;
+        }
+    }
+    conn.deadline = Clock::CoarseMs() + getReadTimeout();
+    if(!flush(conn)) {
+        return false;
+    }
+    return conn.hasOutput() || !conn.closing;
+}
+
+void HttpServer::processInput(Connection& conn) {
+    while(!conn.closing && conn.inBegin < conn.inEnd) {
+        char* base = &conn.in[conn.inBegin];
+        HttpParser::Result rt = conn.parser.execute(base, conn.inEnd - conn.inBegin);
+        if(rt == HttpParser::NEED_MORE) {
+            break;
+        }
+        HttpResponse& rsp = *conn.response;
+        if(rt == HttpParser::ERROR) {
+            LOG_DEBUG(g_logger) << "http parse error: " << conn.parser.getErrorString()
+                << " " << *conn.sock;
+            g_parse_errors->inc();
+            rsp.reset(0x11, true);
+            switch(conn.parser.getError()) {
+                case HttpParser::HEADER_TOO_LARGE:
+                case HttpParser::TOO_MANY_HEADERS:
+                    rsp.setStatus(HttpStatus::REQUEST_HEADER_FIELDS_TOO_LARGE);
+                    break;
+                case HttpParser::BODY_TOO_LARGE:
+                    rsp.setStatus(HttpStatus::PAYLOAD_TOO_LARGE);
+                    break;
+                case HttpParser::UNSUPPORTED_TRANSFER_ENCODING:
+                    rsp.setStatus(HttpStatus::NOT_IMPLEMENTED);
+                    break;
+                default:
+                    rsp.setStatus(HttpStatus::BAD_REQUEST);
+                    break;
+            }
+            enqueueResponse(conn, false);
+            return;
+        }
+
+        HttpRequest& req = *conn.request;
+        req.init(conn.parser, base);
+        rsp.reset(req.getVersion(), req.isClose() || !m_isKeepalive);
+        {
+            TRACE_SPAN("http.server.dispatch");
+            SLOW_SCOPE(g_logger, "http.server.dispatch", 200);
+            m_dispatch->handle(conn.request, conn.response, conn.sock);
+        }
+        g_requests->inc();
+        enqueueResponse(conn, req.getMethod() == HttpMethod::HEAD);
+
+        conn.inBegin += conn.parser.getConsumed();
+        conn.parser.reset();
+        if(conn.inBegin == conn.inEnd) {
+            conn.inBegin = conn.inEnd = 0;
+        }
+    }
+}
+
+void HttpServer::enqueueResponse(Connection& conn, bool head) {
+    HttpResponse& rsp = *conn.response;
+    std::string& header = conn.nextOut().data;
+    header.clear();
+    rsp.encodeHeader(header);
+    if(head) {
+    } else if(rsp.getFile() && rsp.getFileLength() < g_http_server_sendfile_min_size->getValue()) {
+        // 小文件多一次 sendfile 调用与一个单独的报文段反而更慢，直接读到头部之后一起发送
+        size_t len = rsp.getFileLength();
+        size_t pos = header.size();
+        header.resize(pos + len);
+        size_t got = 0;
+        while(got < len) {
+            ssize_t n = pread(rsp.getFile()->fd, &header[pos + got], len - got, rsp.getFileOffset() + got);
+            if(n < 0 && errno == EINTR) {
+                continue;
+            }
+            if(n <= 0) {
+                LOG_ERROR(g_logger) << "http pread fail file=" << rsp.getFile()->path
+                    << " errno=" << errno << " errstr=" << strerror(errno);
+                header.resize(pos + got);
+                conn.closing = true;
+                break;
+            }
+            got += n;
+        }
+    } else if(rsp.getFile()) {
+        OutBuf& buf = conn.nextOut();
+        buf.file = rsp.getFile();
+        buf.fileOffset = rsp.getFileOffset();
+        buf.fileLength = rsp.getFileLength();
+    } else if(!rsp.getBody().empty()) {
+        // 交换而非拷贝，响应对象拿到的旧缓冲区在下次 reset 时清空
+        conn.nextOut().data.swap(rsp.getBody());
+    }
+    if(rsp.isClose()) {
+        conn.closing = true;
+    }
+}
+
+bool HttpServer::flush(Connection& conn) {
+    while(conn.hasOutput()) {
+        OutBuf& first = conn.out[conn.outBegin];
+        size_t sent = 0;
+        if(first.file) {
+            off_t off = first.fileOffset + conn.outOffset;
+            size_t len = std::min<uint64_t>(first.fileLength - conn.outOffset, 0x7ffff000);
+            ssize_t rt;
+            do {
+                rt = sendfile(conn.sock->getSocket(), first.file->fd, &off, len);
+            } while(rt < 0 && errno == EINTR);
+            if(rt < 0) {
+                if(errno == EAGAIN || errno == EWOULDBLOCK) {
+                    return true;
+                }
+                LOG_DEBUG(g_logger) << "http sendfile fail errno=" << errno
+                    << " errstr=" << strerror(errno) << " " << *conn.sock;
+                return false;
+            }
+            if(rt == 0) {
+                // 文件在发送过程中被截断，无法再满足已声明的 Content-Length
+                LOG_ERROR(g_logger) << "http sendfile eof file=" << first.file->path;
+                return false;
+            }
+            sent = rt;
+        } else {
+            iovec iov[MAX_IOV];
+            size_t n = 0;
+            for(size_t i = conn.outBegin; i < conn.outEnd && n < MAX_IOV && !conn.out[i].file; ++i, ++n) {
+                size_t off = i == conn.outBegin ? conn.outOffset : 0;
+                iov[n].iov_base = &conn.out[i].data[0] + off;
+                iov[n].iov_len = conn.out[i].data.size() - off;
+            }
+            int rt = conn.sock->send(iov, n);
+            if(rt < 0) {
+                if(errno == ETIMEDOUT) {
+                    return true;
+                }
+                LOG_DEBUG(g_logger) << "http send fail errno=" << errno
+                    << " errstr=" << strerror(errno) << " " << *conn.sock;
+                return false;
+            }
+            sent = rt;
+        }
+        while(sent > 0) {
+            OutBuf& buf = conn.out[conn.outBegin];
+            size_t left = buf.size() - conn.outOffset;
+            if(sent < left) {
+                conn.outOffset += sent;
+                break;
+            }
+            sent -= left;
+            conn.outOffset = 0;
+            // 尽早释放文件引用
+            buf.file.reset();
+            ++conn.outBegin;
+        }
+    }
+    conn.outBegin = conn.outEnd = conn.outOffset = 0;
+    return true;
+}
+
+}
+}
@@ -0,0 +1,119 @@
+#ifndef __MYSERVER_HTTP_SERVER_H__
+#define __MYSERVER_HTTP_SERVER_H__
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include "tcp_server.h"
+#include "http.h"
+#include "http_parser.h"
+#include "servlet.h"
+#include "file_cache.h"
+
+namespace myserver {
+namespace http {
+
+/**
+ * @brief HTTP/1.1 服务器
+ * @details 连接由接收它的工作线程通过 TcpServer 的 poll 扩展点多路复用处理，不跨线程转交。
+ *          每个连接复用一个输入缓冲区、解析器和请求/响应对象，稳定后处理请求不再分配内存。
+ *          一次读到的多个流水线请求依次分发，响应按顺序排队后用一次 sendmsg(iovec)
+ *          聚合写出，状态行+头部与消息体是各自独立的 iovec，消息体不拷贝；
+ *          文件消息体用 sendfile 从页缓存直接发送，不经过用户态缓冲区(小于 http.server.sendfile_min_size 的随头部一起写出)。
+ *          写不完时停止读取该连接直到输出排空；连接空闲超过读超时后关闭。
+ *          io_uring 后端下每个连接注册为固定文件并提交一个 multishot recv，数据由内核写入提供缓冲区，
+ *          读不再需要系统调用；只有输出未写完的连接才加入 poll 等待可写
+ */
+class HttpServer : public TcpServer {
+public:
+    typedef std::shared_ptr<HttpServer> ptr;
+
+    /**
+     * @brief 构造函数
+     * @param[in] keepalive 是否支持长连接
+     * @param[in] worker_count 工作线程数，0 表示使用配置 tcp_server.workers
+     */
+    HttpServer(bool keepalive = true, size_t worker_count = 0);
+    ~HttpServer();
+
+    ServletDispatch::ptr getServletDispatch() const { return m_dispatch; }
+    void setServletDispatch(ServletDispatch::ptr v) { m_dispatch = v; }
+
+    void setName(const std::string& v) override;
+    void stop() override;
+
+    // 各工作线程当前的连接数
+    std::vector<size_t> getConnectionCounts() const;
+protected:
+    void handleClient(Socket::ptr client) override;
+    int onPollPrepare(size_t worker, std::vector<pollfd>& fds) override;
+    void onPollEvents(size_t worker, pollfd* fds, size_t size) override;
+    void onUringCompletion(size_t worker, const IoUring::Completion& c) override;
+private:
+    // 待发送的一段数据：内存缓冲区或文件的一段
+    struct OutBuf {
+        std::string data;
+        std::shared_ptr<CachedFile> file;
+        uint64_t fileOffset = 0;
+        uint64_t fileLength = 0;
+
+        uint64_t size() const { return file ? fileLength : data.size(); }
+    };
+
+    struct Connection {
+        Socket::ptr sock;
+        HttpParser parser;
+        HttpRequest::ptr request;
+        HttpResponse::ptr response;
+        std::vector<char> in;           // 输入缓冲区
+        size_t inBegin = 0;             // 当前消息起点
+        size_t inEnd = 0;               // 已读数据末尾
+        std::vector<OutBuf> out;        // 待发送的缓冲区，复用其中字符串的容量
+        size_t outBegin = 0;
+        size_t outEnd = 0;
+        size_t outOffset = 0;           // out[outBegin] 已发送的字节数
+        uint64_t deadline = 0;          // 空闲超时时间点(毫秒)
+        bool closing = false;           // 输出排空后关闭
+        uint64_t id = 0;                // io_uring 后端的连接号，poll 后端为0
+        bool fixed = false;             // 已注册为固定文件
+        bool recvArmed = false;         // 有未结束的 multishot recv
+        bool recvPaused = false;        // 输出积压，已取消 recv
+        bool dead = false;              // 已关闭，下一轮移除
+
+        bool hasOutput() const { return outBegin < outEnd; }
+        // 取一个空闲的输出缓冲区
+        OutBuf& nextOut();
+    };
+
+    struct WorkerConns {
+        std::vector<std::unique_ptr<Connection> > conns;
+        std::atomic<size_t> count;
+        std::unordered_map<uint64_t, Connection*> byId;     // io_uring 后端按连接号查找
+        std::vector<size_t> polled;                         // 本轮加入 poll 的连接下标
+        uint64_t nextId = 0;
+        WorkerConns() : count(0) {}
+    };
+
+    // 读取并处理请求，返回 false 时关闭连接
+    bool onRead(Connection& conn);
+    // 分发缓冲区内全部完整的请求
+    void processInput(Connection& conn);
+    // 把响应加入输出队列
+    void enqueueResponse(Connection& conn, bool head);
+    // 尽量写出输出队列，出错返回 false
+    bool flush(Connection& conn);
+    // 提交连接的 multishot recv
+    void armRecv(IoUring& ring, Connection& conn);
+    // 关闭连接，io_uring 后端下同时取消 recv 并释放固定文件槽位
+    void closeConn(WorkerConns& w, Connection& conn);
+private:
+    bool m_isKeepalive;
+    ServletDispatch::ptr m_dispatch;
+    std::vector<std::unique_ptr<WorkerConns> > m_conns;
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,196 @@
+#include "servlet.h"
+#include <fnmatch.h>
+#include "clock.h"
+#include "log.h"
+
+namespace myserver {
+namespace http {
+
+// 访问日志默认不输出，配置 http.access 的级别为 debug 后记录每个请求的路由与耗时
+static myserver::Logger::ptr g_logger = []() {
+    myserver::Logger::ptr logger = LOGGER_NAME("http.access");
+    logger->setLevel(myserver::LogLevel::INFO);
+    return logger;
+}();
+
+FunctionServlet::FunctionServlet(callback cb)
+    :Servlet("FunctionServlet")
+    ,m_cb(cb) {
+}
+
+int32_t FunctionServlet::handle(HttpRequest::ptr request, HttpResponse::ptr response,
+                                Socket::ptr session) {
+    return m_cb(request, response, session);
+}
+
+NotFoundServlet::NotFoundServlet(const std::string& name)
+    :Servlet("NotFoundServlet") {
+    m_content = "<html><head><title>404 Not Found"
+        "</title></head><body><center><h1>404 Not Found</h1></center>"
+        "<hr><center>" + name + "</center></body></html>";
+}
+
+int32_t NotFoundServlet::handle(HttpRequest::ptr request, HttpResponse::ptr response,
+                                Socket::ptr session) {
+    response->setStatus(HttpStatus::NOT_FOUND);
+    response->setHeader("Content-Type", "text/html");
+    response->setBody(m_content);
+    return 0;
+}
+
+ServletDispatch::ServletDispatch()
+    :Servlet("ServletDispatch") {
+    m_table.def.pattern = "<default>";
+    m_table.def.servlet.reset(new NotFoundServlet("myserver/1.0"));
+}
+
+ServletDispatch::~ServletDispatch() {
+}
+
+void ServletDispatch::RouteTable::addExact(const std::string& uri, Servlet::ptr slt) {
+    Route& r = exact[uri];
+    r.pattern = uri;
+    r.servlet = slt;
+}
+
+void ServletDispatch::RouteTable::addGlob(const std::string& uri, Servlet::ptr slt) {
+    for(auto& i : globs) {
+        if(i.pattern == uri) {
+            i.servlet = slt;
+            return;
+        }
+    }
+    Route r;
+    r.pattern = uri;
+    r.servlet = slt;
+    globs.push_back(r);
+}
+
+const ServletDispatch::Route* ServletDispatch::Match(const RouteTable& table,
+                                                     const std::string& uri) {
+    auto it = table.exact.find(uri);
+    if(it != table.exact.end()) {
+        return &it->second;
+    }
+    for(auto& i : table.globs) {
+        if(!fnmatch(i.pattern.c_str(), uri.c_str(), 0)) {
+            return &i;
+        }
+    }
+    return &table.def;
+}
+
+int32_t ServletDispatch::handle(HttpRequest::ptr request, HttpResponse::ptr response,
+                                Socket::ptr session) {
+    // 读锁内只查找路由，处理期间路由变更不影响已取得的 Servlet
+    bool access = g_logger->getLevel() <= LogLevel::DEBUG;
+    Servlet::ptr slt;
+    std::string pattern;
+    {
+        MutexType::ReadLock lock(m_mutex);
+        const Route* route = Match(m_table, request->getPath());
+        slt = route->servlet;
+        if(access) {
+            pattern = route->pattern;
+        }
+    }
+    if(!access) {
+        return slt->handle(request, response, session);
+    }
+    uint64_t begin = Clock::NowUs();
+    int32_t rt = slt->handle(request, response, session);
+    LOG_DEBUG(g_logger) << HttpMethodToString(request->getMethod())
+        << " " << request->getPath()
+        << " route=" << pattern
+        << " status=" << (int)response->getStatus()
+        << " cost_us=" << Clock::NowUs() - begin;
+    return rt;
+}
+
+void ServletDispatch::addServlet(const std::string& uri, Servlet::ptr slt) {
+    MutexType::WriteLock lock(m_mutex);
+    m_table.addExact(uri, slt);
+}
+
+void ServletDispatch::addServlet(const std::string& uri, FunctionServlet::callback cb) {
+    addServlet(uri, std::make_shared<FunctionServlet>(cb));
+}
+
+void ServletDispatch::addGlobServlet(const std::string& uri, Servlet::ptr slt) {
+    MutexType::WriteLock lock(m_mutex);
+    m_table.addGlob(uri, slt);
+}
+
+void ServletDispatch::addGlobServlet(const std::string& uri, FunctionServlet::callback cb) {
+    addGlobServlet(uri, std::make_shared<FunctionServlet>(cb));
+}
+
+void ServletDispatch::addServlets(const std::vector<std::pair<std::string, Servlet::ptr> >& servlets) {
+    MutexType::WriteLock lock(m_mutex);
+    for(auto& i : servlets) {
+        m_table.addExact(i.first, i.second);
+    }
+}
+
+void ServletDispatch::addGlobServlets(const std::vector<std::pair<std::string, Servlet::ptr> >& servlets) {
+    MutexType::WriteLock lock(m_mutex);
+    for(auto& i : servlets) {
+        m_table.addGlob(i.first, i.second);
+    }
+}
+
+void ServletDispatch::delServlet(const std::string& uri) {
+    Servlet::ptr slt;   // 在写锁外析构被删除的 Servlet
+    MutexType::WriteLock lock(m_mutex);
+    auto it = m_table.exact.find(uri);
+    if(it != m_table.exact.end()) {
+        slt.swap(it->second.servlet);
+        m_table.exact.erase(it);
+    }
+}
+
+void ServletDispatch::delGlobServlet(const std::string& uri) {
+    Servlet::ptr slt;
+    MutexType::WriteLock lock(m_mutex);
+    for(auto it = m_table.globs.begin(); it != m_table.globs.end(); ++it) {
+        if(it->pattern == uri) {
+            slt.swap(it->servlet);
+            m_table.globs.erase(it);
+            break;
+        }
+    }
+}
+
+Servlet::ptr ServletDispatch::getDefault() const {
+    MutexType::ReadLock lock(m_mutex);
+    return m_table.def.servlet;
+}
+
+void ServletDispatch::setDefault(Servlet::ptr v) {
+    MutexType::WriteLock lock(m_mutex);
+    m_table.def.servlet = v;
+}
+
+Servlet::ptr ServletDispatch::getServlet(const std::string& uri) const {
+    MutexType::ReadLock lock(m_mutex);
+    auto it = m_table.exact.find(uri);
+    return it == m_table.exact.end() ? nullptr : it->second.servlet;
+}
+
+Servlet::ptr ServletDispatch::getGlobServlet(const std::string& uri) const {
+    MutexType::ReadLock lock(m_mutex);
+    for(auto& i : m_table.globs) {
+    if(!fnmatch(i.pattern.c_str(), uri.c_str(), 0)) {
+        return i.servlet;
+    }
+    }
+    return nullptr;
+}
+
+Servlet::ptr ServletDispatch::getMatchedServlet(const std::string& uri) const {
+    MutexType::ReadLock lock(m_mutex);
+    return Match(m_table, uri)->servlet;
+}
+
+}
+}
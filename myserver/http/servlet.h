@@ -0,0 +1,135 @@
+#ifndef __MYSERVER_HTTP_SERVLET_H__
+#define __MYSERVER_HTTP_SERVLET_H__
+
+#include <memory>
+#include <functional>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "http.h"
+#include "socket.h"
+#include "mutex.h"
+
+namespace myserver {
+namespace http {
+
+/**
+ * @brief Servlet 封装
+ * @details handle 在连接所属的工作线程上调用，同一个 Servlet 会被多个线程并发调用
+ */
+class Servlet {
+public:
+    typedef std::shared_ptr<Servlet> ptr;
+
+    Servlet(const std::string& name)
+        :m_name(name) {}
+    virtual ~Servlet() {}
+
+    /**
+     * @brief 处理请求
+     * @param[in] request HTTP请求
+     * @param[out] response HTTP响应
+     * @param[in] session 客户端连接
+     * @return 是否处理成功
+     */
+    virtual int32_t handle(HttpRequest::ptr request, HttpResponse::ptr response,
+                           Socket::ptr session) = 0;
+
+    const std::string& getName() const { return m_name; }
+protected:
+    std::string m_name;
+};
+
+// 函数式 Servlet
+class FunctionServlet : public Servlet {
+public:
+    typedef std::shared_ptr<FunctionServlet> ptr;
+    typedef std::function<int32_t (HttpRequest::ptr request, HttpResponse::ptr response,
+                                   Socket::ptr session)> callback;
+
+    FunctionServlet(callback cb);
+    int32_t handle(HttpRequest::ptr request, HttpResponse::ptr response,
+                   Socket::ptr session) override;
+private:
+    callback m_cb;
+};
+
+// 默认返回 404 的 Servlet
+class NotFoundServlet : public Servlet {
+public:
+    typedef std::shared_ptr<NotFoundServlet> ptr;
+
+    NotFoundServlet(const std::string& name);
+    int32_t handle(HttpRequest::ptr request, HttpResponse::ptr response,
+                   Socket::ptr session) override;
+private:
+    std::string m_content;
+};
+
+/**
+ * @brief Servlet 分发器
+ * @details 支持精确匹配与 fnmatch 通配匹配，精确匹配优先，通配按添加顺序匹配，都未命中交给默认 Servlet。
+ *          路由表由读偏向的 BRWMutex 保护：分发时读锁只覆盖查找路由与复制命中的 Servlet 指针，
+ *          读者只修改自己独占缓存行的计数槽，没有写者时互不竞争；Servlet::handle 在锁外执行。
+ *          路由变更在写锁内原地修改，不复制路由表，被替换/删除的 Servlet 在正在处理的请求结束后即释放。
+ *          批量接口 addServlets 等整批只获取一次写锁。
+ *          logger http.access 级别为 DEBUG 时(默认 INFO)记录每个请求命中的路由与处理耗时
+ */
+class ServletDispatch : public Servlet {
+public:
+    typedef std::shared_ptr<ServletDispatch> ptr;
+    typedef BRWMutex MutexType;
+
+    ServletDispatch();
+    ~ServletDispatch();
+
+    int32_t handle(HttpRequest::ptr request, HttpResponse::ptr response,
+                   Socket::ptr session) override;
+
+    // 添加精确匹配的 Servlet，已存在则覆盖
+    void addServlet(const std::string& uri, Servlet::ptr slt);
+    void addServlet(const std::string& uri, FunctionServlet::callback cb);
+    // 添加通配匹配的 Servlet，如 /static/*
+    void addGlobServlet(const std::string& uri, Servlet::ptr slt);
+    void addGlobServlet(const std::string& uri, FunctionServlet::callback cb);
+    // 批量添加，整批只获取一次写锁
+    void addServlets(const std::vector<std::pair<std::string, Servlet::ptr> >& servlets);
+    void addGlobServlets(const std::vector<std::pair<std::string, Servlet::ptr> >& servlets);
+
+    void delServlet(const std::string& uri);
+    void delGlobServlet(const std::string& uri);
+
+    Servlet::ptr getDefault() const;
+    void setDefault(Servlet::ptr v);
+
+    // 精确/通配查找，不存在返回 nullptr
+    Servlet::ptr getServlet(const std::string& uri) const;
+    Servlet::ptr getGlobServlet(const std::string& uri) const;
+    // 按分发规则查找
+    Servlet::ptr getMatchedServlet(const std::string& uri) const;
+private:
+    struct Route {
+        std::string pattern;
+        Servlet::ptr servlet;
+    };
+
+    struct RouteTable {
+        std::unordered_map<std::string, Route> exact;
+        std::vector<Route> globs;
+        Route def;
+
+        void addExact(const std::string& uri, Servlet::ptr slt);
+        void addGlob(const std::string& uri, Servlet::ptr slt);
+    };
+
+    static const Route* Match(const RouteTable& table, const std::string& uri);
+private:
+    RouteTable m_table;
+    // 读者查找路由时持读锁，写者持写锁原地修改路由表
+    mutable MutexType m_mutex;
+};
+
+}
+}
+
+#endif
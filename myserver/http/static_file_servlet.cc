@@ -0,0 +1,230 @@
+#include "static_file_servlet.h"
+#include <ctype.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <algorithm>
+
+namespace myserver {
+namespace http {
+
+struct ContentTypeItem {
+    const char* ext;
+    const char* type;
+};
+
+static const ContentTypeItem s_content_types[] = {
+    {"html", "text/html"},
+    {"htm", "text/html"},
+    {"css", "text/css"},
+    {"js", "application/javascript"},
+    {"json", "application/json"},
+    {"txt", "text/plain"},
+    {"xml", "text/xml"},
+    {"png", "image/png"},
+    {"jpg", "image/jpeg"},
+    {"jpeg", "image/jpeg"},
+    {"gif", "image/gif"},
+    {"svg", "image/svg+xml"},
+    {"ico", "image/x-icon"},
+    {"webp", "image/webp"},
+    {"woff", "font/woff"},
+    {"woff2", "font/woff2"},
+    {"pdf", "application/pdf"},
+    {"mp4", "video/mp4"},
+    {"wasm", "application/wasm"},
+};
+
+const char* StaticFileServlet::GetContentType(const std::string& path) {
+    size_t dot = path.rfind('.');
+    if(dot == std::string::npos || path.find('/', dot) != std::string::npos) {
+        return "application/octet-stream";
+    }
+    const char* ext = path.c_str() + dot + 1;
+    for(auto& i : s_content_types) {
+        if(strcasecmp(i.ext, ext) == 0) {
+            return i.type;
+        }
+    }
+    return "application/octet-stream";
+}
+
+// 解码 %XX，非法编码或解出 NUL 时返回 false
+static bool UrlDecode(const std::string& in, std::string& out) {
+    out.clear();
+    out.reserve(in.size());
+    for(size_t i = 0; i < in.size(); ++i) {
+        if(in[i] != '%') {
+            out.push_back(in[i]);
+            continue;
+        }
+        if(i + 2 >= in.size() || !isxdigit((unsigned char)in[i + 1])
+                || !isxdigit((unsigned char)in[i + 2])) {
+            return false;
+        }
+        char hex[3] = {in[i + 1], in[i + 2], 0};
+        char c = (char)strtol(hex, nullptr, 16);
+        if(c == 0) {
+            return false;
+        }
+        out.push_back(c);
+        i += 2;
+    }
+    return true;
+}
+
+// 是否含有 ".." 路径段
+static bool HasDotDot(const std::string& path) {
+    size_t pos = 0;
+    while((pos = path.find("..", pos)) != std::string::npos) {
+        bool begin = pos == 0 || path[pos - 1] == '/';
+        bool end = pos + 2 == path.size() || path[pos + 2] == '/';
+        if(begin && end) {
+            return true;
+        }
+        pos += 2;
+    }
+    return false;
+}
+
+int StaticFileServlet::ParseRange(const std::string& range, uint64_t size,
+                                  uint64_t& offset, uint64_t& length) {
+    if(range.compare(0, 6, "bytes=") != 0 || range.find(',') != std::string::npos) {
+        return -1;
+    }
+    const char* p = range.c_str() + 6;
+    const char* dash = strchr(p, '-');
+    if(!dash) {
+        return -1;
+    }
+    auto parse = [](const char* b, const char* e, uint64_t& v) {
+        if(b == e) {
+            return false;
+        }
+        v = 0;
+        for(; b < e; ++b) {
+            if(*b < '0' || *b > '9' || v > (UINT64_MAX - 9) / 10) {
+                return false;
+            }
+            v = v * 10 + (*b - '0');
+        }
+        return true;
+    };
+    const char* end = range.c_str() + range.size();
+    uint64_t first = 0;
+    uint64_t last = 0;
+    if(p == dash) {
+        // bytes=-n 最后 n 个字节
+        if(!parse(dash + 1, end, last)) {
+            return -1;
+        }
+        if(last == 0 || size == 0) {
+            return 0;
+        }
+        length = std::min(last, size);
+        offset = size - length;
+        return 1;
+    }
+    if(!parse(p, dash, first)) {
+        return -1;
+    }
+    if(dash + 1 == end) {
+        last = size ? size - 1 : 0;
+    } else if(!parse(dash + 1, end, last) || last < first) {
+        return -1;
+    }
+    if(first >= size) {
+        return 0;
+    }
+    last = std::min(last, size - 1);
+    offset = first;
+    length = last - first + 1;
+    return 1;
+}
+
+static std::string HttpDate(time_t t) {
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    char buf[64];
+    strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    return buf;
+}
+
+StaticFileServlet::StaticFileServlet(const std::string& root, const std::string& prefix,
+                                     FileCache::ptr cache)
+    :Servlet("StaticFileServlet")
+    ,m_root(root)
+    ,m_prefix(prefix)
+    ,m_cache(cache ? cache : std::make_shared<FileCache>()) {
+    while(!m_root.empty() && m_root.back() == '/') {
+        m_root.pop_back();
+    }
+}
+
+int32_t StaticFileServlet::handle(HttpRequest::ptr request, HttpResponse::ptr response,
+                                  Socket::ptr session) {
+    if(request->getMethod() != HttpMethod::GET && request->getMethod() != HttpMethod::HEAD) {
+        response->setStatus(HttpStatus::METHOD_NOT_ALLOWED);
+        response->setHeader("Allow", "GET, HEAD");
+        return 0;
+    }
+    const std::string& uri = request->getPath();
+    std::string rel;
+    if(uri.compare(0, m_prefix.size(), m_prefix) != 0
+            || !UrlDecode(uri.substr(m_prefix.size()), rel)
+            || HasDotDot(rel)) {
+        response->setStatus(HttpStatus::FORBIDDEN);
+        return 0;
+    }
+    if(rel.empty() || rel[0] != '/') {
+        rel.insert(rel.begin(), '/');
+    }
+
+    int err = 0;
+    CachedFile::ptr file = m_cache->open(m_root + rel, &err);
+    if(!file) {
+        response->setStatus(err == EACCES ? HttpStatus::FORBIDDEN : HttpStatus::NOT_FOUND);
+        return 0;
+    }
+
+    uint64_t size = file->st.st_size;
+    char etag[64];
+    snprintf(etag, sizeof(etag), "\"%llx-%llx\"",
+             (unsigned long long)file->st.st_mtime, (unsigned long long)size);
+    response->setHeader("ETag", etag);
+    response->setHeader("Last-Modified", HttpDate(file->st.st_mtime));
+    response->setHeader("Accept-Ranges", "bytes");
+    if(request->getHeader("If-None-Match") == etag) {
+        response->setStatus(HttpStatus::NOT_MODIFIED);
+        return 0;
+    }
+    response->setHeader("Content-Type", GetContentType(rel));
+
+    uint64_t offset = 0;
+    uint64_t length = size;
+    std::string range;
+    if(request->hasHeader("Range", &range)) {
+        int rt = ParseRange(range, size, offset, length);
+        if(rt == 0) {
+            response->setStatus(HttpStatus::RANGE_NOT_SATISFIABLE);
+            response->setHeader("Content-Range", "bytes */" + std::to_string(size));
+            return 0;
+        } else if(rt > 0) {
+            response->setStatus(HttpStatus::PARTIAL_CONTENT);
+            response->setHeader("Content-Range", "bytes " + std::to_string(offset) + "-"
+                    + std::to_string(offset + length - 1) + "/" + std::to_string(size));
+        } else {
+            offset = 0;
+            length = size;
+        }
+    }
+    response->setFile(file, offset, length);
+    return 0;
+}
+
+}
+}
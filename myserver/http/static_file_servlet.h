@@ -0,0 +1,58 @@
+#ifndef __MYSERVER_HTTP_STATIC_FILE_SERVLET_H__
+#define __MYSERVER_HTTP_STATIC_FILE_SERVLET_H__
+
+#include <string>
+#include "servlet.h"
+#include "file_cache.h"
+
+namespace myserver {
+namespace http {
+
+/**
+ * @brief 静态文件 Servlet
+ * @details 把 uri 去掉前缀后映射到根目录下的文件，通过 FileCache 取得已打开的fd与 stat 结果，
+ *          热点文件不再调用 open / stat；消息体以文件段的形式交给 HttpServer 用 sendfile 发送。
+ *          支持 GET / HEAD、单个 Range(bytes=a-b / a- / -n)与 If-None-Match 协商缓存，
+ *          含 ".." 路径段的请求被拒绝
+ */
+class StaticFileServlet : public Servlet {
+public:
+    typedef std::shared_ptr<StaticFileServlet> ptr;
+
+    /**
+     * @brief 构造函数
+     * @param[in] root 根目录
+     * @param[in] prefix 路由前缀，uri 去掉前缀后作为根目录下的相对路径
+     * @param[in] cache 文件缓存，为空时创建一个独立的缓存
+     */
+    StaticFileServlet(const std::string& root, const std::string& prefix = "",
+                      FileCache::ptr cache = nullptr);
+
+    int32_t handle(HttpRequest::ptr request, HttpResponse::ptr response,
+                   Socket::ptr session) override;
+
+    FileCache::ptr getFileCache() const { return m_cache; }
+
+    /**
+     * @brief 解析单个 Range 头
+     * @param[in] range Range 头的值
+     * @param[in] size 文件大小
+     * @param[out] offset 起始偏移
+     * @param[out] length 长度
+     * @return 1 有效范围，0 无法满足(416)，-1 格式不支持(按整个文件返回)
+     */
+    static int ParseRange(const std::string& range, uint64_t size,
+                          uint64_t& offset, uint64_t& length);
+
+    // 根据扩展名返回 Content-Type
+    static const char* GetContentType(const std::string& path);
+private:
+    std::string m_root;
+    std::string m_prefix;
+    FileCache::ptr m_cache;
+};
+
+}
+}
+
+#endif
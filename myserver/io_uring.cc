@@ -0,0 +1,478 @@
+#include "io_uring.h"
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <atomic>
+#include <algorithm>
+#include "log.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define MYSERVER_IO_URING 1
+#endif
+#endif
+
+namespace myserver {
+
+static myserver::Logger::ptr g_logger = LOGGER_NAME("system");
+
+IoUring::IoUring()
+    :m_fd(-1)
+    ,m_sqpoll(false)
+    ,m_sqRing(nullptr)
+    ,m_sqRingSize(0)
+    ,m_cqRing(nullptr)
+    ,m_cqRingSize(0)
+    ,m_sqes(nullptr)
+    ,m_sqesSize(0)
+    ,m_sqHead(nullptr)
+    ,m_sqTail(nullptr)
+    ,m_sqFlags(nullptr)
+    ,m_sqArray(nullptr)
+    ,m_sqMask(0)
+    ,m_sqEntries(0)
+    ,m_sqeTail(0)
+    ,m_cqHead(nullptr)
+    ,m_cqTail(nullptr)
+    ,m_cqMask(0)
+    ,m_cqes(nullptr)
+    ,m_fileCount(0)
+    ,m_bufRing(nullptr)
+    ,m_bufRingSize(0)
+    ,m_bufBase(nullptr)
+    ,m_bufSize(0)
+    ,m_bufCount(0)
+    ,m_bufTail(0)
+    ,m_features(0)
+    ,m_enterCount(0) {
+}
+
+IoUring::~IoUring() {
+    destroy();
+}
+
+void IoUring::destroy() {
+    // 关闭 ring 时内核取消全部未完成的请求并释放固定文件
+    if(m_fd >= 0) {
+        close(m_fd);
+        m_fd = -1;
+    }
+    if(m_bufRing) {
+        munmap(m_bufRing, m_bufRingSize);
+        m_bufRing = nullptr;
+    }
+    if(m_bufBase) {
+        munmap(m_bufBase, (size_t)m_bufCount * m_bufSize);
+        m_bufBase = nullptr;
+    }
+    if(m_sqes) {
+        munmap(m_sqes, m_sqesSize);
+        m_sqes = nullptr;
+    }
+    if(m_cqRing && m_cqRing != m_sqRing) {
+        munmap(m_cqRing, m_cqRingSize);
+    }
+    m_cqRing = nullptr;
+    if(m_sqRing) {
+        munmap(m_sqRing, m_sqRingSize);
+        m_sqRing = nullptr;
+    }
+}
+
+#ifdef MYSERVER_IO_URING
+
+static int SysSetup(uint32_t entries, io_uring_params* p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int SysEnter(int fd, uint32_t to_submit, uint32_t min_complete, uint32_t flags,
+                    const void* arg, size_t argsz) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz);
+}
+
+static int SysRegister(int fd, uint32_t opcode, const void* arg, uint32_t nr) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr);
+}
+
+bool IoUring::Completion::hasMore() const {
+    return flags & IORING_CQE_F_MORE;
+}
+
+bool IoUring::Completion::getBufferId(uint16_t& bid) const {
+    if(!(flags & IORING_CQE_F_BUFFER)) {
+        return false;
+    }
+    bid = flags >> IORING_CQE_BUFFER_SHIFT;
+    return true;
+}
+
+bool IoUring::init(uint32_t entries, bool sqpoll, uint32_t sqpoll_idle_ms) {
+    destroy();
+    io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    p.flags = IORING_SETUP_CQSIZE;
+    p.cq_entries = entries * 4;
+    if(sqpoll) {
+        p.flags |= IORING_SETUP_SQPOLL;
+        p.sq_thread_idle = sqpoll_idle_ms;
+    } else {
+        // 完成事件在下次进入内核时处理，不打断工作线程
+        p.flags |= IORING_SETUP_COOP_TASKRUN | IORING_SETUP_TASKRUN_FLAG;
+    }
+    m_fd = SysSetup(entries, &p);
+    if(m_fd < 0 && errno == EINVAL && !sqpoll) {
+        p.flags &= ~(IORING_SETUP_COOP_TASKRUN | IORING_SETUP_TASKRUN_FLAG);
+        m_fd = SysSetup(entries, &p);
+    }
+    if(m_fd < 0) {
+        return false;
+    }
+    m_sqpoll = sqpoll;
+    m_features = p.features;
+
+    m_sqRingSize = p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+    m_cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+    if(single) {
+        m_sqRingSize = m_cqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+    }
+    m_sqRing = mmap(nullptr, m_sqRingSize, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+    if(m_sqRing == MAP_FAILED) {
+        m_sqRing = nullptr;
+        int err = errno;
+        destroy();
+        errno = err;
+        return false;
+    }
+    if(single) {
+        m_cqRing = m_sqRing;
+    } else {
+        m_cqRing = mmap(nullptr, m_cqRingSize, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+        if(m_cqRing == MAP_FAILED) {
+            m_cqRing = nullptr;
+            int err = errno;
+            destroy();
+            errno = err;
+            return false;
+        }
+    }
+    m_sqesSize = p.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES);
+    if(sqes == MAP_FAILED) {
+        int err = errno;
+        destroy();
+        errno = err;
+        return false;
+    }
+    m_sqes = (io_uring_sqe*)sqes;
+
+    char* sq = (char*)m_sqRing;
+    m_sqHead = (uint32_t*)(sq + p.sq_off.head);
+    m_sqTail = (uint32_t*)(sq + p.sq_off.tail);
+    m_sqFlags = (uint32_t*)(sq + p.sq_off.flags);
+    m_sqArray = (uint32_t*)(sq + p.sq_off.array);
+    m_sqMask = *(uint32_t*)(sq + p.sq_off.ring_mask);
+    m_sqEntries = *(uint32_t*)(sq + p.sq_off.ring_entries);
+    m_sqeTail = *m_sqTail;
+    // SQE 按顺序使用，间接数组固定为恒等映射
+    for(uint32_t i = 0; i < m_sqEntries; ++i) {
+        m_sqArray[i] = i;
+    }
+
+    char* cq = (char*)m_cqRing;
+    m_cqHead = (uint32_t*)(cq + p.cq_off.head);
+    m_cqTail = (uint32_t*)(cq + p.cq_off.tail);
+    m_cqMask = *(uint32_t*)(cq + p.cq_off.ring_mask);
+    m_cqes = cq + p.cq_off.cqes;
+    return true;
+}
+
+io_uring_sqe* IoUring::getSqe() {
+    if(m_fd < 0) {
+        return nullptr;
+    }
+    uint32_t head = __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE);
+    if(m_sqeTail - head >= m_sqEntries) {
+        submit();
+        head = __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE);
+        if(m_sqeTail - head >= m_sqEntries) {
+            return nullptr;
+        }
+    }
+    io_uring_sqe* sqe = &m_sqes[m_sqeTail & m_sqMask];
+    memset(sqe, 0, sizeof(*sqe));
+    ++m_sqeTail;
+    return sqe;
+}
+
+uint32_t IoUring::flushSq() {
+    __atomic_store_n(m_sqTail, m_sqeTail, __ATOMIC_RELEASE);
+    return m_sqeTail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE);
+}
+
+int IoUring::submit(uint32_t wait_nr, int timeout_ms) {
+    if(m_fd < 0) {
+        return -EBADF;
+    }
+    uint32_t pending = flushSq();
+    uint32_t to_submit = 0;
+    uint32_t flags = 0;
+    bool need_enter = false;
+    uint32_t sq_flags = __atomic_load_n(m_sqFlags, __ATOMIC_ACQUIRE);
+    if(m_sqpoll) {
+        // 内核线程运行中时无需系统调用
+        if(pending && (sq_flags & IORING_SQ_NEED_WAKEUP)) {
+            flags |= IORING_ENTER_SQ_WAKEUP;
+            need_enter = true;
+        }
+    } else if(pending) {
+        to_submit = pending;
+        need_enter = true;
+    }
+    if(sq_flags & (IORING_SQ_CQ_OVERFLOW | IORING_SQ_TASKRUN)) {
+        flags |= IORING_ENTER_GETEVENTS;
+        need_enter = true;
+    }
+    if(wait_nr) {
+        uint32_t ready = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE) - *m_cqHead;
+        if(ready >= wait_nr) {
+            wait_nr = 0;
+        } else {
+            flags |= IORING_ENTER_GETEVENTS;
+            need_enter = true;
+        }
+    }
+    if(!need_enter) {
+        return 0;
+    }
+
+    __kernel_timespec ts;
+    io_uring_getevents_arg arg;
+    const void* argp = nullptr;
+    size_t argsz = _NSIG / 8;
+    if(wait_nr && timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (timeout_ms % 1000) * 1000000LL;
+        memset(&arg, 0, sizeof(arg));
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+        flags |= IORING_ENTER_EXT_ARG;
+        argp = &arg;
+        argsz = sizeof(arg);
+    }
+    ++m_enterCount;
+    int rt = SysEnter(m_fd, to_submit, wait_nr, flags, argp, argsz);
+    if(rt < 0) {
+        if(errno == ETIME || errno == EINTR) {
+            return 0;
+        }
+        return -errno;
+    }
+    return rt;
+}
+
+size_t IoUring::reap(Completion* out, size_t max) {
+    if(m_fd < 0) {
+        return 0;
+    }
+    uint32_t head = *m_cqHead;
+    uint32_t tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+    io_uring_cqe* cqes = (io_uring_cqe*)m_cqes;
+    size_t n = 0;
+    for(; head != tail && n < max; ++head, ++n) {
+        const io_uring_cqe& cqe = cqes[head & m_cqMask];
+        out[n].data = cqe.user_data;
+        out[n].res = cqe.res;
+        out[n].flags = cqe.flags;
+    }
+    __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+    return n;
+}
+
+bool IoUring::registerFiles(uint32_t count) {
+    io_uring_rsrc_register reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.nr = count;
+    reg.flags = IORING_RSRC_REGISTER_SPARSE;
+    if(SysRegister(m_fd, IORING_REGISTER_FILES2, &reg, sizeof(reg)) < 0) {
+        // 老内核：传入全部为 -1 的数组
+        std::unique_ptr<int[]> fds(new int[count]);
+        std::fill(fds.get(), fds.get() + count, -1);
+        if(SysRegister(m_fd, IORING_REGISTER_FILES, fds.get(), count) < 0) {
+            return false;
+        }
+    }
+    m_fileCount = count;
+    return true;
+}
+
+bool IoUring::updateFile(uint32_t slot, int fd) {
+    if(slot >= m_fileCount) {
+        errno = EINVAL;
+        return false;
+    }
+    io_uring_files_update up;
+    memset(&up, 0, sizeof(up));
+    up.offset = slot;
+    up.fds = (uint64_t)(uintptr_t)&fd;
+    return SysRegister(m_fd, IORING_REGISTER_FILES_UPDATE, &up, 1) == 1;
+}
+
+bool IoUring::registerBuffers(const iovec* iov, uint32_t count) {
+    return SysRegister(m_fd, IORING_REGISTER_BUFFERS, iov, count) == 0;
+}
+
+bool IoUring::setupBufRing(uint16_t bgid, uint32_t count, uint32_t size) {
+    if(m_bufRing || !count || (count & (count - 1)) || count > 32768) {
+        errno = EINVAL;
+        return false;
+    }
+    m_bufRingSize = count * sizeof(io_uring_buf);
+    void* ring = mmap(nullptr, m_bufRingSize, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(ring == MAP_FAILED) {
+        return false;
+    }
+    void* base = mmap(nullptr, (size_t)count * size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(base == MAP_FAILED) {
+        munmap(ring, m_bufRingSize);
+        return false;
+    }
+    io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)ring;
+    reg.ring_entries = count;
+    reg.bgid = bgid;
+    if(SysRegister(m_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        int err = errno;
+        munmap(ring, m_bufRingSize);
+        munmap(base, (size_t)count * size);
+        errno = err;
+        return false;
+    }
+    m_bufRing = (io_uring_buf_ring*)ring;
+    m_bufBase = (char*)base;
+    m_bufCount = count;
+    m_bufSize = size;
+    m_bufTail = 0;
+    for(uint32_t i = 0; i < count; ++i) {
+        recycleBuffer(i);
+    }
+    return true;
+}
+
+void IoUring::recycleBuffer(uint16_t bid) {
+    // C++ 下头文件里 bufs 前的空结构体占1字节，偏移不为0，直接按 io_uring_buf 数组访问；
+    // tail 与 bufs[0].resv 重叠
+    io_uring_buf* bufs = (io_uring_buf*)m_bufRing;
+    io_uring_buf& b = bufs[m_bufTail++ & (m_bufCount - 1)];
+    b.addr = (uint64_t)(uintptr_t)getBuffer(bid);
+    b.len = m_bufSize;
+    b.bid = bid;
+    __atomic_store_n(&bufs[0].resv, m_bufTail, __ATOMIC_RELEASE);
+}
+
+bool IoUring::IsSupported() {
+    static std::atomic<int> s_supported(-1);
+    int v = s_supported.load(std::memory_order_acquire);
+    if(v >= 0) {
+        return v;
+    }
+    // multishot recv 需要 6.0，功能无法逐项探测，以内核版本为准
+    struct utsname un;
+    memset(&un, 0, sizeof(un));
+    int major = 0;
+    int minor = 0;
+    bool ok = uname(&un) == 0 && sscanf(un.release, "%d.%d", &major, &minor) == 2 && major >= 6;
+    if(ok) {
+        IoUring ring;
+        ok = ring.init(8) && (ring.m_features & IORING_FEAT_EXT_ARG)
+                && ring.setupBufRing(0, 8, 64) && ring.registerFiles(8);
+    }
+    if(!ok) {
+        LOG_INFO(g_logger) << "io_uring unavailable kernel=" << un.release
+            << " errno=" << errno << " errstr=" << strerror(errno);
+    }
+    s_supported.store(ok, std::memory_order_release);
+    return ok;
+}
+
+void IoUring::PrepAcceptMultishot(io_uring_sqe* sqe, int fd, bool fixed, uint64_t data) {
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = fd;
+    sqe->flags = fixed ? IOSQE_FIXED_FILE : 0;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data = data;
+}
+
+void IoUring::PrepRecvMultishot(io_uring_sqe* sqe, int fd, bool fixed, uint16_t bgid, uint64_t data) {
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->flags = IOSQE_BUFFER_SELECT | (fixed ? IOSQE_FIXED_FILE : 0);
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->buf_group = bgid;
+    sqe->user_data = data;
+}
+
+void IoUring::PrepPollAdd(io_uring_sqe* sqe, int fd, uint32_t events, bool multishot, uint64_t data) {
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = events;
+    sqe->len = multishot ? IORING_POLL_ADD_MULTI : 0;
+    sqe->user_data = data;
+}
+
+void IoUring::PrepPollRemove(io_uring_sqe* sqe, uint64_t target, uint64_t data) {
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = target;
+    sqe->user_data = data;
+}
+
+void IoUring::PrepCancel(io_uring_sqe* sqe, uint64_t target, uint64_t data) {
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = target;
+    sqe->user_data = data;
+}
+
+#else
+
+bool IoUring::Completion::hasMore() const { return false; }
+bool IoUring::Completion::getBufferId(uint16_t& bid) const { return false; }
+
+bool IoUring::init(uint32_t entries, bool sqpoll, uint32_t sqpoll_idle_ms) {
+    errno = ENOSYS;
+    return false;
+}
+
+io_uring_sqe* IoUring::getSqe() { return nullptr; }
+uint32_t IoUring::flushSq() { return 0; }
+int IoUring::submit(uint32_t wait_nr, int timeout_ms) { return -ENOSYS; }
+size_t IoUring::reap(Completion* out, size_t max) { return 0; }
+bool IoUring::registerFiles(uint32_t count) { return false; }
+bool IoUring::updateFile(uint32_t slot, int fd) { return false; }
+bool IoUring::registerBuffers(const iovec* iov, uint32_t count) { return false; }
+bool IoUring::setupBufRing(uint16_t bgid, uint32_t count, uint32_t size) { return false; }
+void IoUring::recycleBuffer(uint16_t bid) {}
+bool IoUring::IsSupported() { return false; }
+void IoUring::PrepAcceptMultishot(io_uring_sqe* sqe, int fd, bool fixed, uint64_t data) {}
+void IoUring::PrepRecvMultishot(io_uring_sqe* sqe, int fd, bool fixed, uint16_t bgid, uint64_t data) {}
+void IoUring::PrepPollAdd(io_uring_sqe* sqe, int fd, uint32_t events, bool multishot, uint64_t data) {}
+void IoUring::PrepPollRemove(io_uring_sqe* sqe, uint64_t target, uint64_t data) {}
+void IoUring::PrepCancel(io_uring_sqe* sqe, uint64_t target, uint64_t data) {}
+
+#endif
+
+}
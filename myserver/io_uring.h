@@ -0,0 +1,147 @@
+#ifndef __MYSERVER_IO_URING_H__
+#define __MYSERVER_IO_URING_H__
+
+#include <stdint.h>
+#include <sys/uio.h>
+#include <memory>
+#include "noncopyable.h"
+
+struct io_uring_sqe;
+struct io_uring_buf_ring;
+
+namespace myserver {
+
+/**
+ * @brief io_uring 的轻量封装
+ * @details 直接使用 io_uring_setup / io_uring_enter / io_uring_register 系统调用，不依赖 liburing。
+ *          只能由创建它的线程使用：getSqe 取得的 SQE 在 submit 时一次性提交，
+ *          提交与等待完成合并为一次 io_uring_enter；开启 SQPOLL 时由内核线程取走 SQE，
+ *          只有内核线程休眠时才需要系统调用唤醒。
+ *          支持稀疏固定文件表、注册缓冲区与提供缓冲区环(供 multishot recv 选择缓冲区)
+ */
+class IoUring : Noncopyable {
+public:
+    typedef std::shared_ptr<IoUring> ptr;
+
+    // 一个完成事件
+    struct Completion {
+        uint64_t data;      // 提交时的 user_data
+        int32_t res;        // 结果，负数为 -errno
+        uint32_t flags;     // IORING_CQE_F_*
+
+        // multishot 请求是否仍然有效，false 时需重新提交
+        bool hasMore() const;
+        // 是否选中了提供缓冲区，bid 为缓冲区号
+        bool getBufferId(uint16_t& bid) const;
+    };
+
+    IoUring();
+    ~IoUring();
+
+    /**
+     * @brief 创建 ring
+     * @param[in] entries SQ 大小，CQ 为其4倍
+     * @param[in] sqpoll 是否使用 IORING_SETUP_SQPOLL
+     * @param[in] sqpoll_idle_ms SQPOLL 内核线程空闲多久后休眠
+     * @return 失败返回 false，errno 为失败原因
+     */
+    bool init(uint32_t entries, bool sqpoll = false, uint32_t sqpoll_idle_ms = 1000);
+    bool isValid() const { return m_fd >= 0; }
+    bool isSqPoll() const { return m_sqpoll; }
+
+    /**
+     * @brief 取一个清零的 SQE
+     * @details SQ 已满时先提交已有的 SQE，仍取不到返回 nullptr
+     */
+    io_uring_sqe* getSqe();
+
+    /**
+     * @brief 提交全部待提交的 SQE，可选地等待完成事件
+     * @param[in] wait_nr 至少等待的完成事件数，已有完成事件时不等待
+     * @param[in] timeout_ms 等待超时，-1 表示不超时
+     * @return 成功返回提交的 SQE 数，失败返回 -errno(超时与被信号打断返回 0)
+     */
+    int submit(uint32_t wait_nr = 0, int timeout_ms = -1);
+
+    /**
+     * @brief 取出已完成的事件
+     * @return 取出的个数
+     */
+    size_t reap(Completion* out, size_t max);
+
+    // 注册 count 个槽位的稀疏固定文件表
+    bool registerFiles(uint32_t count);
+    // 设置槽位对应的fd，fd 为 -1 时清除；清除后内核不再持有该文件的引用
+    bool updateFile(uint32_t slot, int fd);
+    uint32_t getFileCount() const { return m_fileCount; }
+
+    // 注册固定缓冲区(IORING_REGISTER_BUFFERS)，供 READ_FIXED / WRITE_FIXED 使用
+    bool registerBuffers(const iovec* iov, uint32_t count);
+
+    /**
+     * @brief 创建并注册提供缓冲区环，每个 ring 只支持一个缓冲区组
+     * @param[in] bgid 缓冲区组
+     * @param[in] count 缓冲区个数，需为2的幂
+     * @param[in] size 每个缓冲区大小
+     */
+    bool setupBufRing(uint16_t bgid, uint32_t count, uint32_t size);
+    // 选中缓冲区的地址
+    char* getBuffer(uint16_t bid) { return m_bufBase + (size_t)bid * m_bufSize; }
+    uint32_t getBufferSize() const { return m_bufSize; }
+    // 归还选中的缓冲区
+    void recycleBuffer(uint16_t bid);
+
+    // io_uring_enter 调用次数
+    uint64_t getEnterCount() const { return m_enterCount; }
+
+    // 内核是否支持本封装用到的全部功能(multishot accept/recv、缓冲区环、EXT_ARG)，结果缓存
+    static bool IsSupported();
+
+    static void PrepAcceptMultishot(io_uring_sqe* sqe, int fd, bool fixed, uint64_t data);
+    static void PrepRecvMultishot(io_uring_sqe* sqe, int fd, bool fixed, uint16_t bgid, uint64_t data);
+    static void PrepPollAdd(io_uring_sqe* sqe, int fd, uint32_t events, bool multishot, uint64_t data);
+    static void PrepPollRemove(io_uring_sqe* sqe, uint64_t target, uint64_t data);
+    static void PrepCancel(io_uring_sqe* sqe, uint64_t target, uint64_t data);
+private:
+    // 把本地的 SQ 尾部发布给内核，返回待提交数
+    uint32_t flushSq();
+    void destroy();
+private:
+    int m_fd;
+    bool m_sqpoll;
+    void* m_sqRing;
+    size_t m_sqRingSize;
+    void* m_cqRing;
+    size_t m_cqRingSize;
+    io_uring_sqe* m_sqes;
+    size_t m_sqesSize;
+
+    uint32_t* m_sqHead;
+    uint32_t* m_sqTail;
+    uint32_t* m_sqFlags;
+    uint32_t* m_sqArray;
+    uint32_t m_sqMask;
+    uint32_t m_sqEntries;
+    uint32_t m_sqeTail;         // 本地已填写的位置，submit 时发布给内核
+
+    uint32_t* m_cqHead;
+    uint32_t* m_cqTail;
+    uint32_t m_cqMask;
+    void* m_cqes;
+
+    uint32_t m_fileCount;
+
+    io_uring_buf_ring* m_bufRing;
+    size_t m_bufRingSize;
+    char* m_bufBase;
+    uint32_t m_bufSize;
+    uint32_t m_bufCount;
+    uint16_t m_bufTail;
+
+    uint32_t m_features;        // IORING_FEAT_*
+    uint64_t m_enterCount;
+};
+
+}
+
+#endif
@@ -2,7 +2,15 @@
 #include <iostream>
 #include <map>
 #include <functional>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 #include "config.h"
+#include "socket_log_appender.h"
+#include "mmap_log_appender.h"
 
 namespace myserver {
 
@@ -52,6 +60,9 @@ public:
     MessageFormatItem(const std::string& str = "") { }
     void format(std::ostream& os, Logger::ptr logger, LogEvent::ptr event) override {
         os << event->getContent();
+        for(auto& f : event->getFields()) {
+            os << ' ' << f.getKey() << '=' << f.getValue();
+        }
     }
 };
 
@@ -110,18 +121,35 @@ public:
         if(m_format.empty()) {
             m_format = "%Y-%m-%d %H:%M:%S";
         }
+        // 按 %L(毫秒) 切分，其余部分交给 strftime
+        size_t begin = 0;
+        for(size_t pos = m_format.find("%L"); pos != std::string::npos;
+                pos = m_format.find("%L", begin)) {
+            m_parts.push_back(m_format.substr(begin, pos - begin));
+            begin = pos + 2;
+        }
+        m_parts.push_back(m_format.substr(begin));
     }
 
     void format(std::ostream& os, Logger::ptr logger, LogEvent::ptr event) override {
         struct tm tm;
-        time_t time = event->getTime();
+        time_t time = event->getTime() / 1000;
         localtime_r(&time, &tm);
         char buf[64];
-        strftime(buf, sizeof(buf), m_format.c_str(), &tm);
-        os << buf;
+        for(size_t i = 0; i < m_parts.size(); ++i) {
+            if(i) {
+                snprintf(buf, sizeof(buf), "%03u", (uint32_t)(event->getTime() % 1000));
+                os << buf;
+            }
+            if(!m_parts[i].empty()) {
+                strftime(buf, sizeof(buf), m_parts[i].c_str(), &tm);
+                os << buf;
+            }
+        }
     }
 private:
     std::string m_format;
+    std::vector<std::string> m_parts;
 };
 
 class FileNameFormatItem : public LogFormatter::FormatItem {
@@ -168,12 +196,33 @@ public:
     }
 };
 
+std::ostream& operator<<(std::ostream& os, const LogField& field) {
+    LogStream* ls = dynamic_cast<LogStream*>(&os);
+    if(ls) {
+        ls->addField(field);
+    } else {
+        os << field.getKey() << '=' << field.getValue();
+    }
+    return os;
+}
+
 LogEvent::LogEvent(LogLevel::Level level, const char* file, int32_t line, 
             uint32_t elapse, uint32_t thread_id, uint32_t fiber_id, 
-            uint64_t time, std::string threadName)
+            uint64_t time, const std::string& threadName)
             :m_level(level), m_file(file), m_line(line),
              m_elaspe(elapse), m_threadId(thread_id), m_fiberId(fiber_id), 
-             m_time(time), m_threadName(threadName){
+             m_time(time), m_threadName(ThreadContext::GetThis().getNamePtr()){
+    // 通常传入的就是当前线程名称，直接复用已驻留的字符串；不同时才驻留(加锁)
+    if(*m_threadName != threadName) {
+        m_threadName = ThreadContext::Intern(threadName);
+    }
+}
+
+LogEvent::LogEvent(LogLevel::Level level, const char* file, int32_t line,
+            uint32_t elapse, const ThreadContext& ctx, uint64_t time)
+            :m_level(level), m_file(file), m_line(line),
+             m_elaspe(elapse), m_threadId(ctx.getTid()), m_fiberId(ctx.getFiberId()),
+             m_time(time), m_threadName(ctx.getNamePtr()){
 }
 
 void LogEvent::format(const char* fmt, ...) {
@@ -200,13 +249,64 @@ LogEventWrap::~LogEventWrap(){
     m_logger->log(m_event); 
 }
 
+bool LogSite::rateLimit(Logger* logger, LogLevel::Level level, uint32_t per_second) {
+    if(per_second == 0) {
+        return true;
+    }
+    uint64_t now = Clock::CoarseMs() * 1000;
+    uint64_t interval = 1000000 / per_second;
+    uint64_t tolerance = interval * (per_second - 1);
+    uint64_t tat = m_tat.load(std::memory_order_relaxed);
+    uint64_t next;
+    do {
+        uint64_t base = tat > now ? tat : now;
+        if(base - now > tolerance) {
+            m_suppressed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        next = base + interval;
+    } while(!m_tat.compare_exchange_weak(tat, next, std::memory_order_relaxed));
+
+    if(m_suppressed.load(std::memory_order_relaxed)) {
+        uint64_t n = m_suppressed.exchange(0, std::memory_order_relaxed);
+        if(n) {
+            LogEventWrap(logger->shared_from_this(), LogEvent::Create(level, m_file, m_line,
+                        (uint32_t)Clock::ElapsedMs(), ThreadContext::GetThis(),
+                        Clock::CoarseWallMs())).getSS()
+                << "suppressed " << n << " identical messages";
+        }
+    }
+    return true;
+}
+
 
 Logger::Logger(const std::string& name)
     :m_name(name)
-    ,m_level(LogLevel::DEBUG) {
+    ,m_level(LogLevel::DEBUG)
+    ,m_rateLimit(0)
+    ,m_everyN(0)
+    ,m_hasSitePolicy(false) {
     m_formatter.reset(new LogFormatter("%d{%Y-%m-%d %H:%M:%S}%T%t%T%N%T%F%T[%p]%T[%c]%T%f:%l%T%m%n"));
 }
 
+void Logger::setRateLimit(uint32_t per_second) {
+    m_rateLimit.store(per_second, std::memory_order_relaxed);
+    m_hasSitePolicy.store(per_second || getEveryN(), std::memory_order_relaxed);
+}
+
+void Logger::setEveryN(uint32_t n) {
+    m_everyN.store(n, std::memory_order_relaxed);
+    m_hasSitePolicy.store(n || getRateLimit(), std::memory_order_relaxed);
+}
+
+bool Logger::allowSite(LogSite& site, LogLevel::Level level) {
+    if(!site.everyN(getEveryN())) {
+        return false;
+    }
+    uint32_t rate = getRateLimit();
+    return !rate || site.rateLimit(this, level, rate);
+}
+
 void Logger::addAppender(LogAppender::ptr appender) {
     if (!appender->getFormatter()){
         appender->m_formatter = m_formatter;
@@ -238,7 +338,7 @@ void Logger::setFormatter(LogFormatter::ptr val) {
 }
 
 void Logger::setFormatter(const std::string& val) {
-    myserver::LogFormatter::ptr new_fmt(new myserver::LogFormatter(val));
+    myserver::LogFormatter::ptr new_fmt = LogFormatter::Create(val);
     if (new_fmt->isError()) {
         std::cout << "Logger setFormatter name=" << m_name
                   << " value=" << val << " invalid formatter"
@@ -261,6 +361,12 @@ std::string Logger::toYamlString() {
     if(m_formatter) {
         node["formatter"] = m_formatter->getPattern();
     }
+    if(getRateLimit()) {
+        node["rate_limit"] = getRateLimit();
+    }
+    if(getEveryN()) {
+        node["every_n"] = getEveryN();
+    }
 
     for(auto& i : m_appenders) {
         node["appenders"].push_back(YAML::Load(i->toYamlString()));
@@ -314,8 +420,17 @@ std::string StdoutLogAppender::toYamlString() {
 }
 
 FileLogAppender::FileLogAppender(const std::string& filename, LogLevel::Level level)
-    :m_filename(filename) {
+    :m_filename(filename)
+    ,m_filestream(&m_filebuf) {
     reopen();
+    FatalSignalHandler::AddFlushable(this);
+}
+
+FileLogAppender::~FileLogAppender() {
+    FatalSignalHandler::RemoveFlushable(this);
+    if(m_crashFd >= 0) {
+        close(m_crashFd);
+    }
 }
 
 void FileLogAppender::log(std::shared_ptr<Logger> logger, LogEvent::ptr event) {
@@ -327,13 +442,37 @@ void FileLogAppender::log(std::shared_ptr<Logger> logger, LogEvent::ptr event) {
 }
 
 bool FileLogAppender::reopen(){
-    if (m_filestream) {
-        m_filestream.close();
+    if (m_filebuf.is_open()) {
+        m_filebuf.close();
+    }
+    m_filestream.clear();
+    if (!m_filebuf.open(m_filename, std::ios::out | std::ios::trunc)) {
+        m_filestream.setstate(std::ios::badbit);
+    }
+    int fd = open(m_filename.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+    int old_fd = m_crashFd;
+    m_crashFd = fd;
+    if(old_fd >= 0) {
+        close(old_fd);
     }
-    m_filestream.open(m_filename);
     return !m_filestream;
 }
 
+void FileLogAppender::crashFlush(const char* report, size_t len) {
+    int fd = m_crashFd;
+    if(fd < 0) {
+        return;
+    }
+    size_t pending_len = 0;
+    const char* pending = m_filebuf.pending(pending_len);
+    if(pending && pending_len && write(fd, pending, pending_len) < 0) {
+        return;
+    }
+    if(write(fd, report, len) < 0) {
+        return;
+    }
+}
+
 std::string FileLogAppender::toYamlString() {
     YAML::Node node;
     node["type"] = "FileLogAppender";
@@ -350,15 +489,26 @@ std::string FileLogAppender::toYamlString() {
 }
 
 LogFormatter::LogFormatter(const std::string& pattern)
+    :LogFormatter(pattern, true) {
+}
+
+LogFormatter::LogFormatter(const std::string& pattern, bool parse)
     :m_pattern(pattern) {
-    init();     // 构造时初始化解析pattern
+    if(parse) {
+        init();     // 构造时初始化解析pattern
+    }
+}
+
+LogFormatter::ptr LogFormatter::Create(const std::string& pattern) {
+    if(pattern == "json") {
+        return LogFormatter::ptr(new JsonLogFormatter);
+    }
+    return LogFormatter::ptr(new LogFormatter(pattern));
 }
 
 std::string LogFormatter::format(Logger::ptr logger, LogEvent::ptr event){
     std::stringstream ss;
-    for (auto &m_item : m_items){
-        m_item->format(ss, logger, event);
-    }
+    format(ss, logger, event);
     return ss.str();
 }
 
@@ -369,6 +519,131 @@ std::ostream& LogFormatter::format(std::ostream& ofs, std::shared_ptr<Logger> lo
     return ofs;
 }
 
+JsonLogFormatter::JsonLogFormatter()
+    :LogFormatter("json", false) {
+}
+
+bool JsonLogFormatter::NeedsEscape(const char* str, size_t len) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i limit = _mm_set1_epi8(0x1F);
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    for(; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(str + i));
+        // 无符号比较 v <= 0x1F 等价于 max(v, 0x1F) == 0x1F
+        __m128i hit = _mm_cmpeq_epi8(_mm_max_epu8(v, limit), limit);
+        hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, quote));
+        hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, backslash));
+        if(_mm_movemask_epi8(hit)) {
+            return true;
+        }
+    }
+#endif
+    for(; i < len; ++i) {
+        unsigned char c = str[i];
+        if(c < 0x20 || c == '"' || c == '\\') {
+            return true;
+        }
+    }
+    return false;
+}
+
+void JsonLogFormatter::AppendString(std::string& out, const char* str, size_t len) {
+    out.push_back('"');
+    if(!NeedsEscape(str, len)) {
+        out.append(str, len);
+        out.push_back('"');
+        return;
+    }
+    for(size_t i = 0; i < len; ++i) {
+        unsigned char c = str[i];
+        switch(c) {
+            case '"': out.append("\\\""); break;
+            case '\\': out.append("\\\\"); break;
+            case '\n': out.append("\\n"); break;
+            case '\r': out.append("\\r"); break;
+            case '\t': out.append("\\t"); break;
+            case '\b': out.append("\\b"); break;
+            case '\f': out.append("\\f"); break;
+            default:
+                if(c < 0x20) {
+                    char buf[8];
+                    snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    out.append(buf);
+                } else {
+                    out.push_back(c);
+                }
+        }
+    }
+    out.push_back('"');
+}
+
+static void AppendUint(std::string& out, uint64_t v) {
+    char buf[24];
+    int n = sizeof(buf);
+    do {
+        buf[--n] = '0' + v % 10;
+        v /= 10;
+    } while(v);
+    out.append(buf + n, sizeof(buf) - n);
+}
+
+static void AppendInt(std::string& out, int64_t v) {
+    if(v < 0) {
+        out.push_back('-');
+        AppendUint(out, -(uint64_t)v);
+    } else {
+        AppendUint(out, v);
+    }
+}
+
+static void AppendJsonString(std::string& out, const std::string& str) {
+    JsonLogFormatter::AppendString(out, str.c_str(), str.size());
+}
+
+std::ostream& JsonLogFormatter::format(std::ostream& ofs, std::shared_ptr<Logger> logger, LogEvent::ptr event) {
+    static thread_local std::string t_buf;
+    std::string& out = t_buf;
+    out.clear();
+    out.append("{\"time\":");
+    AppendUint(out, event->getTime());
+    out.append(",\"level\":\"");
+    out.append(LogLevel::ToString(event->getLevel()));
+    out.append("\",\"logger\":");
+    AppendJsonString(out, logger->getName());
+    out.append(",\"thread_id\":");
+    AppendUint(out, event->getThreadId());
+    out.append(",\"thread_name\":");
+    AppendJsonString(out, event->getThreadName());
+    out.append(",\"fiber_id\":");
+    AppendUint(out, event->getFiberId());
+    out.append(",\"elapse\":");
+    AppendUint(out, event->getElapse());
+    out.append(",\"file\":");
+    const char* file = event->getFile() ? event->getFile() : "";
+    AppendString(out, file, strlen(file));
+    out.append(",\"line\":");
+    AppendInt(out, event->getLine());
+    out.append(",\"message\":");
+    AppendJsonString(out, event->getContent());
+    for(auto& f : event->getFields()) {
+        out.push_back(',');
+        AppendJsonString(out, f.getKey());
+        out.push_back(':');
+        if(f.isString()) {
+            AppendJsonString(out, f.getValue());
+        } else {
+            out.append(f.getValue());
+        }
+    }
+    out.append("}\n");
+    ofs.write(out.data(), out.size());
+    // 与文本格式的 %n 一致，每行刷新
+    ofs.flush();
+    return ofs;
+}
+
 void LogFormatter::init(){
     // 解析形如：%d{%Y-%m-%d %H:%M:%S}%T%t%T%N%T%F%T[%p]%T[%c]%T%f:%l%T%m%n
     std::vector<std::tuple<std::string, std::string, int>> vec; // str, format, type
@@ -451,7 +726,7 @@ void LogFormatter::init(){
         XX(c, NameFormatItem),              //c:日志名称
         XX(t, ThreadIdFormatItem),          //t:线程id
         XX(n, NewLineFormatItem),           //n:换行
-        XX(d, DateTimeFormatItem),          //d:时间
+        XX(d, DateTimeFormatItem),          //d:时间，{} 内为 strftime 格式，另支持 %L 毫秒
         XX(f, FileNameFormatItem),          //f:文件名
         XX(l, LineFormatItem),              //l:行号
         XX(T, TabFormatItem),               //T:Tab
@@ -478,6 +753,7 @@ void LogFormatter::init(){
 }
 
 LoggerManager::LoggerManager(){
+    FatalSignalHandler::Install();
     m_root.reset(new Logger);
     m_root->addAppender(LogAppender::ptr(new StdoutLogAppender));
 
@@ -497,16 +773,28 @@ Logger::ptr LoggerManager::getLogger(const std::string& name){
 }
 
 struct LogAppenderDefine {
-    int type = 0;   // 1: File, 2: Stdout     
+    int type = 0;   // 1: File, 2: Stdout, 3: Socket, 4: MmapFile
     LogLevel::Level level = LogLevel::UNKNOWN;
     std::string formatter;
     std::string file;
+    std::string address;
+    SocketLogAppender::Options socket;
+    MmapFileLogAppender::Options mmap;
 
     bool operator==(const LogAppenderDefine& rhs) const {   // 定义==在Config管理时使用
         return type == rhs.type
             && level == rhs.level
             && formatter == rhs.formatter
-            && file == rhs.file;
+            && file == rhs.file
+            && address == rhs.address
+            && socket.batch_size == rhs.socket.batch_size
+            && socket.flush_interval == rhs.socket.flush_interval
+            && socket.queue_size == rhs.socket.queue_size
+            && socket.policy == rhs.socket.policy
+            && socket.spill_file == rhs.socket.spill_file
+            && socket.spill_size == rhs.socket.spill_size
+            && mmap.segment_size == rhs.mmap.segment_size
+            && mmap.sync_interval == rhs.mmap.sync_interval;
     }
 };
 
@@ -514,12 +802,16 @@ struct LogDefine {
     std::string name;
     LogLevel::Level level = LogLevel::UNKNOWN;
     std::string formatter;
+    uint32_t rate_limit = 0;    // 每个调用点每秒条数
+    uint32_t every_n = 0;       // 每个调用点每 n 条输出一条
     std::vector<LogAppenderDefine> appenders;
 
     bool operator==(const LogDefine& rhs) const {
         return name == rhs.name
             && level == rhs.level
             && formatter == rhs.formatter
+            && rate_limit == rhs.rate_limit
+            && every_n == rhs.every_n
             && appenders == rhs.appenders;
     }
 
@@ -548,6 +840,12 @@ public:
             if(n["formatter"].IsDefined()) {
                 logDef.formatter = n["formatter"].as<std::string>();
             }
+            if(n["rate_limit"].IsDefined()) {
+                logDef.rate_limit = n["rate_limit"].as<uint32_t>();
+            }
+            if(n["every_n"].IsDefined()) {
+                logDef.every_n = n["every_n"].as<uint32_t>();
+            }
 
             if(n["appenders"].IsDefined()) {
                 for(size_t x = 0; x < n["appenders"].size(); ++x) {
@@ -573,6 +871,51 @@ public:
                         if(apdr["formatter"].IsDefined()) {
                             logApdrDef.formatter = apdr["formatter"].as<std::string>();
                         }
+                    } else if(type == "SocketLogAppender") {
+                        logApdrDef.type = 3;
+                        if(!apdr["address"].IsDefined()) {
+                            std::cout << "log config error: socketappender address is null, " << apdr << std::endl;
+                            continue;
+                        }
+                        logApdrDef.address = apdr["address"].as<std::string>();
+                        SocketLogAppender::Options& opt = logApdrDef.socket;
+                        if(apdr["batch_size"].IsDefined()) {
+                            opt.batch_size = apdr["batch_size"].as<uint32_t>();
+                        }
+                        if(apdr["flush_interval"].IsDefined()) {
+                            opt.flush_interval = apdr["flush_interval"].as<uint32_t>();
+                        }
+                        if(apdr["queue_size"].IsDefined()) {
+                            opt.queue_size = apdr["queue_size"].as<uint32_t>();
+                        }
+                        if(apdr["policy"].IsDefined()) {
+                            opt.policy = SocketLogAppender::PolicyFromString(apdr["policy"].as<std::string>());
+                        }
+                        if(apdr["spill_file"].IsDefined()) {
+                            opt.spill_file = apdr["spill_file"].as<std::string>();
+                        }
+                        if(apdr["spill_size"].IsDefined()) {
+                            opt.spill_size = apdr["spill_size"].as<uint64_t>();
+                        }
+                        if(apdr["formatter"].IsDefined()) {
+                            logApdrDef.formatter = apdr["formatter"].as<std::string>();
+                        }
+                    } else if(type == "MmapFileLogAppender") {
+                        logApdrDef.type = 4;
+                        if(!apdr["file"].IsDefined()) {
+                            std::cout << "log config error: mmapfileappender file is null, " << apdr << std::endl;
+                            continue;
+                        }
+                        logApdrDef.file = apdr["file"].as<std::string>();
+                        if(apdr["segment_size"].IsDefined()) {
+                            logApdrDef.mmap.segment_size = apdr["segment_size"].as<uint64_t>();
+                        }
+                        if(apdr["sync_interval"].IsDefined()) {
+                            logApdrDef.mmap.sync_interval = apdr["sync_interval"].as<uint32_t>();
+                        }
+                        if(apdr["formatter"].IsDefined()) {
+                            logApdrDef.formatter = apdr["formatter"].as<std::string>();
+                        }
                     } else {
                         std::cout << "log config error: appender type is invalid, " << apdr << std::endl;
                         continue;
@@ -601,6 +944,12 @@ public:
         if(!logDef.formatter.empty()) {
             n["formatter"] = logDef.formatter;
         }
+        if(logDef.rate_limit) {
+            n["rate_limit"] = logDef.rate_limit;
+        }
+        if(logDef.every_n) {
+            n["every_n"] = logDef.every_n;
+        }
 
         for(auto& appender : logDef.appenders) {
             YAML::Node na;
@@ -609,6 +958,22 @@ public:
                 na["file"] = appender.file;
             } else if(appender.type ==    2) {
                 na["type"] = "StdoutLogAppender";
+            } else if(appender.type == 3) {
+                na["type"] = "SocketLogAppender";
+                na["address"] = appender.address;
+                na["batch_size"] = appender.socket.batch_size;
+                na["flush_interval"] = appender.socket.flush_interval;
+                na["queue_size"] = appender.socket.queue_size;
+                na["policy"] = SocketLogAppender::PolicyToString(appender.socket.policy);
+                if(!appender.socket.spill_file.empty()) {
+                    na["spill_file"] = appender.socket.spill_file;
+                    na["spill_size"] = appender.socket.spill_size;
+                }
+            } else if(appender.type == 4) {
+                na["type"] = "MmapFileLogAppender";
+                na["file"] = appender.file;
+                na["segment_size"] = appender.mmap.segment_size;
+                na["sync_interval"] = appender.mmap.sync_interval;
             }
             if(appender.level != LogLevel::UNKNOWN) {
                 na["level"] = LogLevel::ToString(appender.level);
@@ -649,6 +1014,8 @@ struct LogIniter {
                     }
                 }
                 logger->setLevel(i.level);
+                logger->setRateLimit(i.rate_limit);
+                logger->setEveryN(i.every_n);
                 if (!i.formatter.empty()) {
                     logger->setFormatter(i.formatter);
                 }
@@ -660,10 +1027,14 @@ struct LogIniter {
                         ap.reset(new FileLogAppender(a.file));
                     } else if(a.type == 2) {
                         ap.reset(new StdoutLogAppender);
+                    } else if(a.type == 3) {
+                        ap.reset(new SocketLogAppender(a.address, a.socket));
+                    } else if(a.type == 4) {
+                        ap.reset(new MmapFileLogAppender(a.file, a.mmap));
                     }
                     ap->setLevel(a.level);
                     if(!a.formatter.empty()) {
-                        LogFormatter::ptr fmt(new LogFormatter(a.formatter));
+                        LogFormatter::ptr fmt = LogFormatter::Create(a.formatter);
                         if(!fmt->isError()) {
                             ap->setFormatter(fmt);
                         } else {
@@ -681,6 +1052,8 @@ struct LogIniter {
                     // 删除日志 logger
                     auto logger = LOGGER_NAME(i.name);
                     logger->setLevel((LogLevel::Level)100);
+                    logger->setRateLimit(0);
+                    logger->setEveryN(0);
                     logger->clearAppenders();
                 }
             }
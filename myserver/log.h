@@ -9,19 +9,46 @@
 #include <list> 
 #include <vector>
 #include <map>
+#include <atomic>
+#include <type_traits>
+#include <cmath>
 #include "singleton.h"
 #include <stdarg.h>
 #include "util.h"
+#include "allocator.h"
+#include "clock.h"
+#include "fatal_signal.h"
+
+/**
+ * @brief 创建日志事件包装器，析构时写入logger
+ */
+#define LOG_EVENT_WRAP(logger, level)                                   \
+    myserver::LogEventWrap(logger, myserver::LogEvent::Create(          \
+        level, __FILE__, __LINE__,                                      \
+        (uint32_t)myserver::Clock::ElapsedMs(),                         \
+        myserver::ThreadContext::GetThis(),                             \
+        myserver::Clock::CoarseWallMs()))
+
+/**
+ * @brief 当前调用点的静态 LogSite，常量初始化，不需要初始化守卫
+ */
+#define LOG_SITE()                                                      \
+    ([]() -> myserver::LogSite& {                                       \
+        static myserver::LogSite s_log_site(__FILE__, __LINE__);        \
+        return s_log_site; }())
+
+/**
+ * @brief 日志器配置了默认调用点策略(rate_limit/every_n)时按调用点采样、限流
+ */
+#define LOG_SITE_ALLOW(logger, level)                                   \
+    (!logger->hasSitePolicy() || logger->allowSite(LOG_SITE(), level))
 
 /**
  * @brief 使用流式方式将日志级别level的日志写入到logger
  */
 #define LOG_LEVEL(logger, level)                                        \
-    if (logger->getLevel() <= level)                                    \
-        myserver::LogEventWrap(logger, myserver::LogEvent::ptr(         \
-            new myserver::LogEvent(level, __FILE__, __LINE__, 0,        \
-            myserver::GetThreadId(), myserver::GetFiberId(), time(0),   \
-            "thread_i"))).getSS()    
+    if (logger->getLevel() <= level && LOG_SITE_ALLOW(logger, level))   \
+        LOG_EVENT_WRAP(logger, level).getSS()
  
 #define LOG_DEBUG(logger) LOG_LEVEL(logger, myserver::LogLevel::DEBUG)
 #define LOG_INFO(logger) LOG_LEVEL(logger, myserver::LogLevel::INFO)
@@ -30,11 +57,8 @@
 #define LOG_FATAL(logger) LOG_LEVEL(logger, myserver::LogLevel::FATAL)
 
 #define LOG_FMT_LEVEL(logger, level, fmt, ...)                          \
-    if(logger->getLevel() <= level)                                     \
-        myserver::LogEventWrap(logger, myserver::LogEvent::ptr(         \
-            new myserver::LogEvent(level, __FILE__, __LINE__, 0,        \
-            myserver::GetThreadId(), myserver::GetFiberId(), time(0),   \
-            "thread_i"))).getEvent()->format(fmt, __VA_ARGS__)                                              
+    if(logger->getLevel() <= level && LOG_SITE_ALLOW(logger, level))    \
+        LOG_EVENT_WRAP(logger, level).getEvent()->format(fmt, __VA_ARGS__)
     
 #define LOG_FMT_DEBUG(logger, fmt, ...) LOG_FMT_LEVEL(logger, myserver::LogLevel::DEBUG, fmt, __VA_ARGS__)
 #define LOG_FMT_INFO(logger, fmt, ...) LOG_FMT_LEVEL(logger, myserver::LogLevel::INFO, fmt, __VA_ARGS__)
@@ -42,6 +66,23 @@
 #define LOG_FMT_ERROR(logger, fmt, ...) LOG_FMT_LEVEL(logger, myserver::LogLevel::ERROR, fmt, __VA_ARGS__)
 #define LOG_FMT_FATAL(logger, fmt, ...) LOG_FMT_LEVEL(logger, myserver::LogLevel::FATAL, fmt, __VA_ARGS__)
 
+/**
+ * @brief 本调用点每 n 条只输出一条(第 1、n+1、2n+1... 条)，不受日志器默认策略影响
+ */
+#define LOG_EVERY_N(logger, level, n)                                   \
+    if(logger->getLevel() <= level && LOG_SITE().everyN(n))             \
+        LOG_EVENT_WRAP(logger, level).getSS()
+
+/**
+ * @brief 本调用点按令牌桶限流，每秒最多 per_second 条(允许 1 秒的突发)，
+ *        被抑制的条数在下一条放行的消息前以一条汇总输出，不受日志器默认策略影响；
+ *        最后一段突发之后若不再有消息放行，其被抑制条数不会输出(可由 LogSite::getSuppressed 查看)
+ */
+#define LOG_RATE_LIMITED(logger, level, per_second)                     \
+    if(logger->getLevel() <= level                                      \
+            && LOG_SITE().rateLimit(&*logger, level, per_second))       \
+        LOG_EVENT_WRAP(logger, level).getSS()
+
 #define ROOT_LOGGER() myserver::LoggerMgr::GetInstance()->getRoot()
 #define LOGGER_NAME(name) myserver::LoggerMgr::GetInstance()->getLogger(name)
 
@@ -67,6 +108,63 @@ public:
     static LogLevel::Level FromString(const std::string str);
 };
 
+/**
+ * @brief 日志附加字段
+ * @details 通过流式接口附加：LOG_INFO(g_logger) << "login" << LogField("uid", 42);
+ *          JsonLogFormatter 输出为独立的键，文本格式在 %m 后追加 " key=value"
+ */
+class LogField {
+public:
+    template<class T>
+    LogField(const std::string& key, const T& value)
+        :m_key(key) {
+        assign(value, std::is_arithmetic<T>());
+    }
+    LogField(const std::string& key, const char* value)
+        :m_key(key)
+        ,m_value(value ? value : "") {
+    }
+    LogField(const std::string& key, bool value)
+        :m_key(key)
+        ,m_value(value ? "true" : "false")
+        ,m_isString(false) {
+    }
+
+    const std::string& getKey() const { return m_key; }
+    const std::string& getValue() const { return m_value; }
+    // 值为字符串(JSON 中需加引号转义)，否则为数字或布尔
+    bool isString() const { return m_isString; }
+private:
+    template<class T>
+    void assign(const T& value, std::true_type) {
+        std::stringstream ss;
+        ss << +value;
+        m_value = ss.str();
+        m_isString = !std::isfinite(value);
+    }
+    template<class T>
+    void assign(const T& value, std::false_type) {
+        std::stringstream ss;
+        ss << value;
+        m_value = ss.str();
+    }
+private:
+    std::string m_key;
+    std::string m_value;
+    bool m_isString = true;
+};
+
+// 日志内容流，附带 LogField 字段
+class LogStream : public std::stringstream {
+public:
+    void addField(const LogField& field) { m_fields.push_back(field); }
+    const std::vector<LogField>& getFields() const { return m_fields; }
+private:
+    std::vector<LogField> m_fields;
+};
+
+// 写入 LogStream 时作为字段保存，写入其他流时输出 "key=value"
+std::ostream& operator<<(std::ostream& os, const LogField& field);
 
 // 日志事件
 class LogEvent {
@@ -74,7 +172,16 @@ public:
     typedef std::shared_ptr<LogEvent> ptr;
     LogEvent(LogLevel::Level level, const char* file, int32_t line, 
             uint32_t elapse, uint32_t thread_id, uint32_t fiber_id, 
-            uint64_t time, std::string threadName);
+            uint64_t time, const std::string& threadName);
+    // 从线程上下文获取线程id、协程id与线程名称，不发生系统调用和字符串拷贝
+    LogEvent(LogLevel::Level level, const char* file, int32_t line,
+            uint32_t elapse, const ThreadContext& ctx, uint64_t time);
+
+    // 事件对象与引用计数控制块合并为一次 slab 分配
+    template<class... Args>
+    static ptr Create(Args&&... args) {
+        return ObjectPool<LogEvent>::MakeShared(std::forward<Args>(args)...);
+    }
 
     LogLevel::Level getLevel() const { return m_level; }
     const char* getFile() const { return m_file; }
@@ -85,7 +192,8 @@ public:
     uint64_t getTime() const { return m_time; }
     std::string getContent() const { return m_ss.str(); }
     std::stringstream& getSS() { return m_ss; }
-    const std::string& getThreadName() const { return m_threadName; }
+    const std::vector<LogField>& getFields() const { return m_ss.getFields(); }
+    const std::string& getThreadName() const { return *m_threadName; }
 
     void format(const char* fmt, ...);
     void format(const char* fmt, va_list al);
@@ -97,9 +205,47 @@ private:
     uint32_t m_elaspe = 0;          // 程序启动至现在的毫秒数
     uint32_t m_threadId = 0;        // 线程ID
     uint32_t m_fiberId = 0;         // 协程ID
-    uint64_t m_time;                // 时间戳
-    std::stringstream m_ss;     // 日志内容流
-    std::string m_threadName;   // 线程名称
+    uint64_t m_time;                // 时间戳(毫秒)
+    LogStream m_ss;             // 日志内容流
+    const std::string* m_threadName;    // 线程名称(驻留字符串)
+};
+
+/**
+ * @brief 日志调用点状态
+ * @details 每个调用点一个静态实例(LOG_SITE)，只含原子变量，多线程共享同一份限额。
+ *          限流使用 GCRA(与令牌桶等价)：只保存一个"理论到达时间"，放行时一次 CAS
+ */
+class LogSite {
+public:
+    constexpr LogSite(const char* file, int32_t line)
+        :m_file(file)
+        ,m_line(line)
+        ,m_count(0)
+        ,m_tat(0)
+        ,m_suppressed(0) {
+    }
+
+    // 每 n 条放行一条，n 为 0/1 时全部放行
+    bool everyN(uint32_t n) {
+        return n <= 1 || m_count.fetch_add(1, std::memory_order_relaxed) % n == 0;
+    }
+
+    /**
+     * @brief 令牌桶限流，每秒 per_second 条，突发上限 per_second 条，per_second 为 0 时不限制
+     * @details 放行时若此前有被抑制的消息，先向 logger 输出一条同级别的汇总；汇总只在放行时输出，
+     *          没有后续放行的消息时最后一段的被抑制条数留在 getSuppressed() 中。
+     *          传裸指针，未被抑制时不产生引用计数的原子操作
+     */
+    bool rateLimit(Logger* logger, LogLevel::Level level, uint32_t per_second);
+
+    // 尚未汇总输出的被抑制条数
+    uint64_t getSuppressed() const { return m_suppressed.load(std::memory_order_relaxed); }
+private:
+    const char* m_file;
+    int32_t m_line;
+    std::atomic<uint64_t> m_count;      // everyN 计数
+    std::atomic<uint64_t> m_tat;        // 理论到达时间(微秒)
+    std::atomic<uint64_t> m_suppressed; // 被抑制条数
 };
 
 // 日志事件包装器
@@ -121,11 +267,15 @@ class LogFormatter {
 public:
     typedef std::shared_ptr<LogFormatter> ptr;
     LogFormatter(const std::string& pattern);
+    virtual ~LogFormatter() { }
+
+    // 按配置值创建：json 创建 JsonLogFormatter，其余按模板解析
+    static LogFormatter::ptr Create(const std::string& pattern);
 
     // 初始化，根据m_pattern解析日志模板
     void init();
     std::string format(std::shared_ptr<Logger> logger, LogEvent::ptr event);   
-    std::ostream& format(std::ostream& ofs, std::shared_ptr<Logger> logger, LogEvent::ptr event);
+    virtual std::ostream& format(std::ostream& ofs, std::shared_ptr<Logger> logger, LogEvent::ptr event);
     
     const std::string getPattern() const { return m_pattern; }
     bool isError() const { return m_error; }
@@ -141,6 +291,29 @@ private:
     std::string m_pattern;  // 日志格式模板
     std::vector<FormatItem::ptr> m_items;   // 日志格式解析后格式
     bool m_error = false;   // 日志格式错误
+protected:
+    // 子类不使用模板时调用，pattern 只作为名称(toYamlString 输出)
+    LogFormatter(const std::string& pattern, bool parse);
+};
+
+/**
+ * @brief JSON 日志格式，每个事件一行
+ * @details {"time":毫秒时间戳,"level":..,"logger":..,"thread_id":..,"thread_name":..,"fiber_id":..,
+ *          "elapse":..,"file":..,"line":..,"message":..,附加字段...}
+ *          字符串先用 SSE2 每次检查 16 字节是否含控制字符、引号或反斜杠，不含时直接整段写出
+ */
+class JsonLogFormatter : public LogFormatter {
+public:
+    typedef std::shared_ptr<JsonLogFormatter> ptr;
+    JsonLogFormatter();
+
+    using LogFormatter::format;
+    std::ostream& format(std::ostream& ofs, std::shared_ptr<Logger> logger, LogEvent::ptr event) override;
+
+    // 字符串是否含需要转义的字符
+    static bool NeedsEscape(const char* str, size_t len);
+    // 追加带引号的 JSON 字符串
+    static void AppendString(std::string& out, const char* str, size_t len);
 };
 
 
@@ -192,9 +365,20 @@ public:
     LogFormatter::ptr getFormatter();
 
     std::string toYamlString(); 
+
+    // 默认调用点策略，作用于本日志器的 LOG_xxx/LOG_FMT_xxx 调用点，0 表示不限制
+    uint32_t getRateLimit() const { return m_rateLimit.load(std::memory_order_relaxed); }
+    void setRateLimit(uint32_t per_second);
+    uint32_t getEveryN() const { return m_everyN.load(std::memory_order_relaxed); }
+    void setEveryN(uint32_t n);
+    bool hasSitePolicy() const { return m_hasSitePolicy.load(std::memory_order_relaxed); }
+    bool allowSite(LogSite& site, LogLevel::Level level);
 private:
     std::string m_name;         // 日志名称
     LogLevel::Level m_level;    // 日志级别
+    std::atomic<uint32_t> m_rateLimit;  // 每个调用点每秒条数
+    std::atomic<uint32_t> m_everyN;     // 每个调用点每 n 条输出一条
+    std::atomic<bool> m_hasSitePolicy;  // 以上任一非 0
     std::list<LogAppender::ptr> m_appenders;    // Appenders集合
     LogFormatter::ptr m_formatter;  // 日志格式
     Logger::ptr m_root;         // 主日志器
@@ -209,17 +393,30 @@ public:
     std::string toYamlString() override;
 };
 
-// 输出到文件的Appender
-class FileLogAppender : public LogAppender {
+// 可在信号处理函数中读取待写出区间的filebuf
+class CrashSafeFileBuf : public std::filebuf {
+public:
+    const char* pending(size_t& len) const {
+        len = pptr() > pbase() ? pptr() - pbase() : 0;
+        return pbase();
+    }
+};
+
+// 输出到文件的Appender，崩溃时把filebuf中未写出的数据与崩溃报告追加到文件
+class FileLogAppender : public LogAppender, public CrashFlushable {
 public:
     typedef std::shared_ptr<FileLogAppender> ptr;
     FileLogAppender(const std::string& filename, LogLevel::Level level = LogLevel::DEBUG);
+    ~FileLogAppender();
     void log(Logger::ptr logger, LogEvent::ptr event) override;
     std::string toYamlString() override;
     bool reopen();
+    void crashFlush(const char* report, size_t len) override;
 private:
     std::string m_filename;     // 输出文件名
-    std::ofstream m_filestream; // 输出文件流
+    CrashSafeFileBuf m_filebuf; // 输出文件缓冲
+    std::ostream m_filestream;  // 输出文件流
+    int m_crashFd = -1;         // 崩溃时追加写入的fd
 };
 
 // 日志器管理类
@@ -0,0 +1,368 @@
+#include "metrics.h"
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <map>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include "config.h"
+#include "mutex.h"
+#include "thread.h"
+
+namespace myserver {
+
+static myserver::ConfigVar<uint64_t>::ptr g_metrics_dump_interval =
+    myserver::Config::Lookup("metrics.dump_interval", (uint64_t)(60 * 1000),
+            "metrics dump interval(ms)");
+
+static myserver::ConfigVar<std::string>::ptr g_metrics_dump_format =
+    myserver::Config::Lookup("metrics.dump_format", std::string("text"),
+            "metrics dump format: text or json");
+
+namespace detail {
+
+thread_local size_t t_metric_shard = (size_t)-1;
+
+size_t MetricShardCount() {
+    static size_t s_count = []() {
+        size_t n = std::max(1u, std::thread::hardware_concurrency());
+        size_t count = 1;
+        while(count < n && count < 64) {
+            count <<= 1;
+        }
+        return count;
+    }();
+    return s_count;
+}
+
+size_t MetricAssignShard() {
+    static std::atomic<size_t> s_next(0);
+    t_metric_shard = s_next.fetch_add(1, std::memory_order_relaxed) & (MetricShardCount() - 1);
+    return t_metric_shard;
+}
+
+void* MetricAlloc(size_t size) {
+    void* p = nullptr;
+    if(posix_memalign(&p, MYSERVER_CACHELINE_SIZE, size)) {
+        throw std::bad_alloc();
+    }
+    memset(p, 0, size);
+    return p;
+}
+
+}
+
+Counter::Counter(const std::string& name, const std::string& description)
+    :m_name(name)
+    ,m_description(description) {
+    size_t n = detail::MetricShardCount();
+    m_cells = (detail::MetricCell*)detail::MetricAlloc(n * sizeof(detail::MetricCell));
+    for(size_t i = 0; i < n; ++i) {
+        new (&m_cells[i]) detail::MetricCell();
+    }
+}
+
+Counter::~Counter() {
+    free(m_cells);
+}
+
+int64_t Counter::value() const {
+    int64_t v = 0;
+    for(size_t i = 0; i < detail::MetricShardCount(); ++i) {
+        v += m_cells[i].value.load(std::memory_order_relaxed);
+    }
+    return v;
+}
+
+Gauge::Gauge(const std::string& name, const std::string& description)
+    :m_name(name)
+    ,m_description(description)
+    ,m_base(0) {
+    size_t n = detail::MetricShardCount();
+    m_cells = (detail::MetricCell*)detail::MetricAlloc(n * sizeof(detail::MetricCell));
+    for(size_t i = 0; i < n; ++i) {
+        new (&m_cells[i]) detail::MetricCell();
+    }
+}
+
+Gauge::~Gauge() {
+    free(m_cells);
+}
+
+int64_t Gauge::shardSum() const {
+    int64_t v = 0;
+    for(size_t i = 0; i < detail::MetricShardCount(); ++i) {
+        v += m_cells[i].value.load(std::memory_order_relaxed);
+    }
+    return v;
+}
+
+void Gauge::set(int64_t v) {
+    m_base.store(v - shardSum(), std::memory_order_relaxed);
+}
+
+int64_t Gauge::value() const {
+    return m_base.load(std::memory_order_relaxed) + shardSum();
+}
+
+uint64_t HistogramSnapshot::bucketLower(size_t idx) const {
+    if(idx < ((size_t)1 << precision)) {
+        return idx;
+    }
+    uint32_t e = (idx >> (precision - 1)) - 1;
+    uint64_t mant = idx - ((size_t)e << (precision - 1));
+    return mant << e;
+}
+
+uint64_t HistogramSnapshot::bucketUpper(size_t idx) const {
+    if(idx < ((size_t)1 << precision)) {
+        return idx;
+    }
+    uint32_t e = (idx >> (precision - 1)) - 1;
+    uint64_t mant = idx - ((size_t)e << (precision - 1));
+    return ((mant + 1) << e) - 1;
+}
+
+uint64_t HistogramSnapshot::percentile(double p) const {
+    if(!count) {
+        return 0;
+    }
+    uint64_t target = (uint64_t)std::ceil(p / 100.0 * count);
+    target = std::max<uint64_t>(1, std::min(target, count));
+    uint64_t seen = 0;
+    for(size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if(seen >= target) {
+            return std::min(bucketUpper(i), max);
+        }
+    }
+    return max;
+}
+
+Histogram::Histogram(const std::string& name, const std::string& description,
+                     uint64_t max_value, uint32_t precision)
+    :m_name(name)
+    ,m_description(description)
+    ,m_maxValue(max_value)
+    ,m_precision(std::min(12u, std::max(2u, precision))) {
+    m_bucketCount = bucketIndex(m_maxValue) + 1;
+    m_shardSize = (1 + m_bucketCount) * sizeof(std::atomic<uint64_t>);
+    m_shardSize = (m_shardSize + MYSERVER_CACHELINE_SIZE - 1) / MYSERVER_CACHELINE_SIZE * MYSERVER_CACHELINE_SIZE;
+    m_shards = (char*)detail::MetricAlloc(detail::MetricShardCount() * m_shardSize);
+}
+
+Histogram::~Histogram() {
+    free(m_shards);
+}
+
+HistogramSnapshot Histogram::snapshot() const {
+    HistogramSnapshot snap;
+    snap.precision = m_precision;
+    snap.buckets.assign(m_bucketCount, 0);
+    for(size_t i = 0; i < detail::MetricShardCount(); ++i) {
+        std::atomic<uint64_t>* s = shard(i);
+        snap.sum += s[0].load(std::memory_order_relaxed);
+        for(size_t b = 0; b < m_bucketCount; ++b) {
+            snap.buckets[b] += s[1 + b].load(std::memory_order_relaxed);
+        }
+    }
+    bool first = true;
+    for(size_t b = 0; b < m_bucketCount; ++b) {
+        if(!snap.buckets[b]) {
+            continue;
+        }
+        if(first) {
+            snap.min = snap.bucketLower(b);
+            first = false;
+        }
+        snap.max = std::min(snap.bucketUpper(b), m_maxValue);
+        snap.count += snap.buckets[b];
+    }
+    return snap;
+}
+
+struct Metrics::Registry {
+    RWMutex mutex;
+    std::map<std::string, Counter::ptr> counters;
+    std::map<std::string, Gauge::ptr> gauges;
+    std::map<std::string, Histogram::ptr> histograms;
+
+    Mutex dumpMutex;
+    Thread::ptr dumper;
+    Semaphore dumpStop;
+
+    bool exists(const std::string& name) const {
+        return counters.count(name) || gauges.count(name) || histograms.count(name);
+    }
+};
+
+Metrics::Registry& Metrics::GetRegistry() {
+    static Registry s_registry;
+    return s_registry;
+}
+
+void Metrics::CheckName(const std::string& name) {
+    if(name.empty() || name.find_first_not_of("abcdefghijklmnopqrstuvwxyz._0123456789")
+            != std::string::npos) {
+        LOG_ERROR(ROOT_LOGGER()) << "Metrics name invalid " << name;
+        throw std::invalid_argument(name);
+    }
+}
+
+// 先在读锁下查找，不存在时在写锁下创建；可能在其他文件的静态初始化期间调用，日志使用 ROOT_LOGGER
+template<class T, class F>
+static std::shared_ptr<T> GetOrCreate(RWMutex& mutex, std::map<std::string, std::shared_ptr<T> >& m,
+                                      const std::string& name, F exists, std::function<T*()> create) {
+    {
+        RWMutex::ReadLock lock(mutex);
+        auto it = m.find(name);
+        if(it != m.end()) {
+            return it->second;
+        }
+    }
+    RWMutex::WriteLock lock(mutex);
+    auto it = m.find(name);
+    if(it != m.end()) {
+        return it->second;
+    }
+    if(exists()) {
+        LOG_ERROR(ROOT_LOGGER()) << "Metrics name=" << name << " exists with another type";
+        return nullptr;
+    }
+    std::shared_ptr<T> v(create());
+    m[name] = v;
+    return v;
+}
+
+Counter::ptr Metrics::GetCounter(const std::string& name, const std::string& description) {
+    CheckName(name);
+    Registry& r = GetRegistry();
+    return GetOrCreate<Counter>(r.mutex, r.counters, name, [&r, &name]() { return r.exists(name); },
+                                [&]() { return new Counter(name, description); });
+}
+
+Gauge::ptr Metrics::GetGauge(const std::string& name, const std::string& description) {
+    CheckName(name);
+    Registry& r = GetRegistry();
+    return GetOrCreate<Gauge>(r.mutex, r.gauges, name, [&r, &name]() { return r.exists(name); },
+                              [&]() { return new Gauge(name, description); });
+}
+
+Histogram::ptr Metrics::GetHistogram(const std::string& name, const std::string& description,
+                                     uint64_t max_value, uint32_t precision) {
+    CheckName(name);
+    Registry& r = GetRegistry();
+    return GetOrCreate<Histogram>(r.mutex, r.histograms, name, [&r, &name]() { return r.exists(name); },
+                                  [&]() { return new Histogram(name, description, max_value, precision); });
+}
+
+static const double PERCENTILES[] = {50, 90, 99, 99.9};
+static const char* PERCENTILE_NAMES[] = {"p50", "p90", "p99", "p999"};
+
+std::string Metrics::ToText() {
+    Registry& r = GetRegistry();
+    std::map<std::string, Counter::ptr> counters;
+    std::map<std::string, Gauge::ptr> gauges;
+    std::map<std::string, Histogram::ptr> histograms;
+    {
+        RWMutex::ReadLock lock(r.mutex);
+        counters = r.counters;
+        gauges = r.gauges;
+        histograms = r.histograms;
+    }
+    std::stringstream ss;
+    for(auto& i : counters) {
+        ss << "counter " << i.first << " " << i.second->value() << std::endl;
+    }
+    for(auto& i : gauges) {
+        ss << "gauge " << i.first << " " << i.second->value() << std::endl;
+    }
+    for(auto& i : histograms) {
+        HistogramSnapshot snap = i.second->snapshot();
+        ss << "histogram " << i.first << " count=" << snap.count << " sum=" << snap.sum
+           << " min=" << snap.min << " mean=" << (uint64_t)snap.mean();
+        for(size_t k = 0; k < sizeof(PERCENTILES) / sizeof(PERCENTILES[0]); ++k) {
+            ss << " " << PERCENTILE_NAMES[k] << "=" << snap.percentile(PERCENTILES[k]);
+        }
+        ss << " max=" << snap.max << std::endl;
+    }
+    return ss.str();
+}
+
+std::string Metrics::ToJson() {
+    Registry& r = GetRegistry();
+    std::map<std::string, Counter::ptr> counters;
+    std::map<std::string, Gauge::ptr> gauges;
+    std::map<std::string, Histogram::ptr> histograms;
+    {
+        RWMutex::ReadLock lock(r.mutex);
+        counters = r.counters;
+        gauges = r.gauges;
+        histograms = r.histograms;
+    }
+    // 指标名只含 [0-9a-z_.]，无需转义
+    std::stringstream ss;
+    ss << "{\"counters\":{";
+    for(auto it = counters.begin(); it != counters.end(); ++it) {
+        ss << (it == counters.begin() ? "" : ",") << "\"" << it->first << "\":" << it->second->value();
+    }
+    ss << "},\"gauges\":{";
+    for(auto it = gauges.begin(); it != gauges.end(); ++it) {
+        ss << (it == gauges.begin() ? "" : ",") << "\"" << it->first << "\":" << it->second->value();
+    }
+    ss << "},\"histograms\":{";
+    for(auto it = histograms.begin(); it != histograms.end(); ++it) {
+        HistogramSnapshot snap = it->second->snapshot();
+        ss << (it == histograms.begin() ? "" : ",") << "\"" << it->first << "\":{"
+           << "\"count\":" << snap.count << ",\"sum\":" << snap.sum
+           << ",\"min\":" << snap.min << ",\"mean\":" << (uint64_t)snap.mean();
+        for(size_t k = 0; k < sizeof(PERCENTILES) / sizeof(PERCENTILES[0]); ++k) {
+            ss << ",\"" << PERCENTILE_NAMES[k] << "\":" << snap.percentile(PERCENTILES[k]);
+        }
+        ss << ",\"max\":" << snap.max << "}";
+    }
+    ss << "}}";
+    return ss.str();
+}
+
+void Metrics::Dump(Logger::ptr logger, bool json) {
+    if(json) {
+        LOG_INFO(logger) << ToJson();
+    } else {
+        LOG_INFO(logger) << "metrics" << std::endl << ToText();
+    }
+}
+
+void Metrics::StartDump(uint64_t interval_ms) {
+    Registry& r = GetRegistry();
+    Mutex::Lock lock(r.dumpMutex);
+    if(r.dumper) {
+        return;
+    }
+    if(!interval_ms) {
+        interval_ms = g_metrics_dump_interval->getValue();
+    }
+    r.dumper.reset(new Thread([&r, interval_ms]() {
+        Logger::ptr logger = LOGGER_NAME("metrics");
+        while(!r.dumpStop.waitFor(interval_ms)) {
+            Dump(logger, g_metrics_dump_format->getValue() == "json");
+        }
+    }, "metrics_dump"));
+}
+
+void Metrics::StopDump() {
+    Registry& r = GetRegistry();
+    Mutex::Lock lock(r.dumpMutex);
+    if(!r.dumper) {
+        return;
+    }
+    r.dumpStop.notify();
+    r.dumper->join();
+    r.dumper.reset();
+}
+
+}
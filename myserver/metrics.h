@@ -0,0 +1,210 @@
+#ifndef __MYSERVER_METRICS_H__
+#define __MYSERVER_METRICS_H__
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include <atomic>
+#include "noncopyable.h"
+#include "log.h"
+#include "queue.h"
+
+namespace myserver {
+
+namespace detail {
+
+// 独占一个缓存行的计数单元
+struct MetricCell {
+    std::atomic<int64_t> value;
+    char pad[MYSERVER_CACHELINE_SIZE - sizeof(std::atomic<int64_t>)];
+    MetricCell() : value(0) {}
+};
+
+// 分片数(2的幂)，不少于CPU数，最多 64
+size_t MetricShardCount();
+// 为当前线程分配分片号，各线程轮流分配
+size_t MetricAssignShard();
+extern thread_local size_t t_metric_shard;
+
+// 当前线程的分片号
+inline size_t MetricShardIndex() {
+    size_t i = t_metric_shard;
+    return i != (size_t)-1 ? i : MetricAssignShard();
+}
+
+// 按缓存行对齐分配 size 字节并清零
+void* MetricAlloc(size_t size);
+
+}
+
+/**
+ * @brief 计数器
+ * @details 每个线程固定落在一个独占缓存行的分片上，inc 只是一次无竞争的原子加；
+ *          读取时才把各分片求和
+ */
+class Counter : Noncopyable {
+public:
+    typedef std::shared_ptr<Counter> ptr;
+
+    Counter(const std::string& name, const std::string& description);
+    ~Counter();
+
+    void inc(int64_t v = 1) {
+        m_cells[detail::MetricShardIndex()].value.fetch_add(v, std::memory_order_relaxed);
+    }
+    // 各分片之和
+    int64_t value() const;
+
+    const std::string& getName() const { return m_name; }
+    const std::string& getDescription() const { return m_description; }
+private:
+    std::string m_name;
+    std::string m_description;
+    detail::MetricCell* m_cells;
+};
+
+/**
+ * @brief 瞬时值
+ * @details add 与 Counter 相同地分片累加；set 把基准值设为 v 减去当前各分片之和，
+ *          与并发的 add 同时发生时结果近似
+ */
+class Gauge : Noncopyable {
+public:
+    typedef std::shared_ptr<Gauge> ptr;
+
+    Gauge(const std::string& name, const std::string& description);
+    ~Gauge();
+
+    void add(int64_t v) {
+        m_cells[detail::MetricShardIndex()].value.fetch_add(v, std::memory_order_relaxed);
+    }
+    void inc() { add(1); }
+    void dec() { add(-1); }
+    void set(int64_t v);
+    int64_t value() const;
+
+    const std::string& getName() const { return m_name; }
+    const std::string& getDescription() const { return m_description; }
+private:
+    int64_t shardSum() const;
+private:
+    std::string m_name;
+    std::string m_description;
+    std::atomic<int64_t> m_base;
+    detail::MetricCell* m_cells;
+};
+
+// 直方图某一时刻的汇总
+struct HistogramSnapshot {
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t min = 0;
+    uint64_t max = 0;
+    uint32_t precision = 0;
+    std::vector<uint64_t> buckets;      // 合并后的各桶计数
+
+    double mean() const { return count ? (double)sum / count : 0; }
+    // 百分位值，p 取 [0, 100]，返回所在桶的上界
+    uint64_t percentile(double p) const;
+    // 第 idx 个桶的取值范围 [lower, upper]
+    uint64_t bucketLower(size_t idx) const;
+    uint64_t bucketUpper(size_t idx) const;
+};
+
+/**
+ * @brief HDR 风格的对数线性直方图
+ * @details 小于 2^precision 的值各占一个桶，之后每个2的幂区间再等分为 2^(precision-1) 个桶，
+ *          相对误差不超过 2^(1-precision)；超过 max_value 的值计入最后一个桶。
+ *          每个分片一份桶数组，record 为一次桶计数与一次求和的无竞争原子加，
+ *          数值单位由使用者决定(一般为微秒)
+ */
+class Histogram : Noncopyable {
+public:
+    typedef std::shared_ptr<Histogram> ptr;
+
+    /**
+     * @param[in] max_value 可精确记录的最大值
+     * @param[in] precision 有效二进制位数，取 [2, 12]
+     */
+    Histogram(const std::string& name, const std::string& description,
+              uint64_t max_value, uint32_t precision);
+    ~Histogram();
+
+    void record(uint64_t v) {
+        std::atomic<uint64_t>* s = shard(detail::MetricShardIndex());
+        s[1 + bucketIndex(v)].fetch_add(1, std::memory_order_relaxed);
+        s[0].fetch_add(v, std::memory_order_relaxed);
+    }
+    // 合并各分片
+    HistogramSnapshot snapshot() const;
+
+    size_t getBucketCount() const { return m_bucketCount; }
+    uint64_t getMaxValue() const { return m_maxValue; }
+    const std::string& getName() const { return m_name; }
+    const std::string& getDescription() const { return m_description; }
+private:
+    // 分片布局：[0] 为求和，[1, m_bucketCount] 为各桶计数
+    std::atomic<uint64_t>* shard(size_t i) const {
+        return (std::atomic<uint64_t>*)(m_shards + i * m_shardSize);
+    }
+    size_t bucketIndex(uint64_t v) const {
+        if(v > m_maxValue) {
+            v = m_maxValue;
+        }
+        if(v < ((uint64_t)1 << m_precision)) {
+            return v;
+        }
+        uint32_t e = 64 - __builtin_clzll(v) - m_precision;
+        return ((size_t)e << (m_precision - 1)) + (v >> e);
+    }
+private:
+    std::string m_name;
+    std::string m_description;
+    uint64_t m_maxValue;
+    uint32_t m_precision;
+    size_t m_bucketCount;
+    size_t m_shardSize;             // 每个分片的字节数，按缓存行对齐
+    char* m_shards;
+};
+
+/**
+ * @brief 指标注册表
+ * @details 指标名与 Config 相同地使用点分小写命名(如 http.server.requests)，同名同类型的指标只创建一次；
+ *          一般在文件作用域取得指标指针，热路径上直接使用。
+ *          快照在读取时才汇总各分片；StartDump 启动后台线程按 metrics.dump_interval
+ *          把全部指标以 metrics.dump_format(text/json)格式写入名为 metrics 的 Logger
+ */
+class Metrics {
+public:
+    /**
+     * @brief 获取/创建计数器
+     * @return 同名指标类型不同时返回 nullptr
+     * @exception 名称包含 [^0-9a-z_.] 以外的字符时抛出 std::invalid_argument
+     */
+    static Counter::ptr GetCounter(const std::string& name, const std::string& description = "");
+    static Gauge::ptr GetGauge(const std::string& name, const std::string& description = "");
+    static Histogram::ptr GetHistogram(const std::string& name, const std::string& description = "",
+                                       uint64_t max_value = 60ULL * 1000 * 1000, uint32_t precision = 7);
+
+    // 每行一个指标
+    static std::string ToText();
+    static std::string ToJson();
+    // 把全部指标写入 logger
+    static void Dump(Logger::ptr logger, bool json);
+
+    /**
+     * @brief 启动周期输出线程
+     * @param[in] interval_ms 输出间隔，0 表示使用配置 metrics.dump_interval
+     */
+    static void StartDump(uint64_t interval_ms = 0);
+    static void StopDump();
+private:
+    struct Registry;
+    static Registry& GetRegistry();
+    static void CheckName(const std::string& name);
+};
+
+}
+
+#endif
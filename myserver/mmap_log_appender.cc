@@ -0,0 +1,263 @@
+#include "mmap_log_appender.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <iostream>
+#include <yaml-cpp/yaml.h>
+#include "metrics.h"
+
+namespace myserver {
+
+static myserver::Counter::ptr g_log_mmap_dropped =
+    myserver::Metrics::GetCounter("log.mmap.dropped", "log events dropped by MmapFileLogAppender");
+
+uint64_t MmapFileLogAppender::Segment::used() const {
+    uint64_t t = tail.load(std::memory_order_relaxed);
+    return t <= capacity ? t : end.load(std::memory_order_relaxed);
+}
+
+MmapFileLogAppender::MmapFileLogAppender(const std::string& filename, const Options& options)
+    :m_filename(filename)
+    ,m_options(options)
+    ,m_current(nullptr)
+    ,m_stopping(false)
+    ,m_rolled(0)
+    ,m_dropped(0) {
+    if(m_options.segment_size == 0) {
+        m_options.segment_size = 1;
+    }
+    Segment* seg = nullptr;
+    {
+        Mutex::Lock lock(m_mutex);
+        seg = allocSegment();
+    }
+    if(!openSegment(seg, m_filename)) {
+        return;
+    }
+    m_current.store(seg);
+    FatalSignalHandler::AddFlushable(this);
+    m_thread.reset(new Thread(std::bind(&MmapFileLogAppender::run, this), "log_mmap"));
+}
+
+MmapFileLogAppender::~MmapFileLogAppender() {
+    FatalSignalHandler::RemoveFlushable(this);
+    m_stopping.store(true, std::memory_order_release);
+    if(m_thread) {
+        m_wakeup.notify();
+        m_thread->join();
+    }
+    Segment* cur = m_current.exchange(nullptr);
+    for(auto seg : m_retired) {
+        closeSegment(seg);
+    }
+    m_retired.clear();
+    if(cur) {
+        closeSegment(cur);
+    }
+    if(m_spare) {
+        closeSegment(m_spare);
+        unlink((m_filename + ".next").c_str());
+        m_spare = nullptr;
+    }
+    for(auto seg : m_all) {
+        delete seg;
+    }
+}
+
+void MmapFileLogAppender::log(Logger::ptr logger, LogEvent::ptr event) {
+    if(event->getLevel() < m_level) {
+        return;
+    }
+    std::string msg = m_formatter->format(logger, event);
+    append(msg.c_str(), msg.size());
+}
+
+bool MmapFileLogAppender::append(const char* data, size_t len) {
+    if(len == 0) {
+        return true;
+    }
+    if(len <= m_options.segment_size) {
+        while(Segment* seg = m_current.load()) {
+            int rt = tryAppend(seg, data, len);
+            if(rt == 0) {
+                return true;
+            }
+            if(rt > 0 && !roll(seg)) {
+                break;
+            }
+        }
+    }
+    m_dropped.fetch_add(1, std::memory_order_relaxed);
+    g_log_mmap_dropped->inc();
+    return false;
+}
+
+int MmapFileLogAppender::tryAppend(Segment* seg, const char* data, size_t len) {
+    // 先登记再确认仍是当前段，与 roll 中先切换再等待 writers 归零配对
+    seg->writers.fetch_add(1);
+    if(m_current.load() != seg) {
+        seg->writers.fetch_sub(1, std::memory_order_release);
+        return -1;
+    }
+    int rt = 0;
+    uint64_t off = seg->tail.fetch_add(len, std::memory_order_relaxed);
+    if(off + len <= seg->capacity) {
+        memcpy(seg->base + off, data, len);
+    } else {
+        // 只有一个预留跨过段尾，它的起点就是数据的结尾
+        if(off <= seg->capacity) {
+            seg->end.store(off, std::memory_order_relaxed);
+        }
+        rt = 1;
+    }
+    seg->writers.fetch_sub(1, std::memory_order_release);
+    return rt;
+}
+
+bool MmapFileLogAppender::roll(Segment* seg) {
+    Mutex::Lock lock(m_mutex);
+    // 结构体会被复用：seg 可能已经切换出去又成为当前段，只有本代确实写满才切换
+    if(m_current.load() != seg || seg->tail.load(std::memory_order_relaxed) <= seg->capacity) {
+        return true;
+    }
+    std::string spare_path = m_filename + ".next";
+    Segment* next = m_spare;
+    m_spare = nullptr;
+    if(!next) {
+        // 后台线程还没准备好，同步创建
+        next = allocSegment();
+        if(!openSegment(next, spare_path)) {
+            m_free.push_back(next);
+            return false;
+        }
+    }
+    std::string rolled = m_filename + "." + std::to_string(m_rolled.load(std::memory_order_relaxed) + 1);
+    if(rename(m_filename.c_str(), rolled.c_str()) || rename(spare_path.c_str(), m_filename.c_str())) {
+        std::cout << "MmapFileLogAppender rename " << m_filename << " errno=" << errno
+                  << " errstr=" << strerror(errno) << std::endl;
+    }
+    m_current.store(next);
+    m_retired.push_back(seg);
+    m_rolled.fetch_add(1, std::memory_order_relaxed);
+    lock.unlock();
+    m_wakeup.notify();
+    return true;
+}
+
+void MmapFileLogAppender::run() {
+    while(!m_stopping.load(std::memory_order_acquire)) {
+        m_wakeup.waitFor(m_options.sync_interval);
+        std::list<Segment*> retired;
+        {
+            // 持锁准备下一段，避免与 roll 中的同步创建同时写 filename.next
+            Mutex::Lock lock(m_mutex);
+            retired.swap(m_retired);
+            if(!m_spare && !m_stopping.load(std::memory_order_relaxed)) {
+                Segment* seg = allocSegment();
+                if(openSegment(seg, m_filename + ".next")) {
+                    m_spare = seg;
+                } else {
+                    m_free.push_back(seg);
+                }
+            }
+        }
+        for(auto seg : retired) {
+            closeSegment(seg);
+        }
+        // 段只在本线程关闭，当前段在此期间不会被解除映射
+        Segment* cur = m_current.load();
+        if(cur) {
+            msync(cur->base, cur->used(), MS_ASYNC);
+        }
+    }
+}
+
+MmapFileLogAppender::Segment* MmapFileLogAppender::allocSegment() {
+    if(!m_free.empty()) {
+        Segment* seg = m_free.front();
+        m_free.pop_front();
+        return seg;
+    }
+    Segment* seg = new Segment;
+    m_all.push_back(seg);
+    return seg;
+}
+
+bool MmapFileLogAppender::openSegment(Segment* seg, const std::string& path) {
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd < 0) {
+        std::cout << "MmapFileLogAppender open " << path << " errno=" << errno
+                  << " errstr=" << strerror(errno) << std::endl;
+        return false;
+    }
+    uint64_t size = m_options.segment_size;
+    int rt = fallocate(fd, 0, 0, size);
+    if(rt && (errno == EOPNOTSUPP || errno == ENOSYS)) {
+        rt = ftruncate(fd, size);
+    }
+    void* base = MAP_FAILED;
+    if(rt == 0) {
+        base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if(base == MAP_FAILED) {
+        std::cout << "MmapFileLogAppender map " << path << " size=" << size << " errno=" << errno
+                  << " errstr=" << strerror(errno) << std::endl;
+        close(fd);
+        return false;
+    }
+    seg->base = (char*)base;
+    seg->capacity = size;
+    seg->fd = fd;
+    seg->tail.store(0, std::memory_order_relaxed);
+    seg->end.store(0, std::memory_order_relaxed);
+    return true;
+}
+
+void MmapFileLogAppender::closeSegment(Segment* seg) {
+    while(seg->writers.load() != 0) {
+        sched_yield();
+    }
+    uint64_t used = seg->used();
+    msync(seg->base, used, MS_ASYNC);
+    munmap(seg->base, seg->capacity);
+    if(ftruncate(seg->fd, used)) {
+        std::cout << "MmapFileLogAppender truncate errno=" << errno
+                  << " errstr=" << strerror(errno) << std::endl;
+    }
+    close(seg->fd);
+    seg->base = nullptr;
+    seg->fd = -1;
+    Mutex::Lock lock(m_mutex);
+    m_free.push_back(seg);
+}
+
+void MmapFileLogAppender::crashFlush(const char* report, size_t len) {
+    // 数据已在页缓存中，只追加报告；不切换段，写不下时报告只出现在 stderr
+    Segment* seg = m_current.load();
+    if(seg && len && len <= seg->capacity) {
+        tryAppend(seg, report, len);
+    }
+}
+
+std::string MmapFileLogAppender::toYamlString() {
+    YAML::Node node;
+    node["type"] = "MmapFileLogAppender";
+    node["file"] = m_filename;
+    node["segment_size"] = m_options.segment_size;
+    node["sync_interval"] = m_options.sync_interval;
+    if(m_level != LogLevel::UNKNOWN) {
+        node["level"] = LogLevel::ToString(m_level);
+    }
+    if(m_hasFormatter && m_formatter) {
+        node["formatter"] = m_formatter->getPattern();
+    }
+    std::stringstream ss;
+    ss << node;
+    return ss.str();
+}
+
+}
@@ -0,0 +1,91 @@
+#ifndef __MYSERVER_MMAP_LOG_APPENDER_H__
+#define __MYSERVER_MMAP_LOG_APPENDER_H__
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <string>
+#include "log.h"
+#include "mutex.h"
+#include "thread.h"
+#include "fatal_signal.h"
+
+namespace myserver {
+
+/**
+ * @brief 通过内存映射写文件的Appender，用于量很大的调试日志
+ * @details 文件按 segment_size 预分配(fallocate)后整段 mmap，log() 格式化后对段尾偏移做一次
+ *          fetch_add 预留空间再 memcpy，多个线程写日志时不加锁、不进入内核。
+ *          段写满时把当前段改名为 filename.N(N 从 1 递增)，切换到后台线程 log_mmap 预先准备好的
+ *          下一段(filename.next 改名为 filename)；旧段由后台线程等写入完成后 msync(MS_ASYNC)、
+ *          截断到实际大小再关闭。后台线程每 sync_interval 毫秒对当前段做一次 msync(MS_ASYNC)。
+ *          与 FileLogAppender 一样打开时覆盖旧文件；超过 segment_size 的单条日志被丢弃。
+ *          进程崩溃时已写入的数据在页缓存中不会丢失，崩溃报告追加到当前段，但文件保留预分配的大小(尾部为 0)
+ */
+class MmapFileLogAppender : public LogAppender, public CrashFlushable {
+public:
+    typedef std::shared_ptr<MmapFileLogAppender> ptr;
+
+    struct Options {
+        uint64_t segment_size = 64 * 1024 * 1024;   // 每段大小(字节)
+        uint32_t sync_interval = 1000;              // msync 间隔(毫秒)
+    };
+
+    MmapFileLogAppender(const std::string& filename, const Options& options);
+    ~MmapFileLogAppender();
+
+    void log(Logger::ptr logger, LogEvent::ptr event) override;
+    std::string toYamlString() override;
+    void crashFlush(const char* report, size_t len) override;
+
+    // 直接追加一段已格式化的数据，失败(超长或无法切换段)返回 false
+    bool append(const char* data, size_t len);
+
+    // 已切换出的段数
+    uint32_t getRolled() const { return m_rolled.load(std::memory_order_relaxed); }
+    uint64_t getDropped() const { return m_dropped.load(std::memory_order_relaxed); }
+private:
+    // 一个映射段，结构体在 Appender 析构前不释放(复用)，持有旧指针的线程可以安全地访问计数
+    struct Segment {
+        char* base = nullptr;
+        uint64_t capacity = 0;
+        int fd = -1;
+        std::atomic<uint64_t> tail;     // 已预留到的偏移，可能超过 capacity
+        std::atomic<uint64_t> end;      // 写满时数据的实际结尾
+        std::atomic<int> writers;       // 正在写入的线程数
+
+        Segment() : tail(0), end(0), writers(0) { }
+        uint64_t used() const;
+    };
+
+    void run();
+    // 取一个空闲结构体，调用时持有 m_mutex
+    Segment* allocSegment();
+    // 创建文件、预分配并映射到 seg
+    bool openSegment(Segment* seg, const std::string& path);
+    // 截断到实际大小并关闭，结构体放回空闲列表
+    void closeSegment(Segment* seg);
+    // seg 写满，切换到下一段
+    bool roll(Segment* seg);
+    // 0 成功，1 段已满，-1 seg 已不是当前段
+    int tryAppend(Segment* seg, const char* data, size_t len);
+private:
+    std::string m_filename;
+    Options m_options;
+    std::atomic<Segment*> m_current;
+    std::atomic<bool> m_stopping;
+    std::atomic<uint32_t> m_rolled;
+    std::atomic<uint64_t> m_dropped;
+
+    Mutex m_mutex;
+    Segment* m_spare = nullptr;         // 预先准备好的下一段
+    std::list<Segment*> m_retired;      // 待关闭的旧段
+    std::list<Segment*> m_free;         // 可复用的结构体
+    std::list<Segment*> m_all;          // 全部结构体，析构时释放
+    Semaphore m_wakeup;
+    Thread::ptr m_thread;
+};
+
+}
+
+#endif
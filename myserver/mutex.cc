@@ -1,29 +1,241 @@
 #include "mutex.h"
+#include <stdexcept>
+#include <thread>
+#include <algorithm>
+#include <sched.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 
 
 namespace myserver {
 
-Semaphore::Semaphore(uint32_t count) {
-    if(sem_init(&m_semaphore, 0, count)) {
-        throw std::logic_error("sem_init error");
+// futex 等待：*addr == expected 时睡眠，deadline 为 CLOCK_MONOTONIC 绝对时间(为空则不限时)
+// 返回 false 表示已超时
+static bool FutexWait(std::atomic<int32_t>* addr, int32_t expected, const struct timespec* deadline) {
+    struct timespec rel;
+    struct timespec* prel = nullptr;
+    if(deadline) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        int64_t ns = (deadline->tv_sec - now.tv_sec) * 1000000000LL
+                     + (deadline->tv_nsec - now.tv_nsec);
+        if(ns <= 0) {
+            return false;
+        }
+        rel.tv_sec = ns / 1000000000LL;
+        rel.tv_nsec = ns % 1000000000LL;
+        prel = &rel;
     }
+    int rt = syscall(SYS_futex, reinterpret_cast<int32_t*>(addr), FUTEX_WAIT_PRIVATE,
+                     expected, prel, nullptr, 0);
+    return !(rt == -1 && errno == ETIMEDOUT);
+}
+
+static void FutexWake(std::atomic<int32_t>* addr, int32_t n) {
+    syscall(SYS_futex, reinterpret_cast<int32_t*>(addr), FUTEX_WAKE_PRIVATE, n, nullptr, nullptr, 0);
+}
+
+static struct timespec MakeDeadline(uint64_t timeout_ms) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec += timeout_ms / 1000;
+    ts.tv_nsec += (timeout_ms % 1000) * 1000000;
+    if(ts.tv_nsec >= 1000000000) {
+        ++ts.tv_sec;
+        ts.tv_nsec -= 1000000000;
+    }
+    return ts;
+}
+
+// 等待计数归零，CountDownLatch 与 WaitGroup 共用
+static bool WaitZero(std::atomic<int32_t>& count, std::atomic<int32_t>& waiters,
+                     const struct timespec* deadline) {
+    int32_t c;
+    while((c = count.load(std::memory_order_acquire)) > 0) {
+        // 先登记等待者再由内核复查计数，与唤醒方的 减计数->查等待者 构成 Dekker 式配对
+        waiters.fetch_add(1);
+        bool ok = FutexWait(&count, c, deadline);
+        waiters.fetch_sub(1);
+        if(!ok) {
+            return count.load(std::memory_order_acquire) <= 0;
+        }
+    }
+    return true;
+}
 
+Semaphore::Semaphore(uint32_t count)
+    :m_count(count)
+    ,m_waiters(0) {
 }
 
 Semaphore::~Semaphore() {
-    sem_destroy(&m_semaphore);
+}
+
+bool Semaphore::tryWait() {
+    int32_t c = m_count.load(std::memory_order_relaxed);
+    while(c > 0) {
+        if(m_count.compare_exchange_weak(c, c - 1, std::memory_order_acquire,
+                                         std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Semaphore::waitUntil(const struct timespec* deadline) {
+    while(!tryWait()) {
+        m_waiters.fetch_add(1);
+        bool ok = FutexWait(&m_count, 0, deadline);
+        m_waiters.fetch_sub(1);
+        if(!ok) {
+            return tryWait();
+        }
+    }
+    return true;
 }
 
 void Semaphore::wait() {
-    if(sem_wait(&m_semaphore)) {
-        throw std::logic_error("sem_wait error");
+    waitUntil(nullptr);
+}
+
+bool Semaphore::waitFor(uint64_t timeout_ms) {
+    if(tryWait()) {
+        return true;
     }
+    struct timespec deadline = MakeDeadline(timeout_ms);
+    return waitUntil(&deadline);
 }
 
 void Semaphore::notify() {
-    if(sem_post(&m_semaphore)) {
-        throw std::logic_error("sem_post error");
+    m_count.fetch_add(1);
+    if(m_waiters.load()) {
+        FutexWake(&m_count, 1);
+    }
+}
+
+CountDownLatch::CountDownLatch(uint32_t count)
+    :m_count(count)
+    ,m_waiters(0) {
+}
+
+void CountDownLatch::countDown(uint32_t n) {
+    int32_t c = m_count.load(std::memory_order_relaxed);
+    do {
+        if(c <= 0) {
+            return;
+        }
+    } while(!m_count.compare_exchange_weak(c, c > (int32_t)n ? c - (int32_t)n : 0));
+    if(c <= (int32_t)n && m_waiters.load()) {
+        FutexWake(&m_count, INT32_MAX);
+    }
+}
+
+void CountDownLatch::wait() {
+    WaitZero(m_count, m_waiters, nullptr);
+}
+
+bool CountDownLatch::waitFor(uint64_t timeout_ms) {
+    struct timespec deadline = MakeDeadline(timeout_ms);
+    return WaitZero(m_count, m_waiters, &deadline);
+}
+
+WaitGroup::WaitGroup()
+    :m_count(0)
+    ,m_waiters(0) {
+}
+
+void WaitGroup::add(int32_t delta) {
+    // 先检查再发布，计数不会出现短暂的负值
+    int32_t c = m_count.load();
+    int32_t v;
+    do {
+        v = c + delta;
+        if(v < 0) {
+            throw std::logic_error("WaitGroup negative counter");
+        }
+    } while(!m_count.compare_exchange_weak(c, v));
+    if(v == 0 && delta < 0 && m_waiters.load()) {
+        FutexWake(&m_count, INT32_MAX);
+    }
+}
+
+void WaitGroup::wait() {
+    WaitZero(m_count, m_waiters, nullptr);
+}
+
+bool WaitGroup::waitFor(uint64_t timeout_ms) {
+    struct timespec deadline = MakeDeadline(timeout_ms);
+    return WaitZero(m_count, m_waiters, &deadline);
+}
+
+static std::atomic<uint32_t> s_brw_slot_seq(0);
+static thread_local int64_t t_brw_slot = -1;    // 当前线程分配到的读计数槽序号
+
+static uint32_t RoundUpPow2(uint32_t v) {
+    uint32_t n = 1;
+    while(n < v) {
+        n <<= 1;
+    }
+    return n;
+}
+
+BRWMutex::BRWMutex()
+    :m_slots(RoundUpPow2(std::max(1u, std::thread::hardware_concurrency())))
+    ,m_mask(m_slots.size() - 1)
+    ,m_writer(false)
+    ,m_owner(0) {
+    pthread_mutex_init(&m_wmutex, nullptr);
+}
+
+BRWMutex::~BRWMutex() {
+    pthread_mutex_destroy(&m_wmutex);
+}
+
+BRWMutex::Slot& BRWMutex::mySlot() {
+    if(t_brw_slot < 0) {
+        t_brw_slot = s_brw_slot_seq.fetch_add(1, std::memory_order_relaxed);
+    }
+    return m_slots[t_brw_slot & m_mask];
+}
+
+void BRWMutex::rdlock() {
+    Slot& slot = mySlot();
+    while(true) {
+        // 先登记再检查写标志，与 wrlock 中先置位再检查计数构成 Dekker 式互斥(均为 seq_cst)
+        slot.readers.fetch_add(1);
+        if(!m_writer.load()) {
+            return;
+        }
+        slot.readers.fetch_sub(1);
+        for(int i = 0; m_writer.load(std::memory_order_relaxed); ++i) {
+            i < 64 ? CpuRelax() : (void)sched_yield();
+        }
     }
 }
 
-}
\ No newline at end of file
+void BRWMutex::wrlock() {
+    pthread_mutex_lock(&m_wmutex);
+    m_writer.store(true);
+    for(auto& slot : m_slots) {
+        for(int i = 0; slot.readers.load() != 0; ++i) {
+            i < 64 ? CpuRelax() : (void)sched_yield();
+        }
+    }
+    m_owner.store(pthread_self(), std::memory_order_relaxed);
+}
+
+void BRWMutex::unlock() {
+    if(m_writer.load(std::memory_order_relaxed)
+            && pthread_equal(m_owner.load(std::memory_order_relaxed), pthread_self())) {
+        m_owner.store(0, std::memory_order_relaxed);
+        m_writer.store(false, std::memory_order_release);
+        pthread_mutex_unlock(&m_wmutex);
+        return;
+    }
+    mySlot().readers.fetch_sub(1, std::memory_order_release);
+}
+
+}
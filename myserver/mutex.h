@@ -2,15 +2,23 @@
 #define __MYSERVER_MUTEX_H__
 
 #include "noncopyable.h"
-#include <semaphore.h>
+#include <pthread.h>
 #include <stdint.h>
+#include <string.h>
+#include <time.h>
 #include <memory>
 #include <atomic>
+#include <vector>
+#include <type_traits>
 
 namespace myserver {
 
 // 信号量 和 锁 类：在构造时进行初始化，在析构时进行销毁；隐藏初始化与销毁操作
 
+// 同步原语(Semaphore/CountDownLatch/WaitGroup)直接基于 futex 实现：
+// 计数充足或无等待者时只做用户态原子操作，只有真正需要睡眠/唤醒时才进入内核。
+// 阻塞点集中在 mutex.cc 的 FutexWait/FutexWake，后续协程调度可在此处替换为让出协程
+
 // 信号量
 class Semaphore : Noncopyable {
 public:
@@ -24,8 +32,50 @@ public:
     void wait();
     void notify();
 
+    // 不阻塞地尝试获取，成功返回true
+    bool tryWait();
+
+    /**
+     * @brief 限时等待
+     * @param[in] timeout_ms 超时时间(毫秒)
+     * @return 超时返回false
+     */
+    bool waitFor(uint64_t timeout_ms);
+private:
+    bool waitUntil(const struct timespec* deadline);
+private:
+    std::atomic<int32_t> m_count;       // 信号量值(futex字)
+    std::atomic<int32_t> m_waiters;     // 正在等待的线程数
+};
+
+// 倒计数门闩：计数减为0后唤醒所有等待者，不可重置
+class CountDownLatch : Noncopyable {
+public:
+    CountDownLatch(uint32_t count);
+
+    void countDown(uint32_t n = 1);
+    void wait();
+    bool waitFor(uint64_t timeout_ms);
+    uint32_t getCount() const { return m_count.load(std::memory_order_acquire); }
 private:
-    sem_t m_semaphore;
+    std::atomic<int32_t> m_count;       // 剩余计数(futex字)
+    std::atomic<int32_t> m_waiters;     // 正在等待的线程数
+};
+
+// 类似 Go sync.WaitGroup：add 登记任务数，done 完成一个，wait 等待计数归零；计数归零后可复用
+class WaitGroup : Noncopyable {
+public:
+    WaitGroup();
+
+    // 计数变为负数时抛出 std::logic_error
+    void add(int32_t delta = 1);
+    void done() { add(-1); }
+    void wait();
+    bool waitFor(uint64_t timeout_ms);
+    int32_t getCount() const { return m_count.load(std::memory_order_acquire); }
+private:
+    std::atomic<int32_t> m_count;       // 未完成任务数(futex字)
+    std::atomic<int32_t> m_waiters;     // 正在等待的线程数
 };
 
 // 1. 自主上锁解锁：遵循RAII准则，提供锁的局部控制类，在栈内创建局部控制类锁时上锁，超出作用域时解锁；
@@ -257,6 +307,130 @@ private:
     volatile std::atomic_flag m_mutex;  // 原子状态
 };
 
+// 忙等时让出流水线
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __asm__ __volatile__("pause" ::: "memory");
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield" ::: "memory");
+#else
+    __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+/**
+ * @brief 读偏向的分片读写锁(big-reader lock)
+ * @details 按CPU数分配若干独占缓存行的读计数槽，线程首次使用时固定分配一个槽；
+ *          读者只修改自己槽所在的缓存行，写者置位写标志后等待所有槽清零。
+ *          适用于配置快照、路由表等读多写少的共享数据，写操作代价为 O(槽数)
+ */
+class BRWMutex : Noncopyable {
+public:
+    typedef ReadScopedLockImpl<BRWMutex> ReadLock;    // 装配局部读锁
+    typedef WriteScopedLockImpl<BRWMutex> WriteLock;  // 装配局部写锁
+
+    BRWMutex();
+    ~BRWMutex();
+
+    void rdlock();
+    void wrlock();
+    void unlock();
+private:
+    // 按128字节填充，避免相邻槽共享缓存行及相邻行预取带来的伪共享
+    struct Slot {
+        std::atomic<int32_t> readers;
+        char pad[128 - sizeof(std::atomic<int32_t>)];
+        Slot() : readers(0) {}
+    };
+
+    Slot& mySlot();
+private:
+    std::vector<Slot> m_slots;          // 读计数槽
+    uint32_t m_mask;                    // 槽数-1(槽数为2的幂)
+    char m_pad0[128];
+    std::atomic<bool> m_writer;         // 是否有写者持有或正在获取锁
+    std::atomic<pthread_t> m_owner;     // 持有写锁的线程
+    char m_pad1[128];
+    pthread_mutex_t m_wmutex;           // 写者之间互斥
+};
+
+/**
+ * @brief 顺序锁：保护小型POD数据，读者无锁且不写共享内存
+ * @details 写者递增序列号(奇数表示写入中)后修改数据；读者前后两次读取序列号一致
+ *          且为偶数时拷贝有效，否则重试。读者通过 load() 乐观读取；
+ *          ReadLock 为排他读(与写者互斥、不递增序列号)，WriteLock 可原地修改数据
+ */
+template<class T>
+class SeqLock : Noncopyable {
+public:
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock requires trivially copyable T");
+    typedef ReadScopedLockImpl<SeqLock> ReadLock;    // 装配局部排他读锁
+    typedef WriteScopedLockImpl<SeqLock> WriteLock;  // 装配局部写锁
+
+    SeqLock(const T& v = T())
+        :m_seq(0) {
+        m_mutex.clear();
+        memcpy(&m_data, &v, sizeof(T));
+    }
+
+    // 乐观读：无写者时只读两次序列号
+    T load() const {
+        T v;
+        uint32_t s1, s2;
+        do {
+            while((s1 = m_seq.load(std::memory_order_acquire)) & 1) {
+                CpuRelax();
+            }
+            memcpy(&v, (const void*)&m_data, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            s2 = m_seq.load(std::memory_order_relaxed);
+        } while(s1 != s2);
+        return v;
+    }
+
+    void store(const T& v) {
+        wrlock();
+        memcpy((void*)&m_data, &v, sizeof(T));
+        unlock();
+    }
+
+    uint32_t getSequence() const { return m_seq.load(std::memory_order_acquire); }
+
+    // 仅在持有 ReadLock/WriteLock 时访问
+    T& get() { return m_data; }
+
+    void rdlock() {
+        lockWriters();
+        m_writing = false;
+    }
+
+    void wrlock() {
+        lockWriters();
+        m_writing = true;
+        m_seq.store(m_seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void unlock() {
+        if(m_writing) {
+            m_writing = false;
+            m_seq.store(m_seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+        m_mutex.clear(std::memory_order_release);
+    }
+private:
+    void lockWriters() {
+        while(m_mutex.test_and_set(std::memory_order_acquire)) {
+            CpuRelax();
+        }
+    }
+private:
+    std::atomic<uint32_t> m_seq;    // 序列号
+    std::atomic_flag m_mutex;       // 写者(及排他读者)互斥
+    bool m_writing = false;         // 当前持有者是否为写者
+    T m_data;                       // 被保护数据
+};
+
 
 }
 
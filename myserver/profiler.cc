@@ -0,0 +1,493 @@
+#include "profiler.h"
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <execinfo.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <ucontext.h>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <vector>
+#include "config.h"
+#include "log.h"
+#include "mutex.h"
+#include "queue.h"
+#include "thread.h"
+#include "util.h"
+
+#ifndef SIGEV_THREAD_ID
+#define SIGEV_THREAD_ID 4
+#endif
+
+namespace myserver {
+
+static myserver::Logger::ptr g_logger = LOGGER_NAME("system");
+
+static myserver::ConfigVar<bool>::ptr g_profiler_enable =
+    myserver::Config::Lookup("profiler.enable", false, "enable sampling cpu profiler");
+
+static myserver::ConfigVar<uint32_t>::ptr g_profiler_frequency =
+    myserver::Config::Lookup("profiler.frequency", (uint32_t)99, "profiler samples per cpu second");
+
+static myserver::ConfigVar<std::string>::ptr g_profiler_output =
+    myserver::Config::Lookup("profiler.output", std::string("cpu.folded"), "profiler output file");
+
+static myserver::ConfigVar<std::string>::ptr g_profiler_format =
+    myserver::Config::Lookup("profiler.format", std::string("folded"),
+            "profiler output format: folded or pprof");
+
+namespace {
+
+// 单个样本最多记录的栈帧数
+const uint32_t MAX_DEPTH = 64;
+// 每个线程的样本缓冲容量，后台线程每 100ms 取一次
+const uint64_t RING_SIZE = 256;
+const uint64_t DRAIN_INTERVAL_MS = 100;
+
+struct Sample {
+    uint32_t weight;                // 定时器到期次数，含信号未处理期间的 overrun
+    uint32_t depth;
+    void* pcs[MAX_DEPTH];           // pcs[0] 为被打断处，之后依次为各层返回地址
+};
+
+/**
+ * @brief 已登记的线程
+ * @details 样本缓冲的生产者为本线程的信号处理函数，消费者为后台线程。
+ *          缓冲在首次为该线程创建定时器时分配，从未开启采样的线程不占用
+ */
+struct ProfileThread {
+    typedef std::shared_ptr<ProfileThread> ptr;
+
+    std::atomic<uint64_t> head;     // 仅信号处理函数修改
+    char pad0[MYSERVER_CACHELINE_SIZE - sizeof(std::atomic<uint64_t>)];
+    std::atomic<uint64_t> tail;     // 仅后台线程修改
+    char pad1[MYSERVER_CACHELINE_SIZE - sizeof(std::atomic<uint64_t>)];
+
+    std::unique_ptr<Sample[]> samples;  // RING_SIZE 个，创建定时器前分配
+    pid_t tid;
+    pthread_t thread;
+    std::atomic<const std::string*> name;   // 线程名称(驻留字符串)
+    uintptr_t stackLo = 0;          // 栈范围，用于校验帧指针
+    uintptr_t stackHi = 0;
+    timer_t timer;
+    bool hasTimer = false;
+    bool dead = false;              // 已注销，取空后移除
+
+    ProfileThread()
+        :head(0)
+        ,tail(0) {
+        ThreadContext& ctx = ThreadContext::GetThis();
+        tid = ctx.getTid();
+        name.store(ctx.getNamePtr(), std::memory_order_relaxed);
+        thread = pthread_self();
+        pthread_attr_t attr;
+        if(pthread_getattr_np(thread, &attr) == 0) {
+            void* addr = nullptr;
+            size_t size = 0;
+            if(pthread_attr_getstack(&attr, &addr, &size) == 0) {
+                stackLo = (uintptr_t)addr;
+                stackHi = stackLo + size;
+            }
+            pthread_attr_destroy(&attr);
+        }
+    }
+};
+
+thread_local ProfileThread* t_profile_thread = nullptr;
+
+std::atomic<bool> s_running(false);
+std::atomic<uint64_t> s_dropped(0);
+
+struct ProfilerState {
+    Mutex mutex;                                // 保护 threads 及各线程的定时器
+    std::vector<ProfileThread::ptr> threads;
+    uint32_t periodNs = 0;
+
+    Mutex controlMutex;                         // 串行化 Start/Stop
+    Thread::ptr drainer;
+    Semaphore stop;
+    std::string path;
+
+    Mutex aggMutex;                             // 保护聚合结果
+    std::map<std::string, std::map<std::vector<void*>, uint64_t> > stacks;
+    uint64_t samples = 0;
+};
+
+ProfilerState& GetState() {
+    static ProfilerState* s_state = new ProfilerState;
+    return *s_state;
+}
+
+// 沿帧指针回溯，只接受落在本线程栈范围内且向栈底递增的帧
+uint32_t Unwind(void* context, void** pcs, const ProfileThread* t) {
+#if defined(__x86_64__)
+    const ucontext_t* uc = (const ucontext_t*)context;
+    pcs[0] = (void*)uc->uc_mcontext.gregs[REG_RIP];
+    uintptr_t fp = uc->uc_mcontext.gregs[REG_RBP];
+    uint32_t depth = 1;
+    while(depth < MAX_DEPTH) {
+        if(fp < t->stackLo || fp + 2 * sizeof(uintptr_t) > t->stackHi
+                || (fp & (sizeof(uintptr_t) - 1))) {
+            break;
+        }
+        const uintptr_t* frame = (const uintptr_t*)fp;
+        if(!frame[1]) {
+            break;
+        }
+        pcs[depth++] = (void*)frame[1];
+        if(frame[0] <= fp) {
+            break;
+        }
+        fp = frame[0];
+    }
+    return depth;
+#else
+    return backtrace(pcs, MAX_DEPTH);
+#endif
+}
+
+void SigprofHandler(int sig, siginfo_t* info, void* context) {
+    ProfileThread* t = t_profile_thread;
+    if(!t || !t->samples || !s_running.load(std::memory_order_relaxed)) {
+        return;
+    }
+    int saved_errno = errno;
+    // CPU 时间定时器按时钟节拍检查到期，周期短于节拍时一次信号代表多次到期
+    uint32_t weight = 1;
+    if(info && info->si_code == SI_TIMER && info->si_overrun > 0) {
+        weight += info->si_overrun;
+    }
+    uint64_t h = t->head.load(std::memory_order_relaxed);
+    if(h - t->tail.load(std::memory_order_acquire) >= RING_SIZE) {
+        s_dropped.fetch_add(weight, std::memory_order_relaxed);
+    } else {
+        Sample& s = t->samples[h % RING_SIZE];
+        s.weight = weight;
+        s.depth = Unwind(context, s.pcs, t);
+        t->head.store(h + 1, std::memory_order_release);
+    }
+    errno = saved_errno;
+}
+
+bool InstallHandler() {
+    static bool s_installed = false;
+    if(s_installed) {
+        return true;
+    }
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = &SigprofHandler;
+    sa.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    if(sigaction(SIGPROF, &sa, nullptr)) {
+        LOG_ERROR(g_logger) << "Profiler sigaction SIGPROF errno=" << errno
+            << " errstr=" << strerror(errno);
+        return false;
+    }
+    s_installed = true;
+    return true;
+}
+
+// 为线程创建按其 CPU 时间计时的定时器，调用方持有 mutex
+void StartTimerLocked(ProfilerState& st, ProfileThread& t) {
+    if(t.hasTimer || t.dead) {
+        return;
+    }
+    if(!t.samples) {
+        t.samples.reset(new Sample[RING_SIZE]);
+    }
+    clockid_t cid;
+    if(pthread_getcpuclockid(t.thread, &cid)) {
+        return;
+    }
+    struct sigevent sev;
+    memset(&sev, 0, sizeof(sev));
+    sev.sigev_notify = SIGEV_THREAD_ID;
+    sev.sigev_signo = SIGPROF;
+    sev._sigev_un._tid = t.tid;
+    if(timer_create(cid, &sev, &t.timer)) {
+        LOG_ERROR(g_logger) << "Profiler timer_create tid=" << t.tid << " errno=" << errno
+            << " errstr=" << strerror(errno);
+        return;
+    }
+    struct itimerspec its;
+    its.it_interval.tv_sec = st.periodNs / 1000000000;
+    its.it_interval.tv_nsec = st.periodNs % 1000000000;
+    its.it_value = its.it_interval;
+    timer_settime(t.timer, 0, &its, nullptr);
+    t.hasTimer = true;
+}
+
+void StopTimerLocked(ProfileThread& t) {
+    if(t.hasTimer) {
+        timer_delete(t.timer);
+        t.hasTimer = false;
+    }
+}
+
+// 取出各线程缓冲中的样本并聚合，移除已注销且取空的线程
+void Drain(ProfilerState& st) {
+    std::vector<ProfileThread::ptr> threads;
+    {
+        Mutex::Lock lock(st.mutex);
+        threads = st.threads;
+    }
+    Mutex::Lock lock(st.aggMutex);
+    for(auto& t : threads) {
+        uint64_t tail = t->tail.load(std::memory_order_relaxed);
+        uint64_t head = t->head.load(std::memory_order_acquire);
+        if(tail == head) {
+            continue;
+        }
+        auto& stacks = st.stacks[*t->name.load(std::memory_order_relaxed)];
+        for(; tail != head; ++tail) {
+            const Sample& s = t->samples[tail % RING_SIZE];
+            stacks[std::vector<void*>(s.pcs, s.pcs + s.depth)] += s.weight;
+            st.samples += s.weight;
+        }
+        t->tail.store(head, std::memory_order_release);
+    }
+    Mutex::Lock tlock(st.mutex);
+    for(auto it = st.threads.begin(); it != st.threads.end();) {
+        ProfileThread::ptr& t = *it;
+        if(t->dead && t->tail.load(std::memory_order_relaxed) == t->head.load(std::memory_order_acquire)) {
+            it = st.threads.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// 函数名(已还原)，失败时为 模块+偏移 或地址；返回地址减一以落在调用指令内
+std::string Symbolize(void* pc, bool leaf) {
+    void* addr = leaf ? pc : (void*)((uintptr_t)pc - 1);
+    Dl_info info;
+    memset(&info, 0, sizeof(info));
+    std::string name;
+    if(dladdr(addr, &info) && info.dli_sname) {
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+        name = status == 0 && demangled ? demangled : info.dli_sname;
+        free(demangled);
+    } else {
+        std::stringstream ss;
+        if(info.dli_fname) {
+            const char* base = strrchr(info.dli_fname, '/');
+            ss << (base ? base + 1 : info.dli_fname) << "+0x" << std::hex
+               << ((uintptr_t)addr - (uintptr_t)info.dli_fbase);
+        } else {
+            ss << addr;
+        }
+        name = ss.str();
+    }
+    // folded 格式以 ';' 分隔栈帧、以最后一个空格分隔次数
+    for(auto& c : name) {
+        if(c == ';') {
+            c = ':';
+        }
+    }
+    return name;
+}
+
+std::string FoldedLocked(ProfilerState& st) {
+    std::map<void*, std::string> leafs;
+    std::map<void*, std::string> callers;
+    // 同一函数内不同位置的样本符号化后相同，按文本合并
+    std::map<std::string, uint64_t> folded;
+    for(auto& i : st.stacks) {
+        for(auto& s : i.second) {
+            std::string line = i.first;
+            for(size_t k = s.first.size(); k > 0; --k) {
+                void* pc = s.first[k - 1];
+                bool leaf = k == 1;
+                std::map<void*, std::string>& cache = leaf ? leafs : callers;
+                auto it = cache.find(pc);
+                if(it == cache.end()) {
+                    it = cache.insert(std::make_pair(pc, Symbolize(pc, leaf))).first;
+                }
+                line.append(";").append(it->second);
+            }
+            folded[line] += s.second;
+        }
+    }
+    std::stringstream ss;
+    for(auto& i : folded) {
+        ss << i.first << " " << i.second << "\n";
+    }
+    return ss.str();
+}
+
+/**
+ * @brief pprof 旧版(gperftools)CPU profile 格式
+ * @details 以机器字为单位：头部 [0, 3, 0, 采样周期us, 0]，每条记录 [次数, 栈深, pc...]，
+ *          结尾 [0, 1, 0]，之后附加 /proc/self/maps 供符号化。该格式没有线程维度，各线程合并输出
+ */
+bool WritePprofLocked(ProfilerState& st, std::ofstream& ofs) {
+    std::vector<uintptr_t> words = {0, 3, 0, st.periodNs / 1000, 0};
+    for(auto& i : st.stacks) {
+        for(auto& s : i.second) {
+            words.push_back(s.second);
+            words.push_back(s.first.size());
+            for(auto pc : s.first) {
+                words.push_back((uintptr_t)pc);
+            }
+        }
+    }
+    words.push_back(0);
+    words.push_back(1);
+    words.push_back(0);
+    ofs.write((const char*)&words[0], words.size() * sizeof(uintptr_t));
+    std::ifstream maps("/proc/self/maps");
+    ofs << maps.rdbuf();
+    return (bool)ofs;
+}
+
+}
+
+bool Profiler::Start(const std::string& path) {
+    ProfilerState& st = GetState();
+    Mutex::Lock lock(st.controlMutex);
+    if(st.drainer || !InstallHandler()) {
+        return false;
+    }
+    st.path = path.empty() ? g_profiler_output->getValue() : path;
+    {
+        Mutex::Lock alock(st.aggMutex);
+        st.stacks.clear();
+        st.samples = 0;
+        // 丢弃上一次采样残留的样本
+        Mutex::Lock tlock(st.mutex);
+        for(auto& t : st.threads) {
+            t->tail.store(t->head.load(std::memory_order_acquire), std::memory_order_release);
+        }
+    }
+    s_dropped = 0;
+    uint32_t freq = std::max(1u, std::min(g_profiler_frequency->getValue(), 10000u));
+    {
+        Mutex::Lock tlock(st.mutex);
+        st.periodNs = 1000000000 / freq;
+        s_running = true;
+        for(auto& t : st.threads) {
+            StartTimerLocked(st, *t);
+        }
+    }
+    st.drainer.reset(new Thread([&st]() {
+        while(!st.stop.waitFor(DRAIN_INTERVAL_MS)) {
+            Drain(st);
+        }
+    }, "profiler"));
+    LOG_INFO(g_logger) << "Profiler started, frequency=" << freq << " output=" << st.path;
+    return true;
+}
+
+void Profiler::Stop() {
+    ProfilerState& st = GetState();
+    Mutex::Lock lock(st.controlMutex);
+    if(!st.drainer) {
+        return;
+    }
+    {
+        Mutex::Lock tlock(st.mutex);
+        s_running = false;
+        for(auto& t : st.threads) {
+            StopTimerLocked(*t);
+        }
+    }
+    st.stop.notify();
+    st.drainer->join();
+    st.drainer.reset();
+    Drain(st);
+
+    Mutex::Lock alock(st.aggMutex);
+    std::ofstream ofs(st.path, std::ios::out | std::ios::trunc | std::ios::binary);
+    bool ok = false;
+    if(ofs) {
+        if(g_profiler_format->getValue() == "pprof") {
+            ok = WritePprofLocked(st, ofs);
+        } else {
+            ofs << FoldedLocked(st);
+            ok = (bool)ofs;
+        }
+    }
+    if(!ok) {
+        LOG_ERROR(g_logger) << "Profiler write " << st.path << " failed";
+    }
+    LOG_INFO(g_logger) << "Profiler stopped, samples=" << st.samples
+        << " dropped=" << s_dropped << " output=" << st.path;
+}
+
+bool Profiler::IsRunning() {
+    return s_running;
+}
+
+void Profiler::RegisterThread() {
+    if(t_profile_thread) {
+        // 已登记时只更新线程名称
+        t_profile_thread->name.store(ThreadContext::GetThis().getNamePtr(), std::memory_order_relaxed);
+        return;
+    }
+    ProfilerState& st = GetState();
+    ProfileThread::ptr t(new ProfileThread);
+    Mutex::Lock lock(st.mutex);
+    st.threads.push_back(t);
+    t_profile_thread = t.get();
+    if(s_running) {
+        StartTimerLocked(st, *t);
+    }
+}
+
+void Profiler::UnregisterThread() {
+    ProfileThread* t = t_profile_thread;
+    if(!t) {
+        return;
+    }
+    // 先清空，之后到达的信号直接忽略
+    t_profile_thread = nullptr;
+    ProfilerState& st = GetState();
+    Mutex::Lock lock(st.mutex);
+    StopTimerLocked(*t);
+    t->dead = true;
+}
+
+std::string Profiler::ToFolded() {
+    ProfilerState& st = GetState();
+    Drain(st);
+    Mutex::Lock lock(st.aggMutex);
+    return FoldedLocked(st);
+}
+
+uint64_t Profiler::GetSamples() {
+    ProfilerState& st = GetState();
+    Mutex::Lock lock(st.aggMutex);
+    return st.samples;
+}
+
+uint64_t Profiler::GetDropped() {
+    return s_dropped;
+}
+
+struct ProfilerIniter {
+    ProfilerIniter() {
+        // 静态初始化在主线程执行
+        Profiler::RegisterThread();
+        g_profiler_enable->addListener(0x9F0F1E01,
+            [](const bool& old_value, const bool& new_value) {
+            if(new_value) {
+                Profiler::Start();
+            } else {
+                Profiler::Stop();
+            }
+        });
+    }
+};
+
+static ProfilerIniter __profiler_init;
+
+}
@@ -0,0 +1,49 @@
+#ifndef __MYSERVER_PROFILER_H__
+#define __MYSERVER_PROFILER_H__
+
+#include <stdint.h>
+#include <string>
+
+namespace myserver {
+
+/**
+ * @brief 进程内采样 CPU 分析器
+ * @details 为每个已登记的线程创建一个按该线程 CPU 时间计时的 timer_create 定时器，
+ *          到期时向该线程发送 SIGPROF；信号处理函数沿帧指针回溯调用栈，
+ *          写入本线程的单生产者单消费者环形缓冲(不加锁、不分配内存)。
+ *          内核按时钟节拍检查定时器，频率高于节拍时一次信号包含多次到期(si_overrun)，
+ *          样本按到期次数计权，样本数 × 采样周期即为该线程消耗的 CPU 时间。
+ *          后台线程定期取出样本，按线程名称(Thread::GetName)与调用栈聚合，
+ *          Stop 时以 folded 格式(可直接交给 flamegraph.pl)或 pprof 旧版二进制格式写出。
+ *          myserver::Thread 自动登记，主线程在静态初始化时登记，其他线程需自行调用 RegisterThread；
+ *          样本缓冲在线程开始被采样时才分配，未开启采样时登记只占用很少的内存。
+ *          配置 profiler.enable 变化时自动 Start/Stop
+ */
+class Profiler {
+public:
+    /**
+     * @brief 开始采样
+     * @param[in] path 输出文件，为空时使用配置 profiler.output
+     * @return 已在采样或安装信号处理失败时返回 false
+     */
+    static bool Start(const std::string& path = "");
+    // 停止采样并写出结果
+    static void Stop();
+    static bool IsRunning();
+
+    // 登记/注销当前线程，采样进行中登记的线程立即开始采样；已登记时再次调用只更新线程名称
+    static void RegisterThread();
+    static void UnregisterThread();
+
+    // 本次采样已聚合的 folded 格式结果，每行 "线程名;外层函数;...;内层函数 次数"
+    static std::string ToFolded();
+
+    // 本次采样已聚合的样本数(按定时器到期次数计)
+    static uint64_t GetSamples();
+    // 环形缓冲满而丢弃的样本数
+    static uint64_t GetDropped();
+};
+
+}
+
+#endif
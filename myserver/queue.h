@@ -0,0 +1,291 @@
+#ifndef __MYSERVER_QUEUE_H__
+#define __MYSERVER_QUEUE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include "noncopyable.h"
+
+// 缓存行大小，用于隔离生产者/消费者各自频繁修改的字段
+#define MYSERVER_CACHELINE_SIZE 64
+
+namespace myserver {
+
+/**
+ * @brief 有界无锁多生产者多消费者队列(Vyukov 环形队列)
+ * @details 每个槽带一个序列号：seq == pos 表示可写入，seq == pos + 1 表示可读取。
+ *          生产者/消费者分别只竞争 m_enqueuePos / m_dequeuePos，二者位于不同缓存行。
+ *          批量接口一次 CAS 认领连续的多个槽，摊薄竞争开销。容量向上取整为2的幂
+ */
+template<class T>
+class MPMCQueue : Noncopyable {
+public:
+    explicit MPMCQueue(size_t capacity) {
+        size_t cap = 2;
+        while(cap < capacity) {
+            cap <<= 1;
+        }
+        m_mask = cap - 1;
+        m_cells = new Cell[cap];
+        for(size_t i = 0; i < cap; ++i) {
+            m_cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+        m_enqueuePos.store(0, std::memory_order_relaxed);
+        m_dequeuePos.store(0, std::memory_order_relaxed);
+    }
+
+    ~MPMCQueue() {
+        size_t end = m_enqueuePos.load(std::memory_order_relaxed);
+        for(size_t pos = m_dequeuePos.load(std::memory_order_relaxed); pos != end; ++pos) {
+            Cell* cell = &m_cells[pos & m_mask];
+            if(cell->seq.load(std::memory_order_relaxed) == pos + 1) {
+                cell->get()->~T();
+            }
+        }
+        delete[] m_cells;
+    }
+
+    template<class... Args>
+    bool tryEmplace(Args&&... args) {
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while(true) {
+            cell = &m_cells[pos & m_mask];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if(diff == 0) {
+                if(m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if(diff < 0) {
+                return false;   // 已满
+            } else {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        new (cell->data()) T(std::forward<Args>(args)...);
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPush(const T& v) { return tryEmplace(v); }
+    bool tryPush(T&& v) { return tryEmplace(std::move(v)); }
+
+    bool tryPop(T& v) {
+        size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while(true) {
+            cell = &m_cells[pos & m_mask];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if(diff == 0) {
+                if(m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if(diff < 0) {
+                return false;   // 为空
+            } else {
+                pos = m_dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+        consume(cell, pos, v);
+        return true;
+    }
+
+    /**
+     * @brief 批量写入，一次认领最多 n 个连续空槽
+     * @return 实际写入的个数(队列满时可能小于 n)
+     */
+    size_t tryPushBatch(const T* items, size_t n) {
+        size_t pos, k;
+        if(!(k = claim(m_enqueuePos, 0, n, pos))) {
+            return 0;
+        }
+        for(size_t i = 0; i < k; ++i) {
+            Cell* cell = &m_cells[(pos + i) & m_mask];
+            new (cell->data()) T(items[i]);
+            cell->seq.store(pos + i + 1, std::memory_order_release);
+        }
+        return k;
+    }
+
+    /**
+     * @brief 批量读取，一次认领最多 n 个连续就绪槽
+     * @return 实际读取的个数
+     */
+    size_t tryPopBatch(T* out, size_t n) {
+        size_t pos, k;
+        if(!(k = claim(m_dequeuePos, 1, n, pos))) {
+            return 0;
+        }
+        for(size_t i = 0; i < k; ++i) {
+            consume(&m_cells[(pos + i) & m_mask], pos + i, out[i]);
+        }
+        return k;
+    }
+
+    size_t getCapacity() const { return m_mask + 1; }
+
+    // 近似元素个数，并发修改时仅供参考
+    size_t sizeApprox() const {
+        size_t e = m_enqueuePos.load(std::memory_order_relaxed);
+        size_t d = m_dequeuePos.load(std::memory_order_relaxed);
+        return e > d ? e - d : 0;
+    }
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+        void* data() { return &storage; }
+        T* get() { return reinterpret_cast<T*>(&storage); }
+    };
+
+    void consume(Cell* cell, size_t pos, T& v) {
+        T* p = cell->get();
+        v = std::move(*p);
+        p->~T();
+        cell->seq.store(pos + m_mask + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief 从 cursor 开始扫描连续的 seq == pos + i + off 的槽，并一次 CAS 认领
+     * @param[in] off 0:认领空槽(生产者) 1:认领就绪槽(消费者)
+     * @param[out] pos 认领区间起点
+     * @return 认领的槽个数
+     */
+    size_t claim(std::atomic<size_t>& cursor, size_t off, size_t n, size_t& pos) {
+        if(n == 0) {
+            return 0;
+        }
+        pos = cursor.load(std::memory_order_relaxed);
+        while(true) {
+            size_t k = 0;
+            while(k < n && k <= m_mask) {
+                size_t seq = m_cells[(pos + k) & m_mask].seq.load(std::memory_order_acquire);
+                if(seq != pos + k + off) {
+                    break;
+                }
+                ++k;
+            }
+            if(k == 0) {
+                size_t seq = m_cells[pos & m_mask].seq.load(std::memory_order_acquire);
+                if((intptr_t)seq - (intptr_t)(pos + off) < 0) {
+                    return 0;   // 满(生产者)或空(消费者)
+                }
+                pos = cursor.load(std::memory_order_relaxed);
+                continue;
+            }
+            if(cursor.compare_exchange_weak(pos, pos + k, std::memory_order_relaxed)) {
+                return k;
+            }
+        }
+    }
+private:
+    char m_pad0[MYSERVER_CACHELINE_SIZE];
+    Cell* m_cells;
+    size_t m_mask;
+    char m_pad1[MYSERVER_CACHELINE_SIZE];
+    std::atomic<size_t> m_enqueuePos;   // 生产者游标
+    char m_pad2[MYSERVER_CACHELINE_SIZE];
+    std::atomic<size_t> m_dequeuePos;   // 消费者游标
+    char m_pad3[MYSERVER_CACHELINE_SIZE];
+};
+
+// MPSCQueue 的侵入式节点，元素类型需公有继承该结构
+struct MPSCNode {
+    std::atomic<MPSCNode*> mpsc_next;
+    MPSCNode() : mpsc_next(nullptr) {}
+    // 拷贝元素时不拷贝链接状态
+    MPSCNode(const MPSCNode&) : mpsc_next(nullptr) {}
+    MPSCNode& operator=(const MPSCNode&) { return *this; }
+};
+
+/**
+ * @brief 无界侵入式多生产者单消费者队列(Vyukov 节点队列)
+ * @details 队列不持有元素所有权也不分配内存，元素需继承 MPSCNode，且在出队前不可重复入队。
+ *          push 为 wait-free(一次 exchange)，pop 只能由单个消费者线程调用。
+ *          生产者在 exchange 与链接 next 之间被挂起时，pop 可能暂时返回 nullptr
+ */
+template<class T>
+class MPSCQueue : Noncopyable {
+public:
+    MPSCQueue()
+        :m_head(&m_stub)
+        ,m_tail(&m_stub) {
+    }
+
+    void push(T* item) {
+        pushChain(item, item);
+    }
+
+    // 批量入队：先在本地串成链表，整批只做一次 exchange
+    void pushBatch(T* const* items, size_t n) {
+        if(n == 0) {
+            return;
+        }
+        for(size_t i = 0; i + 1 < n; ++i) {
+            static_cast<MPSCNode*>(items[i])->mpsc_next.store(items[i + 1], std::memory_order_relaxed);
+        }
+        pushChain(items[0], items[n - 1]);
+    }
+
+    T* pop() {
+        MPSCNode* tail = m_tail;
+        MPSCNode* next = tail->mpsc_next.load(std::memory_order_acquire);
+        if(tail == &m_stub) {
+            if(!next) {
+                return nullptr;
+            }
+            m_tail = next;
+            tail = next;
+            next = next->mpsc_next.load(std::memory_order_acquire);
+        }
+        if(next) {
+            m_tail = next;
+            return static_cast<T*>(tail);
+        }
+        if(tail != m_head.load(std::memory_order_acquire)) {
+            return nullptr;     // 有生产者正在链接
+        }
+        pushChain(&m_stub, &m_stub);
+        next = tail->mpsc_next.load(std::memory_order_acquire);
+        if(next) {
+            m_tail = next;
+            return static_cast<T*>(tail);
+        }
+        return nullptr;
+    }
+
+    size_t popBatch(T** out, size_t n) {
+        size_t k = 0;
+        while(k < n && (out[k] = pop())) {
+            ++k;
+        }
+        return k;
+    }
+
+    // 仅消费者线程调用
+    bool empty() const {
+        return m_tail == &m_stub && !m_stub.mpsc_next.load(std::memory_order_acquire);
+    }
+private:
+    void pushChain(MPSCNode* first, MPSCNode* last) {
+        last->mpsc_next.store(nullptr, std::memory_order_relaxed);
+        MPSCNode* prev = m_head.exchange(last, std::memory_order_acq_rel);
+        prev->mpsc_next.store(first, std::memory_order_release);
+    }
+private:
+    char m_pad0[MYSERVER_CACHELINE_SIZE];
+    std::atomic<MPSCNode*> m_head;      // 生产者端
+    char m_pad1[MYSERVER_CACHELINE_SIZE];
+    MPSCNode* m_tail;                   // 消费者端
+    MPSCNode m_stub;
+    char m_pad2[MYSERVER_CACHELINE_SIZE];
+};
+
+}
+
+#endif
@@ -0,0 +1,91 @@
+#include "slow_scope.h"
+#include <map>
+#include <set>
+#include "config.h"
+#include "mutex.h"
+
+namespace myserver {
+
+static myserver::ConfigVar<std::map<std::string, uint64_t> >::ptr g_slow_scope_thresholds =
+    myserver::Config::Lookup("slow_scope.thresholds", std::map<std::string, uint64_t>(),
+            "SLOW_SCOPE threshold(ms) overrides by op name");
+
+namespace {
+
+struct SlowOpRegistry {
+    Mutex mutex;
+    std::set<SlowOp*> ops;
+    std::map<std::string, uint64_t> overrides;
+};
+
+SlowOpRegistry& GetRegistry() {
+    static SlowOpRegistry* s_registry = new SlowOpRegistry;
+    return *s_registry;
+}
+
+struct SlowScopeIniter {
+    SlowScopeIniter() {
+        {
+            SlowOpRegistry& r = GetRegistry();
+            Mutex::Lock lock(r.mutex);
+            r.overrides = g_slow_scope_thresholds->getValue();
+        }
+        g_slow_scope_thresholds->addListener(0x510E5C01,
+            [](const std::map<std::string, uint64_t>& old_value,
+               const std::map<std::string, uint64_t>& new_value) {
+            SlowOpRegistry& r = GetRegistry();
+            Mutex::Lock lock(r.mutex);
+            r.overrides = new_value;
+            for(auto op : r.ops) {
+                auto it = new_value.find(op->getName());
+                op->setThresholdMs(it == new_value.end() ? op->getDefaultThreshold() : it->second);
+            }
+        });
+    }
+};
+
+SlowScopeIniter __slow_scope_init;
+
+}
+
+SlowOp::SlowOp(const char* name, uint64_t threshold_ms)
+    :m_name(name)
+    ,m_defaultMs(threshold_ms)
+    ,m_thresholdMs(0)
+    ,m_thresholdTicks(0) {
+    setThresholdMs(threshold_ms);
+    SlowOpRegistry& r = GetRegistry();
+    Mutex::Lock lock(r.mutex);
+    r.ops.insert(this);
+    auto it = r.overrides.find(name);
+    if(it != r.overrides.end()) {
+        setThresholdMs(it->second);
+    }
+}
+
+SlowOp::~SlowOp() {
+    SlowOpRegistry& r = GetRegistry();
+    Mutex::Lock lock(r.mutex);
+    r.ops.erase(this);
+}
+
+void SlowOp::setThresholdMs(uint64_t ms) {
+    m_thresholdMs.store(ms, std::memory_order_relaxed);
+    m_thresholdTicks.store(Clock::DurationToTicks(ms * 1000000), std::memory_order_relaxed);
+}
+
+void SlowScope::report(uint64_t ticks) {
+    if(m_logger->getLevel() > LogLevel::WARN) {
+        return;
+    }
+    ThreadContext& ctx = ThreadContext::GetThis();
+    LogEventWrap(m_logger->shared_from_this(), LogEvent::Create(LogLevel::WARN, m_file, m_line,
+            (uint32_t)Clock::ElapsedMs(), ctx, Clock::CoarseWallMs())).getSS()
+        << "slow op=" << m_op.getName()
+        << " cost_us=" << Clock::TicksToDuration(ticks) / 1000
+        << " threshold_ms=" << m_op.getThresholdMs()
+        << " thread=" << ctx.getName()
+        << " fiber=" << ctx.getFiberId();
+}
+
+}
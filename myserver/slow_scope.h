@@ -0,0 +1,81 @@
+#ifndef __MYSERVER_SLOW_SCOPE_H__
+#define __MYSERVER_SLOW_SCOPE_H__
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include "clock.h"
+#include "log.h"
+#include "noncopyable.h"
+
+#define MYSERVER_SLOW_CONCAT_IMPL(a, b) a##b
+#define MYSERVER_SLOW_CONCAT(a, b) MYSERVER_SLOW_CONCAT_IMPL(a, b)
+
+/**
+ * @brief 记录当前作用域的耗时，超过阈值时向 logger 输出一条 WARN 日志
+ * @details 每个调用点有一个静态的 SlowOp 保存阈值，配置 slow_scope.thresholds 中
+ *          同名 op 的值会覆盖代码中的 threshold_ms。阈值预先换算为 Clock::Ticks() 计数，
+ *          未超过阈值时只有两次 Clock::Ticks() 与一次比较，不做任何格式化。op 必须是字符串字面量
+ */
+#define SLOW_SCOPE(logger, op, threshold_ms)                                            \
+    static myserver::SlowOp MYSERVER_SLOW_CONCAT(__slow_op_, __LINE__)(op, threshold_ms); \
+    myserver::SlowScope MYSERVER_SLOW_CONCAT(__slow_scope_, __LINE__)(                   \
+            logger, MYSERVER_SLOW_CONCAT(__slow_op_, __LINE__), __FILE__, __LINE__)
+
+namespace myserver {
+
+/**
+ * @brief 慢操作的调用点
+ * @details 构造时登记到全局列表并应用配置中的覆盖值，配置变化时统一更新
+ */
+class SlowOp : Noncopyable {
+public:
+    SlowOp(const char* name, uint64_t threshold_ms);
+    ~SlowOp();
+
+    const char* getName() const { return m_name; }
+    uint64_t getDefaultThreshold() const { return m_defaultMs; }
+    // 当前生效的阈值
+    uint64_t getThresholdMs() const { return m_thresholdMs.load(std::memory_order_relaxed); }
+    uint64_t getThresholdTicks() const { return m_thresholdTicks.load(std::memory_order_relaxed); }
+    void setThresholdMs(uint64_t ms);
+private:
+    const char* m_name;
+    uint64_t m_defaultMs;
+    std::atomic<uint64_t> m_thresholdMs;
+    std::atomic<uint64_t> m_thresholdTicks;
+};
+
+// 作用域计时
+class SlowScope {
+public:
+    // 只保存 Logger 的裸指针，避免快路径上的引用计数原子操作；Logger 由 LoggerManager 持有
+    SlowScope(const Logger::ptr& logger, const SlowOp& op, const char* file, int32_t line)
+        :m_logger(logger.get())
+        ,m_op(op)
+        ,m_file(file)
+        ,m_line(line)
+        ,m_begin(Clock::Ticks()) {
+    }
+    ~SlowScope() {
+        uint64_t ticks = Clock::Ticks() - m_begin;
+        if(ticks >= m_op.getThresholdTicks()) {
+            report(ticks);
+        }
+    }
+private:
+    SlowScope(const SlowScope&) = delete;
+    SlowScope& operator=(const SlowScope&) = delete;
+
+    void report(uint64_t ticks);
+private:
+    Logger* m_logger;
+    const SlowOp& m_op;
+    const char* m_file;
+    int32_t m_line;
+    uint64_t m_begin;               // Clock::Ticks()
+};
+
+}
+
+#endif
@@ -0,0 +1,614 @@
+#include "socket.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sstream>
+#include "clock.h"
+#include "log.h"
+
+namespace myserver {
+
+static myserver::Logger::ptr g_logger = LOGGER_NAME("system");
+
+/**
+ * @brief 非阻塞IO的通用重试流程
+ * @details 调用 fun，遇到 EINTR 直接重试，遇到 EAGAIN 等待 events 就绪后重试，
+ *          累计等待超过 timeout_ms 时返回 -1 并置 errno 为 ETIMEDOUT
+ */
+template<class Fun>
+static ssize_t DoIO(int fd, Fun fun, short events, uint64_t timeout_ms) {
+    uint64_t deadline = timeout_ms == (uint64_t)-1 ? (uint64_t)-1 : Clock::NowMs() + timeout_ms;
+    while(true) {
+        ssize_t n = fun();
+        if(n >= 0) {
+            return n;
+        }
+        if(errno == EINTR) {
+            continue;
+        }
+        if(errno != EAGAIN && errno != EWOULDBLOCK) {
+            return n;
+        }
+        uint64_t wait = (uint64_t)-1;
+        if(deadline != (uint64_t)-1) {
+            uint64_t now = Clock::NowMs();
+            if(now >= deadline) {
+                errno = ETIMEDOUT;
+                return -1;
+            }
+            wait = deadline - now;
+        }
+        int rt = Socket::WaitEvent(fd, events, wait);
+        if(rt == 0) {
+            errno = ETIMEDOUT;
+            return -1;
+        } else if(rt < 0) {
+            return -1;
+        }
+    }
+}
+
+int Socket::WaitEvent(int fd, short events, uint64_t timeout_ms) {
+    pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = events;
+    pfd.revents = 0;
+    int timeout = timeout_ms >= (uint64_t)INT32_MAX ? -1 : (int)timeout_ms;
+    int rt;
+    do {
+        rt = poll(&pfd, 1, timeout);
+    } while(rt < 0 && errno == EINTR);
+    return rt > 0 ? 1 : rt;
+}
+
+Socket::ptr Socket::CreateTCP(myserver::Address::ptr address) {
+    Socket::ptr sock(new Socket(address->getFamily(), TCP, 0));
+    return sock;
+}
+
+Socket::ptr Socket::CreateUDP(myserver::Address::ptr address) {
+    Socket::ptr sock(new Socket(address->getFamily(), UDP, 0));
+    sock->newSock();
+    sock->m_isConnected = true;
+    return sock;
+}
+
+Socket::ptr Socket::CreateTCPSocket() {
+    Socket::ptr sock(new Socket(IPv4, TCP, 0));
+    return sock;
+}
+
+Socket::ptr Socket::CreateUDPSocket() {
+    Socket::ptr sock(new Socket(IPv4, UDP, 0));
+    sock->newSock();
+    sock->m_isConnected = true;
+    return sock;
+}
+
+Socket::ptr Socket::CreateTCPSocket6() {
+    Socket::ptr sock(new Socket(IPv6, TCP, 0));
+    return sock;
+}
+
+Socket::ptr Socket::CreateUDPSocket6() {
+    Socket::ptr sock(new Socket(IPv6, UDP, 0));
+    sock->newSock();
+    sock->m_isConnected = true;
+    return sock;
+}
+
+Socket::ptr Socket::CreateUnixTCPSocket() {
+    Socket::ptr sock(new Socket(UNIX, TCP, 0));
+    return sock;
+}
+
+Socket::ptr Socket::CreateUnixUDPSocket() {
+    Socket::ptr sock(new Socket(UNIX, UDP, 0));
+    sock->newSock();
+    sock->m_isConnected = true;
+    return sock;
+}
+
+bool Socket::CreatePair(Socket::ptr& first, Socket::ptr& second, int type) {
+    int fds[2];
+    if(socketpair(AF_UNIX, type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds)) {
+        LOG_ERROR(g_logger) << "socketpair(" << type << ") errno=" << errno
+            << " errstr=" << strerror(errno);
+        return false;
+    }
+    first.reset(new Socket(UNIX, type, 0));
+    second.reset(new Socket(UNIX, type, 0));
+    first->init(fds[0]);
+    second->init(fds[1]);
+    return true;
+}
+
+Socket::Socket(int family, int type, int protocol)
+    :m_sock(-1)
+    ,m_family(family)
+    ,m_type(type)
+    ,m_protocol(protocol)
+    ,m_isConnected(false)
+    ,m_sendTimeout(-1)
+    ,m_recvTimeout(-1) {
+}
+
+Socket::~Socket() {
+    close();
+}
+
+void Socket::setSendTimeout(uint64_t v) {
+    m_sendTimeout = v;
+}
+
+void Socket::setRecvTimeout(uint64_t v) {
+    m_recvTimeout = v;
+}
+
+bool Socket::getOption(int level, int option, void* result, socklen_t* len) {
+    int rt = getsockopt(m_sock, level, option, result, len);
+    if(rt) {
+        LOG_DEBUG(g_logger) << "getOption sock=" << m_sock
+            << " level=" << level << " option=" << option
+            << " errno=" << errno << " errstr=" << strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+bool Socket::setOption(int level, int option, const void* result, socklen_t len) {
+    if(!isValid()) {
+        newSock();
+    }
+    if(setsockopt(m_sock, level, option, result, len)) {
+        LOG_DEBUG(g_logger) << "setOption sock=" << m_sock
+            << " level=" << level << " option=" << option
+            << " errno=" << errno << " errstr=" << strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+bool Socket::setNonBlock(bool v) {
+    int flags = fcntl(m_sock, F_GETFL, 0);
+    if(flags < 0) {
+        return false;
+    }
+    flags = v ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+    return fcntl(m_sock, F_SETFL, flags) == 0;
+}
+
+bool Socket::isNonBlock() const {
+    int flags = fcntl(m_sock, F_GETFL, 0);
+    return flags >= 0 && (flags & O_NONBLOCK);
+}
+
+bool Socket::setTcpNoDelay(bool v) {
+    int val = v ? 1 : 0;
+    return setOption(IPPROTO_TCP, TCP_NODELAY, val);
+}
+
+bool Socket::setReuseAddr(bool v) {
+    int val = v ? 1 : 0;
+    return setOption(SOL_SOCKET, SO_REUSEADDR, val);
+}
+
+bool Socket::setReusePort(bool v) {
+    int val = v ? 1 : 0;
+    return setOption(SOL_SOCKET, SO_REUSEPORT, val);
+}
+
+Socket::ptr Socket::accept() {
+    Socket::ptr sock(new Socket(m_family, m_type, m_protocol));
+    int fd = m_sock;
+    int newsock = DoIO(m_sock, [fd]() {
+        return (ssize_t)::accept4(fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    }, POLLIN, m_recvTimeout);
+    if(newsock == -1) {
+        LOG_ERROR(g_logger) << "accept(" << m_sock << ") errno="
+            << errno << " errstr=" << strerror(errno);
+        return nullptr;
+    }
+    if(sock->init(newsock)) {
+        return sock;
+    }
+    return nullptr;
+}
+
+size_t Socket::acceptBatch(std::vector<Socket::ptr>& socks, size_t max) {
+    size_t count = 0;
+    if(max == 0) {
+        return 0;
+    }
+    if(WaitEvent(m_sock, POLLIN, m_recvTimeout) <= 0) {
+        return 0;
+    }
+    while(count < max) {
+        int newsock = ::accept4(m_sock, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if(newsock < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            if(errno != EAGAIN && errno != EWOULDBLOCK) {
+                LOG_ERROR(g_logger) << "acceptBatch(" << m_sock << ") errno="
+                    << errno << " errstr=" << strerror(errno);
+            }
+            break;
+        }
+        Socket::ptr sock(new Socket(m_family, m_type, m_protocol));
+        if(sock->init(newsock)) {
+            socks.push_back(sock);
+            ++count;
+        }
+    }
+    return count;
+}
+
+Socket::ptr Socket::adoptAccepted(int fd) {
+    Socket::ptr sock(new Socket(m_family, m_type, m_protocol));
+    sock->init(fd);
+    return sock;
+}
+
+bool Socket::init(int sock) {
+    m_sock = sock;
+    m_isConnected = true;
+    initSock();
+    getLocalAddress();
+    getRemoteAddress();
+    return true;
+}
+
+bool Socket::bind(const Address::ptr addr) {
+    if(!isValid()) {
+        newSock();
+        if(!isValid()) {
+            return false;
+        }
+    }
+
+    if(addr->getFamily() != m_family) {
+        LOG_ERROR(g_logger) << "bind sock.family("
+            << m_family << ") addr.family(" << addr->getFamily()
+            << ") not equal, addr=" << addr->toString();
+        return false;
+    }
+
+    if(::bind(m_sock, addr->getAddr(), addr->getAddrLen())) {
+        LOG_ERROR(g_logger) << "bind error errno=" << errno
+            << " errstr=" << strerror(errno);
+        return false;
+    }
+    getLocalAddress();
+    return true;
+}
+
+bool Socket::reconnect(uint64_t timeout_ms) {
+    if(!m_remoteAddress) {
+        LOG_ERROR(g_logger) << "reconnect m_remoteAddress is null";
+        return false;
+    }
+    m_localAddress.reset();
+    return connect(m_remoteAddress, timeout_ms);
+}
+
+bool Socket::connect(const Address::ptr addr, uint64_t timeout_ms) {
+    m_remoteAddress = addr;
+    if(!isValid()) {
+        newSock();
+        if(!isValid()) {
+            return false;
+        }
+    }
+
+    if(addr->getFamily() != m_family) {
+        LOG_ERROR(g_logger) << "connect sock.family("
+            << m_family << ") addr.family(" << addr->getFamily()
+            << ") not equal, addr=" << addr->toString();
+        return false;
+    }
+
+    if(timeout_ms == (uint64_t)-1) {
+        timeout_ms = m_sendTimeout;
+    }
+    int rt = ::connect(m_sock, addr->getAddr(), addr->getAddrLen());
+    if(rt && errno == EINPROGRESS) {
+        // 非阻塞连接：等待可写后通过 SO_ERROR 取得连接结果
+        int w = WaitEvent(m_sock, POLLOUT, timeout_ms);
+        if(w == 0) {
+            errno = ETIMEDOUT;
+        } else if(w > 0) {
+            errno = getError();
+            rt = errno ? -1 : 0;
+        }
+    }
+    if(rt) {
+        LOG_ERROR(g_logger) << "sock=" << m_sock << " connect(" << addr->toString()
+            << ") timeout=" << timeout_ms << " error errno="
+            << errno << " errstr=" << strerror(errno);
+        close();
+        return false;
+    }
+    m_isConnected = true;
+    getRemoteAddress();
+    getLocalAddress();
+    return true;
+}
+
+bool Socket::listen(int backlog) {
+    if(!isValid()) {
+        LOG_ERROR(g_logger) << "listen error sock=-1";
+        return false;
+    }
+    if(::listen(m_sock, backlog)) {
+        LOG_ERROR(g_logger) << "listen error errno=" << errno
+            << " errstr=" << strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+bool Socket::close() {
+    if(!m_isConnected && m_sock == -1) {
+        return true;
+    }
+    m_isConnected = false;
+    if(m_sock != -1) {
+        ::close(m_sock);
+        m_sock = -1;
+    }
+    return true;
+}
+
+int Socket::send(const void* buffer, size_t length, int flags) {
+    if(isConnected()) {
+        int fd = m_sock;
+        return DoIO(m_sock, [=]() {
+            return ::send(fd, buffer, length, flags | MSG_NOSIGNAL);
+        }, POLLOUT, m_sendTimeout);
+    }
+    return -1;
+}
+
+int Socket::send(const iovec* buffers, size_t length, int flags) {
+    if(isConnected()) {
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = (iovec*)buffers;
+        msg.msg_iovlen = length;
+        int fd = m_sock;
+        return DoIO(m_sock, [fd, &msg, flags]() {
+            return ::sendmsg(fd, &msg, flags | MSG_NOSIGNAL);
+        }, POLLOUT, m_sendTimeout);
+    }
+    return -1;
+}
+
+int Socket::sendTo(const void* buffer, size_t length, const Address::ptr to, int flags) {
+    if(isConnected()) {
+        int fd = m_sock;
+        return DoIO(m_sock, [=]() {
+            return ::sendto(fd, buffer, length, flags | MSG_NOSIGNAL,
+                            to->getAddr(), to->getAddrLen());
+        }, POLLOUT, m_sendTimeout);
+    }
+    return -1;
+}
+
+int Socket::sendTo(const iovec* buffers, size_t length, const Address::ptr to, int flags) {
+    if(isConnected()) {
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = (iovec*)buffers;
+        msg.msg_iovlen = length;
+        msg.msg_name = to->getAddr();
+        msg.msg_namelen = to->getAddrLen();
+        int fd = m_sock;
+        return DoIO(m_sock, [fd, &msg, flags]() {
+            return ::sendmsg(fd, &msg, flags | MSG_NOSIGNAL);
+        }, POLLOUT, m_sendTimeout);
+    }
+    return -1;
+}
+
+int Socket::recv(void* buffer, size_t length, int flags) {
+    if(isConnected()) {
+        int fd = m_sock;
+        return DoIO(m_sock, [=]() {
+            return ::recv(fd, buffer, length, flags);
+        }, POLLIN, m_recvTimeout);
+    }
+    return -1;
+}
+
+int Socket::recv(iovec* buffers, size_t length, int flags) {
+    if(isConnected()) {
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = (iovec*)buffers;
+        msg.msg_iovlen = length;
+        int fd = m_sock;
+        return DoIO(m_sock, [fd, &msg, flags]() {
+            return ::recvmsg(fd, &msg, flags);
+        }, POLLIN, m_recvTimeout);
+    }
+    return -1;
+}
+
+int Socket::recvFrom(void* buffer, size_t length, Address::ptr from, int flags) {
+    if(isConnected()) {
+        socklen_t len = from->getAddrLen();
+        int fd = m_sock;
+        return DoIO(m_sock, [=, &len]() {
+            return ::recvfrom(fd, buffer, length, flags, from->getAddr(), &len);
+        }, POLLIN, m_recvTimeout);
+    }
+    return -1;
+}
+
+int Socket::recvFrom(iovec* buffers, size_t length, Address::ptr from, int flags) {
+    if(isConnected()) {
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = (iovec*)buffers;
+        msg.msg_iovlen = length;
+        msg.msg_name = from->getAddr();
+        msg.msg_namelen = from->getAddrLen();
+        int fd = m_sock;
+        return DoIO(m_sock, [fd, &msg, flags]() {
+            return ::recvmsg(fd, &msg, flags);
+        }, POLLIN, m_recvTimeout);
+    }
+    return -1;
+}
+
+int Socket::recvBatch(mmsghdr* msgvec, unsigned int vlen, int flags) {
+    if(!isValid()) {
+        return -1;
+    }
+    int fd = m_sock;
+    return DoIO(m_sock, [=]() {
+        return (ssize_t)::recvmmsg(fd, msgvec, vlen, flags | MSG_DONTWAIT, nullptr);
+    }, POLLIN, m_recvTimeout);
+}
+
+int Socket::sendBatch(mmsghdr* msgvec, unsigned int vlen, int flags) {
+    if(!isValid()) {
+        return -1;
+    }
+    int fd = m_sock;
+    return DoIO(m_sock, [=]() {
+        return (ssize_t)::sendmmsg(fd, msgvec, vlen, flags | MSG_NOSIGNAL);
+    }, POLLOUT, m_sendTimeout);
+}
+
+Address::ptr Socket::getRemoteAddress() {
+    if(m_remoteAddress) {
+        return m_remoteAddress;
+    }
+
+    Address::ptr result;
+    switch(m_family) {
+        case AF_INET:
+            result.reset(new IPv4Address());
+            break;
+        case AF_INET6:
+            result.reset(new IPv6Address());
+            break;
+        case AF_UNIX:
+            result.reset(new UnixAddress());
+            break;
+        default:
+            result.reset(new UnknownAddress(m_family));
+            break;
+    }
+    socklen_t addrlen = result->getAddrLen();
+    if(getpeername(m_sock, result->getAddr(), &addrlen)) {
+        return Address::ptr(new UnknownAddress(m_family));
+    }
+    if(m_family == AF_UNIX) {
+        UnixAddress::ptr addr = std::dynamic_pointer_cast<UnixAddress>(result);
+        addr->setAddrLen(addrlen);
+    }
+    m_remoteAddress = result;
+    return m_remoteAddress;
+}
+
+Address::ptr Socket::getLocalAddress() {
+    if(m_localAddress) {
+        return m_localAddress;
+    }
+
+    Address::ptr result;
+    switch(m_family) {
+        case AF_INET:
+            result.reset(new IPv4Address());
+            break;
+        case AF_INET6:
+            result.reset(new IPv6Address());
+            break;
+        case AF_UNIX:
+            result.reset(new UnixAddress());
+            break;
+        default:
+            result.reset(new UnknownAddress(m_family));
+            break;
+    }
+    socklen_t addrlen = result->getAddrLen();
+    if(getsockname(m_sock, result->getAddr(), &addrlen)) {
+        LOG_ERROR(g_logger) << "getsockname error sock=" << m_sock
+            << " errno=" << errno << " errstr=" << strerror(errno);
+        return Address::ptr(new UnknownAddress(m_family));
+    }
+    if(m_family == AF_UNIX) {
+        UnixAddress::ptr addr = std::dynamic_pointer_cast<UnixAddress>(result);
+        addr->setAddrLen(addrlen);
+    }
+    m_localAddress = result;
+    return m_localAddress;
+}
+
+bool Socket::isValid() const {
+    return m_sock != -1;
+}
+
+int Socket::getError() {
+    int error = 0;
+    socklen_t len = sizeof(error);
+    if(!getOption(SOL_SOCKET, SO_ERROR, &error, &len)) {
+        error = errno;
+    }
+    return error;
+}
+
+std::ostream& Socket::dump(std::ostream& os) const {
+    os << "[Socket sock=" << m_sock
+       << " is_connected=" << m_isConnected
+       << " family=" << m_family
+       << " type=" << m_type
+       << " protocol=" << m_protocol;
+    if(m_localAddress) {
+        os << " local_address=" << m_localAddress->toString();
+    }
+    if(m_remoteAddress) {
+        os << " remote_address=" << m_remoteAddress->toString();
+    }
+    os << "]";
+    return os;
+}
+
+std::string Socket::toString() const {
+    std::stringstream ss;
+    dump(ss);
+    return ss.str();
+}
+
+void Socket::initSock() {
+    setNonBlock(true);
+    fcntl(m_sock, F_SETFD, fcntl(m_sock, F_GETFD) | FD_CLOEXEC);
+    if(m_family != AF_UNIX) {
+        setReuseAddr(true);
+        if(m_type == SOCK_STREAM) {
+            setTcpNoDelay(true);
+        }
+    }
+}
+
+void Socket::newSock() {
+    m_sock = socket(m_family, m_type, m_protocol);
+    if(m_sock != -1) {
+        initSock();
+    } else {
+        LOG_ERROR(g_logger) << "socket(" << m_family
+            << ", " << m_type << ", " << m_protocol << ") errno="
+            << errno << " errstr=" << strerror(errno);
+    }
+}
+
+std::ostream& operator<<(std::ostream& os, const Socket& sock) {
+    return sock.dump(os);
+}
+
+}
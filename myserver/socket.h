@@ -0,0 +1,204 @@
+#ifndef __MYSERVER_SOCKET_H__
+#define __MYSERVER_SOCKET_H__
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/tcp.h>
+#include "address.h"
+#include "noncopyable.h"
+
+namespace myserver {
+
+/**
+ * @brief Socket封装类
+ * @details 文件描述符创建后即为 O_NONBLOCK。读写类操作遇到 EAGAIN 时在 WaitEvent 中等待就绪，
+ *          等待时长受 setRecvTimeout / setSendTimeout 限制，超时返回 -1 且 errno 为 ETIMEDOUT。
+ *          因此对调用方表现为"带超时的阻塞调用"，而 fd 本身始终可以交给事件循环
+ */
+class Socket : public std::enable_shared_from_this<Socket>, Noncopyable {
+public:
+    typedef std::shared_ptr<Socket> ptr;
+    typedef std::weak_ptr<Socket> weak_ptr;
+
+    // Socket类型
+    enum Type {
+        TCP = SOCK_STREAM,
+        UDP = SOCK_DGRAM
+    };
+
+    // Socket协议簇
+    enum Family {
+        IPv4 = AF_INET,
+        IPv6 = AF_INET6,
+        UNIX = AF_UNIX
+    };
+
+    // 根据地址的协议簇创建 TCP / UDP Socket
+    static Socket::ptr CreateTCP(myserver::Address::ptr address);
+    static Socket::ptr CreateUDP(myserver::Address::ptr address);
+
+    static Socket::ptr CreateTCPSocket();
+    static Socket::ptr CreateUDPSocket();
+    static Socket::ptr CreateTCPSocket6();
+    static Socket::ptr CreateUDPSocket6();
+    static Socket::ptr CreateUnixTCPSocket();
+    static Socket::ptr CreateUnixUDPSocket();
+
+    /**
+     * @brief 创建一对互相连接的 Unix Socket (socketpair)
+     * @param[out] first, second 连接的两端
+     * @param[in] type TCP 对应 SOCK_STREAM，UDP 对应 SOCK_DGRAM
+     */
+    static bool CreatePair(Socket::ptr& first, Socket::ptr& second, int type = TCP);
+
+    /**
+     * @brief 等待 fd 上的事件就绪
+     * @param[in] events POLLIN / POLLOUT
+     * @param[in] timeout_ms 超时毫秒数，(uint64_t)-1 表示不超时
+     * @return 就绪返回1，超时返回0，出错返回-1
+     * @details 目前直接阻塞在 poll 上；协程调度(IOManager)就位后，
+     *          这里改为注册事件并让出当前协程，上层读写接口无需改动
+     */
+    static int WaitEvent(int fd, short events, uint64_t timeout_ms);
+
+    Socket(int family, int type, int protocol = 0);
+    virtual ~Socket();
+
+    // 发送/接收超时时间(毫秒)，(uint64_t)-1 表示不超时
+    uint64_t getSendTimeout() const { return m_sendTimeout; }
+    void setSendTimeout(uint64_t v);
+    uint64_t getRecvTimeout() const { return m_recvTimeout; }
+    void setRecvTimeout(uint64_t v);
+
+    // 获取/设置 sockopt，失败时记录日志
+    bool getOption(int level, int option, void* result, socklen_t* len);
+    template<class T>
+    bool getOption(int level, int option, T& result) {
+        socklen_t length = sizeof(T);
+        return getOption(level, option, &result, &length);
+    }
+
+    // 尚未创建fd时先创建，以便在 bind 之前设置 SO_REUSEPORT 等选项
+    bool setOption(int level, int option, const void* result, socklen_t len);
+    template<class T>
+    bool setOption(int level, int option, const T& value) {
+        return setOption(level, option, &value, sizeof(T));
+    }
+
+    bool setNonBlock(bool v);
+    bool isNonBlock() const;
+    // TCP_NODELAY，只对 TCP Socket 有效
+    bool setTcpNoDelay(bool v = true);
+    bool setReuseAddr(bool v = true);
+    // SO_REUSEPORT，多个 Socket 绑定同一端口，由内核在其间分发连接
+    bool setReusePort(bool v = true);
+
+    /**
+     * @brief 接收一个连接
+     * @return 成功返回新连接的socket(非阻塞、CLOEXEC)，失败返回nullptr
+     * @pre Socket 必须 bind, listen 成功
+     */
+    virtual Socket::ptr accept();
+
+    /**
+     * @brief 批量接收连接
+     * @details 等待第一个连接就绪(受接收超时限制)，之后持续 accept4 直到队列为空或已取满 max 个
+     * @return 本次接收的连接数，追加到 socks
+     */
+    size_t acceptBatch(std::vector<Socket::ptr>& socks, size_t max);
+
+    /**
+     * @brief 包装在本 socket 上接收的连接(如 io_uring 的 accept 完成事件)
+     * @return 与本 socket 同类型的新连接socket
+     */
+    Socket::ptr adoptAccepted(int fd);
+
+    virtual bool bind(const Address::ptr addr);
+
+    /**
+     * @brief 连接地址
+     * @param[in] addr 目标地址
+     * @param[in] timeout_ms 超时时间(毫秒)，(uint64_t)-1 表示使用发送超时
+     */
+    virtual bool connect(const Address::ptr addr, uint64_t timeout_ms = -1);
+
+    virtual bool reconnect(uint64_t timeout_ms = -1);
+
+    virtual bool listen(int backlog = SOMAXCONN);
+
+    virtual bool close();
+
+    /**
+     * @brief 发送数据
+     * @return >0 发送成功对应大小的数据；=0 socket被关闭；<0 socket出错(含超时)
+     */
+    virtual int send(const void* buffer, size_t length, int flags = 0);
+    virtual int send(const iovec* buffers, size_t length, int flags = 0);
+    virtual int sendTo(const void* buffer, size_t length, const Address::ptr to, int flags = 0);
+    virtual int sendTo(const iovec* buffers, size_t length, const Address::ptr to, int flags = 0);
+
+    /**
+     * @brief 接收数据
+     * @return >0 接收到对应大小的数据；=0 socket被关闭；<0 socket出错(含超时)
+     */
+    virtual int recv(void* buffer, size_t length, int flags = 0);
+    virtual int recv(iovec* buffers, size_t length, int flags = 0);
+    virtual int recvFrom(void* buffer, size_t length, Address::ptr from, int flags = 0);
+    virtual int recvFrom(iovec* buffers, size_t length, Address::ptr from, int flags = 0);
+
+    /**
+     * @brief 批量接收数据报 (recvmmsg)
+     * @details 等待第一个数据报就绪后一次系统调用取走最多 vlen 个，适用于UDP
+     * @return 接收到的消息个数，各消息长度在 msgvec[i].msg_len；出错返回-1
+     */
+    int recvBatch(mmsghdr* msgvec, unsigned int vlen, int flags = 0);
+
+    /**
+     * @brief 批量发送数据报 (sendmmsg)
+     * @return 已发送的消息个数；出错返回-1
+     */
+    int sendBatch(mmsghdr* msgvec, unsigned int vlen, int flags = 0);
+
+    Address::ptr getRemoteAddress();
+    Address::ptr getLocalAddress();
+
+    int getFamily() const { return m_family; }
+    int getType() const { return m_type; }
+    int getProtocol() const { return m_protocol; }
+    bool isConnected() const { return m_isConnected; }
+    bool isValid() const;
+    // 返回 SO_ERROR
+    int getError();
+
+    virtual std::ostream& dump(std::ostream& os) const;
+    virtual std::string toString() const;
+
+    int getSocket() const { return m_sock; }
+protected:
+    // 设置默认的 socket 选项：非阻塞、CLOEXEC、SO_REUSEADDR，TCP 额外开启 TCP_NODELAY
+    void initSock();
+    void newSock();
+    // 以已存在的 fd 初始化(accept / socketpair)
+    virtual bool init(int sock);
+protected:
+    int m_sock;                         // socket句柄
+    int m_family;                       // 协议簇
+    int m_type;                         // 类型
+    int m_protocol;                     // 协议
+    bool m_isConnected;                 // 是否连接
+    uint64_t m_sendTimeout;             // 发送超时(毫秒)
+    uint64_t m_recvTimeout;             // 接收超时(毫秒)
+    Address::ptr m_localAddress;        // 本地地址
+    Address::ptr m_remoteAddress;       // 远端地址
+};
+
+// 流式输出socket
+std::ostream& operator<<(std::ostream& os, const Socket& sock);
+
+}
+
+#endif
@@ -0,0 +1,450 @@
+#include "socket_log_appender.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <iostream>
+#include <new>
+#include <yaml-cpp/yaml.h>
+#include "clock.h"
+#include "metrics.h"
+
+namespace myserver {
+
+static myserver::Counter::ptr g_log_socket_sent =
+    myserver::Metrics::GetCounter("log.socket.sent", "log events delivered to the collector");
+static myserver::Counter::ptr g_log_socket_spilled =
+    myserver::Metrics::GetCounter("log.socket.spilled", "log events written to the spill file");
+static myserver::Counter::ptr g_log_socket_dropped =
+    myserver::Metrics::GetCounter("log.socket.dropped", "log events dropped by SocketLogAppender");
+
+static const size_t SEND_CHUNK = 64 * 1024;    // 流式连接单次写入的最大字节数
+
+// spill 文件中每个批次的头部，其后依次为 count 个事件结尾偏移(uint32_t)与数据
+struct SpillHeader {
+    uint32_t len;
+    uint32_t count;
+};
+
+const char* SocketLogAppender::PolicyToString(Policy policy) {
+    return policy == BLOCK ? "block" : "drop";
+}
+
+SocketLogAppender::Policy SocketLogAppender::PolicyFromString(const std::string& str) {
+    return str == "block" ? BLOCK : DROP;
+}
+
+SocketLogAppender::SocketLogAppender(const std::string& address, const Options& options)
+    :m_address(address)
+    ,m_options(options)
+    ,m_queue(options.queue_size ? options.queue_size : 1)
+    ,m_pendingBytes(0)
+    ,m_notified(false)
+    ,m_blocked(0)
+    ,m_stopping(false)
+    ,m_enqueued(0)
+    ,m_done(0)
+    ,m_fd(-1)
+    ,m_sent(0)
+    ,m_spilled(0)
+    ,m_dropped(0) {
+    if(m_options.batch_size == 0) {
+        m_options.batch_size = 1;
+    }
+    if(address.compare(0, 5, "unix:") == 0) {
+        m_addr.reset(new UnixAddress(address.substr(5)));
+        m_sockType = SOCK_STREAM;
+    } else if(address.compare(0, 9, "unixgram:") == 0) {
+        m_addr.reset(new UnixAddress(address.substr(9)));
+        m_sockType = SOCK_DGRAM;
+    } else if(address.compare(0, 4, "udp:") == 0) {
+        m_addr = Address::LookupAny(address.substr(4), AF_UNSPEC, SOCK_DGRAM);
+        m_sockType = SOCK_DGRAM;
+    }
+    m_valid = (bool)m_addr;
+    if(!m_valid) {
+        std::cout << "SocketLogAppender invalid address: " << address << std::endl;
+        return;
+    }
+
+    if(!m_options.spill_file.empty()) {
+        m_spillFd = open(m_options.spill_file.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        struct stat st;
+        if(m_spillFd >= 0 && fstat(m_spillFd, &st) == 0) {
+            // 上次运行遗留的数据在连接后重放
+            m_spillSize = st.st_size;
+        } else {
+            std::cout << "SocketLogAppender open spill file " << m_options.spill_file
+                      << " errno=" << errno << " errstr=" << strerror(errno) << std::endl;
+        }
+    }
+    FatalSignalHandler::AddFlushable(this);
+    m_thread.reset(new Thread(std::bind(&SocketLogAppender::run, this), "log_socket"));
+}
+
+SocketLogAppender::~SocketLogAppender() {
+    FatalSignalHandler::RemoveFlushable(this);
+    m_stopping.store(true, std::memory_order_release);
+    if(m_thread) {
+        m_wakeup.notify();
+        m_thread->join();
+    }
+    if(m_spillFd >= 0) {
+        close(m_spillFd);
+    }
+}
+
+void SocketLogAppender::log(Logger::ptr logger, LogEvent::ptr event) {
+    if(!m_valid || event->getLevel() < m_level) {
+        return;
+    }
+    std::string msg = m_formatter->format(logger, event);
+    size_t len = msg.size();
+    while(!m_queue.tryPush(std::move(msg))) {
+        // 发送线程自身写日志时不能等待自己
+        if(m_options.policy == DROP || m_stopping.load(std::memory_order_relaxed)
+                || Thread::GetThis() == m_thread.get()) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            g_log_socket_dropped->inc();
+            return;
+        }
+        m_blocked.fetch_add(1, std::memory_order_relaxed);
+        m_wakeup.notify();
+        m_space.waitFor(10);
+        m_blocked.fetch_sub(1, std::memory_order_relaxed);
+    }
+    m_enqueued.fetch_add(1, std::memory_order_relaxed);
+    if(m_pendingBytes.fetch_add(len, std::memory_order_relaxed) + len >= m_options.batch_size
+            && !m_notified.exchange(true, std::memory_order_relaxed)) {
+        m_wakeup.notify();
+    }
+}
+
+bool SocketLogAppender::flush(uint64_t timeout_ms) {
+    uint64_t target = m_enqueued.load(std::memory_order_relaxed);
+    uint64_t deadline = Clock::NowMs() + timeout_ms;
+    while(m_done.load(std::memory_order_acquire) < target) {
+        if(Clock::NowMs() >= deadline) {
+            return false;
+        }
+        if(!m_notified.exchange(true, std::memory_order_relaxed)) {
+            m_wakeup.notify();
+        }
+        usleep(1000);
+    }
+    return true;
+}
+
+void SocketLogAppender::run() {
+    while(!m_stopping.load(std::memory_order_acquire)) {
+        m_wakeup.waitFor(m_options.flush_interval);
+        m_notified.store(false, std::memory_order_relaxed);
+        drain();
+    }
+    // 退出前处理剩余事件，仍无法送出的丢弃
+    drain();
+    for(auto& b : m_carry) {
+        m_dropped.fetch_add(b.count, std::memory_order_relaxed);
+        g_log_socket_dropped->inc(b.count);
+        m_done.fetch_add(b.count, std::memory_order_release);
+    }
+    m_carry.clear();
+    disconnect();
+}
+
+void SocketLogAppender::drain() {
+    if(m_fd.load(std::memory_order_relaxed) < 0 && Clock::CoarseMs() >= m_nextRetryMs) {
+        if(connect()) {
+            replaySpill();
+        } else {
+            m_nextRetryMs = Clock::CoarseMs() + m_options.retry_interval;
+        }
+    }
+    while(!m_carry.empty()) {
+        if(!ship(m_carry.front())) {
+            return;
+        }
+        m_carry.pop_front();
+    }
+
+    Batch batch;
+    std::string item;
+    while(m_queue.tryPop(item)) {
+        m_pendingBytes.fetch_sub(item.size(), std::memory_order_relaxed);
+        if(m_blocked.load(std::memory_order_relaxed)) {
+            m_space.notify();
+        }
+        if(batch.count && batch.data.size() + item.size() > m_options.batch_size) {
+            if(!ship(batch)) {
+                // block 策略：保留未送出的数据，不再取队列，让写日志的线程阻塞
+                m_carry.push_back(std::move(batch));
+                m_carry.push_back(Batch());
+                m_carry.back().data.swap(item);
+                m_carry.back().ends.push_back(m_carry.back().data.size());
+                m_carry.back().count = 1;
+                return;
+            }
+            batch.data.clear();
+            batch.ends.clear();
+            batch.count = 0;
+        }
+        batch.data.append(item);
+        batch.ends.push_back(batch.data.size());
+        ++batch.count;
+    }
+    if(batch.count && !ship(batch)) {
+        m_carry.push_back(std::move(batch));
+    }
+}
+
+bool SocketLogAppender::connect() {
+    int fd = socket(m_addr->getFamily(), m_sockType | SOCK_CLOEXEC, 0);
+    if(fd < 0) {
+        return false;
+    }
+    // 采集端读得慢时最多阻塞发送线程 1 秒，避免退出时卡住
+    struct timeval tv = {1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    if(::connect(fd, m_addr->getAddr(), m_addr->getAddrLen())) {
+        close(fd);
+        return false;
+    }
+    m_fd.store(fd, std::memory_order_relaxed);
+    return true;
+}
+
+void SocketLogAppender::disconnect() {
+    int fd = m_fd.exchange(-1, std::memory_order_relaxed);
+    if(fd >= 0) {
+        close(fd);
+        m_nextRetryMs = Clock::CoarseMs() + m_options.retry_interval;
+    }
+}
+
+int SocketLogAppender::sendAll(const char* data, size_t len, size_t& sent) {
+    int fd = m_fd.load(std::memory_order_relaxed);
+    sent = 0;
+    while(len > 0) {
+        // 对端在一次写入中途断开时内核可能只返回 EPIPE 而不报告已写入的字节数，
+        // 流式写入分块进行，不确定的部分不超过一块
+        size_t n = m_sockType == SOCK_STREAM ? std::min(len, (size_t)SEND_CHUNK) : len;
+        ssize_t rt = send(fd, data, n, MSG_NOSIGNAL);
+        if(rt < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            if(errno == EMSGSIZE) {
+                return -1;
+            }
+            disconnect();
+            return 0;
+        }
+        sent += rt;
+        if(m_sockType == SOCK_DGRAM) {
+            break;
+        }
+        data += rt;
+        len -= rt;
+    }
+    return 1;
+}
+
+// ends 中结尾不超过 sent 的事件个数，即已完整送达的事件数
+static size_t Delivered(const uint32_t* ends, size_t count, uint64_t sent) {
+    return std::upper_bound(ends, ends + count, sent) - ends;
+}
+
+bool SocketLogAppender::ship(Batch& batch) {
+    int rt = 0;
+    if(m_fd.load(std::memory_order_relaxed) >= 0) {
+        size_t sent = 0;
+        rt = sendAll(batch.data.c_str(), batch.data.size(), sent);
+        size_t n = rt == 0 ? Delivered(batch.ends.data(), batch.ends.size(), sent) : 0;
+        if(n) {
+            // 流式连接在部分写入后断开：完整送达的事件计为已发送，
+            // 其余事件(含只送达一部分的)整条落盘或在重连后重发
+            uint32_t off = batch.ends[n - 1];
+            batch.data.erase(0, off);
+            batch.ends.erase(batch.ends.begin(), batch.ends.begin() + n);
+            for(auto& e : batch.ends) {
+                e -= off;
+            }
+            batch.count -= n;
+            m_sent.fetch_add(n, std::memory_order_relaxed);
+            g_log_socket_sent->inc(n);
+            m_done.fetch_add(n, std::memory_order_release);
+        }
+    }
+    if(rt > 0) {
+        m_sent.fetch_add(batch.count, std::memory_order_relaxed);
+        g_log_socket_sent->inc(batch.count);
+    } else if(rt == 0 && spill(batch)) {
+        m_spilled.fetch_add(batch.count, std::memory_order_relaxed);
+        g_log_socket_spilled->inc(batch.count);
+    } else if(rt == 0 && m_options.policy == BLOCK && !m_stopping.load(std::memory_order_relaxed)) {
+        return false;
+    } else {
+        // 数据报超长或无法落盘
+        m_dropped.fetch_add(batch.count, std::memory_order_relaxed);
+        g_log_socket_dropped->inc(batch.count);
+    }
+    m_done.fetch_add(batch.count, std::memory_order_release);
+    return true;
+}
+
+bool SocketLogAppender::spill(const Batch& batch) {
+    if(m_spillFd < 0) {
+        return false;
+    }
+    SpillHeader header;
+    header.len = batch.data.size();
+    header.count = batch.count;
+    size_t ends_len = batch.count * sizeof(uint32_t);
+    uint64_t size = sizeof(header) + ends_len + batch.data.size();
+    if(m_spillSize + size > m_options.spill_size) {
+        return false;
+    }
+    iovec iov[3];
+    iov[0].iov_base = &header;
+    iov[0].iov_len = sizeof(header);
+    iov[1].iov_base = (void*)batch.ends.data();
+    iov[1].iov_len = ends_len;
+    iov[2].iov_base = (void*)batch.data.c_str();
+    iov[2].iov_len = batch.data.size();
+    if(pwritev(m_spillFd, iov, 3, m_spillSize) != (ssize_t)size) {
+        return false;
+    }
+    m_spillSize += size;
+    return true;
+}
+
+bool SocketLogAppender::replaySpill() {
+    std::string data;
+    std::vector<uint32_t> ends;
+    while(m_spillOffset < m_spillSize) {
+        SpillHeader header;
+        if(pread(m_spillFd, &header, sizeof(header), m_spillOffset) != sizeof(header)) {
+            break;  // 文件损坏，丢弃剩余部分
+        }
+        uint64_t ends_len = (uint64_t)header.count * sizeof(uint32_t);
+        uint64_t frame = sizeof(header) + ends_len + header.len;
+        if(header.count == 0 || m_replaySkip >= header.count || m_spillOffset + frame > m_spillSize) {
+            break;
+        }
+        ends.resize(header.count);
+        data.resize(header.len);
+        if(pread(m_spillFd, &ends[0], ends_len, m_spillOffset + sizeof(header)) != (ssize_t)ends_len
+                || pread(m_spillFd, &data[0], header.len, m_spillOffset + sizeof(header) + ends_len) != header.len
+                || ends.back() != header.len) {
+            break;
+        }
+        // 上次重放在部分写入后断开时，跳过已完整送达的事件
+        uint32_t begin = m_replaySkip ? ends[m_replaySkip - 1] : 0;
+        size_t sent = 0;
+        int rt = sendAll(data.c_str() + begin, data.size() - begin, sent);
+        if(rt == 0) {
+            // 再次断开，下次连接后从第一条未完整送达的事件继续
+            size_t n = Delivered(ends.data(), ends.size(), begin + sent);
+            m_sent.fetch_add(n - m_replaySkip, std::memory_order_relaxed);
+            g_log_socket_sent->inc(n - m_replaySkip);
+            m_replaySkip = n;
+            return false;
+        }
+        if(rt > 0) {
+            m_sent.fetch_add(header.count - m_replaySkip, std::memory_order_relaxed);
+            g_log_socket_sent->inc(header.count - m_replaySkip);
+        } else {
+            m_dropped.fetch_add(header.count - m_replaySkip, std::memory_order_relaxed);
+            g_log_socket_dropped->inc(header.count - m_replaySkip);
+        }
+        m_replaySkip = 0;
+        m_spillOffset += frame;
+    }
+    if(ftruncate(m_spillFd, 0)) {
+        return false;
+    }
+    m_spillSize = 0;
+    m_spillOffset = 0;
+    m_replaySkip = 0;
+    return true;
+}
+
+void SocketLogAppender::crashWrite(int fd, const char* data, size_t len, uint64_t& spill_size) {
+    if(fd >= 0) {
+        // 数据报逐条发送；流式连接可能与发送线程正在进行的写入交错，尽力而为
+        while(len > 0) {
+            ssize_t rt = send(fd, data, len, MSG_NOSIGNAL);
+            if(rt <= 0 || m_sockType == SOCK_DGRAM) {
+                return;
+            }
+            data += rt;
+            len -= rt;
+        }
+        return;
+    }
+    // 每条事件一个批次，重启后连接时按正常流程重放
+    SpillHeader header;
+    header.len = len;
+    header.count = 1;
+    uint32_t end = len;
+    uint64_t size = sizeof(header) + sizeof(end) + len;
+    if(spill_size + size > m_options.spill_size) {
+        return;
+    }
+    iovec iov[3];
+    iov[0].iov_base = &header;
+    iov[0].iov_len = sizeof(header);
+    iov[1].iov_base = &end;
+    iov[1].iov_len = sizeof(end);
+    iov[2].iov_base = (void*)data;
+    iov[2].iov_len = len;
+    if(pwritev(m_spillFd, iov, 3, spill_size) == (ssize_t)size) {
+        spill_size += size;
+    }
+}
+
+void SocketLogAppender::crashFlush(const char* report, size_t len) {
+    int fd = m_fd.load(std::memory_order_relaxed);
+    if(!m_valid || (fd < 0 && m_spillFd < 0)) {
+        return;
+    }
+    uint64_t spill_size = m_spillSize;
+    // 取出的字符串不析构：被移走的缓冲直接泄漏，避免在信号处理函数中 free
+    alignas(std::string) char storage[sizeof(std::string)];
+    std::string* item = new (storage) std::string;
+    while(m_queue.tryPop(*item)) {
+        crashWrite(fd, item->c_str(), item->size(), spill_size);
+        item = new (storage) std::string;
+    }
+    crashWrite(fd, report, len, spill_size);
+}
+
+std::string SocketLogAppender::toYamlString() {
+    YAML::Node node;
+    node["type"] = "SocketLogAppender";
+    node["address"] = m_address;
+    node["batch_size"] = m_options.batch_size;
+    node["flush_interval"] = m_options.flush_interval;
+    node["queue_size"] = m_options.queue_size;
+    node["policy"] = PolicyToString(m_options.policy);
+    if(!m_options.spill_file.empty()) {
+        node["spill_file"] = m_options.spill_file;
+        node["spill_size"] = m_options.spill_size;
+    }
+    if(m_level != LogLevel::UNKNOWN) {
+        node["level"] = LogLevel::ToString(m_level);
+    }
+    if(m_hasFormatter && m_formatter) {
+        node["formatter"] = m_formatter->getPattern();
+    }
+    std::stringstream ss;
+    ss << node;
+    return ss.str();
+}
+
+}
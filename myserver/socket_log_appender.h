@@ -0,0 +1,122 @@
+#ifndef __MYSERVER_SOCKET_LOG_APPENDER_H__
+#define __MYSERVER_SOCKET_LOG_APPENDER_H__
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+#include "log.h"
+#include "address.h"
+#include "mutex.h"
+#include "queue.h"
+#include "thread.h"
+#include "fatal_signal.h"
+
+namespace myserver {
+
+/**
+ * @brief 把格式化后的日志发往本机采集进程的Appender
+ * @details log() 只格式化并放入有界队列；后台线程 log_socket 按 batch_size 把多条事件拼成
+ *          一个数据报或一次流写入，每 flush_interval 毫秒或积压超过 batch_size 时发送。
+ *          地址形如 unix:/path(Unix 流)、unixgram:/path(Unix 数据报)、udp:host:port。
+ *          采集端不可用时批次按 [长度, 事件数][各事件结尾][数据] 写入有界的 spill 文件，重连后先按原批次重放；
+ *          流式连接部分写入后断开时，只有未完整送达的事件(含只送达一部分的)落盘或重发
+ *          (按 64KB 分块写入，内核未报告部分写入时最多重发一块内的事件)；
+ *          spill 文件满(或未配置)时按策略处理：drop 丢弃；block 停止取队列直到重连，
+ *          队列满后 log() 阻塞等待。发送使用原始系统调用且不写日志，避免经由本Appender递归。
+ *          UDP 只能在下一次发送时得知对端不可达，期间的数据报会丢失。
+ *          崩溃时把队列中的事件与崩溃报告直接写到已连接的 socket，未连接时按批次格式追加到 spill 文件；
+ *          block 策略下积压在发送线程中的批次不写出
+ */
+class SocketLogAppender : public LogAppender, public CrashFlushable {
+public:
+    typedef std::shared_ptr<SocketLogAppender> ptr;
+
+    enum Policy {
+        DROP = 0,   // 队列或 spill 满时丢弃
+        BLOCK = 1,  // 队列满时阻塞写日志的线程
+    };
+
+    struct Options {
+        uint32_t batch_size = 4096;         // 单个数据报/单次写入的最大字节数
+        uint32_t flush_interval = 100;      // 最长发送间隔(毫秒)
+        uint32_t queue_size = 8192;         // 队列可容纳的事件数
+        Policy policy = DROP;
+        std::string spill_file;             // 为空时不落盘
+        uint64_t spill_size = 64 * 1024 * 1024; // spill 文件上限(字节)
+        uint32_t retry_interval = 1000;     // 重连间隔(毫秒)
+    };
+
+    SocketLogAppender(const std::string& address, const Options& options);
+    ~SocketLogAppender();
+
+    void log(Logger::ptr logger, LogEvent::ptr event) override;
+    std::string toYamlString() override;
+    void crashFlush(const char* report, size_t len) override;
+
+    // 等待调用前入队的事件处理完(发送、落盘或丢弃)，超时返回 false
+    bool flush(uint64_t timeout_ms = 1000);
+
+    bool isConnected() const { return m_fd.load(std::memory_order_relaxed) >= 0; }
+    // 已发送/已落盘/已丢弃的事件数
+    uint64_t getSent() const { return m_sent.load(std::memory_order_relaxed); }
+    uint64_t getSpilled() const { return m_spilled.load(std::memory_order_relaxed); }
+    uint64_t getDropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+    static const char* PolicyToString(Policy policy);
+    static Policy PolicyFromString(const std::string& str);
+private:
+    // 一批事件
+    struct Batch {
+        std::string data;
+        std::vector<uint32_t> ends;     // 每个事件在 data 中的结尾偏移
+        uint32_t count = 0;
+    };
+
+    void run();
+    void drain();
+    bool connect();
+    void disconnect();
+    // 1 成功，0 连接失败(已断开，sent 为断开前已写入的字节数)，-1 数据报超长
+    int sendAll(const char* data, size_t len, size_t& sent);
+    // 发送或落盘，都失败时返回 false
+    bool ship(Batch& batch);
+    bool spill(const Batch& batch);
+    // 崩溃时写出单条事件，只使用异步信号安全的调用
+    void crashWrite(int fd, const char* data, size_t len, uint64_t& spill_size);
+    bool replaySpill();
+private:
+    std::string m_address;
+    Options m_options;
+    Address::ptr m_addr;
+    int m_sockType = SOCK_STREAM;
+    bool m_valid = false;
+
+    MPMCQueue<std::string> m_queue;
+    std::atomic<uint64_t> m_pendingBytes;
+    std::atomic<bool> m_notified;
+    std::atomic<int> m_blocked;         // 在 log() 中等待队列空位的线程数
+    Semaphore m_wakeup;                 // 唤醒发送线程
+    Semaphore m_space;                  // 队列有空位
+    std::atomic<bool> m_stopping;
+    std::atomic<uint64_t> m_enqueued;   // 已入队事件数
+    std::atomic<uint64_t> m_done;       // 已处理事件数
+
+    std::atomic<int> m_fd;
+    uint64_t m_nextRetryMs = 0;
+    std::list<Batch> m_carry;           // block 策略下尚未送出的批次
+    int m_spillFd = -1;
+    uint64_t m_spillSize = 0;           // spill 文件当前大小
+    uint64_t m_spillOffset = 0;         // 已重放到的位置
+    uint32_t m_replaySkip = 0;          // 当前批次已完整送达的事件数
+
+    std::atomic<uint64_t> m_sent;
+    std::atomic<uint64_t> m_spilled;
+    std::atomic<uint64_t> m_dropped;
+    Thread::ptr m_thread;
+};
+
+}
+
+#endif
@@ -0,0 +1,167 @@
+#include "stack_allocator.h"
+#include <sys/mman.h>
+#include <unistd.h>
+#include <errno.h>
+#include <atomic>
+#include <new>
+#include <vector>
+#include <cstdlib>
+#include "config.h"
+#include "log.h"
+
+namespace myserver {
+
+static myserver::Logger::ptr g_logger = LOGGER_NAME("system");
+
+static ConfigVar<uint32_t>::ptr g_fiber_stack_size =
+    Config::Lookup<uint32_t>("fiber.stack_size", 128 * 1024, "fiber stack size");
+
+static ConfigVar<uint32_t>::ptr g_fiber_max_cached_stacks =
+    Config::Lookup<uint32_t>("fiber.max_cached_stacks", 64, "max cached fiber stacks per thread");
+
+// 配置值缓存为原子量，分配路径上不访问 ConfigVar
+static std::atomic<uint32_t> s_stack_size(128 * 1024);
+static std::atomic<uint32_t> s_max_cached(64);
+
+struct StackAllocatorIniter {
+    StackAllocatorIniter() {
+        s_stack_size = g_fiber_stack_size->getValue();
+        s_max_cached = g_fiber_max_cached_stacks->getValue();
+        g_fiber_stack_size->addListener(0x5A7C0001,
+            [](const uint32_t& old_value, const uint32_t& new_value) {
+            s_stack_size = new_value;
+        });
+        g_fiber_max_cached_stacks->addListener(0x5A7C0002,
+            [](const uint32_t& old_value, const uint32_t& new_value) {
+            s_max_cached = new_value;
+        });
+    }
+};
+
+static StackAllocatorIniter __stack_allocator_init;
+
+static std::atomic<uint64_t> s_mapped_stacks(0);
+static std::atomic<uint64_t> s_cached_stacks(0);
+static std::atomic<uint64_t> s_mapped_bytes(0);
+static std::atomic<uint64_t> s_total_allocs(0);
+static std::atomic<uint64_t> s_cache_hits(0);
+
+static size_t PageSize() {
+    static size_t s_page = sysconf(_SC_PAGESIZE);
+    return s_page;
+}
+
+static void UnmapStack(void* stack, size_t usable) {
+    size_t page = PageSize();
+    munmap(static_cast<char*>(stack) - page, usable + page);
+    s_mapped_stacks.fetch_sub(1, std::memory_order_relaxed);
+    s_mapped_bytes.fetch_sub(usable + page, std::memory_order_relaxed);
+}
+
+namespace {
+
+struct CachedStack {
+    void* stack;
+    size_t size;    // 可用大小
+};
+
+// 线程本地空闲栈链表，线程退出时解除全部映射
+struct StackCache {
+    std::vector<CachedStack> stacks;
+
+    void clear() {
+        for(auto& i : stacks) {
+            UnmapStack(i.stack, i.size);
+        }
+        s_cached_stacks.fetch_sub(stacks.size(), std::memory_order_relaxed);
+        stacks.clear();
+    }
+
+    ~StackCache() { clear(); }
+};
+
+static thread_local StackCache t_stack_cache;
+
+}
+
+size_t StackAllocator::GetUsableSize(size_t size) {
+    if(!size) {
+        size = s_stack_size.load(std::memory_order_relaxed);
+    }
+    size_t page = PageSize();
+    return (size + page - 1) / page * page;
+}
+
+void* StackAllocator::Alloc(size_t size) {
+    size = GetUsableSize(size);
+    s_total_allocs.fetch_add(1, std::memory_order_relaxed);
+
+    // 从后往前找，最近释放的栈其浅层页面最可能仍驻留内存
+    std::vector<CachedStack>& stacks = t_stack_cache.stacks;
+    for(size_t i = stacks.size(); i > 0; --i) {
+        if(stacks[i - 1].size == size) {
+            void* stack = stacks[i - 1].stack;
+            stacks[i - 1] = stacks.back();
+            stacks.pop_back();
+            s_cached_stacks.fetch_sub(1, std::memory_order_relaxed);
+            s_cache_hits.fetch_add(1, std::memory_order_relaxed);
+            return stack;
+        }
+    }
+
+    size_t page = PageSize();
+    void* mem = mmap(nullptr, size + page, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+    if(mem == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+    if(mprotect(mem, page, PROT_NONE)) {
+        munmap(mem, size + page);
+        throw std::bad_alloc();
+    }
+    s_mapped_stacks.fetch_add(1, std::memory_order_relaxed);
+    s_mapped_bytes.fetch_add(size + page, std::memory_order_relaxed);
+    return static_cast<char*>(mem) + page;
+}
+
+void StackAllocator::Dealloc(void* stack, size_t size) {
+    if(!stack) {
+        return;
+    }
+    if(!size) {
+        // 无法得知映射大小，既不能缓存也不能 munmap；静默返回会泄漏整个栈和保护页
+        LOG_ERROR(g_logger) << "StackAllocator::Dealloc size=0 stack=" << stack;
+        abort();
+    }
+    // 不回落到当前 fiber.stack_size：配置可能在分配之后被修改
+    size = GetUsableSize(size);
+    std::vector<CachedStack>& stacks = t_stack_cache.stacks;
+    if(stacks.size() >= s_max_cached.load(std::memory_order_relaxed)) {
+        UnmapStack(stack, size);
+        return;
+    }
+    // 栈向低地址增长，只保留栈顶 HOT_SIZE 的页面
+    if(size > HOT_SIZE) {
+        if(madvise(stack, size - HOT_SIZE, MADV_FREE) && errno == EINVAL) {
+            madvise(stack, size - HOT_SIZE, MADV_DONTNEED);
+        }
+    }
+    stacks.push_back(CachedStack{stack, size});
+    s_cached_stacks.fetch_add(1, std::memory_order_relaxed);
+}
+
+void StackAllocator::ReleaseCache() {
+    t_stack_cache.clear();
+}
+
+StackStats StackAllocator::GetStats() {
+    StackStats stats;
+    stats.mapped_stacks = s_mapped_stacks.load(std::memory_order_relaxed);
+    stats.cached_stacks = s_cached_stacks.load(std::memory_order_relaxed);
+    stats.mapped_bytes = s_mapped_bytes.load(std::memory_order_relaxed);
+    stats.total_allocs = s_total_allocs.load(std::memory_order_relaxed);
+    stats.cache_hits = s_cache_hits.load(std::memory_order_relaxed);
+    return stats;
+}
+
+}
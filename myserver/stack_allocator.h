@@ -0,0 +1,59 @@
+#ifndef __MYSERVER_STACK_ALLOCATOR_H__
+#define __MYSERVER_STACK_ALLOCATOR_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace myserver {
+
+// 栈分配统计信息
+struct StackStats {
+    uint64_t mapped_stacks = 0;     // 当前已映射的栈个数(使用中 + 缓存中)
+    uint64_t cached_stacks = 0;     // 各线程空闲链表中缓存的栈个数
+    uint64_t mapped_bytes = 0;      // 已映射的虚拟地址空间字节数(含保护页)
+    uint64_t total_allocs = 0;      // 累计分配次数
+    uint64_t cache_hits = 0;        // 命中线程缓存的分配次数
+};
+
+/**
+ * @brief 协程栈分配器
+ * @details 每个栈用 mmap 单独映射并带 MAP_NORESERVE，物理页在首次访问时由内核按需提交，
+ *          因此内存占用与栈实际使用深度成正比。栈底(低地址)额外映射一个 PROT_NONE 保护页，
+ *          栈溢出时直接触发 SIGSEGV 而不是静默踩坏相邻内存。
+ *          释放的栈放入当前线程的空闲链表复用，链表长度受配置 fiber.max_cached_stacks 限制；
+ *          入链时将栈顶 HOT_SIZE 以外的页交还内核，缓存的栈只保留常用的浅层页面。
+ *          线程退出时其缓存的栈全部解除映射
+ */
+class StackAllocator {
+public:
+    enum {
+        HOT_SIZE = 16 * 1024        // 回收时保留的栈顶字节数
+    };
+
+    /**
+     * @brief 分配协程栈
+     * @param[in] size 可用栈大小，向上取整到页大小；为0时使用配置 fiber.stack_size
+     * @return 栈的最低可用地址，栈顶为返回值 + GetUsableSize(size)
+     * @exception 映射失败抛出 std::bad_alloc
+     */
+    static void* Alloc(size_t size = 0);
+
+    /**
+     * @brief 释放协程栈
+     * @param[in] size 分配时的可用大小(GetUsableSize 的结果)，为0时记录错误并 abort；
+     *            调用方自行保存，避免分配后修改 fiber.stack_size 导致按错误大小释放
+     */
+    static void Dealloc(void* stack, size_t size);
+
+    // 返回 size 对应的实际可用栈大小
+    static size_t GetUsableSize(size_t size = 0);
+
+    // 解除当前线程缓存的全部栈映射
+    static void ReleaseCache();
+
+    static StackStats GetStats();
+};
+
+}
+
+#endif
@@ -0,0 +1,539 @@
+#include "tcp_server.h"
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sstream>
+#include "config.h"
+#include "log.h"
+
+namespace myserver {
+
+static myserver::ConfigVar<std::vector<std::string> >::ptr g_tcp_server_address =
+    myserver::Config::Lookup("tcp_server.address",
+            std::vector<std::string>{"0.0.0.0:8020"}, "tcp server bind addresses");
+
+static myserver::ConfigVar<uint32_t>::ptr g_tcp_server_workers =
+    myserver::Config::Lookup("tcp_server.workers", (uint32_t)0,
+            "tcp server worker threads, 0 means hardware concurrency");
+
+static myserver::ConfigVar<uint64_t>::ptr g_tcp_server_read_timeout =
+    myserver::Config::Lookup("tcp_server.read_timeout", (uint64_t)(60 * 1000 * 2),
+            "tcp server read timeout(ms)");
+
+static myserver::ConfigVar<uint32_t>::ptr g_tcp_server_keepalive =
+    myserver::Config::Lookup("tcp_server.keepalive", (uint32_t)60,
+            "tcp keepalive idle seconds, 0 means disabled");
+
+static myserver::ConfigVar<bool>::ptr g_tcp_server_pin_cpu =
+    myserver::Config::Lookup("tcp_server.pin_cpu", false, "pin worker threads to cpus");
+
+static myserver::ConfigVar<std::string>::ptr g_tcp_server_io_backend =
+    myserver::Config::Lookup("tcp_server.io_backend", std::string("poll"),
+            "tcp server worker io backend: poll or io_uring");
+
+static myserver::ConfigVar<uint32_t>::ptr g_tcp_server_uring_entries =
+    myserver::Config::Lookup("tcp_server.io_uring.entries", (uint32_t)1024,
+            "io_uring submission queue entries per worker");
+
+static myserver::ConfigVar<bool>::ptr g_tcp_server_uring_sqpoll =
+    myserver::Config::Lookup("tcp_server.io_uring.sqpoll", false,
+            "io_uring use a kernel thread to poll the submission queue");
+
+static myserver::ConfigVar<uint32_t>::ptr g_tcp_server_uring_sqpoll_idle =
+    myserver::Config::Lookup("tcp_server.io_uring.sqpoll_idle", (uint32_t)1000,
+            "io_uring sqpoll thread idle time(ms) before sleeping");
+
+static myserver::ConfigVar<uint32_t>::ptr g_tcp_server_uring_buffer_count =
+    myserver::Config::Lookup("tcp_server.io_uring.buffer_count", (uint32_t)1024,
+            "io_uring provided receive buffers per worker, power of 2");
+
+static myserver::ConfigVar<uint32_t>::ptr g_tcp_server_uring_buffer_size =
+    myserver::Config::Lookup("tcp_server.io_uring.buffer_size", (uint32_t)4096,
+            "io_uring provided receive buffer size");
+
+static myserver::Logger::ptr g_logger = LOGGER_NAME("system");
+
+// 每轮最多连续接收的连接数，之后重新 poll 以兼顾多个监听socket
+static const size_t ACCEPT_BATCH = 64;
+
+static thread_local size_t t_worker_index = 0;
+static thread_local IoUring* t_uring = nullptr;
+
+// io_uring user_data 的高4位区分请求类型
+enum UringTag {
+    TAG_NONE = 0,       // 不关心结果(POLL_REMOVE、取消等)
+    TAG_ACCEPT = 1,     // 低位为监听socket序号
+    TAG_WAKE = 2,
+    TAG_POLL = 3,       // 32~55位为轮次，低32位为子类fd序号
+    TAG_USER = 4        // 子类提交的请求
+};
+static const int TAG_SHIFT = 60;
+static const uint64_t TAG_VALUE_MASK = (1ULL << TAG_SHIFT) - 1;
+// SQ 已满时推迟的请求最迟多久后重试(毫秒)
+static const int URING_RETRY_MS = 1;
+// 固定文件表最大槽位数，槽位号即fd
+static const uint32_t MAX_FIXED_FILES = 65536;
+
+TcpServer::TcpServer(size_t worker_count)
+    :m_workerCount(worker_count)
+    ,m_readTimeout(g_tcp_server_read_timeout->getValue())
+    ,m_keepalive(g_tcp_server_keepalive->getValue())
+    ,m_pinCpu(g_tcp_server_pin_cpu->getValue())
+    ,m_backend(POLL)
+    ,m_name("myserver/1.0.0")
+    ,m_wakeFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+    ,m_isStop(true) {
+    if(!m_workerCount) {
+        m_workerCount = g_tcp_server_workers->getValue();
+    }
+    if(!m_workerCount) {
+        m_workerCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for(size_t i = 0; i < m_workerCount; ++i) {
+        m_workers.push_back(std::unique_ptr<Worker>(new Worker));
+    }
+    const std::string& backend = g_tcp_server_io_backend->getValue();
+    if(backend == "io_uring") {
+        if(IoUring::IsSupported()) {
+            m_backend = IO_URING;
+        } else {
+            LOG_WARN(g_logger) << "io_uring not supported, fall back to poll";
+        }
+    } else if(backend != "poll") {
+        LOG_WARN(g_logger) << "unknown tcp_server.io_backend=" << backend << ", use poll";
+    }
+}
+
+TcpServer::~TcpServer() {
+    stop();
+    for(auto& w : m_workers) {
+        for(auto& s : w->socks) {
+            s->close();
+        }
+    }
+    if(m_wakeFd >= 0) {
+        close(m_wakeFd);
+    }
+}
+
+bool TcpServer::bind(myserver::Address::ptr addr) {
+    std::vector<Address::ptr> addrs;
+    std::vector<Address::ptr> fails;
+    addrs.push_back(addr);
+    return bind(addrs, fails);
+}
+
+bool TcpServer::bind(const std::vector<Address::ptr>& addrs,
+                     std::vector<Address::ptr>& fails) {
+    for(auto& addr : addrs) {
+        std::vector<Socket::ptr> socks;
+        if(addr->getFamily() == AF_UNIX) {
+            Socket::ptr sock = bindUnix(addr);
+            if(sock) {
+                socks.assign(m_workerCount, sock);
+            }
+        }
+        Address::ptr bind_addr = addr;
+        for(size_t i = 0; i < m_workerCount && addr->getFamily() != AF_UNIX; ++i) {
+            Socket::ptr sock = Socket::CreateTCP(bind_addr);
+            if(!sock->setReusePort() || !sock->bind(bind_addr) || !sock->listen()) {
+                LOG_ERROR(g_logger) << "bind fail errno=" << errno
+                    << " errstr=" << strerror(errno)
+                    << " addr=[" << addr->toString() << "]";
+                socks.clear();
+                break;
+            }
+            // 随机端口时其余socket绑定第一个socket实际拿到的端口
+            bind_addr = sock->getLocalAddress();
+            socks.push_back(sock);
+        }
+        if(socks.empty()) {
+            fails.push_back(addr);
+            continue;
+        }
+        for(size_t i = 0; i < m_workerCount; ++i) {
+            m_workers[i]->socks.push_back(socks[i]);
+        }
+    }
+
+    if(!fails.empty()) {
+        for(auto& w : m_workers) {
+            w->socks.clear();
+        }
+        return false;
+    }
+
+    for(auto& i : m_workers[0]->socks) {
+        LOG_INFO(g_logger) << "server bind success: " << *i
+            << " workers=" << m_workerCount;
+    }
+    return true;
+}
+
+Socket::ptr TcpServer::bindUnix(Address::ptr addr) {
+    // 清理上次进程退出时残留的socket文件，其他类型的文件不动
+    UnixAddress::ptr uaddr = std::dynamic_pointer_cast<UnixAddress>(addr);
+    std::string path = uaddr ? uaddr->getPath() : "";
+    struct stat st;
+    if(!path.empty() && path[0] != '\0' && lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+        unlink(path.c_str());
+    }
+    Socket::ptr sock = Socket::CreateTCP(addr);
+    if(!sock->bind(addr) || !sock->listen()) {
+        LOG_ERROR(g_logger) << "bind fail errno=" << errno
+            << " errstr=" << strerror(errno)
+            << " addr=[" << addr->toString() << "]";
+        return nullptr;
+    }
+    return sock;
+}
+
+bool TcpServer::bindFromConfig(std::vector<Address::ptr>& fails) {
+    std::vector<Address::ptr> addrs;
+    for(auto& str : g_tcp_server_address->getValue()) {
+        Address::ptr addr;
+        if(!str.empty() && str[0] == '/') {
+            addr.reset(new UnixAddress(str));
+        } else {
+            addr = Address::LookupAnyIPAddress(str, AF_UNSPEC, SOCK_STREAM);
+        }
+        if(!addr) {
+            LOG_ERROR(g_logger) << "invalid address: " << str;
+            return false;
+        }
+        addrs.push_back(addr);
+    }
+    return bind(addrs, fails);
+}
+
+void TcpServer::startAccept(size_t worker) {
+    Worker& w = *m_workers[worker];
+    t_worker_index = worker;
+    if(m_pinCpu) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(worker % (ncpu > 0 ? ncpu : 1), &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+
+    if(m_backend == IO_URING) {
+        IoUring ring;
+        if(initUring(w, ring)) {
+            uringLoop(worker, ring);
+            return;
+        }
+        LOG_ERROR(g_logger) << "worker " << worker << " io_uring init fail errno=" << errno
+            << " errstr=" << strerror(errno) << ", fall back to poll";
+    }
+
+    std::vector<pollfd> fds(w.socks.size() + 1);
+    for(size_t i = 0; i < w.socks.size(); ++i) {
+        fds[i].fd = w.socks[i]->getSocket();
+        fds[i].events = POLLIN;
+        // 就绪后 acceptBatch 不再等待，取空队列即返回
+        w.socks[i]->setRecvTimeout(0);
+    }
+    // 监听socket + eventfd 之后为子类追加的fd
+    size_t base = w.socks.size() + 1;
+    fds.back().fd = m_wakeFd;
+    fds.back().events = POLLIN;
+
+    std::vector<Socket::ptr> clients;
+    while(!m_isStop) {
+        fds.resize(base);
+        int timeout = onPollPrepare(worker, fds);
+        int rt = poll(&fds[0], fds.size(), timeout);
+        if(rt < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            LOG_ERROR(g_logger) << "poll errno=" << errno << " errstr=" << strerror(errno);
+            break;
+        }
+        if(fds[base - 1].revents) {
+            break;
+        }
+        for(size_t i = 0; i < w.socks.size(); ++i) {
+            if(!fds[i].revents) {
+                continue;
+            }
+            // accept4 直到 EAGAIN
+            while(w.socks[i]->acceptBatch(clients, ACCEPT_BATCH) == ACCEPT_BATCH) {
+            }
+        }
+        dispatchClients(w, clients);
+        onPollEvents(worker, &fds[0] + base, fds.size() - base);
+    }
+}
+
+void TcpServer::dispatchClients(Worker& w, std::vector<Socket::ptr>& clients) {
+    w.accepted.fetch_add(clients.size(), std::memory_order_relaxed);
+    for(auto& client : clients) {
+        client->setRecvTimeout(m_readTimeout);
+        if(m_keepalive && client->getFamily() != AF_UNIX) {
+            int on = 1;
+            int idle = m_keepalive;
+            client->setOption(SOL_SOCKET, SO_KEEPALIVE, on);
+            client->setOption(IPPROTO_TCP, TCP_KEEPIDLE, idle);
+        }
+        handleClient(client);
+    }
+    clients.clear();
+}
+
+bool TcpServer::initUring(Worker& w, IoUring& ring) {
+    if(!ring.init(g_tcp_server_uring_entries->getValue(), g_tcp_server_uring_sqpoll->getValue(),
+                  g_tcp_server_uring_sqpoll_idle->getValue())) {
+        return false;
+    }
+    struct rlimit rl;
+    uint32_t files = MAX_FIXED_FILES;
+    if(getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < files) {
+        files = rl.rlim_cur;
+    }
+    if(!ring.registerFiles(files)
+            || !ring.setupBufRing(URING_BUFFER_GROUP, g_tcp_server_uring_buffer_count->getValue(),
+                                  g_tcp_server_uring_buffer_size->getValue())) {
+        return false;
+    }
+    w.fixed.assign(w.socks.size(), false);
+    for(size_t i = 0; i < w.socks.size(); ++i) {
+        int fd = w.socks[i]->getSocket();
+        w.fixed[i] = ring.updateFile(fd, fd);
+        io_uring_sqe* sqe = ring.getSqe();
+        if(!sqe) {
+            errno = EBUSY;
+            return false;
+        }
+        IoUring::PrepAcceptMultishot(sqe, fd, w.fixed[i], ((uint64_t)TAG_ACCEPT << TAG_SHIFT) | i);
+    }
+    io_uring_sqe* sqe = ring.getSqe();
+    if(!sqe) {
+        errno = EBUSY;
+        return false;
+    }
+    IoUring::PrepPollAdd(sqe, m_wakeFd, POLLIN, true, (uint64_t)TAG_WAKE << TAG_SHIFT);
+    return true;
+}
+
+void TcpServer::uringLoop(size_t worker, IoUring& ring) {
+    Worker& w = *m_workers[worker];
+    t_uring = &ring;
+    // 前 base 项占位，与 poll 后端保持相同的布局
+    size_t base = w.socks.size() + 1;
+    std::vector<pollfd> fds(base);
+    for(auto& i : fds) {
+        i.fd = -1;
+        i.events = i.revents = 0;
+    }
+    // 已提交但尚未完成的 POLL_ADD，下一轮开始时撤销；未提交的为 0
+    std::vector<uint64_t> armed;
+    // SQ 已满、推迟到下一轮提交的 POLL_REMOVE 目标与 accept
+    std::vector<uint64_t> removing;
+    std::vector<uint64_t> accepting;
+    std::vector<IoUring::Completion> cqes(256);
+    std::vector<Socket::ptr> clients;
+    uint64_t round = 0;
+    bool stop = false;
+    while(!m_isStop && !stop) {
+        for(auto d : armed) {
+            if(d) {
+                removing.push_back(d);
+            }
+        }
+        armed.clear();
+        size_t keep = 0;
+        for(auto d : removing) {
+            io_uring_sqe* sqe = ring.getSqe();
+            if(sqe) {
+                IoUring::PrepPollRemove(sqe, d, (uint64_t)TAG_NONE << TAG_SHIFT);
+            } else {
+                removing[keep++] = d;
+            }
+        }
+        removing.resize(keep);
+        keep = 0;
+        for(auto d : accepting) {
+            if(!armAccept(w, ring, d)) {
+                accepting[keep++] = d;
+            }
+        }
+        accepting.resize(keep);
+        bool deferred = !removing.empty() || !accepting.empty();
+        round = (round + 1) & 0xffffff;
+        fds.resize(base);
+        int timeout = onPollPrepare(worker, fds);
+        for(size_t i = base; i < fds.size(); ++i) {
+            fds[i].revents = 0;
+            uint64_t d = ((uint64_t)TAG_POLL << TAG_SHIFT) | (round << 32) | (i - base);
+            io_uring_sqe* sqe = ring.getSqe();
+            if(!sqe) {
+                armed.push_back(0);
+                deferred = true;
+                continue;
+            }
+            IoUring::PrepPollAdd(sqe, fds[i].fd, fds[i].events, false, d);
+            armed.push_back(d);
+        }
+        if(deferred) {
+            // 本轮没能全部提交，尽快进入下一轮重试
+            LOG_WARN(g_logger) << "worker " << worker << " io_uring submission queue full";
+            if(timeout < 0 || timeout > URING_RETRY_MS) {
+                timeout = URING_RETRY_MS;
+            }
+        }
+        int rt = ring.submit(1, timeout);
+        if(rt < 0 && rt != -EBUSY && rt != -EAGAIN) {
+            LOG_ERROR(g_logger) << "io_uring_enter errno=" << -rt << " errstr=" << strerror(-rt);
+            break;
+        }
+        while(true) {
+            size_t n = ring.reap(&cqes[0], cqes.size());
+            for(size_t k = 0; k < n; ++k) {
+                const IoUring::Completion& c = cqes[k];
+                uint64_t value = c.data & TAG_VALUE_MASK;
+                switch(c.data >> TAG_SHIFT) {
+                    case TAG_ACCEPT:
+                        if(c.res >= 0) {
+                            clients.push_back(w.socks[value]->adoptAccepted(c.res));
+                        } else if(c.res != -ECANCELED) {
+                            LOG_ERROR(g_logger) << "io_uring accept(" << *w.socks[value] << ") errno="
+                                << -c.res << " errstr=" << strerror(-c.res);
+                        }
+                        if(!c.hasMore() && !m_isStop && !armAccept(w, ring, c.data)) {
+                            accepting.push_back(c.data);
+                        }
+                        break;
+                    case TAG_WAKE:
+                        stop = true;
+                        break;
+                    case TAG_POLL:
+                        if(((value >> 32) & 0xffffff) == round && (value & 0xffffffff) < armed.size()) {
+                            size_t idx = value & 0xffffffff;
+                            fds[base + idx].revents = c.res < 0 ? POLLERR : c.res;
+                            armed[idx] = 0;
+                        }
+                        break;
+                    case TAG_USER:
+                        {
+                            IoUring::Completion uc = c;
+                            uc.data = value;
+                            onUringCompletion(worker, uc);
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+            if(n < cqes.size()) {
+                break;
+            }
+        }
+        dispatchClients(w, clients);
+        onPollEvents(worker, &fds[0] + base, fds.size() - base);
+    }
+    t_uring = nullptr;
+}
+
+bool TcpServer::armAccept(Worker& w, IoUring& ring, uint64_t data) {
+    io_uring_sqe* sqe = ring.getSqe();
+    if(!sqe) {
+        return false;
+    }
+    // 与首次提交时一致：updateFile 失败的 fd 不能按固定文件提交
+    size_t i = data & TAG_VALUE_MASK;
+    IoUring::PrepAcceptMultishot(sqe, w.socks[i]->getSocket(), w.fixed[i], data);
+    return true;
+}
+
+size_t TcpServer::GetWorkerIndex() {
+    return t_worker_index;
+}
+
+IoUring* TcpServer::GetWorkerUring() {
+    return t_uring;
+}
+
+uint64_t TcpServer::MakeUringData(uint64_t v) {
+    return ((uint64_t)TAG_USER << TAG_SHIFT) | (v & TAG_VALUE_MASK);
+}
+
+bool TcpServer::start() {
+    if(!m_isStop) {
+        return true;
+    }
+    if(m_workers.empty() || m_workers[0]->socks.empty()) {
+        LOG_ERROR(g_logger) << "TcpServer::start without bound address";
+        return false;
+    }
+    uint64_t v;
+    while(read(m_wakeFd, &v, sizeof(v)) > 0) {
+    }
+    m_isStop = false;
+    TcpServer::ptr self = shared_from_this();
+    for(size_t i = 0; i < m_workers.size(); ++i) {
+        m_workers[i]->thread.reset(new Thread(std::bind(&TcpServer::startAccept, self, i),
+                    "accept_" + std::to_string(i)));
+    }
+    return true;
+}
+
+void TcpServer::stop() {
+    if(m_isStop) {
+        return;
+    }
+    m_isStop = true;
+    uint64_t one = 1;
+    if(write(m_wakeFd, &one, sizeof(one)) != sizeof(one)) {
+        LOG_ERROR(g_logger) << "TcpServer::stop wake fail errno=" << errno;
+    }
+    for(auto& w : m_workers) {
+        if(w->thread) {
+            w->thread->join();
+            w->thread.reset();
+        }
+    }
+}
+
+std::vector<Socket::ptr> TcpServer::getSocks() const {
+    std::vector<Socket::ptr> socks;
+    for(auto& w : m_workers) {
+        socks.insert(socks.end(), w->socks.begin(), w->socks.end());
+    }
+    return socks;
+}
+
+std::vector<uint64_t> TcpServer::getAcceptCounts() const {
+    std::vector<uint64_t> counts;
+    for(auto& w : m_workers) {
+        counts.push_back(w->accepted.load(std::memory_order_relaxed));
+    }
+    return counts;
+}
+
+void TcpServer::handleClient(Socket::ptr client) {
+    LOG_INFO(g_logger) << "handleClient: " << *client;
+}
+
+std::string TcpServer::toString(const std::string& prefix) {
+    std::stringstream ss;
+    ss << prefix << "[name=" << m_name
+       << " workers=" << m_workerCount
+       << " read_timeout=" << m_readTimeout
+       << " keepalive=" << m_keepalive
+       << " io_backend=" << (m_backend == IO_URING ? "io_uring" : "poll") << "]" << std::endl;
+    std::string pfx = prefix.empty() ? "    " : prefix;
+    if(!m_workers.empty()) {
+        for(auto& i : m_workers[0]->socks) {
+            ss << pfx << pfx << *i << std::endl;
+        }
+    }
+    return ss.str();
+}
+
+}
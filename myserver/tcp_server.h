@@ -0,0 +1,163 @@
+#ifndef __MYSERVER_TCP_SERVER_H__
+#define __MYSERVER_TCP_SERVER_H__
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <poll.h>
+#include "address.h"
+#include "socket.h"
+#include "thread.h"
+#include "noncopyable.h"
+#include "io_uring.h"
+
+namespace myserver {
+
+/**
+ * @brief 多 acceptor 的TCP服务器
+ * @details 每个工作线程为每个绑定地址各持有一个开启 SO_REUSEPORT 的监听socket，
+ *          由内核按四元组哈希把新连接分发到各线程的监听队列，不存在单一 acceptor 热点。
+ *          工作线程就绪后循环 accept4 直到 EAGAIN，连接在接收它的线程上交给 handleClient 处理，
+ *          不跨线程转交。开启 tcp_server.pin_cpu 时第 i 个工作线程绑定到第 i % ncpu 个CPU。
+ *          目前没有协程调度器，handleClient 在工作线程上同步执行，处理期间该线程不再 accept；
+ *          协程就位后在此处为每个连接创建协程并调度到本线程即可。
+ *          需要长连接的子类可通过 onPollPrepare / onPollEvents 把连接加入工作线程的 poll 循环。
+ *          tcp_server.io_backend 为 io_uring 时每个工作线程使用自己的 io_uring：监听socket 注册为固定文件
+ *          并提交 multishot accept，子类追加的fd以 POLL_ADD 代替 poll，提交与等待合并为一次 io_uring_enter；
+ *          子类还可以直接向工作线程的 ring 提交请求，完成时回调 onUringCompletion。
+ *          内核不支持或创建失败时退回 poll
+ */
+class TcpServer : public std::enable_shared_from_this<TcpServer>, Noncopyable {
+public:
+    typedef std::shared_ptr<TcpServer> ptr;
+
+    // 工作线程的IO多路复用方式
+    enum IoBackend {
+        POLL = 0,
+        IO_URING = 1
+    };
+
+    /**
+     * @brief 构造函数
+     * @param[in] worker_count 工作线程数，0 表示使用配置 tcp_server.workers
+     */
+    TcpServer(size_t worker_count = 0);
+    virtual ~TcpServer();
+
+    /**
+     * @brief 绑定地址，为每个工作线程各创建一个监听socket
+     * @details 端口为0时第一个socket绑定到随机端口，其余socket绑定到同一端口。
+     *          Unix 域地址不支持 SO_REUSEPORT，只创建一个监听socket由全部工作线程共享，
+     *          绑定前删除残留的socket文件
+     */
+    virtual bool bind(myserver::Address::ptr addr);
+
+    /**
+     * @brief 绑定多个地址
+     * @param[out] fails 绑定失败的地址
+     * @return 全部成功返回 true
+     */
+    virtual bool bind(const std::vector<Address::ptr>& addrs,
+                      std::vector<Address::ptr>& fails);
+
+    // 绑定配置 tcp_server.address 中的全部地址
+    bool bindFromConfig(std::vector<Address::ptr>& fails);
+
+    // 启动工作线程
+    virtual bool start();
+    // 停止服务并等待工作线程退出
+    virtual void stop();
+
+    uint64_t getReadTimeout() const { return m_readTimeout; }
+    void setReadTimeout(uint64_t v) { m_readTimeout = v; }
+    // TCP keepalive 空闲秒数，0 表示关闭
+    uint32_t getKeepalive() const { return m_keepalive; }
+    void setKeepalive(uint32_t v) { m_keepalive = v; }
+
+    std::string getName() const { return m_name; }
+    virtual void setName(const std::string& v) { m_name = v; }
+
+    size_t getWorkerCount() const { return m_workerCount; }
+    // 实际使用的IO后端，配置为 io_uring 但内核不支持时为 POLL
+    IoBackend getIoBackend() const { return m_backend; }
+    bool isStop() const { return m_isStop; }
+
+    // 各工作线程的监听socket
+    std::vector<Socket::ptr> getSocks() const;
+    // 每个工作线程累计接收的连接数
+    std::vector<uint64_t> getAcceptCounts() const;
+
+    virtual std::string toString(const std::string& prefix = "");
+protected:
+    /**
+     * @brief 处理新连接，在接收连接的工作线程上调用
+     * @details 默认实现记录日志后关闭连接
+     */
+    virtual void handleClient(Socket::ptr client);
+
+    /**
+     * @brief 工作线程每轮 poll 前调用
+     * @details 子类可在 fds 末尾追加自己管理的连接，在接收连接的线程上多路复用处理
+     * @return poll 超时(毫秒)，-1 表示不超时
+     */
+    virtual int onPollPrepare(size_t worker, std::vector<pollfd>& fds) { return -1; }
+
+    /**
+     * @brief poll 返回且新连接处理完后调用
+     * @param[in] fds onPollPrepare 追加的fd及其就绪事件，超时返回时 revents 均为0
+     */
+    virtual void onPollEvents(size_t worker, pollfd* fds, size_t size) {}
+
+    /**
+     * @brief io_uring 后端下子类提交的请求完成时调用
+     * @param[in] c 完成事件，c.data 为 MakeUringData 编码前的值
+     */
+    virtual void onUringCompletion(size_t worker, const IoUring::Completion& c) {}
+
+    // 当前工作线程序号，仅在工作线程上有效
+    static size_t GetWorkerIndex();
+    // 当前工作线程的 io_uring，poll 后端或不在工作线程上时为 nullptr
+    static IoUring* GetWorkerUring();
+    // 子类提交请求的 user_data 需经此编码，v 只能使用低60位
+    static uint64_t MakeUringData(uint64_t v);
+    // 工作线程 ring 上提供缓冲区环的缓冲区组
+    static const uint16_t URING_BUFFER_GROUP = 0;
+
+    // 工作线程主循环
+    virtual void startAccept(size_t worker);
+private:
+    struct Worker;
+    // 绑定 Unix 域地址，返回全部工作线程共享的监听socket，失败返回 nullptr
+    Socket::ptr bindUnix(Address::ptr addr);
+    // 为工作线程创建 io_uring 并提交 accept，失败返回 false
+    bool initUring(Worker& w, IoUring& ring);
+    // io_uring 后端的工作线程主循环
+    void uringLoop(size_t worker, IoUring& ring);
+    // 重新提交 multishot accept，SQ 已满返回 false
+    bool armAccept(Worker& w, IoUring& ring, uint64_t data);
+    // 设置新连接的选项后交给 handleClient
+    void dispatchClients(Worker& w, std::vector<Socket::ptr>& clients);
+private:
+    struct Worker {
+        std::vector<Socket::ptr> socks;     // 本线程的监听socket，每个绑定地址一个
+        std::vector<bool> fixed;            // socks[i] 是否已注册为 io_uring 固定文件
+        Thread::ptr thread;
+        std::atomic<uint64_t> accepted;
+        Worker() : accepted(0) {}
+    };
+private:
+    std::vector<std::unique_ptr<Worker> > m_workers;
+    size_t m_workerCount;
+    uint64_t m_readTimeout;             // 连接读超时(毫秒)
+    uint32_t m_keepalive;               // TCP keepalive 空闲秒数
+    bool m_pinCpu;                      // 工作线程是否绑定CPU
+    IoBackend m_backend;
+    std::string m_name;
+    int m_wakeFd;                       // 停止时唤醒全部工作线程的 eventfd
+    std::atomic<bool> m_isStop;
+};
+
+}
+
+#endif
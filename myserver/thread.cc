@@ -1,11 +1,12 @@
 #include "thread.h"
 #include "log.h"
 #include "util.h"
+#include "profiler.h"
+#include "fatal_signal.h"
 
 namespace myserver {
 
 static thread_local Thread* t_thread = nullptr;
-static thread_local std::string t_thread_name = "UNKNOWN";
 
 static myserver::Logger::ptr g_logger = LOGGER_NAME("system");
 
@@ -14,7 +15,7 @@ Thread* Thread::GetThis() {
 }
 
 const std::string& Thread::GetName() {
-    return t_thread_name;
+    return ThreadContext::GetThis().getName();
 }
 
 void Thread::SetName(const std::string& name) {
@@ -24,7 +25,9 @@ void Thread::SetName(const std::string& name) {
     if(t_thread) {
         t_thread->m_name = name;
     }
-    t_thread_name = name;
+    ThreadContext::GetThis().setName(name);
+    // 同步到内核线程名称，崩溃报告通过 prctl 读取
+    pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
 }
 
 Thread::Thread(std::function<void()> cb, const std::string& name)
@@ -59,10 +62,28 @@ void Thread::join() {
     }
 }
 
+namespace {
+
+// 线程体因 pthread_exit 或取消而展开时，同样注销采样分析器并释放备用信号栈
+struct ThreadRunGuard {
+    void* altstack;
+
+    ThreadRunGuard() {
+        Profiler::RegisterThread();     // 登记到采样分析器，按线程名称聚合
+        altstack = FatalSignalHandler::InstallThreadStack();  // 栈溢出时仍能输出崩溃报告
+    }
+    ~ThreadRunGuard() {
+        FatalSignalHandler::RemoveThreadStack(altstack);
+        Profiler::UnregisterThread();
+    }
+};
+
+}
+
 void* Thread::run(void* arg) {
     Thread* thread = (Thread*)arg;  // arg是this指针
     t_thread = thread;
-    t_thread_name = thread->m_name;
+    ThreadContext::GetThis().setName(thread->m_name);
     thread->m_id = myserver::GetThreadId();
     pthread_setname_np(pthread_self(), thread->m_name.substr(0, 15).c_str());   // 查看线程名称
 
@@ -71,6 +92,7 @@ void* Thread::run(void* arg) {
 
     thread->m_semaphore.notify();   // 信号量抛出
 
+    ThreadRunGuard guard;
     cb();
     return 0;
 }
@@ -2,6 +2,7 @@
 #define __MYSERVER_THREAD_H__
 
 #include <thread>
+#include <string>
 #include <functional>
 #include <memory>
 #include <pthread.h>
@@ -0,0 +1,325 @@
+#include "trace.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <fstream>
+#include <memory>
+#include <vector>
+#include "config.h"
+#include "metrics.h"
+#include "mutex.h"
+#include "queue.h"
+#include "thread.h"
+
+namespace myserver {
+
+static myserver::Logger::ptr g_logger = LOGGER_NAME("system");
+
+static myserver::ConfigVar<bool>::ptr g_trace_enable =
+    myserver::Config::Lookup("trace.enable", false, "enable TRACE_SPAN collection");
+
+static myserver::ConfigVar<std::string>::ptr g_trace_file =
+    myserver::Config::Lookup("trace.file", std::string("trace.json"), "chrome trace output file");
+
+static myserver::ConfigVar<uint32_t>::ptr g_trace_buffer_size =
+    myserver::Config::Lookup("trace.buffer_size", (uint32_t)(64 * 1024),
+            "per thread trace ring capacity(spans)");
+
+static myserver::ConfigVar<uint64_t>::ptr g_trace_flush_interval =
+    myserver::Config::Lookup("trace.flush_interval", (uint64_t)1000, "trace flush interval(ms)");
+
+static myserver::Counter::ptr g_trace_dropped =
+    myserver::Metrics::GetCounter("trace.dropped", "spans dropped because the ring was full");
+
+namespace detail {
+
+std::atomic<bool> g_trace_enabled(false);
+
+}
+
+namespace {
+
+struct TraceEvent {
+    const char* name;
+    uint64_t begin;
+    uint64_t end;
+    uint32_t fiber;
+};
+
+/**
+ * @brief 单个线程的区间缓冲(单生产者单消费者环形队列)
+ * @details 生产者为所属线程，消费者为写出线程，二者的位置各占一个缓存行；
+ *          生产者缓存消费位置，只在看似已满时才重新读取
+ */
+struct TraceBuffer {
+    typedef std::shared_ptr<TraceBuffer> ptr;
+
+    std::atomic<uint64_t> head;         // 下一个写入位置，仅所属线程修改
+    uint64_t tailCache = 0;             // 所属线程缓存的消费位置
+    char pad0[MYSERVER_CACHELINE_SIZE - sizeof(std::atomic<uint64_t>) - sizeof(uint64_t)];
+    std::atomic<uint64_t> tail;         // 下一个读取位置，仅写出线程修改
+    char pad1[MYSERVER_CACHELINE_SIZE - sizeof(std::atomic<uint64_t>)];
+
+    std::vector<TraceEvent> events;
+    uint64_t mask;
+    pid_t tid;
+    const std::string* name;            // 线程名称(驻留字符串)
+    std::atomic<bool> dead;             // 所属线程已退出
+    bool named = false;                 // 当前文件中已写出线程名称
+
+    explicit TraceBuffer(uint32_t capacity)
+        :head(0)
+        ,tail(0)
+        ,dead(false) {
+        uint64_t cap = 2;
+        while(cap < capacity) {
+            cap <<= 1;
+        }
+        events.resize(cap);
+        mask = cap - 1;
+        ThreadContext& ctx = ThreadContext::GetThis();
+        tid = ctx.getTid();
+        name = ctx.getNamePtr();
+    }
+
+    bool push(const char* n, uint64_t begin, uint64_t end) {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        if(h - tailCache > mask) {
+            tailCache = tail.load(std::memory_order_acquire);
+            if(h - tailCache > mask) {
+                return false;
+            }
+        }
+        TraceEvent& e = events[h & mask];
+        e.name = n;
+        e.begin = begin;
+        e.end = end;
+        e.fiber = ThreadContext::GetThis().getFiberId();
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+// 线程退出时标记缓冲，写出线程取空后将其移除
+struct TraceBufferHolder {
+    TraceBuffer::ptr buffer;
+    ~TraceBufferHolder() {
+        if(buffer) {
+            buffer->dead.store(true, std::memory_order_release);
+        }
+    }
+};
+
+thread_local TraceBuffer* t_buffer = nullptr;
+thread_local TraceBufferHolder t_holder;
+
+struct TraceState {
+    Mutex mutex;                                // 保护 buffers
+    std::vector<TraceBuffer::ptr> buffers;
+
+    Mutex controlMutex;                         // 串行化 Start/Stop
+    Thread::ptr writer;
+    Semaphore stop;
+
+    Mutex fileMutex;                            // 保护以下写出状态
+    std::ofstream out;
+    bool first = true;
+    pid_t pid = 0;
+    uint64_t written = 0;
+    uint64_t ns0 = 0;                           // 开始采集的单调时钟纳秒，作为 ts 的零点
+};
+
+TraceState& GetTraceState() {
+    static TraceState* s_state = new TraceState;
+    return *s_state;
+}
+
+void AppendJsonString(std::string& out, const char* str) {
+    out.push_back('"');
+    for(const char* p = str; *p; ++p) {
+        char c = *p;
+        if(c == '"' || c == '\\') {
+            out.push_back('\\');
+            out.push_back(c);
+        } else if((unsigned char)c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out.append(buf);
+        } else {
+            out.push_back(c);
+        }
+    }
+    out.push_back('"');
+}
+
+// 取出全部缓冲中的区间并写入文件，调用方持有 fileMutex
+void DrainLocked(TraceState& st) {
+    std::vector<TraceBuffer::ptr> buffers;
+    {
+        Mutex::Lock lock(st.mutex);
+        buffers = st.buffers;
+    }
+    std::string out;
+    char buf[256];
+    for(auto& b : buffers) {
+        bool dead = b->dead.load(std::memory_order_acquire);
+        uint64_t t = b->tail.load(std::memory_order_relaxed);
+        uint64_t h = b->head.load(std::memory_order_acquire);
+        if(t != h && !b->named) {
+            out.append(st.first ? "\n" : ",\n");
+            st.first = false;
+            snprintf(buf, sizeof(buf), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":",
+                     st.pid, b->tid);
+            out.append(buf);
+            AppendJsonString(out, b->name->c_str());
+            out.append("}}");
+            b->named = true;
+        }
+        for(; t != h; ++t) {
+            const TraceEvent& e = b->events[t & b->mask];
+            double begin = (double)(int64_t)(Clock::TicksToNs(e.begin) - st.ns0);
+            double dur = (double)(int64_t)(Clock::TicksToNs(e.end) - Clock::TicksToNs(e.begin));
+            if(begin < 0) {
+                begin = 0;
+            }
+            if(dur < 0) {
+                dur = 0;
+            }
+            out.append(st.first ? "\n{\"name\":" : ",\n{\"name\":");
+            st.first = false;
+            AppendJsonString(out, e.name);
+            snprintf(buf, sizeof(buf), ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d,\"args\":{\"fiber\":%u}}",
+                     begin / 1000, dur / 1000, st.pid, b->tid, e.fiber);
+            out.append(buf);
+            ++st.written;
+        }
+        b->tail.store(h, std::memory_order_release);
+        if(dead && h == b->head.load(std::memory_order_acquire)) {
+            Mutex::Lock lock(st.mutex);
+            for(auto it = st.buffers.begin(); it != st.buffers.end(); ++it) {
+                if(*it == b) {
+                    st.buffers.erase(it);
+                    break;
+                }
+            }
+        }
+    }
+    if(!out.empty() && st.out.is_open()) {
+        st.out << out;
+        st.out.flush();
+    }
+}
+
+}
+
+namespace detail {
+
+void TraceRecord(const char* name, uint64_t begin, uint64_t end) {
+    TraceBuffer* b = t_buffer;
+    if(!b) {
+        TraceState& st = GetTraceState();
+        TraceBuffer::ptr buffer(new TraceBuffer(g_trace_buffer_size->getValue()));
+        {
+            Mutex::Lock lock(st.mutex);
+            st.buffers.push_back(buffer);
+        }
+        t_holder.buffer = buffer;
+        t_buffer = b = buffer.get();
+    }
+    if(!b->push(name, begin, end)) {
+        g_trace_dropped->inc();
+    }
+}
+
+}
+
+bool Tracer::Start(const std::string& path) {
+    TraceState& st = GetTraceState();
+    Mutex::Lock lock(st.controlMutex);
+    if(st.writer) {
+        return false;
+    }
+    std::string file = path.empty() ? g_trace_file->getValue() : path;
+    {
+        Mutex::Lock flock(st.fileMutex);
+        st.out.open(file, std::ios::out | std::ios::trunc);
+        if(!st.out.is_open()) {
+            LOG_ERROR(g_logger) << "Tracer::Start open " << file << " failed";
+            return false;
+        }
+        st.out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        st.first = true;
+        st.pid = getpid();
+        st.written = 0;
+        st.ns0 = Clock::TicksToNs(Clock::Ticks());
+        // 丢弃上一次采集残留的区间
+        Mutex::Lock lock(st.mutex);
+        for(auto& b : st.buffers) {
+            b->tail.store(b->head.load(std::memory_order_acquire), std::memory_order_release);
+            b->named = false;
+        }
+    }
+    uint64_t interval = g_trace_flush_interval->getValue();
+    st.writer.reset(new Thread([&st, interval]() {
+        while(!st.stop.waitFor(interval)) {
+            Mutex::Lock lock(st.fileMutex);
+            DrainLocked(st);
+        }
+    }, "trace_flush"));
+    detail::g_trace_enabled.store(true, std::memory_order_relaxed);
+    LOG_INFO(g_logger) << "Tracer started, file=" << file;
+    return true;
+}
+
+void Tracer::Stop() {
+    TraceState& st = GetTraceState();
+    Mutex::Lock lock(st.controlMutex);
+    if(!st.writer) {
+        return;
+    }
+    detail::g_trace_enabled.store(false, std::memory_order_relaxed);
+    st.stop.notify();
+    st.writer->join();
+    st.writer.reset();
+
+    Mutex::Lock flock(st.fileMutex);
+    DrainLocked(st);
+    st.out << "\n]}\n";
+    st.out.close();
+    LOG_INFO(g_logger) << "Tracer stopped, spans=" << st.written
+        << " dropped=" << g_trace_dropped->value();
+}
+
+void Tracer::Flush() {
+    TraceState& st = GetTraceState();
+    Mutex::Lock lock(st.fileMutex);
+    if(st.out.is_open()) {
+        DrainLocked(st);
+    }
+}
+
+uint64_t Tracer::GetDropped() {
+    return g_trace_dropped->value();
+}
+
+uint64_t Tracer::GetWritten() {
+    TraceState& st = GetTraceState();
+    Mutex::Lock lock(st.fileMutex);
+    return st.written;
+}
+
+struct TraceIniter {
+    TraceIniter() {
+        g_trace_enable->addListener(0x7A4CE001,
+            [](const bool& old_value, const bool& new_value) {
+            if(new_value) {
+                Tracer::Start();
+            } else {
+                Tracer::Stop();
+            }
+        });
+    }
+};
+
+static TraceIniter __trace_init;
+
+}
@@ -0,0 +1,87 @@
+#ifndef __MYSERVER_TRACE_H__
+#define __MYSERVER_TRACE_H__
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include "clock.h"
+#include "util.h"
+
+#define MYSERVER_TRACE_CONCAT_IMPL(a, b) a##b
+#define MYSERVER_TRACE_CONCAT(a, b) MYSERVER_TRACE_CONCAT_IMPL(a, b)
+
+/**
+ * @brief 记录当前作用域的耗时区间
+ * @details name 必须是字符串字面量(或生命周期覆盖整个进程的字符串)，只保存其指针。
+ *          关闭采集时只有一次分支判断
+ */
+#define TRACE_SPAN(name) \
+    myserver::TraceSpan MYSERVER_TRACE_CONCAT(__trace_span_, __LINE__)(name)
+
+namespace myserver {
+
+namespace detail {
+
+extern std::atomic<bool> g_trace_enabled;
+
+// 把一个完成的区间写入当前线程的环形缓冲，缓冲已满时丢弃并计数
+void TraceRecord(const char* name, uint64_t begin, uint64_t end);
+
+}
+
+/**
+ * @brief 作用域区间
+ * @details 构造时若采集已开启则记下开始时间，析构时把 [begin, end] 与协程id写入本线程缓冲
+ */
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name) {
+        if(detail::g_trace_enabled.load(std::memory_order_relaxed)) {
+            m_name = name;
+            m_begin = Clock::Ticks();
+        }
+    }
+    ~TraceSpan() {
+        if(m_name) {
+            detail::TraceRecord(m_name, m_begin, Clock::Ticks());
+        }
+    }
+private:
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+private:
+    const char* m_name = nullptr;
+    uint64_t m_begin = 0;
+};
+
+/**
+ * @brief 区间采集与 Chrome trace 导出
+ * @details 每个线程首次记录时创建一个单生产者单消费者的环形缓冲(容量 trace.buffer_size)，
+ *          后台线程每隔 trace.flush_interval 取出全部缓冲中的区间，
+ *          以 Chrome/Perfetto 的 JSON 格式("ph":"X" 完整事件)追加写入文件。
+ *          配置 trace.enable 变化时自动 Start/Stop
+ */
+class Tracer {
+public:
+    static bool IsEnabled() { return detail::g_trace_enabled.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 打开输出文件、启动写出线程并开启采集
+     * @param[in] path 输出文件，为空时使用配置 trace.file
+     * @return 已在采集或文件打开失败时返回 false
+     */
+    static bool Start(const std::string& path = "");
+    // 关闭采集，写出剩余区间并结束文件
+    static void Stop();
+    // 立即写出各线程缓冲中的区间
+    static void Flush();
+
+    // 缓冲满而丢弃的区间数
+    static uint64_t GetDropped();
+    // 已写出的区间数
+    static uint64_t GetWritten();
+};
+
+}
+
+#endif
@@ -1,14 +1,72 @@
 #include "util.h"
+#include <set>
+#include <atomic>
+#include <pthread.h>
+#include "mutex.h"
 
 
 namespace myserver {
 
+static std::atomic<uint32_t> s_thread_seq(0);
+
+thread_local ThreadContext ThreadContext::t_context;
+
+ThreadContext::ThreadContext()
+    :m_tid(syscall(SYS_gettid))
+    ,m_seq(s_thread_seq.fetch_add(1, std::memory_order_relaxed))
+    ,m_name(Intern("UNKNOWN")) {
+}
+
+void ThreadContext::setName(const std::string& name) {
+    m_name = Intern(name);
+}
+
+// 有意不释放：线程退出或进程析构阶段仍可能有日志引用这些名称
+static Mutex& InternMutex() {
+    static Mutex* s_mutex = new Mutex;
+    return *s_mutex;
+}
+
+const std::string* ThreadContext::Intern(const std::string& str) {
+    static std::set<std::string>* s_names = new std::set<std::string>;
+    Mutex::Lock lock(InternMutex());
+    return &*s_names->insert(str).first;
+}
+
+// fork 时持有驻留锁，避免子进程继承其他线程持有中的锁
+void ThreadContext::OnForkPrepare() {
+    InternMutex().lock();
+}
+
+void ThreadContext::OnForkParent() {
+    InternMutex().unlock();
+}
+
+// 子进程中调用 fork 的线程获得了新的线程id，其余线程不复存在
+void ThreadContext::OnForkChild() {
+    InternMutex().unlock();
+    t_context.m_tid = syscall(SYS_gettid);
+}
+
+namespace {
+
+struct ThreadContextIniter {
+    ThreadContextIniter() {
+        pthread_atfork(&ThreadContext::OnForkPrepare, &ThreadContext::OnForkParent,
+                       &ThreadContext::OnForkChild);
+    }
+};
+
+ThreadContextIniter __thread_context_init;
+
+}
+
 pid_t GetThreadId(){
-    return syscall(SYS_gettid);
+    return ThreadContext::GetThis().getTid();
 }
 
 uint32_t GetFiberId(){
-    return 0;
+    return ThreadContext::GetThis().getFiberId();
 }
 
-}
\ No newline at end of file
+}
@@ -4,9 +4,47 @@
 #include <unistd.h>
 #include <sys/syscall.h>
 #include <cstdint>
+#include <string>
 
 namespace myserver {
 
+/**
+ * @brief 线程上下文：每个线程首次访问时缓存一次线程id、线程序号，之后只读线程局部变量
+ * @details fork 后子进程中调用 fork 的线程通过 pthread_atfork 刷新缓存的线程id；线程名称被驻留(intern)为进程内永不释放的字符串，日志事件只保存其指针，
+ *          因此跨线程格式化日志时无需拷贝也不会悬空
+ */
+class ThreadContext {
+public:
+    ThreadContext();
+
+    // 获取当前线程的上下文
+    static ThreadContext& GetThis() { return t_context; }
+
+    pid_t getTid() const { return m_tid; }
+    uint32_t getSeq() const { return m_seq; }
+    uint32_t getFiberId() const { return m_fiberId; }
+    const std::string& getName() const { return *m_name; }
+    const std::string* getNamePtr() const { return m_name; }
+
+    void setName(const std::string& name);
+    void setFiberId(uint32_t id) { m_fiberId = id; }
+
+    // 返回驻留后的字符串，相同内容返回同一地址
+    static const std::string* Intern(const std::string& str);
+
+    // pthread_atfork 回调
+    static void OnForkPrepare();
+    static void OnForkParent();
+    static void OnForkChild();
+private:
+    pid_t m_tid;                    // 内核线程id
+    uint32_t m_seq;                 // 线程序号，按首次访问顺序从0递增
+    uint32_t m_fiberId = 0;         // 当前协程id
+    const std::string* m_name;      // 线程名称(驻留字符串)
+
+    static thread_local ThreadContext t_context;
+};
+
 pid_t GetThreadId();
 uint32_t GetFiberId();
 
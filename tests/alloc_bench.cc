@@ -0,0 +1,164 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <sched.h>
+#include "thread.h"
+#include "queue.h"
+#include "allocator.h"
+
+// 分配器基准：glibc malloc/free 对比 SlabAllocator
+// 1. local: 每个线程在本线程内成对分配/释放(保持少量存活对象)
+// 2. cross: 一半线程分配、另一半线程释放，对象经 MPMCQueue 跨线程传递
+// 用法: alloc_bench [ops_per_thread=1000000] [max_threads=8]
+
+namespace {
+
+inline uint64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Malloc {
+    static void* Allocate(size_t n) { return malloc(n); }
+    static void Deallocate(void* p, size_t) { free(p); }
+};
+
+struct Slab {
+    static void* Allocate(size_t n) { return myserver::SlabAllocator::Allocate(n); }
+    static void Deallocate(void* p, size_t n) { myserver::SlabAllocator::Deallocate(p, n); }
+};
+
+template<class A>
+double runLocal(int threads, size_t size, int ops) {
+    std::vector<myserver::Thread::ptr> thrs;
+    std::atomic<int> ready(0);
+    std::atomic<bool> start(false);
+    for(int t = 0; t < threads; ++t) {
+        thrs.push_back(myserver::Thread::ptr(new myserver::Thread([&]() {
+            const int WINDOW = 64;      // 每个线程保持的存活对象数
+            void* slots[WINDOW] = {0};
+            ready.fetch_add(1);
+            while(!start.load(std::memory_order_acquire)) {
+                sched_yield();
+            }
+            for(int i = 0; i < ops; ++i) {
+                int k = i % WINDOW;
+                A::Deallocate(slots[k], size);
+                slots[k] = A::Allocate(size);
+                *(volatile char*)slots[k] = 1;
+            }
+            for(int k = 0; k < WINDOW; ++k) {
+                A::Deallocate(slots[k], size);
+            }
+        }, "AB_L" + std::to_string(t))));
+    }
+    while(ready.load() != threads) {
+        sched_yield();
+    }
+    uint64_t begin = NowNs();
+    start.store(true, std::memory_order_release);
+    for(auto& i : thrs) {
+        i->join();
+    }
+    return (NowNs() - begin) / 1e9;
+}
+
+template<class A>
+double runCross(int pairs, size_t size, int ops) {
+    std::vector<myserver::Thread::ptr> thrs;
+    std::vector<std::shared_ptr<myserver::MPMCQueue<void*> > > queues;
+    std::atomic<int> ready(0);
+    std::atomic<bool> start(false);
+    for(int t = 0; t < pairs; ++t) {
+        std::shared_ptr<myserver::MPMCQueue<void*> > q(new myserver::MPMCQueue<void*>(4096));
+        queues.push_back(q);
+        thrs.push_back(myserver::Thread::ptr(new myserver::Thread([&, q]() {
+            ready.fetch_add(1);
+            while(!start.load(std::memory_order_acquire)) {
+                sched_yield();
+            }
+            for(int i = 0; i < ops; ++i) {
+                void* p = A::Allocate(size);
+                while(!q->tryPush(p)) {
+                    sched_yield();
+                }
+            }
+        }, "AB_P" + std::to_string(t))));
+        thrs.push_back(myserver::Thread::ptr(new myserver::Thread([&, q]() {
+            ready.fetch_add(1);
+            while(!start.load(std::memory_order_acquire)) {
+                sched_yield();
+            }
+            void* p;
+            for(int i = 0; i < ops;) {
+                if(q->tryPop(p)) {
+                    A::Deallocate(p, size);
+                    ++i;
+                } else {
+                    sched_yield();
+                }
+            }
+        }, "AB_C" + std::to_string(t))));
+    }
+    while(ready.load() != pairs * 2) {
+        sched_yield();
+    }
+    uint64_t begin = NowNs();
+    start.store(true, std::memory_order_release);
+    for(auto& i : thrs) {
+        i->join();
+    }
+    return (NowNs() - begin) / 1e9;
+}
+
+std::string toJson(const std::string& mode, const std::string& alloc,
+                   int threads, size_t size, uint64_t pairs, double sec) {
+    std::stringstream ss;
+    ss << "{\"mode\":\"" << mode << "\""
+       << ",\"allocator\":\"" << alloc << "\""
+       << ",\"threads\":" << threads
+       << ",\"size\":" << size
+       << ",\"pairs\":" << pairs
+       << ",\"seconds\":" << sec
+       << ",\"pairs_per_sec\":" << (uint64_t)(pairs / sec)
+       << ",\"ns_per_pair\":" << sec * 1e9 / pairs << "}";
+    return ss.str();
+}
+
+}
+
+int main(int argc, char** argv) {
+    int ops = argc > 1 ? atoi(argv[1]) : 1000000;
+    int max_threads = argc > 2 ? atoi(argv[2]) : 8;
+    std::vector<std::string> lines;
+
+    for(size_t size : {32, 256, 1024}) {
+        for(int t = 1; t <= max_threads; t *= 2) {
+            uint64_t pairs = (uint64_t)t * ops;
+            lines.push_back(toJson("local", "malloc", t, size, pairs, runLocal<Malloc>(t, size, ops)));
+            lines.push_back(toJson("local", "slab", t, size, pairs, runLocal<Slab>(t, size, ops)));
+        }
+        for(int t = 2; t <= max_threads; t *= 2) {
+            uint64_t pairs = (uint64_t)(t / 2) * ops;
+            lines.push_back(toJson("cross", "malloc", t, size, pairs, runCross<Malloc>(t / 2, size, ops)));
+            lines.push_back(toJson("cross", "slab", t, size, pairs, runCross<Slab>(t / 2, size, ops)));
+        }
+    }
+
+    myserver::AllocatorStats stats = myserver::SlabAllocator::GetStats();
+    std::cout << "{\"hardware_threads\":" << std::thread::hardware_concurrency()
+              << ",\"ops_per_thread\":" << ops
+              << ",\"slab_stats\":{\"live_objects\":" << stats.live_objects
+              << ",\"cached_bytes\":" << stats.cached_bytes
+              << ",\"reserved_bytes\":" << stats.reserved_bytes << "}"
+              << ",\"results\":[" << std::endl;
+    for(size_t i = 0; i < lines.size(); ++i) {
+        std::cout << "  " << lines[i] << (i + 1 < lines.size() ? "," : "") << std::endl;
+    }
+    std::cout << "]}" << std::endl;
+    return 0;
+}
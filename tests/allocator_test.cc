@@ -0,0 +1,124 @@
+#include <iostream>
+#include <vector>
+#include <map>
+#include <string>
+#include <cassert>
+#include <sched.h>
+#include "thread.h"
+#include "queue.h"
+#include "allocator.h"
+
+// SlabAllocator / ObjectPool / SlabStlAllocator 功能测试
+
+struct Payload {
+    static int s_alive;
+    int a;
+    std::string b;
+    Payload(int a_, const std::string& b_) : a(a_), b(b_) { ++s_alive; }
+    ~Payload() { --s_alive; }
+};
+int Payload::s_alive = 0;
+
+void testSizeClass() {
+    typedef myserver::SlabAllocator SA;
+    assert(SA::SizeClass(0) == 0 && SA::SizeClass(1) == 0 && SA::SizeClass(16) == 0);
+    assert(SA::SizeClass(17) == 1 && SA::SizeClass(256) == 15);
+    assert(SA::SizeClass(257) == 16 && SA::ClassSize(16) == 320);
+    assert(SA::SizeClass(4096) == SA::NUM_CLASSES - 1 && SA::ClassSize(SA::NUM_CLASSES - 1) == 4096);
+    assert(SA::SizeClass(4097) == -1);
+    for(size_t s = 1; s <= SA::MAX_SIZE; ++s) {
+        int cls = SA::SizeClass(s);
+        assert(SA::ClassSize(cls) >= s);
+        assert(cls == 0 || SA::ClassSize(cls - 1) < s);
+    }
+    std::cout << "testSizeClass ok" << std::endl;
+}
+
+void testObjectPool() {
+    int64_t live = myserver::SlabAllocator::GetStats().live_objects;
+    Payload* p = myserver::ObjectPool<Payload>::New(1, "x");
+    assert(p->a == 1 && p->b == "x" && Payload::s_alive == 1);
+    assert(((uintptr_t)p & (myserver::SlabAllocator::ALIGNMENT - 1)) == 0);
+    assert(myserver::SlabAllocator::GetStats().live_objects == live + 1);
+    myserver::ObjectPool<Payload>::Delete(p);
+    assert(Payload::s_alive == 0);
+
+    {
+        std::shared_ptr<Payload> sp = myserver::ObjectPool<Payload>::MakeShared(2, "y");
+        std::shared_ptr<Payload> sp2 = sp;
+        assert(sp2->a == 2 && Payload::s_alive == 1);
+    }
+    assert(Payload::s_alive == 0);
+    assert(myserver::SlabAllocator::GetStats().live_objects == live);
+
+    // 释放后的对象被同线程立即复用
+    void* a = myserver::SlabAllocator::Allocate(100);
+    myserver::SlabAllocator::Deallocate(a, 100);
+    void* b = myserver::SlabAllocator::Allocate(112);
+    assert(a == b);
+    myserver::SlabAllocator::Deallocate(b, 112);
+    std::cout << "testObjectPool ok" << std::endl;
+}
+
+void testStlAllocator() {
+    std::vector<int, myserver::SlabStlAllocator<int> > vec;
+    for(int i = 0; i < 10000; ++i) {
+        vec.push_back(i);       // 超过 MAX_SIZE 后转为 malloc
+    }
+    assert(vec[9999] == 9999);
+
+    typedef std::pair<const int, std::string> Value;
+    std::map<int, std::string, std::less<int>, myserver::SlabStlAllocator<Value> > m;
+    for(int i = 0; i < 1000; ++i) {
+        m[i] = std::to_string(i);
+    }
+    assert(m.size() == 1000 && m[500] == "500");
+    assert(myserver::SlabAllocator::GetStats().large_allocs > 0);
+    std::cout << "testStlAllocator ok" << std::endl;
+}
+
+// 生产者线程分配、消费者线程释放，对象经中心链表回流
+void testCrossThread() {
+    const int N = 200000;
+    int64_t live = myserver::SlabAllocator::GetStats().live_objects;
+    myserver::MPMCQueue<Payload*> q(1024);
+    myserver::Thread::ptr producer(new myserver::Thread([&]() {
+        for(int i = 0; i < N;) {
+            Payload* p = myserver::ObjectPool<Payload>::New(i, "cross");
+            while(!q.tryPush(p)) {
+                sched_yield();
+            }
+            ++i;
+        }
+    }, "ALLOC_P"));
+    myserver::Thread::ptr consumer(new myserver::Thread([&]() {
+        int expect = 0;
+        while(expect < N) {
+            Payload* p;
+            if(!q.tryPop(p)) {
+                sched_yield();
+                continue;
+            }
+            assert(p->a == expect && p->b == "cross");
+            ++expect;
+            myserver::ObjectPool<Payload>::Delete(p);
+        }
+    }, "ALLOC_C"));
+    producer->join();
+    consumer->join();
+
+    myserver::AllocatorStats stats = myserver::SlabAllocator::GetStats();
+    assert(stats.live_objects == live);
+    assert(stats.cached_bytes <= stats.reserved_bytes);
+    std::cout << "testCrossThread ok live=" << stats.live_objects
+              << " cached_bytes=" << stats.cached_bytes
+              << " reserved_bytes=" << stats.reserved_bytes << std::endl;
+}
+
+int main(int argc, char** argv) {
+    testSizeClass();
+    testObjectPool();
+    testStlAllocator();
+    testCrossThread();
+    return 0;
+}
@@ -0,0 +1,152 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <arpa/inet.h>
+#include "bytearray.h"
+
+// ByteArray 编解码吞吐基准，对照组为逐字段 std::string::append 的朴素实现
+// 每条记录: Fuint32 + varint64 + zigzag varint32 + 带 varint 长度前缀的字符串
+// 用法: bytearray_bench [records=1000000]
+
+namespace {
+
+inline uint64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Record {
+    uint32_t id;
+    uint64_t ts;
+    int32_t delta;
+    std::string name;
+};
+
+// 朴素实现：每个字段单独 append，解码时按下标逐字节解析
+struct NaiveCodec {
+    static void putVarint(std::string& out, uint64_t v) {
+        while(v >= 0x80) {
+            out.push_back((char)((v & 0x7F) | 0x80));
+            v >>= 7;
+        }
+        out.push_back((char)v);
+    }
+
+    static uint64_t getVarint(const std::string& in, size_t& pos) {
+        uint64_t result = 0;
+        for(int i = 0; i < 64; i += 7) {
+            uint8_t b = in.at(pos++);
+            result |= (uint64_t)(b & 0x7F) << i;
+            if(b < 0x80) {
+                break;
+            }
+        }
+        return result;
+    }
+
+    static void encode(std::string& out, const Record& r) {
+        uint32_t id = htonl(r.id);
+        out.append((const char*)&id, sizeof(id));
+        putVarint(out, r.ts);
+        putVarint(out, ((uint32_t)r.delta << 1) ^ (uint32_t)(r.delta >> 31));
+        putVarint(out, r.name.size());
+        out.append(r.name);
+    }
+
+    static void decode(const std::string& in, size_t& pos, Record& r) {
+        uint32_t id;
+        memcpy(&id, in.data() + pos, sizeof(id));
+        pos += sizeof(id);
+        r.id = ntohl(id);
+        r.ts = getVarint(in, pos);
+        uint32_t z = getVarint(in, pos);
+        r.delta = (int32_t)((z >> 1) ^ (~(z & 1) + 1));
+        size_t len = getVarint(in, pos);
+        r.name = in.substr(pos, len);
+        pos += len;
+    }
+};
+
+std::string toJson(const std::string& codec, const std::string& op,
+                   size_t records, size_t bytes, double sec) {
+    std::stringstream ss;
+    ss << "{\"codec\":\"" << codec << "\""
+       << ",\"op\":\"" << op << "\""
+       << ",\"records\":" << records
+       << ",\"bytes\":" << bytes
+       << ",\"seconds\":" << sec
+       << ",\"records_per_sec\":" << (uint64_t)(records / sec)
+       << ",\"mb_per_sec\":" << bytes / sec / 1024 / 1024 << "}";
+    return ss.str();
+}
+
+}
+
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? atoi(argv[1]) : 1000000;
+    std::vector<Record> records(n);
+    for(size_t i = 0; i < n; ++i) {
+        records[i].id = i;
+        records[i].ts = 1700000000000ull + i * 7;
+        records[i].delta = (int32_t)(rand() % 2001) - 1000;
+        records[i].name = "user_" + std::to_string(rand() % 100000);
+    }
+    std::vector<std::string> lines;
+    uint64_t checksum = 0;
+
+    {
+        std::string buf;
+        uint64_t begin = NowNs();
+        for(auto& r : records) {
+            NaiveCodec::encode(buf, r);
+        }
+        lines.push_back(toJson("std::string", "encode", n, buf.size(), (NowNs() - begin) / 1e9));
+
+        Record r;
+        size_t pos = 0;
+        begin = NowNs();
+        for(size_t i = 0; i < n; ++i) {
+            NaiveCodec::decode(buf, pos, r);
+            checksum += r.id + r.name.size();
+        }
+        lines.push_back(toJson("std::string", "decode", n, buf.size(), (NowNs() - begin) / 1e9));
+    }
+
+    for(size_t base_size : {4096, 65536}) {
+        std::string codec = "ByteArray(" + std::to_string(base_size) + ")";
+        myserver::ByteArray ba(base_size);
+        uint64_t begin = NowNs();
+        for(auto& r : records) {
+            ba.writeFuint32(r.id);
+            ba.writeUint64(r.ts);
+            ba.writeInt32(r.delta);
+            ba.writeStringVint(r.name);
+        }
+        lines.push_back(toJson(codec, "encode", n, ba.getSize(), (NowNs() - begin) / 1e9));
+
+        ba.setPosition(0);
+        Record r;
+        begin = NowNs();
+        for(size_t i = 0; i < n; ++i) {
+            r.id = ba.readFuint32();
+            r.ts = ba.readUint64();
+            r.delta = ba.readInt32();
+            r.name = ba.readStringVint();
+            checksum += r.id + r.name.size();
+        }
+        lines.push_back(toJson(codec, "decode", n, ba.getSize(), (NowNs() - begin) / 1e9));
+    }
+
+    std::cout << "{\"records\":" << n
+              << ",\"checksum\":" << checksum
+              << ",\"results\":[" << std::endl;
+    for(size_t i = 0; i < lines.size(); ++i) {
+        std::cout << "  " << lines[i] << (i + 1 < lines.size() ? "," : "") << std::endl;
+    }
+    std::cout << "]}" << std::endl;
+    return 0;
+}
@@ -0,0 +1,215 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include "bytearray.h"
+
+// ByteArray 功能测试：用较小的块大小覆盖跨块读写
+
+template<class T, class W, class R>
+void roundTrip(const char* name, W write, R read, size_t base_size) {
+    std::vector<T> vec;
+    for(int i = 0; i < 100; ++i) {
+        vec.push_back((T)((uint64_t)rand() * rand() * (i % 2 ? 1 : -1)));
+    }
+    vec.push_back(std::numeric_limits<T>::max());
+    vec.push_back(std::numeric_limits<T>::min());
+    vec.push_back(0);
+
+    myserver::ByteArray::ptr ba(new myserver::ByteArray(base_size));
+    for(auto& i : vec) {
+        (ba.get()->*write)(i);
+    }
+    ba->setPosition(0);
+    for(size_t i = 0; i < vec.size(); ++i) {
+        T v = (ba.get()->*read)();
+        assert(v == vec[i]);
+    }
+    assert(ba->getReadSize() == 0);
+
+    // 不同字节序同样可以往返
+    myserver::ByteArray::ptr le(new myserver::ByteArray(base_size));
+    le->setIsLittleEndian(true);
+    for(auto& i : vec) {
+        (le.get()->*write)(i);
+    }
+    le->setPosition(0);
+    for(size_t i = 0; i < vec.size(); ++i) {
+        assert((le.get()->*read)() == vec[i]);
+    }
+    (void)name;
+}
+
+#define XX(type, write, read) \
+    roundTrip<type>(#write, &myserver::ByteArray::write, &myserver::ByteArray::read, base_size);
+
+void testIntegers() {
+    for(size_t base_size : {1, 3, 7, 4096}) {
+        XX(int8_t, writeFint8, readFint8);
+        XX(uint8_t, writeFuint8, readFuint8);
+        XX(int16_t, writeFint16, readFint16);
+        XX(uint16_t, writeFuint16, readFuint16);
+        XX(int32_t, writeFint32, readFint32);
+        XX(uint32_t, writeFuint32, readFuint32);
+        XX(int64_t, writeFint64, readFint64);
+        XX(uint64_t, writeFuint64, readFuint64);
+        XX(int32_t, writeInt32, readInt32);
+        XX(uint32_t, writeUint32, readUint32);
+        XX(int64_t, writeInt64, readInt64);
+        XX(uint64_t, writeUint64, readUint64);
+    }
+    std::cout << "testIntegers ok" << std::endl;
+}
+
+#undef XX
+
+void testEncoding() {
+    myserver::ByteArray ba;
+    ba.writeFuint32(0x01020304);
+    assert(ba.toHexString() == "");
+    ba.setPosition(0);
+    assert(ba.toHexString() == "01 02 03 04 ");
+    ba.clear();
+    ba.setIsLittleEndian(true);
+    ba.writeFuint32(0x01020304);
+    ba.setPosition(0);
+    assert(ba.toHexString() == "04 03 02 01 ");
+
+    // varint 每字节7位，zigzag 让小的负数也只占1字节
+    ba.clear();
+    ba.writeUint32(300);
+    ba.writeInt32(-1);
+    ba.writeInt64(-64);
+    ba.writeUint64(std::numeric_limits<uint64_t>::max());
+    assert(ba.getSize() == 2 + 1 + 1 + 10);
+    ba.setPosition(0);
+    assert(ba.toHexString().substr(0, 12) == "ac 02 01 7f ");
+    std::cout << "testEncoding ok" << std::endl;
+}
+
+void testStringsAndFloats() {
+    myserver::ByteArray ba(5);
+    std::string big(1000, 'x');
+    ba.writeStringF16("hello");
+    ba.writeStringF32("");
+    ba.writeStringF64(big);
+    ba.writeStringVint("varint");
+    ba.writeFloat(3.5f);
+    ba.writeDouble(-1.25e100);
+    ba.writeStringWithoutLength("tail");
+    ba.setPosition(0);
+    assert(ba.readStringF16() == "hello");
+    assert(ba.readStringF32() == "");
+    assert(ba.readStringF64() == big);
+    assert(ba.readStringVint() == "varint");
+    assert(ba.readFloat() == 3.5f);
+    assert(ba.readDouble() == -1.25e100);
+    assert(ba.toString() == "tail");
+
+    bool thrown = false;
+    try {
+        ba.readFint64();
+    } catch(std::out_of_range&) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    // 畸形长度在分配前即被拒绝
+    myserver::ByteArray bad(5);
+    bad.writeFuint32(0xFFFFFFF0);
+    bad.writeStringWithoutLength("abc");
+    bad.setPosition(0);
+    thrown = false;
+    try {
+        bad.readStringF32();
+    } catch(std::out_of_range&) {
+        thrown = true;
+    }
+    assert(thrown);
+    std::cout << "testStringsAndFloats ok" << std::endl;
+}
+
+// 通过 iovec 与 readv/writev 对接
+void testIovec() {
+    int fds[2];
+    assert(pipe(fds) == 0);
+
+    myserver::ByteArray out(7);
+    std::string data;
+    for(int i = 0; i < 1000; ++i) {
+        data += (char)('a' + i % 26);
+    }
+    out.writeStringWithoutLength(data);
+    out.setPosition(0);
+    std::vector<iovec> iovs;
+    assert(out.getReadBuffers(iovs, 1000) == 1000);
+    assert(iovs.size() > 1);
+    assert(writev(fds[1], &iovs[0], iovs.size()) == 1000);
+
+    myserver::ByteArray in(11);
+    iovs.clear();
+    assert(in.getWriteBuffers(iovs, 1000) == 1000);
+    size_t got = 0;
+    while(got < 1000) {
+        std::vector<iovec> rest;
+        size_t skip = got;
+        for(auto& v : iovs) {
+            if(skip >= v.iov_len) {
+                skip -= v.iov_len;
+                continue;
+            }
+            rest.push_back({(char*)v.iov_base + skip, v.iov_len - skip});
+            skip = 0;
+        }
+        ssize_t rt = readv(fds[0], &rest[0], rest.size());
+        assert(rt > 0);
+        got += rt;
+    }
+    in.setPosition(1000);
+    in.setPosition(0);
+    assert(in.toString() == data);
+
+    // 从指定位置导出，不改变当前位置
+    iovs.clear();
+    assert(in.getReadBuffers(iovs, 10, 995) == 5);
+    assert(in.getPosition() == 0);
+    close(fds[0]);
+    close(fds[1]);
+    std::cout << "testIovec ok" << std::endl;
+}
+
+void testFile() {
+    myserver::ByteArray ba(3);
+    for(int i = 0; i < 1000; ++i) {
+        ba.writeInt64(i * 12345 - 500);
+    }
+    ba.setPosition(0);
+    std::string path = "/tmp/bytearray_test.dat";
+    assert(ba.writeToFile(path));
+
+    myserver::ByteArray ba2(64);
+    assert(ba2.readFromFile(path));
+    ba2.setPosition(0);
+    assert(ba2.toString() == ba.toString());
+    for(int i = 0; i < 1000; ++i) {
+        assert(ba2.readInt64() == i * 12345 - 500);
+    }
+    unlink(path.c_str());
+    std::cout << "testFile ok" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    testIntegers();
+    testEncoding();
+    testStringsAndFloats();
+    testIovec();
+    testFile();
+    return 0;
+}
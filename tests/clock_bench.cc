@@ -0,0 +1,59 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <time.h>
+#include <sys/time.h>
+#include "clock.h"
+
+// 时钟读取开销基准：对比 Clock 各接口与 clock_gettime/time/gettimeofday/steady_clock，
+// 以 JSON 输出每次调用耗时(ns)
+// 用法: clock_bench [calls=5000000]
+
+namespace {
+
+template<class F>
+double run(uint64_t calls, F f) {
+    volatile uint64_t sink = 0;
+    struct timespec b, e;
+    clock_gettime(CLOCK_MONOTONIC, &b);
+    for(uint64_t i = 0; i < calls; ++i) {
+        sink = sink + f();
+    }
+    clock_gettime(CLOCK_MONOTONIC, &e);
+    return ((e.tv_sec - b.tv_sec) * 1e9 + (e.tv_nsec - b.tv_nsec)) / calls;
+}
+
+uint64_t ClockGettime(clockid_t id) {
+    struct timespec ts;
+    clock_gettime(id, &ts);
+    return ts.tv_nsec;
+}
+
+}
+
+int main(int argc, char** argv) {
+    uint64_t calls = argc > 1 ? atoll(argv[1]) : 5000000;
+    myserver::Clock::CoarseMs();
+
+    std::cout << "{\"calls\":" << calls << ",\"tsc_stable\":" << myserver::Clock::IsTscStable()
+              << ",\"ns_per_call\":{"
+              << "\"Clock::Ticks\":" << run(calls, []() { return myserver::Clock::Ticks(); })
+              << ",\"Clock::NowNs\":" << run(calls, []() { return myserver::Clock::NowNs(); })
+              << ",\"Clock::CoarseMs\":" << run(calls, []() { return myserver::Clock::CoarseMs(); })
+              << ",\"Clock::CoarseWallMs\":" << run(calls, []() { return myserver::Clock::CoarseWallMs(); })
+              << ",\"Clock::ElapsedMs\":" << run(calls, []() { return myserver::Clock::ElapsedMs(); })
+              << ",\"clock_gettime(MONOTONIC)\":" << run(calls, []() { return ClockGettime(CLOCK_MONOTONIC); })
+              << ",\"clock_gettime(REALTIME_COARSE)\":" << run(calls, []() { return ClockGettime(CLOCK_REALTIME_COARSE); })
+              << ",\"time\":" << run(calls, []() { return (uint64_t)time(0); })
+              << ",\"gettimeofday\":" << run(calls, []() {
+                    struct timeval tv;
+                    gettimeofday(&tv, nullptr);
+                    return (uint64_t)tv.tv_usec;
+                 })
+              << ",\"steady_clock\":" << run(calls, []() {
+                    return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+                 })
+              << "}}" << std::endl;
+    return 0;
+}
@@ -0,0 +1,170 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <cstdlib>
+#include <algorithm>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "clock.h"
+#include "log.h"
+#include "mutex.h"
+
+// Clock 测试：TSC 换算精度、单调性(含重新校准前后)、TSC 不稳定时的退化、粗粒度时钟误差、fork 后重启 ticker，以及日志 %r 与 %L
+
+using namespace myserver;
+
+static uint64_t MonoNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int64_t Diff(uint64_t a, uint64_t b) {
+    return (int64_t)(a - b);
+}
+
+// 按格式化器输出收集日志
+class FormatAppender : public LogAppender {
+public:
+    typedef std::shared_ptr<FormatAppender> ptr;
+    void log(Logger::ptr logger, LogEvent::ptr event) override {
+        Mutex::Lock lock(m_mutex);
+        m_lines.push_back(m_formatter->format(logger, event));
+    }
+    std::string toYamlString() override { return ""; }
+    std::vector<std::string> lines() {
+        Mutex::Lock lock(m_mutex);
+        return m_lines;
+    }
+private:
+    Mutex m_mutex;
+    std::vector<std::string> m_lines;
+};
+
+void testPrecise() {
+    uint64_t a = Clock::NowNs();
+    uint64_t m = MonoNs();
+    assert(std::abs(Diff(a, m)) < 1000 * 1000);
+
+    // 50ms 区间内与 CLOCK_MONOTONIC 的偏差小于 1%
+    uint64_t t0 = Clock::Ticks();
+    uint64_t m0 = MonoNs();
+    usleep(50 * 1000);
+    uint64_t t1 = Clock::Ticks();
+    uint64_t m1 = MonoNs();
+    int64_t d = Diff(Clock::TicksToNs(t1) - Clock::TicksToNs(t0), m1 - m0);
+    assert(std::abs(d) * 100 < (int64_t)(m1 - m0));
+
+    uint64_t last = Clock::NowNs();
+    for(int i = 0; i < 100000; ++i) {
+        uint64_t now = Clock::NowNs();
+        assert(now >= last);
+        last = now;
+    }
+    assert(Clock::NowUs() / 1000 == Clock::NowMs() || Clock::NowUs() / 1000 + 1 == Clock::NowMs());
+    std::cout << "testPrecise ok tsc_stable=" << Clock::IsTscStable()
+              << " drift_ns=" << d << std::endl;
+}
+
+// clock_ticker 在 10ms、100ms、1s 时重新校准，跨过这些时刻 NowNs 仍单调且与 CLOCK_MONOTONIC 一致
+void testRecalibrate() {
+    Clock::CoarseMs();
+    uint64_t end = MonoNs() + 1200 * 1000 * 1000ULL;
+    uint64_t last = Clock::NowNs();
+    int64_t max_diff = 0;
+    while(MonoNs() < end) {
+        uint64_t m0 = MonoNs();
+        uint64_t now = Clock::NowNs();
+        uint64_t m1 = MonoNs();
+        assert(now >= last);
+        last = now;
+        // 读数之间被调度打断时不计偏差
+        if(m1 - m0 < 20 * 1000) {
+            max_diff = std::max(max_diff, std::abs(Diff(now, m0 + (m1 - m0) / 2)));
+        }
+    }
+    assert(max_diff < 1000 * 1000);
+    std::cout << "testRecalibrate ok max_diff_ns=" << max_diff << std::endl;
+}
+
+// TSC 不稳定时 Ticks 退化为单调时钟纳秒，换算为恒等
+void testUnstableTsc() {
+    int old = detail::g_clock_use_tsc.load();
+    detail::g_clock_use_tsc.store(0);
+    assert(!Clock::IsTscStable());
+    uint64_t m0 = MonoNs();
+    uint64_t t = Clock::Ticks();
+    uint64_t m1 = MonoNs();
+    assert(t >= m0 && t <= m1);
+    assert(Clock::TicksToNs(t) == t);
+    assert(Clock::TicksToDuration(12345) == 12345 && Clock::DurationToTicks(12345) == 12345);
+    detail::g_clock_use_tsc.store(old);
+    std::cout << "testUnstableTsc ok" << std::endl;
+}
+
+void testCoarse() {
+    Clock::CoarseMs();
+    usleep(20 * 1000);
+    // ticker 每毫秒更新，单核环境下允许调度延迟
+    assert(std::abs(Diff(Clock::CoarseMs(), Clock::NowMs())) <= 20);
+    assert(std::abs(Diff(Clock::CoarseWallMs(), Clock::WallMs())) <= 20);
+    uint64_t c0 = Clock::CoarseMs();
+    uint64_t e0 = Clock::ElapsedMs();
+    usleep(100 * 1000);
+    uint64_t c1 = Clock::CoarseMs();
+    uint64_t e1 = Clock::ElapsedMs();
+    assert(c1 - c0 >= 80 && c1 - c0 <= 200);
+    assert(e1 - e0 == c1 - c0 || e1 - e0 + 1 == c1 - c0 || e1 - e0 == c1 - c0 + 1);
+    assert(e1 >= 100);
+    std::cout << "testCoarse ok elapsed_ms=" << e1 << std::endl;
+}
+
+void testFork() {
+    pid_t pid = fork();
+    if(pid == 0) {
+        uint64_t c0 = Clock::CoarseMs();
+        usleep(50 * 1000);
+        uint64_t c1 = Clock::CoarseMs();
+        _exit(c1 - c0 >= 30 ? 0 : 1);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    std::cout << "testFork ok" << std::endl;
+}
+
+void testLog() {
+    Logger::ptr logger(new Logger("clock_test"));
+    FormatAppender::ptr app(new FormatAppender);
+    logger->addAppender(app);
+    logger->setFormatter("%d{%H:%M:%S.%L}|%r|%m");
+    LOG_INFO(logger) << "a";
+    usleep(30 * 1000);
+    LOG_INFO(logger) << "b";
+    std::vector<std::string> lines = app->lines();
+    assert(lines.size() == 2);
+    for(auto& l : lines) {
+        // HH:MM:SS.mmm|
+        assert(l.size() > 13 && l[8] == '.' && l[12] == '|');
+        for(int i = 9; i < 12; ++i) {
+            assert(isdigit(l[i]));
+        }
+    }
+    uint32_t r0 = atoi(lines[0].c_str() + 13);
+    uint32_t r1 = atoi(lines[1].c_str() + 13);
+    assert(r1 >= r0 + 20 && r1 <= r0 + 200);
+    assert(r0 >= 100);
+    std::cout << "testLog ok " << lines[1] << std::endl;
+}
+
+int main(int argc, char** argv) {
+    testPrecise();
+    testRecalibrate();
+    testUnstableTsc();
+    testCoarse();
+    testFork();
+    testLog();
+    return 0;
+}
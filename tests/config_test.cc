@@ -1,6 +1,7 @@
 #include "myserver/config.h"
 #include "myserver/log.h"
 #include <yaml-cpp/yaml.h>
+#include <iostream>
 
 myserver::ConfigVar<int>::ptr g_int_value_config = 
     myserver::Config::Lookup("system.port", (int)8080, "system port");
@@ -0,0 +1,138 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cassert>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "log.h"
+#include "thread.h"
+
+// 致命信号处理测试：子进程在缓冲未写出时崩溃，检查缓冲内容、崩溃报告(信号、线程名称、调用栈)与终止信号
+
+using namespace myserver;
+
+static const std::string LOG_FILE = "/tmp/fatal_signal_test.log";
+static const std::string STDOUT_FILE = "/tmp/fatal_signal_test.out";
+
+static std::string ReadFile(const std::string& path) {
+    std::ifstream ifs(path);
+    std::stringstream ss;
+    ss << ifs.rdbuf();
+    return ss.str();
+}
+
+__attribute__((noinline)) void CrashNow() {
+    volatile int* p = nullptr;
+    *p = 1;
+}
+
+// 每层占用 4KB 栈，不会被优化为循环；深度上限远超线程栈大小
+static volatile int s_max_depth = 1 << 30;
+
+__attribute__((noinline)) int Recurse(int n) {
+    volatile char buf[4096];
+    buf[0] = (char)n;
+    if(n >= s_max_depth) {
+        return buf[0];
+    }
+    return Recurse(n + 1) + buf[0];
+}
+
+// 子进程：stdout 重定向到文件(全缓冲)，日志格式不含 %n(不触发 flush)，随后崩溃
+static void RunChild(int sig) {
+    int fd = open(STDOUT_FILE.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    dup2(fd, STDOUT_FILENO);
+    close(fd);
+
+    Logger::ptr logger = LOGGER_NAME("crash");
+    FileLogAppender::ptr appender(new FileLogAppender(LOG_FILE));
+    appender->setFormatter(LogFormatter::ptr(new LogFormatter("%m")));
+    logger->addAppender(appender);
+    LOG_INFO(logger) << "file line 1\n";
+    LOG_INFO(logger) << "file line 2\n";
+    printf("stdout pending\n");
+
+    if(sig == SIGABRT) {
+        Thread::SetName("CRASH_main");
+        abort();
+    }
+    if(sig == 0) {
+        // 工作线程栈溢出，处理函数在该线程的备用信号栈上执行
+        Thread::ptr thr(new Thread([]() {
+            Recurse(0);
+        }, "CRASH_overflow"));
+        thr->join();
+        _exit(0);
+    }
+    Thread::ptr thr(new Thread([]() {
+        CrashNow();
+    }, "CRASH_worker"));
+    thr->join();
+    _exit(0);
+}
+
+// sig 为 0 时工作线程栈溢出，以 SIGSEGV 终止
+static void testCrash(int sig, const std::string& thread_name) {
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if(pid == 0) {
+        // 子进程的崩溃报告同时写到 stderr，测试输出中不需要
+        int null_fd = open("/dev/null", O_WRONLY);
+        dup2(null_fd, STDERR_FILENO);
+        RunChild(sig);
+    }
+    int status = 0;
+    assert(waitpid(pid, &status, 0) == pid);
+    assert(WIFSIGNALED(status));
+    bool overflow = sig == 0;
+    if(overflow) {
+        sig = SIGSEGV;
+    }
+    assert(WTERMSIG(status) == sig);
+
+    std::string out = ReadFile(STDOUT_FILE);
+    assert(out.find("stdout pending\n") == 0);
+
+    std::string log = ReadFile(LOG_FILE);
+    assert(log.find("file line 1\nfile line 2\n") == 0);
+    std::string header = std::string("*** fatal signal ")
+        + (overflow ? "SIGSEGV (11) addr=0x" : sig == SIGSEGV ? "SIGSEGV (11) addr=0x0 " : "SIGABRT (6) ");
+    size_t pos = log.find(header);
+    assert(pos != std::string::npos);
+    assert(log.find("thread=" + thread_name + " ***\n", pos) != std::string::npos);
+    // -rdynamic 导出符号，调用栈中能找到触发点
+    if(overflow) {
+        assert(log.find("(_Z7Recursei+0x", pos) != std::string::npos);
+    } else if(sig == SIGSEGV) {
+        assert(log.find("(_Z8CrashNowv+0x", pos) != std::string::npos);
+    } else {
+        assert(log.find("(abort+0x", pos) != std::string::npos);
+    }
+    std::cout << log.substr(pos, log.find('\n', pos) - pos) << std::endl;
+    unlink(LOG_FILE.c_str());
+    unlink(STDOUT_FILE.c_str());
+}
+
+// 已由使用者设置的处理函数不会被覆盖
+static void testKeepUserHandler() {
+    struct sigaction sa;
+    assert(sigaction(SIGSEGV, nullptr, &sa) == 0);
+    assert(sa.sa_flags & SA_SIGINFO);
+    assert(sigaction(SIGPIPE, nullptr, &sa) == 0);
+    assert(!(sa.sa_flags & SA_SIGINFO) && sa.sa_handler == SIG_DFL);
+    std::cout << "testKeepUserHandler ok" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    testKeepUserHandler();
+    testCrash(SIGSEGV, "CRASH_worker");
+    testCrash(SIGABRT, "CRASH_main");
+    testCrash(0, "CRASH_overflow");
+    std::cout << "fatal_signal_test ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,180 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <cassert>
+#include <unistd.h>
+#include "log.h"
+#include "thread.h"
+#include "http/http_server.h"
+#include "http/http_connection.h"
+
+// HttpConnectionPool 测试：以本地 HttpServer 作为对端，验证连接复用、每连接请求数上限、
+// 空闲超时、对端关闭空闲连接后的检查、最大连接数限制与并发请求
+
+using namespace myserver::http;
+
+HttpServer::ptr startServer(uint16_t& port) {
+    HttpServer::ptr server(new HttpServer(true, 2));
+    ServletDispatch::ptr sd = server->getServletDispatch();
+    sd->addServlet("/hello", [](HttpRequest::ptr req, HttpResponse::ptr rsp, myserver::Socket::ptr) {
+        rsp->setBody("world");
+        return 0;
+    });
+    sd->addServlet("/echo", [](HttpRequest::ptr req, HttpResponse::ptr rsp, myserver::Socket::ptr) {
+        rsp->setBody(req->getBody() + "|" + req->getQuery() + "|" + req->getHeader("Host")
+                     + "|" + req->getHeader("X-Tag"));
+        return 0;
+    });
+    sd->addServlet("/close", [](HttpRequest::ptr req, HttpResponse::ptr rsp, myserver::Socket::ptr) {
+        rsp->setClose(true);
+        rsp->setBody("bye");
+        return 0;
+    });
+    assert(server->bind(myserver::IPv4Address::Create("127.0.0.1", 0)));
+    assert(server->start());
+    port = std::dynamic_pointer_cast<myserver::IPAddress>(
+            server->getSocks()[0]->getLocalAddress())->getPort();
+    return server;
+}
+
+void testReuse(uint16_t port) {
+    HttpConnectionPool pool("127.0.0.1", port, 4, 10000, 0);
+    for(int i = 0; i < 10; ++i) {
+        HttpResult::ptr rt = pool.doGet("/hello", 1000);
+        assert(rt->result == HttpResult::Error::OK);
+        assert((int)rt->response->getStatus() == 200 && rt->response->getBody() == "world");
+    }
+    HttpConnectionPoolStats stats = pool.getStats();
+    assert(stats.created == 1 && stats.reused == 9 && stats.idle == 1 && stats.total == 1);
+
+    HttpResult::ptr rt = pool.doPost("/echo?a=1", 1000, {{"X-Tag", "t"}}, "body");
+    assert(rt->result == HttpResult::Error::OK && rt->response->getBody() == "body|a=1|127.0.0.1|t");
+    rt = pool.doRequest(HttpMethod::HEAD, "/hello", 1000);
+    assert(rt->result == HttpResult::Error::OK && rt->response->getBody().empty());
+    assert(rt->response->getHeader("Content-Length") == "5");
+    assert(pool.doGet("/none", 1000)->response->getStatus() == HttpStatus::NOT_FOUND);
+
+    // 对端要求关闭的连接不放回
+    rt = pool.doGet("/close", 1000);
+    assert(rt->result == HttpResult::Error::OK && rt->response->isClose());
+    stats = pool.getStats();
+    assert(stats.created == 1 && stats.idle == 0 && stats.total == 0);
+    assert(pool.doGet("/hello", 1000)->result == HttpResult::Error::OK);
+    assert(pool.getStats().created == 2);
+    std::cout << "testReuse ok" << std::endl;
+}
+
+void testLimits(uint16_t port) {
+    {
+        HttpConnectionPool pool("127.0.0.1", port, 4, 10000, 3);
+        for(int i = 0; i < 10; ++i) {
+            assert(pool.doGet("/hello", 1000)->result == HttpResult::Error::OK);
+        }
+        assert(pool.getStats().created == 4);
+    }
+    {
+        HttpConnectionPool pool("127.0.0.1", port, 4, 50, 0);
+        assert(pool.doGet("/hello", 1000)->result == HttpResult::Error::OK);
+        usleep(100 * 1000);
+        assert(pool.doGet("/hello", 1000)->result == HttpResult::Error::OK);
+        HttpConnectionPoolStats stats = pool.getStats();
+        assert(stats.created == 2 && stats.discarded == 1 && stats.total == 1);
+    }
+    {
+        HttpConnectionPool pool("127.0.0.1", port, 2, 10000, 0);
+        HttpConnection::ptr a = pool.getConnection(1000);
+        HttpConnection::ptr b = pool.getConnection(1000);
+        assert(a && b);
+        HttpResult::Error err;
+        assert(!pool.getConnection(50, &err) && err == HttpResult::Error::POOL_EXHAUSTED);
+        HttpRequest req(0x11, false);
+        req.setPath("/hello");
+        assert(a->request(req, 1000)->result == HttpResult::Error::OK);
+        a.reset();
+        HttpConnection::ptr c = pool.getConnection(50, &err);
+        assert(c && err == HttpResult::Error::OK && c->getRequestCount() == 1);
+        assert(pool.getStats().total == 2);
+    }
+    {
+        // 没有服务监听的端口
+        HttpConnectionPool pool("127.0.0.1", 1, 2, 10000, 0);
+        HttpResult::ptr rt = pool.doGet("/hello", 1000);
+        assert(rt->result == HttpResult::Error::CONNECT_FAIL && !rt->response);
+        assert(pool.getStats().total == 0);
+        // 失败时归还名额，不会耗尽连接池
+        for(int i = 0; i < 3; ++i) {
+            HttpResult::Error err;
+            assert(!pool.getConnection(100, &err) && err == HttpResult::Error::CONNECT_FAIL);
+        }
+    }
+    std::cout << "testLimits ok" << std::endl;
+}
+
+// 服务端关闭空闲连接后，复用前的检查发现并重新建立连接
+void testHealthCheck(uint16_t port, HttpServer::ptr server) {
+    HttpConnectionPool pool("127.0.0.1", port, 4, 10000, 0);
+    server->setReadTimeout(100);
+    assert(pool.doGet("/hello", 1000)->result == HttpResult::Error::OK);
+    usleep(300 * 1000);
+    assert(pool.doGet("/hello", 1000)->result == HttpResult::Error::OK);
+    HttpConnectionPoolStats stats = pool.getStats();
+    assert(stats.created == 2 && stats.discarded == 1);
+    server->setReadTimeout(120 * 1000);
+
+    std::cout << "testHealthCheck ok" << std::endl;
+}
+
+// fresh 获取不复用空闲连接，doRequest 重试时用它避开其它同样失效的空闲连接
+void testFresh(uint16_t port) {
+    HttpConnectionPool pool("127.0.0.1", port, 4, 10000, 0);
+    assert(pool.doGet("/hello", 1000)->result == HttpResult::Error::OK);
+    assert(pool.getStats().idle == 1);
+    {
+        HttpConnection::ptr conn = pool.getConnection(1000, nullptr, true);
+        assert(conn && conn->getRequestCount() == 0);
+        HttpConnectionPoolStats stats = pool.getStats();
+        assert(stats.idle == 1 && stats.created == 2 && stats.reused == 0);
+    }
+    assert(pool.getStats().idle == 2);
+    std::cout << "testFresh ok" << std::endl;
+}
+
+void testConcurrent(uint16_t port) {
+    HttpConnectionPool pool("127.0.0.1", port, 4, 10000, 0);
+    std::atomic<int> ok(0);
+    std::vector<myserver::Thread::ptr> thrs;
+    for(int i = 0; i < 8; ++i) {
+        thrs.push_back(myserver::Thread::ptr(new myserver::Thread([&pool, &ok, i]() {
+            for(int k = 0; k < 200; ++k) {
+                std::string body = std::to_string(i) + "-" + std::to_string(k);
+                HttpResult::ptr rt = pool.doPost("/echo", 3000, {}, body);
+                if(rt->result == HttpResult::Error::OK
+                        && rt->response->getBody() == body + "||127.0.0.1|") {
+                    ++ok;
+                }
+            }
+        }, "HCT_" + std::to_string(i))));
+    }
+    for(auto& t : thrs) {
+        t->join();
+    }
+    HttpConnectionPoolStats stats = pool.getStats();
+    assert(ok == 8 * 200);
+    assert(stats.created <= 4 && stats.total <= 4);
+    assert(stats.created + stats.reused == 8 * 200);
+    std::cout << "testConcurrent ok created=" << stats.created << std::endl;
+}
+
+int main(int argc, char** argv) {
+    LOGGER_NAME("system")->setLevel(myserver::LogLevel::INFO);
+    uint16_t port = 0;
+    HttpServer::ptr server = startServer(port);
+    testReuse(port);
+    testLimits(port);
+    testHealthCheck(port, server);
+    testFresh(port);
+    testConcurrent(port);
+    server->stop();
+    return 0;
+}
@@ -0,0 +1,329 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <cstring>
+#include <cstdlib>
+#include "http/http_parser.h"
+
+// HttpParser 测试：请求/响应、chunked、流水线、任意位置分段输入、随机变异、限制与扫描实现一致性
+
+using myserver::http::HttpParser;
+
+static const char* s_request =
+    "GET /index.html?a=1&b=2#top HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "User-Agent:  curl/7.68.0 \r\n"
+    "Accept: */*\r\n"
+    "Content-Length: 5\r\n"
+    "\r\n"
+    "hello";
+
+static const char* s_chunked =
+    "POST /upload HTTP/1.1\r\n"
+    "Host: a\r\n"
+    "Transfer-Encoding: chunked\r\n"
+    "\r\n"
+    "5;ext=1\r\nhello\r\n"
+    "7\r\n, world\r\n"
+    "0\r\n"
+    "X-Trailer: t\r\n"
+    "\r\n";
+
+void checkRequest(const HttpParser& p, const char* buf) {
+    assert(p.isFinished() && !p.hasError());
+    assert(p.getMethod().equals(buf, "GET"));
+    assert(p.getUri().toString(buf) == "/index.html?a=1&b=2#top");
+    assert(p.getPath().toString(buf) == "/index.html");
+    assert(p.getQuery().toString(buf) == "a=1&b=2");
+    assert(p.getFragment().toString(buf) == "top");
+    assert(p.getVersion() == 0x11);
+    assert(p.getHeaderCount() == 4);
+    assert(p.getHeader(1).name.toString(buf) == "User-Agent");
+    assert(p.getHeader(1).value.toString(buf) == "curl/7.68.0");
+    const HttpParser::Header* h = p.findHeader(buf, "host");
+    assert(h && h->value.equals(buf, "www.example.com"));
+    assert(!p.findHeader(buf, "cookie"));
+    assert(p.getContentLength() == 5);
+    assert(p.getBody().toString(buf) == "hello");
+    assert(p.isKeepAlive());
+    assert(p.getConsumed() == strlen(s_request));
+}
+
+void testRequest() {
+    std::string buf = s_request;
+    HttpParser p;
+    assert(p.execute(&buf[0], buf.size()) == HttpParser::DONE);
+    checkRequest(p, buf.c_str());
+    assert(p.getHeaderSize() == buf.size() - 5);
+    std::cout << "testRequest ok" << std::endl;
+}
+
+void testResponse() {
+    std::string buf = "HTTP/1.0 200 OK\r\nServer: x\r\nConnection: keep-alive\r\n"
+                      "Content-Length: 2\r\n\r\nok";
+    HttpParser p(HttpParser::RESPONSE);
+    assert(p.execute(&buf[0], buf.size()) == HttpParser::DONE);
+    assert(p.getStatus() == 200 && p.getVersion() == 0x10);
+    assert(p.getReason().equals(buf.c_str(), "OK"));
+    assert(p.getBody().toString(buf.c_str()) == "ok");
+    assert(p.isKeepAlive());
+
+    // 204 无消息体
+    buf = "HTTP/1.1 204 No Content\r\n\r\n";
+    p.reset();
+    assert(p.execute(&buf[0], buf.size()) == HttpParser::DONE);
+    assert(p.getBody().empty());
+
+    // 无长度的响应以连接关闭结束
+    buf = "HTTP/1.1 200 OK\r\nConnection: close\r\n\r\npart1";
+    p.reset();
+    assert(p.execute(&buf[0], buf.size()) == HttpParser::NEED_MORE);
+    assert(p.isHeaderComplete() && !p.isKeepAlive());
+    buf += "part2";
+    assert(p.execute(&buf[0], buf.size()) == HttpParser::NEED_MORE);
+    assert(p.finish(buf.size()) == HttpParser::DONE);
+    assert(p.getBody().toString(buf.c_str()) == "part1part2");
+
+    // HEAD 的响应忽略 Content-Length / Transfer-Encoding
+    buf = "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nHTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n";
+    p.reset();
+    p.setNoBody(true);
+    assert(p.execute(&buf[0], buf.size()) == HttpParser::DONE);
+    assert(p.getBody().empty() && p.getContentLength() == 5 && p.isKeepAlive());
+    size_t next = p.getConsumed();
+    p.reset();
+    p.setNoBody(true);
+    assert(p.execute(&buf[next], buf.size() - next) == HttpParser::DONE);
+    assert(p.getBody().empty() && p.getConsumed() == buf.size() - next);
+    std::cout << "testResponse ok" << std::endl;
+}
+
+void testChunked() {
+    std::string buf = s_chunked;
+    HttpParser p;
+    assert(p.execute(&buf[0], buf.size()) == HttpParser::DONE);
+    assert(p.isChunked());
+    assert(p.getBody().toString(buf.c_str()) == "hello, world");
+    assert(p.getContentLength() == 12);
+    assert(p.getConsumed() == buf.size());
+    std::cout << "testChunked ok" << std::endl;
+}
+
+// 流水线：同一缓冲区中连续的多条消息
+void testPipeline() {
+    std::string buf;
+    for(int i = 0; i < 3; ++i) {
+        buf += "GET /" + std::to_string(i) + " HTTP/1.1\r\nHost: a\r\n\r\n";
+    }
+    buf += s_chunked;
+    size_t pos = 0;
+    HttpParser p;
+    for(int i = 0; i < 4; ++i) {
+        p.reset();
+        assert(p.execute(&buf[pos], buf.size() - pos) == HttpParser::DONE);
+        if(i < 3) {
+            assert(p.getPath().toString(&buf[pos]) == "/" + std::to_string(i));
+        } else {
+            assert(p.getBody().toString(&buf[pos]) == "hello, world");
+        }
+        pos += p.getConsumed();
+    }
+    assert(pos == buf.size());
+    std::cout << "testPipeline ok" << std::endl;
+}
+
+// 数据在任意字节处被分成两段到达，结果与一次到达完全一致
+void testSplit() {
+    for(const char* msg : {s_request, s_chunked}) {
+        std::string full = msg;
+        std::string expect_body;
+        {
+            std::string buf = full;
+            HttpParser p;
+            assert(p.execute(&buf[0], buf.size()) == HttpParser::DONE);
+            expect_body = p.getBody().toString(buf.c_str());
+        }
+        for(size_t i = 0; i <= full.size(); ++i) {
+            std::string buf = full;
+            HttpParser p;
+            HttpParser::Result rt = p.execute(&buf[0], i);
+            assert(rt == (i == full.size() ? HttpParser::DONE : HttpParser::NEED_MORE));
+            assert(p.execute(&buf[0], full.size()) == HttpParser::DONE);
+            assert(p.getBody().toString(buf.c_str()) == expect_body);
+            assert(p.getConsumed() == full.size());
+            if(msg == s_request) {
+                checkRequest(p, buf.c_str());
+            }
+        }
+        // 逐字节到达
+        std::string buf = full;
+        HttpParser p;
+        for(size_t i = 1; i < full.size(); ++i) {
+            assert(p.execute(&buf[0], i) == HttpParser::NEED_MORE);
+        }
+        assert(p.execute(&buf[0], full.size()) == HttpParser::DONE);
+        assert(p.getBody().toString(buf.c_str()) == expect_body);
+    }
+    std::cout << "testSplit ok" << std::endl;
+}
+
+HttpParser::Error parseError(const std::string& msg, HttpParser::Type type = HttpParser::REQUEST) {
+    std::string buf = msg;
+    HttpParser p(type);
+    p.execute(&buf[0], buf.size());
+    return p.getError();
+}
+
+void testInvalid() {
+    assert(parseError("GET / HTTP/2.0\r\n\r\n") == HttpParser::INVALID_VERSION);
+    assert(parseError("GET /\r\n\r\n") == HttpParser::INVALID_REQUEST_LINE);
+    assert(parseError("G(T / HTTP/1.1\r\n\r\n") == HttpParser::INVALID_REQUEST_LINE);
+    assert(parseError("GET / HTTP/1.1\r\nHost a\r\n\r\n") == HttpParser::INVALID_HEADER);
+    assert(parseError("GET / HTTP/1.1\r\nHost : a\r\n\r\n") == HttpParser::INVALID_HEADER);
+    assert(parseError("GET / HTTP/1.1\r\nA: b\r\n c\r\n\r\n") == HttpParser::INVALID_HEADER);
+    assert(parseError("GET / HTTP/1.1\r\nA: b\rc\r\n\r\n") == HttpParser::INVALID_CHAR);
+    assert(parseError(std::string("GET / HTTP/1.1\r\nA: b") + '\0' + "c\r\n\r\n") == HttpParser::INVALID_CHAR);
+    assert(parseError("GET / HTTP/1.1\r\nContent-Length: 1x\r\n\r\n") == HttpParser::INVALID_CONTENT_LENGTH);
+    assert(parseError("GET / HTTP/1.1\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\n")
+            == HttpParser::INVALID_CONTENT_LENGTH);
+    assert(parseError("POST / HTTP/1.1\r\nContent-Length: 1\r\nTransfer-Encoding: chunked\r\n\r\n")
+            == HttpParser::INVALID_CONTENT_LENGTH);
+    assert(parseError("POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\n")
+            == HttpParser::UNSUPPORTED_TRANSFER_ENCODING);
+    assert(parseError("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n")
+            == HttpParser::INVALID_CHUNK);
+    assert(parseError("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n1\r\nabc")
+            == HttpParser::INVALID_CHUNK);
+    assert(parseError("HTTP/1.1 2x0 OK\r\n\r\n", HttpParser::RESPONSE) == HttpParser::INVALID_STATUS_LINE);
+
+    // 错误状态保持
+    std::string buf = "GET / HTTP/3\r\n\r\n";
+    HttpParser p;
+    assert(p.execute(&buf[0], buf.size()) == HttpParser::ERROR);
+    assert(p.execute(&buf[0], buf.size()) == HttpParser::ERROR);
+    assert(std::string(p.getErrorString()) == "INVALID_VERSION");
+    std::cout << "testInvalid ok" << std::endl;
+}
+
+void testLimits() {
+    std::string buf = "GET / HTTP/1.1\r\nX: " + std::string(200, 'a') + "\r\n\r\n";
+    HttpParser p;
+    p.setMaxHeaderSize(128);
+    assert(p.execute(&buf[0], buf.size()) == HttpParser::ERROR);
+    assert(p.getError() == HttpParser::HEADER_TOO_LARGE);
+
+    // 首部尚未收完但已超过上限时即报错
+    p.reset();
+    p.setMaxHeaderSize(128);
+    assert(p.execute(&buf[0], 150) == HttpParser::ERROR);
+    assert(p.getError() == HttpParser::HEADER_TOO_LARGE);
+
+    buf = "GET / HTTP/1.1\r\n";
+    for(int i = 0; i < HttpParser::MAX_HEADERS + 1; ++i) {
+        buf += "X" + std::to_string(i) + ": v\r\n";
+    }
+    buf += "\r\n";
+    p.reset();
+    assert(p.execute(&buf[0], buf.size()) == HttpParser::ERROR);
+    assert(p.getError() == HttpParser::TOO_MANY_HEADERS);
+
+    buf = "POST / HTTP/1.1\r\nContent-Length: 100\r\n\r\n";
+    p.reset();
+    p.setMaxBodySize(10);
+    assert(p.execute(&buf[0], buf.size()) == HttpParser::ERROR);
+    assert(p.getError() == HttpParser::BODY_TOO_LARGE);
+
+    buf = s_chunked;
+    p.reset();
+    p.setMaxBodySize(10);
+    assert(p.execute(&buf[0], buf.size()) == HttpParser::ERROR);
+    assert(p.getError() == HttpParser::BODY_TOO_LARGE);
+    std::cout << "testLimits ok" << std::endl;
+}
+
+// 随机变异输入：不得崩溃或越界，结果在各扫描实现间一致
+void testFuzz() {
+    srand(12345);
+    const char* seeds[] = {s_request, s_chunked,
+        "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabc\r\n0\r\n\r\n"};
+    const char alphabet[] = "\r\n\t :;/?#0123456789abcdefxHTP\x7f\x01";
+    HttpParser::ScanMode modes[] = {HttpParser::SCAN_SCALAR, HttpParser::SCAN_SSE2, HttpParser::SCAN_AVX2};
+    for(int round = 0; round < 20000; ++round) {
+        size_t si = rand() % 3;
+        std::string msg = seeds[si];
+        int mutations = 1 + rand() % 4;
+        for(int m = 0; m < mutations; ++m) {
+            size_t pos = rand() % msg.size();
+            switch(rand() % 3) {
+                case 0: msg[pos] = alphabet[rand() % (sizeof(alphabet) - 1)]; break;
+                case 1: msg.erase(pos, 1); break;
+                default: msg.insert(pos, 1, alphabet[rand() % (sizeof(alphabet) - 1)]); break;
+            }
+        }
+        size_t split = rand() % (msg.size() + 1);
+        int result = -1;
+        HttpParser::Error error = HttpParser::OK;
+        std::string body;
+        for(auto mode : modes) {
+            HttpParser::SetScanMode(mode);
+            // 精确大小的堆内存，越界访问可被 sanitizer 发现
+            std::vector<char> buf(msg.begin(), msg.end());
+            HttpParser p(si == 2 ? HttpParser::RESPONSE : HttpParser::REQUEST);
+            HttpParser::Result rt = p.execute(buf.data(), split);
+            if(rt == HttpParser::NEED_MORE) {
+                rt = p.execute(buf.data(), buf.size());
+            }
+            assert(p.getConsumed() <= buf.size());
+            std::string b;
+            if(rt == HttpParser::DONE) {
+                assert(p.getBody().offset + p.getBody().length <= buf.size());
+                b = p.getBody().toString(buf.data());
+            }
+            if(result < 0) {
+                result = rt;
+                error = p.getError();
+                body = b;
+            } else {
+                assert(result == rt && error == p.getError() && body == b);
+            }
+        }
+    }
+    HttpParser::SetScanMode(HttpParser::SCAN_AUTO);
+    std::cout << "testFuzz ok" << std::endl;
+}
+
+// 长行跨越 SIMD 块边界时各实现找到同一个位置
+void testScanModes() {
+    for(auto mode : {HttpParser::SCAN_SCALAR, HttpParser::SCAN_SSE2, HttpParser::SCAN_AVX2}) {
+        HttpParser::ScanMode m = HttpParser::SetScanMode(mode);
+        std::cout << "scan mode " << HttpParser::ScanModeName(mode)
+                  << " -> " << HttpParser::ScanModeName(m) << std::endl;
+        for(size_t n = 0; n < 80; ++n) {
+            std::string buf = "GET /" + std::string(n, 'p') + " HTTP/1.1\r\nA:\t" + std::string(n, 'v') + "\r\n\r\n";
+            HttpParser p;
+            assert(p.execute(&buf[0], buf.size()) == HttpParser::DONE);
+            assert(p.getPath().length == n + 1);
+            assert(p.getHeader(0).value.toString(buf.c_str()) == std::string(n, 'v'));
+            buf[5 + n / 2] = '\x7f';
+            p.reset();
+            assert(p.execute(&buf[0], buf.size()) == HttpParser::ERROR);
+            assert(p.getError() == HttpParser::INVALID_CHAR);
+        }
+    }
+    HttpParser::SetScanMode(HttpParser::SCAN_AUTO);
+    std::cout << "testScanModes ok" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    testRequest();
+    testResponse();
+    testChunked();
+    testPipeline();
+    testSplit();
+    testInvalid();
+    testLimits();
+    testScanModes();
+    testFuzz();
+    return 0;
+}
@@ -0,0 +1,173 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include "log.h"
+#include "thread.h"
+#include "http/http_server.h"
+
+// HttpServer 本机压测，客户端内置
+// 每个客户端线程持有一个长连接，每轮流水线发送 depth 个请求后读取全部响应，
+// 记录每轮往返耗时作为这些请求的延迟；输出每秒请求数与 p50/p99/p999 延迟
+// 用法: http_server_bench [duration_ms=2000] [connections=16] [workers=4] [depth=1,16]
+
+namespace {
+
+inline uint64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct ClientStat {
+    uint64_t requests = 0;
+    uint64_t errors = 0;
+    std::vector<uint32_t> latency_us;   // 每个请求一个样本
+};
+
+void runClient(myserver::Address::ptr addr, size_t depth, std::atomic<bool>& stop, ClientStat& stat) {
+    using myserver::http::HttpParser;
+    myserver::Socket::ptr sock = myserver::Socket::CreateTCP(addr);
+    if(!sock->connect(addr, 1000)) {
+        ++stat.errors;
+        return;
+    }
+    sock->setRecvTimeout(3000);
+    std::string req;
+    for(size_t i = 0; i < depth; ++i) {
+        req += "GET /ping HTTP/1.1\r\nHost: bench\r\nUser-Agent: http_server_bench\r\n\r\n";
+    }
+    std::vector<char> buf(64 * 1024);
+    HttpParser parser(HttpParser::RESPONSE);
+    while(!stop.load(std::memory_order_relaxed)) {
+        uint64_t begin = NowNs();
+        if(sock->send(req.c_str(), req.size()) != (int)req.size()) {
+            ++stat.errors;
+            return;
+        }
+        size_t got = 0;
+        size_t pos = 0;
+        size_t len = 0;
+        parser.reset();
+        while(got < depth) {
+            if(pos < len) {
+                HttpParser::Result rt = parser.execute(&buf[pos], len - pos);
+                if(rt == HttpParser::DONE) {
+                    ++got;
+                    pos += parser.getConsumed();
+                    parser.reset();
+                    continue;
+                } else if(rt == HttpParser::ERROR) {
+                    ++stat.errors;
+                    return;
+                }
+            }
+            if(pos > 0) {
+                memmove(&buf[0], &buf[pos], len - pos);
+                len -= pos;
+                pos = 0;
+            }
+            int n = sock->recv(&buf[len], buf.size() - len);
+            if(n <= 0) {
+                ++stat.errors;
+                return;
+            }
+            len += n;
+        }
+        uint32_t us = (NowNs() - begin) / 1000;
+        stat.requests += depth;
+        stat.latency_us.insert(stat.latency_us.end(), depth, us);
+    }
+}
+
+std::string run(size_t workers, size_t connections, size_t depth, uint64_t duration_ms) {
+    myserver::http::HttpServer::ptr server(new myserver::http::HttpServer(true, workers));
+    server->getServletDispatch()->addServlet("/ping", [](myserver::http::HttpRequest::ptr req,
+                myserver::http::HttpResponse::ptr rsp, myserver::Socket::ptr) {
+        rsp->setHeader("Content-Type", "text/plain");
+        rsp->setBody("pong");
+        return 0;
+    });
+    if(!server->bind(myserver::IPv4Address::Create("127.0.0.1", 0)) || !server->start()) {
+        std::cerr << "server start fail" << std::endl;
+        exit(1);
+    }
+    myserver::Address::ptr addr = server->getSocks()[0]->getLocalAddress();
+
+    std::atomic<bool> stop(false);
+    std::vector<ClientStat> stats(connections);
+    std::vector<myserver::Thread::ptr> thrs;
+    for(size_t i = 0; i < connections; ++i) {
+        ClientStat& stat = stats[i];
+        thrs.push_back(myserver::Thread::ptr(new myserver::Thread([&, addr]() {
+            runClient(addr, depth, stop, stat);
+        }, "HSB_C" + std::to_string(i))));
+    }
+    uint64_t begin = NowNs();
+    usleep(duration_ms * 1000);
+    stop = true;
+    for(auto& t : thrs) {
+        t->join();
+    }
+    double sec = (NowNs() - begin) / 1e9;
+    server->stop();
+
+    uint64_t requests = 0;
+    uint64_t errors = 0;
+    std::vector<uint32_t> lat;
+    for(auto& s : stats) {
+        requests += s.requests;
+        errors += s.errors;
+        lat.insert(lat.end(), s.latency_us.begin(), s.latency_us.end());
+    }
+    std::sort(lat.begin(), lat.end());
+    auto pct = [&lat](double p) -> uint32_t {
+        return lat.empty() ? 0 : lat[std::min(lat.size() - 1, (size_t)(lat.size() * p))];
+    };
+
+    std::stringstream ss;
+    ss << "{\"workers\":" << workers
+       << ",\"connections\":" << connections
+       << ",\"pipeline_depth\":" << depth
+       << ",\"requests\":" << requests
+       << ",\"errors\":" << errors
+       << ",\"seconds\":" << sec
+       << ",\"requests_per_sec\":" << (uint64_t)(requests / sec)
+       << ",\"p50_us\":" << pct(0.5)
+       << ",\"p99_us\":" << pct(0.99)
+       << ",\"p999_us\":" << pct(0.999) << "}";
+    return ss.str();
+}
+
+}
+
+int main(int argc, char** argv) {
+    uint64_t duration_ms = argc > 1 ? atoi(argv[1]) : 2000;
+    size_t connections = argc > 2 ? atoi(argv[2]) : 16;
+    size_t workers = argc > 3 ? atoi(argv[3]) : 4;
+    LOGGER_NAME("system")->setLevel(myserver::LogLevel::WARN);
+
+    std::vector<std::string> lines;
+    std::vector<size_t> depths;
+    if(argc > 4) {
+        depths.push_back(atoi(argv[4]));
+    } else {
+        depths = {1, 16};
+    }
+    for(size_t depth : depths) {
+        lines.push_back(run(workers, connections, depth, duration_ms));
+    }
+    std::cout << "{\"hardware_threads\":" << std::thread::hardware_concurrency()
+              << ",\"duration_ms\":" << duration_ms
+              << ",\"results\":[" << std::endl;
+    for(size_t i = 0; i < lines.size(); ++i) {
+        std::cout << "  " << lines[i] << (i + 1 < lines.size() ? "," : "") << std::endl;
+    }
+    std::cout << "]}" << std::endl;
+    return 0;
+}
@@ -0,0 +1,278 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <cstring>
+#include "http/http_server.h"
+#include "config.h"
+
+// HttpServer 测试：长连接、流水线、短连接、错误请求、大响应、路由分发
+
+using namespace myserver::http;
+
+// 阻塞式测试客户端，按顺序读取响应
+class Client {
+public:
+    Client(myserver::Address::ptr addr)
+        :m_sock(myserver::Socket::CreateTCP(addr))
+        ,m_parser(HttpParser::RESPONSE)
+        ,m_begin(0) {
+        assert(m_sock->connect(addr, 1000));
+        m_sock->setRecvTimeout(3000);
+    }
+
+    void send(const std::string& data) {
+        assert(m_sock->send(data.c_str(), data.size()) == (int)data.size());
+    }
+
+    // 读取一个完整响应，连接关闭返回 false
+    bool recvResponse(int& status, std::string& body, bool& keepalive) {
+        m_parser.reset();
+        while(true) {
+            if(m_begin < m_buf.size()) {
+                HttpParser::Result rt = m_parser.execute(&m_buf[m_begin], m_buf.size() - m_begin);
+                assert(rt != HttpParser::ERROR);
+                if(rt == HttpParser::DONE) {
+                    break;
+                }
+            }
+            char tmp[65536];
+            int n = m_sock->recv(tmp, sizeof(tmp));
+            if(n <= 0) {
+                return false;
+            }
+            m_buf.append(tmp, n);
+        }
+        const char* base = &m_buf[m_begin];
+        status = m_parser.getStatus();
+        body = m_parser.getBody().toString(base);
+        keepalive = m_parser.isKeepAlive();
+        m_begin += m_parser.getConsumed();
+        return true;
+    }
+
+    // 对端是否已关闭
+    bool isPeerClosed() {
+        char c;
+        return m_begin == m_buf.size() && m_sock->recv(&c, 1) == 0;
+    }
+private:
+    myserver::Socket::ptr m_sock;
+    HttpParser m_parser;
+    std::string m_buf;
+    size_t m_begin;
+};
+
+HttpServer::ptr startServer(myserver::Address::ptr& addr) {
+    HttpServer::ptr server(new HttpServer(true, 2));
+    ServletDispatch::ptr sd = server->getServletDispatch();
+    sd->addServlet("/hello", [](HttpRequest::ptr req, HttpResponse::ptr rsp, myserver::Socket::ptr) {
+        rsp->setHeader("Content-Type", "text/plain");
+        rsp->setBody("world");
+        return 0;
+    });
+    sd->addServlet("/echo", [](HttpRequest::ptr req, HttpResponse::ptr rsp, myserver::Socket::ptr) {
+        rsp->setBody(req->getBody() + "|" + req->getQuery() + "|" + req->getHeader("x-tag"));
+        return 0;
+    });
+    sd->addServlet("/big", [](HttpRequest::ptr req, HttpResponse::ptr rsp, myserver::Socket::ptr) {
+        rsp->setBody(std::string(4 * 1024 * 1024, 'b'));
+        return 0;
+    });
+    sd->addGlobServlet("/api/*", [](HttpRequest::ptr req, HttpResponse::ptr rsp, myserver::Socket::ptr) {
+        rsp->setBody("api:" + req->getPath());
+        return 0;
+    });
+    assert(server->bind(myserver::IPv4Address::Create("127.0.0.1", 0)));
+    assert(server->start());
+    addr = server->getSocks()[0]->getLocalAddress();
+    return server;
+}
+
+void testKeepAlive(myserver::Address::ptr addr) {
+    Client c(addr);
+    int status;
+    std::string body;
+    bool keepalive;
+    for(int i = 0; i < 3; ++i) {
+        c.send("GET /hello HTTP/1.1\r\nHost: a\r\n\r\n");
+        assert(c.recvResponse(status, body, keepalive));
+        assert(status == 200 && body == "world" && keepalive);
+    }
+    c.send("GET /nothing HTTP/1.1\r\n\r\n");
+    assert(c.recvResponse(status, body, keepalive) && status == 404);
+    c.send("GET /api/v1/user HTTP/1.1\r\n\r\n");
+    assert(c.recvResponse(status, body, keepalive) && body == "api:/api/v1/user");
+    c.send("POST /echo?q=1 HTTP/1.1\r\nX-Tag: t\r\nContent-Length: 4\r\n\r\nbody");
+    assert(c.recvResponse(status, body, keepalive) && body == "body|q=1|t");
+    c.send("POST /echo HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabc\r\n2\r\nde\r\n0\r\n\r\n");
+    assert(c.recvResponse(status, body, keepalive) && body == "abcde||");
+    std::cout << "testKeepAlive ok" << std::endl;
+}
+
+void testPipeline(myserver::Address::ptr addr) {
+    Client c(addr);
+    std::string reqs;
+    for(int i = 0; i < 100; ++i) {
+        reqs += "POST /echo HTTP/1.1\r\nContent-Length: " + std::to_string(std::to_string(i).size())
+              + "\r\n\r\n" + std::to_string(i);
+    }
+    // 分两次发送，第二段从请求中间截断
+    size_t half = reqs.size() / 2 + 7;
+    c.send(reqs.substr(0, half));
+    c.send(reqs.substr(half));
+    int status;
+    std::string body;
+    bool keepalive;
+    for(int i = 0; i < 100; ++i) {
+        assert(c.recvResponse(status, body, keepalive));
+        assert(body == std::to_string(i) + "||");
+    }
+    std::cout << "testPipeline ok" << std::endl;
+}
+
+void testClose(myserver::Address::ptr addr) {
+    int status;
+    std::string body;
+    bool keepalive;
+    {
+        Client c(addr);
+        c.send("GET /hello HTTP/1.1\r\nConnection: close\r\n\r\nGET /hello HTTP/1.1\r\n\r\n");
+        assert(c.recvResponse(status, body, keepalive) && !keepalive);
+        // close 之后的流水线请求被丢弃
+        assert(c.isPeerClosed());
+    }
+    {
+        Client c(addr);
+        c.send("GET /hello HTTP/1.0\r\n\r\n");
+        assert(c.recvResponse(status, body, keepalive) && !keepalive && body == "world");
+        assert(c.isPeerClosed());
+    }
+    {
+        Client c(addr);
+        c.send("GET /hello HTTP/1.0\r\nConnection: keep-alive\r\n\r\n");
+        assert(c.recvResponse(status, body, keepalive) && keepalive);
+    }
+    {
+        Client c(addr);
+        c.send("GET /hello HTTP/1.1\r\nBad Header\r\n\r\n");
+        assert(c.recvResponse(status, body, keepalive) && status == 400 && !keepalive);
+        assert(c.isPeerClosed());
+    }
+    {
+        // HEAD 响应带 Content-Length 但没有消息体
+        myserver::Socket::ptr sock = myserver::Socket::CreateTCP(addr);
+        assert(sock->connect(addr, 1000));
+        sock->setRecvTimeout(3000);
+        std::string req = "HEAD /hello HTTP/1.1\r\nConnection: close\r\n\r\n";
+        assert(sock->send(req.c_str(), req.size()) == (int)req.size());
+        std::string data;
+        char buf[256];
+        int n;
+        while((n = sock->recv(buf, sizeof(buf))) > 0) {
+            data.append(buf, n);
+        }
+        assert(data.find("Content-Length: 5\r\n") != std::string::npos);
+        assert(data.size() == data.find("\r\n\r\n") + 4);
+    }
+    std::cout << "testClose ok" << std::endl;
+}
+
+// 大响应触发部分写，连接在输出排空前不读入新请求
+void testBigResponse(myserver::Address::ptr addr) {
+    Client c(addr);
+    c.send("GET /big HTTP/1.1\r\n\r\nGET /hello HTTP/1.1\r\n\r\nGET /big HTTP/1.1\r\n\r\n");
+    int status;
+    std::string body;
+    bool keepalive;
+    assert(c.recvResponse(status, body, keepalive) && body.size() == 4 * 1024 * 1024);
+    assert(c.recvResponse(status, body, keepalive) && body == "world");
+    assert(c.recvResponse(status, body, keepalive) && body.size() == 4 * 1024 * 1024);
+    std::cout << "testBigResponse ok" << std::endl;
+}
+
+void testDispatch() {
+    ServletDispatch::ptr sd(new ServletDispatch);
+    FunctionServlet::callback cb = [](HttpRequest::ptr, HttpResponse::ptr, myserver::Socket::ptr) {
+        return 0;
+    };
+    Servlet::ptr a = std::make_shared<FunctionServlet>(cb);
+    Servlet::ptr b = std::make_shared<FunctionServlet>(cb);
+    sd->addServlet("/a", a);
+    sd->addGlobServlet("/a*", b);
+    assert(sd->getMatchedServlet("/a") == a);
+    assert(sd->getMatchedServlet("/ab") == b);
+    assert(sd->getMatchedServlet("/b") == sd->getDefault());
+    sd->delServlet("/a");
+    assert(sd->getMatchedServlet("/a") == b);
+    sd->delGlobServlet("/a*");
+    assert(!sd->getGlobServlet("/a"));
+    assert(sd->getMatchedServlet("/a") == sd->getDefault());
+
+    // 被替换/删除的 Servlet 不再被分发器引用
+    std::weak_ptr<Servlet> weak_a = a;
+    sd->addServlet("/a", a);
+    sd->addServlet("/a", b);
+    a.reset();
+    assert(weak_a.expired());
+    assert(sd->getMatchedServlet("/a") == b);
+    Servlet::ptr c = std::make_shared<FunctionServlet>(cb);
+    for(int i = 0; i < 1000; ++i) {
+        sd->addServlet("/c" + std::to_string(i), c);
+    }
+    sd->addGlobServlet("/c/*", c);
+    assert(c.use_count() == 1002);
+    for(int i = 0; i < 1000; ++i) {
+        sd->delServlet("/c" + std::to_string(i));
+    }
+    sd->delGlobServlet("/c/*");
+    assert(c.use_count() == 1);
+    sd->delServlet("/a");
+
+    // 批量注册
+    std::vector<std::pair<std::string, Servlet::ptr> > routes;
+    for(int i = 0; i < 100; ++i) {
+        routes.push_back(std::make_pair("/r" + std::to_string(i), std::make_shared<FunctionServlet>(cb)));
+    }
+    sd->addServlets(routes);
+    sd->addGlobServlets({std::make_pair(std::string("/g/*"), b)});
+    assert(sd->getMatchedServlet("/r42") == routes[42].second);
+    assert(sd->getMatchedServlet("/g/x") == b);
+
+    HttpResponse rsp;
+    rsp.setStatus(HttpStatus::NOT_FOUND);
+    rsp.setBody("x");
+    assert(rsp.toString() == "HTTP/1.1 404 Not Found\r\nConnection: close\r\nContent-Length: 1\r\n\r\nx");
+    HttpRequest req(0x11, false);
+    req.setPath("/p");
+    req.setQuery("a=1");
+    req.setHeader("Host", "h");
+    assert(req.toString() == "GET /p?a=1 HTTP/1.1\r\nHost: h\r\n\r\n");
+    assert(StringToHttpMethod("POST") == HttpMethod::POST);
+    assert(StringToHttpMethod("FOO") == HttpMethod::INVALID_METHOD);
+    std::cout << "testDispatch ok" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    testDispatch();
+    // 两种IO后端各跑一遍，不支持 io_uring 时第二遍退回 poll
+    for(auto backend : {"poll", "io_uring"}) {
+        myserver::Config::Lookup<std::string>("tcp_server.io_backend")->setValue(backend);
+        myserver::Address::ptr addr;
+        HttpServer::ptr server = startServer(addr);
+        std::cout << "io_backend=" << backend << " actual="
+                  << (server->getIoBackend() == HttpServer::IO_URING ? "io_uring" : "poll") << std::endl;
+        testKeepAlive(addr);
+        testPipeline(addr);
+        testClose(addr);
+        testBigResponse(addr);
+        server->stop();
+        size_t total = 0;
+        for(auto n : server->getConnectionCounts()) {
+            total += n;
+        }
+        assert(total == 0);
+    }
+    myserver::Config::Lookup<std::string>("tcp_server.io_backend")->setValue("poll");
+    return 0;
+}
@@ -0,0 +1,491 @@
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <map>
+#include <unordered_map>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/ptrace.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include "log.h"
+#include "config.h"
+#include "thread.h"
+#include "io_uring.h"
+#include "http/http_server.h"
+
+// poll 与 io_uring 两种工作线程IO后端的对比基准，echo 与 HTTP 各一组
+// 吞吐：客户端线程各持有一个长连接，一问一答循环，输出每秒请求数与 p50/p99 延迟
+// 系统调用：在 fork 出的子进程中运行服务端，用 ptrace 统计客户端发送固定请求数期间
+// 服务端进程的全部系统调用，输出每请求的系统调用数及主要调用的分布
+// 用法: io_backend_bench [duration_ms=2000] [connections=16] [workers=2] [trace_requests=2000]
+
+namespace {
+
+inline uint64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+const size_t ECHO_SIZE = 64;
+
+/**
+ * @brief 回显服务器
+ * @details poll 后端通过 onPollPrepare / onPollEvents 读；
+ *          io_uring 后端每个连接一个 multishot recv，在 onUringCompletion 中直接写回
+ */
+class EchoServer : public myserver::TcpServer {
+public:
+    typedef std::shared_ptr<EchoServer> ptr;
+
+    EchoServer(size_t workers)
+        :myserver::TcpServer(workers)
+        ,m_conns(workers) {
+    }
+
+    void stop() override {
+        myserver::TcpServer::stop();
+        for(auto& w : m_conns) {
+            w.polled.clear();
+            w.uring.clear();
+        }
+    }
+protected:
+    struct Conn {
+        myserver::Socket::ptr sock;
+        bool fixed = false;
+        bool armed = false;
+    };
+
+    struct WorkerConns {
+        std::vector<myserver::Socket::ptr> polled;
+        std::unordered_map<uint64_t, Conn> uring;
+        uint64_t nextId = 0;
+        std::vector<char> buf = std::vector<char>(64 * 1024);
+    };
+
+    void handleClient(myserver::Socket::ptr client) override {
+        client->setRecvTimeout(0);
+        WorkerConns& w = m_conns[GetWorkerIndex()];
+        myserver::IoUring* ring = GetWorkerUring();
+        if(!ring) {
+            w.polled.push_back(client);
+            return;
+        }
+        uint64_t id = ++w.nextId;
+        Conn& conn = w.uring[id];
+        conn.sock = client;
+        conn.fixed = ring->updateFile(client->getSocket(), client->getSocket());
+        arm(*ring, id, conn);
+    }
+
+    int onPollPrepare(size_t worker, std::vector<pollfd>& fds) override {
+        for(auto& sock : m_conns[worker].polled) {
+            pollfd pfd;
+            pfd.fd = sock->getSocket();
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            fds.push_back(pfd);
+        }
+        return -1;
+    }
+
+    void onPollEvents(size_t worker, pollfd* fds, size_t size) override {
+        WorkerConns& w = m_conns[worker];
+        bool closed = false;
+        for(size_t i = 0; i < size; ++i) {
+            if(!fds[i].revents) {
+                continue;
+            }
+            myserver::Socket::ptr& sock = w.polled[i];
+            int n = sock->recv(&w.buf[0], w.buf.size());
+            if(n > 0 && sock->send(&w.buf[0], n) == n) {
+                continue;
+            }
+            if(n < 0 && errno == ETIMEDOUT) {
+                continue;
+            }
+            sock.reset();
+            closed = true;
+        }
+        if(closed) {
+            w.polled.erase(std::remove(w.polled.begin(), w.polled.end(), myserver::Socket::ptr()),
+                           w.polled.end());
+        }
+    }
+
+    void onUringCompletion(size_t worker, const myserver::IoUring::Completion& c) override {
+        WorkerConns& w = m_conns[worker];
+        myserver::IoUring& ring = *GetWorkerUring();
+        uint16_t bid = 0;
+        bool has_buf = c.getBufferId(bid);
+        auto it = w.uring.find(c.data);
+        if(it == w.uring.end()) {
+            if(has_buf) {
+                ring.recycleBuffer(bid);
+            }
+            return;
+        }
+        Conn& conn = it->second;
+        if(!c.hasMore()) {
+            conn.armed = false;
+        }
+        bool ok = true;
+        if(c.res > 0 && has_buf) {
+            ok = conn.sock->send(ring.getBuffer(bid), c.res) == c.res;
+            ring.recycleBuffer(bid);
+        } else if(c.res != -ENOBUFS) {
+            ok = false;
+        }
+        if(!ok) {
+            if(conn.armed) {
+                myserver::IoUring::PrepCancel(ring.getSqe(), MakeUringData(it->first), 0);
+            }
+            if(conn.fixed) {
+                ring.updateFile(conn.sock->getSocket(), -1);
+            }
+            w.uring.erase(it);
+            return;
+        }
+        if(!conn.armed) {
+            arm(ring, it->first, conn);
+        }
+    }
+private:
+    void arm(myserver::IoUring& ring, uint64_t id, Conn& conn) {
+        myserver::IoUring::PrepRecvMultishot(ring.getSqe(), conn.sock->getSocket(), conn.fixed,
+                URING_BUFFER_GROUP, MakeUringData(id));
+        conn.armed = true;
+    }
+private:
+    std::vector<WorkerConns> m_conns;
+};
+
+myserver::TcpServer::ptr startServer(bool http, const std::string& backend, size_t workers) {
+    myserver::Config::Lookup<std::string>("tcp_server.io_backend")->setValue(backend);
+    myserver::TcpServer::ptr server;
+    if(http) {
+        myserver::http::HttpServer::ptr s(new myserver::http::HttpServer(true, workers));
+        s->getServletDispatch()->addServlet("/ping", [](myserver::http::HttpRequest::ptr req,
+                    myserver::http::HttpResponse::ptr rsp, myserver::Socket::ptr) {
+            rsp->setHeader("Content-Type", "text/plain");
+            rsp->setBody("pong");
+            return 0;
+        });
+        server = s;
+    } else {
+        server.reset(new EchoServer(workers));
+    }
+    if(!server->bind(myserver::IPv4Address::Create("127.0.0.1", 0)) || !server->start()) {
+        std::cerr << "server start fail" << std::endl;
+        exit(1);
+    }
+    if(backend == "io_uring" && server->getIoBackend() != myserver::TcpServer::IO_URING) {
+        std::cerr << "io_uring unavailable" << std::endl;
+        exit(1);
+    }
+    return server;
+}
+
+// 一问一答的客户端连接
+class Client {
+public:
+    Client(bool http, myserver::Address::ptr addr)
+        :m_http(http)
+        ,m_sock(myserver::Socket::CreateTCP(addr))
+        ,m_parser(myserver::http::HttpParser::RESPONSE)
+        ,m_buf(64 * 1024)
+        ,m_ok(m_sock->connect(addr, 1000)) {
+        m_sock->setRecvTimeout(3000);
+        m_req = http ? "GET /ping HTTP/1.1\r\nHost: bench\r\nUser-Agent: io_backend_bench\r\n\r\n"
+                     : std::string(ECHO_SIZE, 'e');
+    }
+
+    bool isOk() const { return m_ok; }
+
+    bool roundTrip() {
+        if(!m_ok || m_sock->send(m_req.c_str(), m_req.size()) != (int)m_req.size()) {
+            return m_ok = false;
+        }
+        size_t len = 0;
+        m_parser.reset();
+        while(true) {
+            int n = m_sock->recv(&m_buf[len], m_buf.size() - len);
+            if(n <= 0) {
+                return m_ok = false;
+            }
+            len += n;
+            if(!m_http) {
+                if(len == ECHO_SIZE) {
+                    return true;
+                }
+                continue;
+            }
+            myserver::http::HttpParser::Result rt = m_parser.execute(&m_buf[0], len);
+            if(rt == myserver::http::HttpParser::DONE) {
+                return true;
+            }
+            if(rt == myserver::http::HttpParser::ERROR) {
+                return m_ok = false;
+            }
+        }
+    }
+private:
+    bool m_http;
+    myserver::Socket::ptr m_sock;
+    myserver::http::HttpParser m_parser;
+    std::vector<char> m_buf;
+    std::string m_req;
+    bool m_ok;
+};
+
+std::string runThroughput(bool http, const std::string& backend, size_t workers,
+                          size_t connections, uint64_t duration_ms) {
+    myserver::TcpServer::ptr server = startServer(http, backend, workers);
+    myserver::Address::ptr addr = server->getSocks()[0]->getLocalAddress();
+
+    std::atomic<bool> stop(false);
+    std::vector<uint64_t> errors(connections);
+    std::vector<std::vector<uint32_t> > lats(connections);
+    std::vector<myserver::Thread::ptr> thrs;
+    for(size_t i = 0; i < connections; ++i) {
+        thrs.push_back(myserver::Thread::ptr(new myserver::Thread([&, i]() {
+            Client c(http, addr);
+            while(!stop.load(std::memory_order_relaxed)) {
+                uint64_t begin = NowNs();
+                if(!c.roundTrip()) {
+                    ++errors[i];
+                    return;
+                }
+                lats[i].push_back((NowNs() - begin) / 1000);
+            }
+        }, "IBB_C" + std::to_string(i))));
+    }
+    uint64_t begin = NowNs();
+    usleep(duration_ms * 1000);
+    stop = true;
+    for(auto& t : thrs) {
+        t->join();
+    }
+    double sec = (NowNs() - begin) / 1e9;
+    server->stop();
+
+    uint64_t errs = 0;
+    std::vector<uint32_t> lat;
+    for(size_t i = 0; i < connections; ++i) {
+        errs += errors[i];
+        lat.insert(lat.end(), lats[i].begin(), lats[i].end());
+    }
+    std::sort(lat.begin(), lat.end());
+    auto pct = [&lat](double p) -> uint32_t {
+        return lat.empty() ? 0 : lat[std::min(lat.size() - 1, (size_t)(lat.size() * p))];
+    };
+    std::stringstream ss;
+    ss << "\"requests\":" << lat.size()
+       << ",\"errors\":" << errs
+       << ",\"requests_per_sec\":" << (uint64_t)(lat.size() / sec)
+       << ",\"p50_us\":" << pct(0.5)
+       << ",\"p99_us\":" << pct(0.99);
+    return ss.str();
+}
+
+const char* SyscallName(uint64_t nr) {
+    switch(nr) {
+#define XX(name) case SYS_##name: return #name;
+        XX(read);
+        XX(write);
+        XX(recvfrom);
+        XX(sendto);
+        XX(recvmsg);
+        XX(sendmsg);
+        XX(sendfile);
+        XX(poll);
+        XX(ppoll);
+        XX(accept4);
+        XX(close);
+        XX(futex);
+        XX(io_uring_enter);
+        XX(io_uring_register);
+        XX(epoll_wait);
+        XX(setsockopt);
+        XX(getsockname);
+        XX(getpeername);
+#undef XX
+        default:
+            return nullptr;
+    }
+}
+
+/**
+ * @brief 统计服务端每请求的系统调用
+ * @details 子进程 PTRACE_TRACEME 后停住，由本线程跟踪其全部线程(PTRACE_O_TRACECLONE)；
+ *          驱动线程建立连接并预热后开始计数，发送 requests 个请求后停止计数并杀死子进程
+ */
+std::string runSyscalls(bool http, const std::string& backend, size_t workers,
+                        size_t connections, size_t requests) {
+    int fds[2];
+    if(pipe(fds)) {
+        std::cerr << "pipe fail" << std::endl;
+        exit(1);
+    }
+    pid_t pid = fork();
+    if(pid == 0) {
+        close(fds[0]);
+        ptrace(PTRACE_TRACEME, 0, nullptr, nullptr);
+        raise(SIGSTOP);
+        myserver::TcpServer::ptr server = startServer(http, backend, workers);
+        uint16_t port = std::dynamic_pointer_cast<myserver::IPAddress>(
+                server->getSocks()[0]->getLocalAddress())->getPort();
+        if(write(fds[1], &port, sizeof(port)) != sizeof(port)) {
+            _exit(1);
+        }
+        while(true) {
+            pause();
+        }
+    }
+    close(fds[1]);
+    int st = 0;
+    waitpid(pid, &st, 0);
+    ptrace(PTRACE_SETOPTIONS, pid, nullptr,
+           (void*)(long)(PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACECLONE | PTRACE_O_EXITKILL));
+    ptrace(PTRACE_SYSCALL, pid, nullptr, nullptr);
+
+    std::atomic<bool> counting(false);
+    std::atomic<uint64_t> done(0);
+    myserver::Thread driver([&]() {
+        uint16_t port = 0;
+        if(read(fds[0], &port, sizeof(port)) != sizeof(port)) {
+            kill(pid, SIGKILL);
+            return;
+        }
+        myserver::Address::ptr addr = myserver::IPv4Address::Create("127.0.0.1", port);
+        std::vector<std::unique_ptr<Client> > clients;
+        for(size_t i = 0; i < connections; ++i) {
+            clients.push_back(std::unique_ptr<Client>(new Client(http, addr)));
+            for(int k = 0; k < 10; ++k) {
+                clients.back()->roundTrip();
+            }
+        }
+        std::atomic<size_t> ready(0);
+        std::vector<myserver::Thread::ptr> thrs;
+        for(size_t i = 0; i < connections; ++i) {
+            thrs.push_back(myserver::Thread::ptr(new myserver::Thread([&, i]() {
+                ++ready;
+                while(!counting) {
+                    if(ready == connections) {
+                        counting = true;
+                    }
+                }
+                for(size_t k = i; k < requests; k += connections) {
+                    if(clients[i]->roundTrip()) {
+                        ++done;
+                    }
+                }
+            }, "IBB_T" + std::to_string(i))));
+        }
+        for(auto& t : thrs) {
+            t->join();
+        }
+        counting = false;
+        kill(pid, SIGKILL);
+    }, "IBB_driver");
+
+    std::map<uint64_t, uint64_t> calls;
+    while(true) {
+        pid_t tid = waitpid(-1, &st, __WALL);
+        if(tid < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if(WIFEXITED(st) || WIFSIGNALED(st)) {
+            if(tid == pid) {
+                break;
+            }
+            continue;
+        }
+        int sig = 0;
+        if(WIFSTOPPED(st)) {
+            int s = WSTOPSIG(st);
+            if(s == (SIGTRAP | 0x80)) {
+                __ptrace_syscall_info info;
+                if(counting && ptrace(PTRACE_GET_SYSCALL_INFO, tid, (void*)sizeof(info), &info) > 0
+                        && info.op == PTRACE_SYSCALL_INFO_ENTRY) {
+                    ++calls[info.entry.nr];
+                }
+            } else if(s != SIGTRAP && s != SIGSTOP) {
+                // PTRACE_EVENT_CLONE 与新线程的初始 SIGSTOP 不转发
+                sig = s;
+            }
+        }
+        ptrace(PTRACE_SYSCALL, tid, nullptr, (void*)(long)sig);
+    }
+    driver.join();
+    close(fds[0]);
+
+    uint64_t total = 0;
+    for(auto& i : calls) {
+        total += i.second;
+    }
+    double n = done ? (double)done : 1.0;
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(2)
+       << "\"traced_requests\":" << done
+       << ",\"syscalls_per_request\":" << total / n
+       << ",\"per_request\":{";
+    bool first = true;
+    for(auto& i : calls) {
+        if(i.second / n < 0.01) {
+            continue;
+        }
+        const char* name = SyscallName(i.first);
+        ss << (first ? "" : ",") << "\"" << (name ? name : ("nr_" + std::to_string(i.first)).c_str())
+           << "\":" << i.second / n;
+        first = false;
+    }
+    ss << "}";
+    return ss.str();
+}
+
+}
+
+int main(int argc, char** argv) {
+    uint64_t duration_ms = argc > 1 ? atoi(argv[1]) : 2000;
+    size_t connections = argc > 2 ? atoi(argv[2]) : 16;
+    size_t workers = argc > 3 ? atoi(argv[3]) : 2;
+    size_t trace_requests = argc > 4 ? atoi(argv[4]) : 2000;
+    LOGGER_NAME("system")->setLevel(myserver::LogLevel::WARN);
+
+    std::vector<std::string> backends = {"poll"};
+    if(myserver::IoUring::IsSupported()) {
+        backends.push_back("io_uring");
+    }
+    std::vector<std::string> lines;
+    for(bool http : {false, true}) {
+        for(auto& backend : backends) {
+            // 先在没有线程时 fork 跟踪子进程，再测吞吐
+            std::string sys = runSyscalls(http, backend, workers, connections, trace_requests);
+            std::string tput = runThroughput(http, backend, workers, connections, duration_ms);
+            lines.push_back(std::string("{\"server\":\"") + (http ? "http" : "echo")
+                    + "\",\"backend\":\"" + backend + "\"," + tput + "," + sys + "}");
+        }
+    }
+    std::cout << "{\"hardware_threads\":" << std::thread::hardware_concurrency()
+              << ",\"duration_ms\":" << duration_ms
+              << ",\"connections\":" << connections
+              << ",\"workers\":" << workers
+              << ",\"results\":[" << std::endl;
+    for(size_t i = 0; i < lines.size(); ++i) {
+        std::cout << "  " << lines[i] << (i + 1 < lines.size() ? "," : "") << std::endl;
+    }
+    std::cout << "]}" << std::endl;
+    return 0;
+}
@@ -0,0 +1,219 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include "io_uring.h"
+#include "config.h"
+#include "thread.h"
+#include "http/http_server.h"
+
+// IoUring 测试：multishot poll、multishot recv 与缓冲区环、固定文件、取消；
+// 以及 io_uring 后端下 HttpServer 的背压与空闲超时
+
+using namespace myserver;
+
+void testPoll() {
+    IoUring ring;
+    assert(ring.init(8));
+    int efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    IoUring::PrepPollAdd(ring.getSqe(), efd, POLLIN, true, 1);
+    assert(ring.submit() == 1);
+    // 没有事件时按超时返回
+    assert(ring.submit(1, 10) == 0);
+    IoUring::Completion c[8];
+    assert(ring.reap(c, 8) == 0);
+
+    uint64_t one = 1;
+    assert(write(efd, &one, sizeof(one)) == sizeof(one));
+    ring.submit(1, 1000);
+    assert(ring.reap(c, 8) == 1 && c[0].data == 1 && (c[0].res & POLLIN) && c[0].hasMore());
+
+    IoUring::PrepPollRemove(ring.getSqe(), 1, 2);
+    ring.submit(2, 1000);
+    size_t n = ring.reap(c, 8);
+    bool removed = false;
+    for(size_t i = 0; i < n; ++i) {
+        if(c[i].data == 2) {
+            removed = c[i].res == 0;
+        }
+    }
+    assert(removed);
+    close(efd);
+    std::cout << "testPoll ok" << std::endl;
+}
+
+void testRecv() {
+    IoUring ring;
+    assert(ring.init(8));
+    assert(ring.registerFiles(64));
+    assert(ring.setupBufRing(0, 2, 16));
+    int sv[2];
+    assert(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sv) == 0);
+    assert(ring.updateFile(sv[0], sv[0]));
+    IoUring::PrepRecvMultishot(ring.getSqe(), sv[0], true, 0, 7);
+    ring.submit();
+
+    // 每个缓冲区16字节，32字节的数据需要两个缓冲区
+    std::string data(32, 'x');
+    data[0] = 'a';
+    assert(write(sv[1], data.c_str(), data.size()) == (ssize_t)data.size());
+    std::string got;
+    IoUring::Completion c[8];
+    bool more = true;
+    while(got.size() < data.size()) {
+        ring.submit(1, 1000);
+        size_t n = ring.reap(c, 8);
+        assert(n > 0);
+        for(size_t i = 0; i < n; ++i) {
+            uint16_t bid;
+            assert(c[i].data == 7 && c[i].res > 0 && c[i].getBufferId(bid));
+            got.append(ring.getBuffer(bid), c[i].res);
+            more = c[i].hasMore();
+            // 不归还缓冲区
+        }
+    }
+    assert(got == data);
+
+    // 缓冲区用尽后 multishot 以 ENOBUFS 结束
+    if(more) {
+        assert(write(sv[1], "b", 1) == 1);
+        ring.submit(1, 1000);
+        assert(ring.reap(c, 8) == 1 && c[0].res == -ENOBUFS && !c[0].hasMore());
+    }
+    ring.recycleBuffer(0);
+    ring.recycleBuffer(1);
+    IoUring::PrepRecvMultishot(ring.getSqe(), sv[0], true, 0, 8);
+    ring.submit(1, 1000);
+    size_t n = ring.reap(c, 8);
+    uint16_t bid;
+    if(!more) {
+        assert(write(sv[1], "b", 1) == 1);
+        ring.submit(1, 1000);
+        n = ring.reap(c, 8);
+    }
+    assert(n == 1 && c[0].data == 8 && c[0].res == 1 && c[0].getBufferId(bid));
+    assert(ring.getBuffer(bid)[0] == 'b');
+    ring.recycleBuffer(bid);
+
+    // 取消后以 ECANCELED 结束
+    IoUring::PrepCancel(ring.getSqe(), 8, 9);
+    ring.submit(2, 1000);
+    n = ring.reap(c, 8);
+    int found = 0;
+    for(size_t i = 0; i < n; ++i) {
+        if(c[i].data == 8) {
+            assert(c[i].res == -ECANCELED && !c[i].hasMore());
+            ++found;
+        } else if(c[i].data == 9) {
+            assert(c[i].res == 0);
+            ++found;
+        }
+    }
+    assert(found == 2);
+
+    // 清除槽位后固定文件请求失败
+    assert(ring.updateFile(sv[0], -1));
+    IoUring::PrepRecvMultishot(ring.getSqe(), sv[0], true, 0, 10);
+    ring.submit(1, 1000);
+    assert(ring.reap(c, 8) == 1 && c[0].res == -EBADF);
+    close(sv[0]);
+    close(sv[1]);
+    std::cout << "testRecv ok enter=" << ring.getEnterCount() << std::endl;
+}
+
+http::HttpServer::ptr startServer(Address::ptr& addr) {
+    http::HttpServer::ptr server(new http::HttpServer(true, 1));
+    server->getServletDispatch()->addServlet("/hello",
+            [](http::HttpRequest::ptr req, http::HttpResponse::ptr rsp, Socket::ptr) {
+        rsp->setBody(std::string(1024, 'h'));
+        return 0;
+    });
+    assert(server->bind(IPv4Address::Create("127.0.0.1", 0)));
+    assert(server->start());
+    assert(server->getIoBackend() == http::HttpServer::IO_URING);
+    addr = server->getSocks()[0]->getLocalAddress();
+    return server;
+}
+
+// 对端先发完大量流水线请求再读，服务端输出积压时暂停接收，排空后恢复
+void testBackpressure(Address::ptr addr) {
+    const size_t count = 20000;
+    Socket::ptr sock = Socket::CreateTCP(addr);
+    assert(sock->connect(addr, 1000));
+    sock->setRecvTimeout(5000);
+    sock->setSendTimeout(5000);
+    Thread sender([sock, count]() {
+        std::string reqs;
+        for(size_t i = 0; i < count; ++i) {
+            reqs += "GET /hello HTTP/1.1\r\n\r\n";
+        }
+        size_t sent = 0;
+        while(sent < reqs.size()) {
+            int n = sock->send(&reqs[sent], reqs.size() - sent);
+            assert(n > 0);
+            sent += n;
+        }
+    }, "sender");
+    // 等发送方被流控阻塞后再开始读
+    usleep(200 * 1000);
+
+    http::HttpParser parser(http::HttpParser::RESPONSE);
+    std::string buf;
+    size_t begin = 0;
+    size_t done = 0;
+    char tmp[65536];
+    while(done < count) {
+        if(begin < buf.size()) {
+            http::HttpParser::Result rt = parser.execute(&buf[begin], buf.size() - begin);
+            assert(rt != http::HttpParser::ERROR);
+            if(rt == http::HttpParser::DONE) {
+                assert(parser.getStatus() == 200 && parser.getBody().length == 1024);
+                begin += parser.getConsumed();
+                parser.reset();
+                ++done;
+                continue;
+            }
+        }
+        if(begin > 0) {
+            buf.erase(0, begin);
+            begin = 0;
+        }
+        int n = sock->recv(tmp, sizeof(tmp));
+        assert(n > 0);
+        buf.append(tmp, n);
+    }
+    sender.join();
+    std::cout << "testBackpressure ok" << std::endl;
+}
+
+// 空闲连接按读超时关闭
+void testIdleTimeout(Address::ptr addr, http::HttpServer::ptr server) {
+    server->setReadTimeout(100);
+    Socket::ptr sock = Socket::CreateTCP(addr);
+    assert(sock->connect(addr, 1000));
+    sock->setRecvTimeout(3000);
+    char c;
+    assert(sock->recv(&c, 1) == 0);
+    server->setReadTimeout(120 * 1000);
+    std::cout << "testIdleTimeout ok" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    if(!IoUring::IsSupported()) {
+        std::cout << "io_uring not supported, skip" << std::endl;
+        return 0;
+    }
+    testPoll();
+    testRecv();
+
+    Config::Lookup<std::string>("tcp_server.io_backend")->setValue("io_uring");
+    Address::ptr addr;
+    http::HttpServer::ptr server = startServer(addr);
+    testBackpressure(addr);
+    testIdleTimeout(addr, server);
+    server->stop();
+    return 0;
+}
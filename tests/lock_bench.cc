@@ -0,0 +1,302 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <unistd.h>
+#include <sched.h>
+#include "thread.h"
+#include "mutex.h"
+
+// 锁性能基准：对 mutex.h 中的各类锁扫描 线程数 x 临界区长度 x 读写比例，
+// 以 JSON 输出吞吐、加锁延迟分位数与公平性，用于按数据选择锁类型
+// 用法: lock_bench [duration_ms=100] [max_threads=8]
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+inline uint64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now().time_since_epoch()).count();
+}
+
+// 对数-线性直方图：小于64ns精确计数，之后每个2的幂区间再均分32个子桶
+class LatencyHistogram {
+public:
+    enum { LINEAR = 64, SUB = 32, EXPS = 40 };
+
+    LatencyHistogram()
+        : m_buckets(LINEAR + SUB * EXPS, 0) {
+    }
+
+    void record(uint64_t v) {
+        ++m_buckets[index(v)];
+        ++m_count;
+        if(v > m_max) {
+            m_max = v;
+        }
+    }
+
+    void merge(const LatencyHistogram& rhs) {
+        for(size_t i = 0; i < m_buckets.size(); ++i) {
+            m_buckets[i] += rhs.m_buckets[i];
+        }
+        m_count += rhs.m_count;
+        m_max = std::max(m_max, rhs.m_max);
+    }
+
+    // 返回分位数p(0~1)所在桶的下界
+    uint64_t percentile(double p) const {
+        if(!m_count) {
+            return 0;
+        }
+        uint64_t target = (uint64_t)std::ceil(p * m_count);
+        uint64_t seen = 0;
+        for(size_t i = 0; i < m_buckets.size(); ++i) {
+            seen += m_buckets[i];
+            if(seen >= target) {
+                return lowerBound(i);
+            }
+        }
+        return m_max;
+    }
+
+    uint64_t getMax() const { return m_max; }
+private:
+    static size_t index(uint64_t v) {
+        if(v < LINEAR) {
+            return v;
+        }
+        int msb = 63 - __builtin_clzll(v);      // msb >= 6
+        int shift = msb - 5;
+        size_t e = msb - 6;
+        if(e >= EXPS) {
+            return LINEAR + SUB * EXPS - 1;
+        }
+        return LINEAR + e * SUB + ((v >> shift) - SUB);
+    }
+
+    static uint64_t lowerBound(size_t i) {
+        if(i < LINEAR) {
+            return i;
+        }
+        size_t e = (i - LINEAR) / SUB;
+        size_t s = (i - LINEAR) % SUB;
+        return (uint64_t)(SUB + s) << (e + 1);
+    }
+private:
+    std::vector<uint64_t> m_buckets;
+    uint64_t m_count = 0;
+    uint64_t m_max = 0;
+};
+
+// 统一读/写加锁接口：互斥锁的读操作同样走 lock()
+template<class T>
+struct LockOps {
+    static void rdlock(T& m) { m.lock(); }
+    static void wrlock(T& m) { m.lock(); }
+    static void unlock(T& m) { m.unlock(); }
+};
+
+template<>
+struct LockOps<myserver::RWMutex> {
+    static void rdlock(myserver::RWMutex& m) { m.rdlock(); }
+    static void wrlock(myserver::RWMutex& m) { m.wrlock(); }
+    static void unlock(myserver::RWMutex& m) { m.unlock(); }
+};
+
+template<>
+struct LockOps<myserver::BRWMutex> {
+    static void rdlock(myserver::BRWMutex& m) { m.rdlock(); }
+    static void wrlock(myserver::BRWMutex& m) { m.wrlock(); }
+    static void unlock(myserver::BRWMutex& m) { m.unlock(); }
+};
+
+// 模拟临界区内的计算量
+inline void cpuWork(int n) {
+    for(int i = 0; i < n; ++i) {
+        __asm__ __volatile__("" ::: "memory");
+    }
+}
+
+struct BenchCase {
+    std::string lock;
+    int threads;
+    int cs_len;
+    int read_pct;
+};
+
+struct BenchResult {
+    BenchCase bc;
+    double seconds = 0;
+    uint64_t ops = 0;
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+    LatencyHistogram latency;
+    std::vector<uint64_t> per_thread;
+    bool consistent = true;
+};
+
+struct WorkerState {
+    uint64_t ops = 0;
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+    LatencyHistogram latency;
+    char pad[64];
+};
+
+template<class LockType>
+BenchResult runCase(const BenchCase& bc, int duration_ms) {
+    typedef LockOps<LockType> Ops;
+    LockType lock;
+    std::atomic<uint64_t> shared(0);
+    std::atomic<int> ready(0);
+    std::atomic<bool> start(false);
+    std::atomic<bool> stop(false);
+    std::vector<WorkerState> states(bc.threads);
+    std::vector<myserver::Thread::ptr> thrs;
+
+    for(int t = 0; t < bc.threads; ++t) {
+        WorkerState* st = &states[t];
+        thrs.push_back(myserver::Thread::ptr(new myserver::Thread([&, st, t]() {
+            uint64_t rnd = 0x9E3779B97F4A7C15ULL * (t + 1);
+            ready.fetch_add(1);
+            while(!start.load(std::memory_order_acquire)) {
+                sched_yield();
+            }
+            while(!stop.load(std::memory_order_relaxed)) {
+                rnd ^= rnd << 13; rnd ^= rnd >> 7; rnd ^= rnd << 17;
+                bool is_read = (int)(rnd % 100) < bc.read_pct;
+                uint64_t t0 = NowNs();
+                if(is_read) {
+                    Ops::rdlock(lock);
+                } else {
+                    Ops::wrlock(lock);
+                }
+                uint64_t t1 = NowNs();
+                if(is_read) {
+                    (void)shared.load(std::memory_order_relaxed);
+                    cpuWork(bc.cs_len);
+                    ++st->reads;
+                } else {
+                    // 非原子的读-改-写：锁失效时会丢失更新，用于正确性校验
+                    shared.store(shared.load(std::memory_order_relaxed) + 1,
+                                 std::memory_order_relaxed);
+                    cpuWork(bc.cs_len);
+                    ++st->writes;
+                }
+                Ops::unlock(lock);
+                st->latency.record(t1 - t0);
+                ++st->ops;
+            }
+        }, "BENCH_" + std::to_string(t))));
+    }
+
+    while(ready.load() != bc.threads) {
+        sched_yield();
+    }
+    uint64_t begin = NowNs();
+    start.store(true, std::memory_order_release);
+    usleep(duration_ms * 1000);
+    stop.store(true);
+    for(auto& i : thrs) {
+        i->join();
+    }
+    uint64_t end = NowNs();
+
+    BenchResult r;
+    r.bc = bc;
+    r.seconds = (end - begin) / 1e9;
+    for(auto& s : states) {
+        r.ops += s.ops;
+        r.reads += s.reads;
+        r.writes += s.writes;
+        r.latency.merge(s.latency);
+        r.per_thread.push_back(s.ops);
+    }
+    r.consistent = shared.load() == r.writes;
+    return r;
+}
+
+// Jain 公平性指数：1 表示完全公平，1/n 表示被单线程独占
+double jainIndex(const std::vector<uint64_t>& v) {
+    double sum = 0, sq = 0;
+    for(auto x : v) {
+        sum += x;
+        sq += (double)x * x;
+    }
+    return sq == 0 ? 1.0 : sum * sum / (v.size() * sq);
+}
+
+std::string toJson(const BenchResult& r) {
+    std::stringstream ss;
+    uint64_t mn = *std::min_element(r.per_thread.begin(), r.per_thread.end());
+    uint64_t mx = *std::max_element(r.per_thread.begin(), r.per_thread.end());
+    ss << "{\"lock\":\"" << r.bc.lock << "\""
+       << ",\"threads\":" << r.bc.threads
+       << ",\"cs_len\":" << r.bc.cs_len
+       << ",\"read_pct\":" << r.bc.read_pct
+       << ",\"seconds\":" << r.seconds
+       << ",\"ops\":" << r.ops
+       << ",\"reads\":" << r.reads
+       << ",\"writes\":" << r.writes
+       << ",\"ops_per_sec\":" << (uint64_t)(r.ops / r.seconds)
+       << ",\"latency_ns\":{\"p50\":" << r.latency.percentile(0.5)
+       << ",\"p90\":" << r.latency.percentile(0.9)
+       << ",\"p99\":" << r.latency.percentile(0.99)
+       << ",\"p999\":" << r.latency.percentile(0.999)
+       << ",\"max\":" << r.latency.getMax() << "}"
+       << ",\"fairness\":{\"jain\":" << jainIndex(r.per_thread)
+       << ",\"min_ops\":" << mn
+       << ",\"max_ops\":" << mx
+       << ",\"min_max_ratio\":" << (mx ? (double)mn / mx : 1.0) << "}"
+       << ",\"consistent\":" << (r.consistent ? "true" : "false")
+       << "}";
+    return ss.str();
+}
+
+}
+
+int main(int argc, char** argv) {
+    int duration_ms = argc > 1 ? atoi(argv[1]) : 100;
+    int max_threads = argc > 2 ? atoi(argv[2]) : 8;
+
+    std::vector<int> thread_counts;
+    for(int t = 1; t <= max_threads; t *= 2) {
+        thread_counts.push_back(t);
+    }
+    std::vector<int> cs_lens = {0, 16, 256};
+    std::vector<int> rw_ratios = {10, 50, 90, 99};  // 读比例：10写多 ~ 99读多
+
+    std::vector<std::string> results;
+    for(int threads : thread_counts) {
+        for(int cs : cs_lens) {
+#define XX(type, name, pct) \
+            results.push_back(toJson(runCase<type>(BenchCase{name, threads, cs, pct}, duration_ms)));
+
+            XX(myserver::NullMutex, "NullMutex", 0);
+            XX(myserver::Mutex, "Mutex", 0);
+            XX(myserver::Spinlock, "Spinlock", 0);
+            XX(myserver::CASLock, "CASLock", 0);
+            for(int pct : rw_ratios) {
+                XX(myserver::RWMutex, "RWMutex", pct);
+                XX(myserver::BRWMutex, "BRWMutex", pct);
+            }
+#undef XX
+        }
+    }
+
+    std::cout << "{\"hardware_threads\":" << std::thread::hardware_concurrency()
+              << ",\"duration_ms\":" << duration_ms
+              << ",\"results\":[" << std::endl;
+    for(size_t i = 0; i < results.size(); ++i) {
+        std::cout << "  " << results[i] << (i + 1 < results.size() ? "," : "") << std::endl;
+    }
+    std::cout << "]}" << std::endl;
+    return 0;
+}
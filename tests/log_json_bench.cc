@@ -0,0 +1,88 @@
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <string>
+#include <time.h>
+#include "log.h"
+
+// JSON 与文本格式化基准：每条事件格式化耗时(ns)，消息无需转义/需要转义两种情况；
+// 以及 256 字节字符串的转义检查耗时(SSE2 与逐字节对比)，以 JSON 输出
+// 用法: log_json_bench [events=200000]
+
+namespace {
+
+uint64_t NowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+__attribute__((noinline)) bool ScalarNeedsEscape(const char* str, size_t len) {
+    for(size_t i = 0; i < len; ++i) {
+        unsigned char c = str[i];
+        if(c < 0x20 || c == '"' || c == '\\') {
+            return true;
+        }
+    }
+    return false;
+}
+
+double formatNs(myserver::LogFormatter::ptr fmt, myserver::Logger::ptr logger,
+                myserver::LogEvent::ptr event, uint64_t n) {
+    std::stringstream ss;
+    uint64_t begin = NowNs();
+    for(uint64_t i = 0; i < n; ++i) {
+        fmt->format(ss, logger, event);
+        if((i & 1023) == 1023) {
+            ss.str("");
+        }
+    }
+    return (double)(NowNs() - begin) / n;
+}
+
+template<class F>
+double checkNs(uint64_t n, const std::string& s, F f) {
+    volatile bool sink = false;
+    uint64_t begin = NowNs();
+    for(uint64_t i = 0; i < n; ++i) {
+        sink = f(s.c_str(), s.size());
+    }
+    (void)sink;
+    return (double)(NowNs() - begin) / n;
+}
+
+}
+
+int main(int argc, char** argv) {
+    uint64_t n = argc > 1 ? atoll(argv[1]) : 200000;
+    myserver::Logger::ptr logger(new myserver::Logger("bench"));
+    myserver::LogFormatter::ptr text = logger->getFormatter();
+    myserver::LogFormatter::ptr json = myserver::LogFormatter::Create("json");
+
+    std::string plain_msg = "GET /api/v1/users/12345 200 OK cost_ms=3 bytes=1834 client=10.0.0.17:53122";
+    std::string escape_msg = "request body {\"user\":\"bob\",\"path\":\"C:\\\\tmp\"}\nsecond line";
+    myserver::LogEvent::ptr plain = myserver::LogEvent::Create(myserver::LogLevel::INFO,
+            __FILE__, __LINE__, (uint32_t)0, myserver::ThreadContext::GetThis(), (uint64_t)1760000000000ULL);
+    plain->getSS() << plain_msg;
+    myserver::LogEvent::ptr escape = myserver::LogEvent::Create(myserver::LogLevel::INFO,
+            __FILE__, __LINE__, (uint32_t)0, myserver::ThreadContext::GetThis(), (uint64_t)1760000000000ULL);
+    escape->getSS() << escape_msg;
+
+    double text_plain = formatNs(text, logger, plain, n);
+    double json_plain = formatNs(json, logger, plain, n);
+    double text_escape = formatNs(text, logger, escape, n);
+    double json_escape = formatNs(json, logger, escape, n);
+
+    std::string s(256, 'a');
+    double simd = checkNs(n * 10, s, myserver::JsonLogFormatter::NeedsEscape);
+    double scalar = checkNs(n * 10, s, ScalarNeedsEscape);
+
+    std::cout << "{\"events\":" << n
+              << ",\"text_plain_ns\":" << text_plain
+              << ",\"json_plain_ns\":" << json_plain
+              << ",\"text_escape_ns\":" << text_escape
+              << ",\"json_escape_ns\":" << json_escape
+              << ",\"check256_simd_ns\":" << simd
+              << ",\"check256_scalar_ns\":" << scalar << "}" << std::endl;
+    return 0;
+}
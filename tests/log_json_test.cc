@@ -0,0 +1,117 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cassert>
+#include <unistd.h>
+#include <yaml-cpp/yaml.h>
+#include "log.h"
+#include "config.h"
+#include "thread.h"
+
+// JsonLogFormatter 测试：转义快路径判断、事件字段与附加字段输出、特殊字符转义可被解析还原、按配置选择 json 格式
+
+using namespace myserver;
+
+static LogEvent::ptr MakeEvent(const std::string& msg) {
+    LogEvent::ptr e = LogEvent::Create(LogLevel::WARN, "tests/log_json_test.cc", 42,
+            (uint32_t)7, ThreadContext::GetThis(), (uint64_t)1760000000123ULL);
+    e->getSS() << msg;
+    return e;
+}
+
+void testNeedsEscape() {
+    assert(!JsonLogFormatter::NeedsEscape("", 0));
+    std::string plain(100, 'a');
+    for(size_t len = 0; len <= plain.size(); ++len) {
+        assert(!JsonLogFormatter::NeedsEscape(plain.c_str(), len));
+    }
+    // 特殊字符出现在 16 字节块内任意位置与尾部都能检出
+    const char specials[] = {'"', '\\', '\n', '\t', '\x01', '\x1f'};
+    for(char c : specials) {
+        for(size_t pos = 0; pos < 40; ++pos) {
+            std::string s(40, 'x');
+            s[pos] = c;
+            assert(JsonLogFormatter::NeedsEscape(s.c_str(), s.size()));
+            assert(!JsonLogFormatter::NeedsEscape(s.c_str(), pos));
+        }
+    }
+    // UTF-8 与 DEL 不需要转义
+    std::string utf8 = "\xe4\xb8\xad\xe6\x96\x87 log message \x7f with high bytes \xff";
+    assert(!JsonLogFormatter::NeedsEscape(utf8.c_str(), utf8.size()));
+
+    std::string out;
+    JsonLogFormatter::AppendString(out, "a\"b\\c\nd\x01", 8);
+    assert(out == "\"a\\\"b\\\\c\\nd\\u0001\"");
+    std::cout << "testNeedsEscape ok" << std::endl;
+}
+
+void testFormat() {
+    Thread::SetName("JSON_main");
+    Logger::ptr logger(new Logger("json_test"));
+    JsonLogFormatter::ptr fmt(new JsonLogFormatter);
+    assert(fmt->getPattern() == "json");
+
+    LogEvent::ptr e = MakeEvent("user login");
+    e->getSS() << LogField("uid", 42) << LogField("name", "bob \"b\"") << LogField("ok", true)
+               << LogField("ratio", 0.5);
+    std::string line = fmt->format(logger, e);
+    assert(line.back() == '\n');
+    assert(line.find('\n') == line.size() - 1);
+    assert(line.find("{\"time\":1760000000123,\"level\":\"WARN\",\"logger\":\"json_test\",\"thread_id\":") == 0);
+    assert(line.find(",\"thread_name\":\"JSON_main\",\"fiber_id\":0,\"elapse\":7,"
+                     "\"file\":\"tests/log_json_test.cc\",\"line\":42,\"message\":\"user login\","
+                     "\"uid\":42,\"name\":\"bob \\\"b\\\"\",\"ok\":true,\"ratio\":0.5}\n") != std::string::npos);
+
+    YAML::Node node = YAML::Load(line);
+    assert(node["level"].as<std::string>() == "WARN");
+    assert(node["uid"].as<int>() == 42);
+    assert(node["name"].as<std::string>() == "bob \"b\"");
+
+    // 含控制字符与引号的消息转义后能还原
+    std::string msg = "line1\nline2\t\"quoted\" back\\slash \x02 end";
+    node = YAML::Load(fmt->format(logger, MakeEvent(msg)));
+    assert(node["message"].as<std::string>() == msg);
+
+    // 文本格式在消息后追加字段，普通流直接输出 key=value
+    LogFormatter::ptr text(new LogFormatter("%m"));
+    assert(text->format(logger, e) == "user login uid=42 name=bob \"b\" ok=true ratio=0.5");
+    std::stringstream ss;
+    ss << LogField("k", 1);
+    assert(ss.str() == "k=1");
+    std::cout << "testFormat ok " << line;
+}
+
+void testConfig() {
+    std::string file = "/tmp/log_json_test.log";
+    YAML::Node root = YAML::Load(
+        "logs:\n"
+        "  - name: json_cfg\n"
+        "    level: info\n"
+        "    appenders:\n"
+        "      - type: FileLogAppender\n"
+        "        file: " + file + "\n"
+        "        formatter: json\n");
+    Config::LoadFromYaml(root);
+    Logger::ptr logger = LOGGER_NAME("json_cfg");
+    assert(logger->toYamlString().find("formatter: json") != std::string::npos);
+    LOG_INFO(logger) << "from config" << LogField("port", 8080);
+
+    std::ifstream ifs(file);
+    std::string line;
+    assert(std::getline(ifs, line));
+    YAML::Node node = YAML::Load(line);
+    assert(node["logger"].as<std::string>() == "json_cfg");
+    assert(node["level"].as<std::string>() == "INFO");
+    assert(node["message"].as<std::string>() == "from config");
+    assert(node["port"].as<int>() == 8080);
+    unlink(file.c_str());
+    std::cout << "testConfig ok" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    testNeedsEscape();
+    testFormat();
+    testConfig();
+    return 0;
+}
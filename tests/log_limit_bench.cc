@@ -0,0 +1,66 @@
+#include <iostream>
+#include <cstdlib>
+#include <time.h>
+#include "log.h"
+
+// 调用点采样/限流基准：级别过滤、未配置默认策略、LOG_EVERY_N 与 LOG_RATE_LIMITED 抑制路径的单次耗时(ns)，以 JSON 输出
+// 用法: log_limit_bench [calls=2000000]
+
+namespace {
+
+uint64_t NowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// 丢弃输出，只计格式化以外的开销
+class NullAppender : public myserver::LogAppender {
+public:
+    void log(myserver::Logger::ptr logger, myserver::LogEvent::ptr event) override { }
+    std::string toYamlString() override { return ""; }
+};
+
+myserver::Logger::ptr g_logger = LOGGER_NAME("limit_bench");
+
+__attribute__((noinline)) void Filtered() {
+    LOG_DEBUG(g_logger) << "filtered";
+}
+
+__attribute__((noinline)) void Plain() {
+    LOG_INFO(g_logger) << "plain";
+}
+
+__attribute__((noinline)) void EveryN() {
+    LOG_EVERY_N(g_logger, myserver::LogLevel::INFO, 1000000000) << "every_n";
+}
+
+__attribute__((noinline)) void RateLimited() {
+    LOG_RATE_LIMITED(g_logger, myserver::LogLevel::INFO, 1) << "rate_limited";
+}
+
+template<class F>
+double run(uint64_t n, F f) {
+    uint64_t begin = NowNs();
+    for(uint64_t i = 0; i < n; ++i) {
+        f();
+    }
+    return (double)(NowNs() - begin) / n;
+}
+
+}
+
+int main(int argc, char** argv) {
+    uint64_t n = argc > 1 ? atoll(argv[1]) : 2000000;
+    g_logger->addAppender(myserver::LogAppender::ptr(new NullAppender));
+    g_logger->setLevel(myserver::LogLevel::INFO);
+    double filtered = run(n, Filtered);
+    double plain = run(n / 10, Plain);
+    double every_n = run(n, EveryN);
+    double rate_limited = run(n, RateLimited);
+    std::cout << "{\"calls\":" << n << ",\"filtered_ns\":" << filtered
+              << ",\"plain_ns\":" << plain
+              << ",\"every_n_suppressed_ns\":" << every_n
+              << ",\"rate_limited_suppressed_ns\":" << rate_limited << "}" << std::endl;
+    return 0;
+}
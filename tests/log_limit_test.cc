@@ -0,0 +1,184 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <unistd.h>
+#include <yaml-cpp/yaml.h>
+#include "log.h"
+#include "config.h"
+#include "mutex.h"
+#include "thread.h"
+
+// 调用点采样与限流测试：LOG_EVERY_N、LOG_RATE_LIMITED 的放行条数与汇总、多线程共享限额、配置默认策略
+
+using namespace myserver;
+
+// 收集日志事件
+class CaptureAppender : public LogAppender {
+public:
+    typedef std::shared_ptr<CaptureAppender> ptr;
+    void log(Logger::ptr logger, LogEvent::ptr event) override {
+        Mutex::Lock lock(m_mutex);
+        m_events.push_back(event);
+    }
+    std::string toYamlString() override { return ""; }
+    std::vector<LogEvent::ptr> events() {
+        Mutex::Lock lock(m_mutex);
+        return m_events;
+    }
+    void clear() {
+        Mutex::Lock lock(m_mutex);
+        m_events.clear();
+    }
+private:
+    Mutex m_mutex;
+    std::vector<LogEvent::ptr> m_events;
+};
+
+static Logger::ptr g_logger = LOGGER_NAME("limit_test");
+static CaptureAppender::ptr g_capture(new CaptureAppender);
+
+// 被抑制条数之和(来自汇总消息)
+static uint64_t SuppressedInSummaries(const std::vector<LogEvent::ptr>& events, size_t* normal) {
+    uint64_t total = 0;
+    *normal = 0;
+    for(auto& e : events) {
+        std::string c = e->getContent();
+        if(c.find("suppressed ") == 0) {
+            assert(c.find(" identical messages") != std::string::npos);
+            total += atoll(c.c_str() + 11);
+        } else {
+            ++*normal;
+        }
+    }
+    return total;
+}
+
+void testEveryN() {
+    for(int i = 0; i < 10; ++i) {
+        LOG_EVERY_N(g_logger, LogLevel::INFO, 3) << "every " << i;
+    }
+    std::vector<LogEvent::ptr> events = g_capture->events();
+    assert(events.size() == 4);
+    assert(events[0]->getContent() == "every 0");
+    assert(events[1]->getContent() == "every 3");
+    assert(events[3]->getContent() == "every 9");
+    g_capture->clear();
+
+    // 级别被过滤的调用不计数
+    g_logger->setLevel(LogLevel::WARN);
+    for(int i = 0; i < 5; ++i) {
+        LOG_EVERY_N(g_logger, LogLevel::INFO, 2) << "filtered";
+    }
+    g_logger->setLevel(LogLevel::DEBUG);
+    assert(g_capture->events().empty());
+    std::cout << "testEveryN ok" << std::endl;
+}
+
+static void rateLimitedOp(int i) {
+    LOG_RATE_LIMITED(g_logger, LogLevel::ERROR, 10) << "rate " << i;
+}
+
+void testRateLimited() {
+    for(int i = 0; i < 100; ++i) {
+        rateLimitedOp(i);
+    }
+    // 突发上限为 1 秒的配额
+    std::vector<LogEvent::ptr> events = g_capture->events();
+    assert(events.size() >= 10 && events.size() <= 12);
+    assert(events[0]->getContent() == "rate 0");
+    size_t passed = events.size();
+    g_capture->clear();
+
+    usleep(350 * 1000);
+    rateLimitedOp(100);
+    events = g_capture->events();
+    assert(events.size() == 2);
+    assert(events[0]->getLevel() == LogLevel::ERROR);
+    assert(events[0]->getContent() == "suppressed " + std::to_string(100 - passed) + " identical messages");
+    assert(events[0]->getLine() == events[1]->getLine());
+    assert(events[1]->getContent() == "rate 100");
+    g_capture->clear();
+    std::cout << "testRateLimited ok" << std::endl;
+}
+
+static void threadOp() {
+    LOG_RATE_LIMITED(g_logger, LogLevel::WARN, 50) << "thread";
+}
+
+void testThreads() {
+    uint64_t start = Clock::NowMs();
+    std::vector<Thread::ptr> thrs;
+    for(int i = 0; i < 4; ++i) {
+        thrs.push_back(Thread::ptr(new Thread([]() {
+            for(int j = 0; j < 2000; ++j) {
+                threadOp();
+            }
+        }, "LIMIT_" + std::to_string(i))));
+    }
+    for(auto& t : thrs) {
+        t->join();
+    }
+    uint64_t cost_ms = Clock::NowMs() - start;
+    // 再放行一条以输出剩余的汇总
+    usleep(100 * 1000);
+    threadOp();
+    uint64_t cost_after_ms = Clock::NowMs() - start;
+
+    size_t normal = 0;
+    uint64_t suppressed = SuppressedInSummaries(g_capture->events(), &normal);
+    assert(normal + suppressed == 8001);
+    assert(normal >= 50 && normal <= 50 + cost_after_ms * 50 / 1000 + 2);
+    g_capture->clear();
+    std::cout << "testThreads ok passed=" << normal << " suppressed=" << suppressed
+              << " cost_ms=" << cost_ms << std::endl;
+}
+
+static void defaultOp(int i) {
+    LOG_INFO(g_logger) << "default " << i;
+}
+
+void testDefaultPolicy() {
+    YAML::Node root = YAML::Load(
+        "logs:\n"
+        "  - name: limit_test\n"
+        "    level: debug\n"
+        "    rate_limit: 5\n"
+        "    every_n: 2\n");
+    Config::LoadFromYaml(root);
+    assert(g_logger->getRateLimit() == 5);
+    assert(g_logger->getEveryN() == 2);
+    assert(g_logger->hasSitePolicy());
+    assert(LoggerMgr::GetInstance()->toYamlString().find("rate_limit: 5") != std::string::npos);
+    g_logger->addAppender(g_capture);
+
+    // 先每 2 条取 1 条，再按每秒 5 条限流
+    for(int i = 0; i < 40; ++i) {
+        defaultOp(i);
+    }
+    std::vector<LogEvent::ptr> events = g_capture->events();
+    assert(events.size() >= 5 && events.size() <= 6);
+    assert(events[0]->getContent() == "default 0");
+    assert(events[1]->getContent() == "default 2");
+    g_capture->clear();
+
+    // 去掉策略后全部输出
+    g_logger->setRateLimit(0);
+    g_logger->setEveryN(0);
+    assert(!g_logger->hasSitePolicy());
+    for(int i = 0; i < 40; ++i) {
+        defaultOp(i);
+    }
+    assert(g_capture->events().size() == 40);
+    g_capture->clear();
+    std::cout << "testDefaultPolicy ok" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    g_logger->addAppender(g_capture);
+    testEveryN();
+    testRateLimited();
+    testThreads();
+    testDefaultPolicy();
+    return 0;
+}
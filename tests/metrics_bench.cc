@@ -0,0 +1,86 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <cstdlib>
+#include "thread.h"
+#include "metrics.h"
+
+// 指标热路径基准：各线程并发累加，对比分片 Counter 与单个共享 std::atomic，
+// 以及 Histogram::record；以 JSON 输出每次操作耗时(ns)
+// 用法: metrics_bench [ops_per_thread=2000000] [max_threads=8]
+
+namespace {
+
+inline uint64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 返回每次操作的平均耗时(ns)
+double run(size_t threads, uint64_t ops, std::function<void(uint64_t)> op) {
+    std::atomic<size_t> ready(0);
+    std::atomic<bool> go(false);
+    std::vector<uint64_t> ns(threads);
+    std::vector<myserver::Thread::ptr> thrs;
+    for(size_t i = 0; i < threads; ++i) {
+        thrs.push_back(myserver::Thread::ptr(new myserver::Thread([&, i]() {
+            ++ready;
+            while(!go) {
+            }
+            uint64_t begin = NowNs();
+            for(uint64_t k = 0; k < ops; ++k) {
+                op(k);
+            }
+            ns[i] = NowNs() - begin;
+        }, "MB_" + std::to_string(i))));
+    }
+    while(ready != threads) {
+    }
+    go = true;
+    uint64_t total = 0;
+    for(size_t i = 0; i < threads; ++i) {
+        thrs[i]->join();
+        total += ns[i];
+    }
+    return (double)total / threads / ops;
+}
+
+}
+
+int main(int argc, char** argv) {
+    uint64_t ops = argc > 1 ? atoll(argv[1]) : 2000000;
+    size_t max_threads = argc > 2 ? atoi(argv[2]) : 8;
+
+    myserver::Counter::ptr counter = myserver::Metrics::GetCounter("bench.counter");
+    myserver::Histogram::ptr hist = myserver::Metrics::GetHistogram("bench.histogram_us");
+    std::atomic<int64_t> shared(0);
+
+    std::cout << "{\"hardware_threads\":" << std::thread::hardware_concurrency()
+              << ",\"shards\":" << myserver::detail::MetricShardCount()
+              << ",\"ops_per_thread\":" << ops
+              << ",\"results\":[" << std::endl;
+    bool first = true;
+    for(size_t t = 1; t <= max_threads; t *= 2) {
+        double c = run(t, ops, [&counter](uint64_t) { counter->inc(); });
+        double a = run(t, ops, [&shared](uint64_t) { shared.fetch_add(1, std::memory_order_relaxed); });
+        double h = run(t, ops, [&hist](uint64_t k) { hist->record(k & 0xffff); });
+        std::stringstream ss;
+        ss.precision(2);
+        ss << std::fixed << "{\"threads\":" << t
+           << ",\"counter_ns\":" << c
+           << ",\"shared_atomic_ns\":" << a
+           << ",\"histogram_ns\":" << h << "}";
+        std::cout << (first ? "  " : ",\n  ") << ss.str();
+        first = false;
+    }
+    std::cout << std::endl << "]}" << std::endl;
+    if(counter->value() != shared.load()) {
+        std::cerr << "counter mismatch" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <stdexcept>
+#include <unistd.h>
+#include "metrics.h"
+#include "mutex.h"
+#include "thread.h"
+
+// Metrics 测试：多线程计数、瞬时值、直方图桶边界与百分位、注册表命名规则、文本/JSON输出与周期输出
+
+using namespace myserver;
+
+// 收集日志内容
+class CaptureAppender : public LogAppender {
+public:
+    typedef std::shared_ptr<CaptureAppender> ptr;
+    void log(Logger::ptr logger, LogEvent::ptr event) override {
+        Mutex::Lock lock(m_mutex);
+        m_lines.push_back(event->getContent());
+    }
+    std::string toYamlString() override { return ""; }
+    size_t size() {
+        Mutex::Lock lock(m_mutex);
+        return m_lines.size();
+    }
+    std::string last() {
+        Mutex::Lock lock(m_mutex);
+        return m_lines.empty() ? "" : m_lines.back();
+    }
+private:
+    Mutex m_mutex;
+    std::vector<std::string> m_lines;
+};
+
+void testCounterGauge() {
+    Counter::ptr c = Metrics::GetCounter("test.counter", "test counter");
+    Gauge::ptr g = Metrics::GetGauge("test.gauge");
+    std::vector<Thread::ptr> thrs;
+    for(int i = 0; i < 8; ++i) {
+        thrs.push_back(Thread::ptr(new Thread([c, g]() {
+            for(int k = 0; k < 100000; ++k) {
+                c->inc();
+                g->inc();
+            }
+            for(int k = 0; k < 40000; ++k) {
+                g->dec();
+            }
+        }, "MT_" + std::to_string(i))));
+    }
+    for(auto& t : thrs) {
+        t->join();
+    }
+    assert(c->value() == 800000);
+    assert(g->value() == 480000);
+    g->set(5);
+    assert(g->value() == 5);
+    g->add(-7);
+    assert(g->value() == -2);
+
+    // 同名同类型返回同一对象
+    assert(Metrics::GetCounter("test.counter") == c);
+    assert(c->getDescription() == "test counter");
+    std::cout << "testCounterGauge ok" << std::endl;
+}
+
+void testHistogram() {
+    Histogram::ptr h = Metrics::GetHistogram("test.latency_us", "", 1000000, 7);
+    HistogramSnapshot empty = h->snapshot();
+    assert(empty.count == 0 && empty.percentile(50) == 0);
+
+    // 桶边界连续且覆盖全部取值
+    HistogramSnapshot s = h->snapshot();
+    assert(s.bucketLower(0) == 0);
+    for(size_t i = 1; i < s.buckets.size(); ++i) {
+        assert(s.bucketLower(i) == s.bucketUpper(i - 1) + 1);
+    }
+    assert(s.bucketUpper(s.buckets.size() - 1) >= 1000000);
+
+    // 1..10000 均匀分布，小于128的值精确，其余相对误差不超过 1/64
+    for(uint64_t v = 1; v <= 10000; ++v) {
+        h->record(v);
+    }
+    s = h->snapshot();
+    assert(s.count == 10000 && s.sum == 10000ULL * 10001 / 2);
+    assert(s.min == 1 && s.max >= 10000 && s.max <= 10000 + 10000 / 64);
+    uint64_t p50 = s.percentile(50);
+    uint64_t p99 = s.percentile(99);
+    assert(p50 >= 5000 && p50 <= 5000 + 5000 / 64);
+    assert(p99 >= 9900 && p99 <= 9900 + 9900 / 64);
+    assert(s.percentile(100) == s.max);
+    assert(s.percentile(0) == 1);
+
+    // 超出上限的值计入最后一个桶
+    h->record(5000000);
+    s = h->snapshot();
+    assert(s.max == 1000000 && s.buckets.back() == 1);
+
+    // 多线程记录
+    Histogram::ptr h2 = Metrics::GetHistogram("test.mt_us");
+    std::vector<Thread::ptr> thrs;
+    for(int i = 0; i < 4; ++i) {
+        thrs.push_back(Thread::ptr(new Thread([h2]() {
+            for(int k = 0; k < 50000; ++k) {
+                h2->record(100);
+            }
+        }, "MH_" + std::to_string(i))));
+    }
+    for(auto& t : thrs) {
+        t->join();
+    }
+    s = h2->snapshot();
+    assert(s.count == 200000 && s.min == 100 && s.max == 100 && s.percentile(99.9) == 100);
+    std::cout << "testHistogram ok buckets=" << h->getBucketCount() << std::endl;
+}
+
+void testRegistry() {
+    assert(!Metrics::GetGauge("test.counter"));
+    assert(!Metrics::GetHistogram("test.gauge"));
+    bool thrown = false;
+    try {
+        Metrics::GetCounter("Test.Upper");
+    } catch(std::invalid_argument&) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    std::string text = Metrics::ToText();
+    assert(text.find("counter test.counter 800000\n") != std::string::npos);
+    assert(text.find("gauge test.gauge -2\n") != std::string::npos);
+    assert(text.find("histogram test.mt_us count=200000 sum=20000000 min=100 mean=100 p50=100") != std::string::npos);
+    std::string json = Metrics::ToJson();
+    assert(json.find("\"test.counter\":800000") != std::string::npos);
+    assert(json.find("\"test.mt_us\":{\"count\":200000,\"sum\":20000000,\"min\":100") != std::string::npos);
+    assert(json.front() == '{' && json.back() == '}');
+    std::cout << "testRegistry ok" << std::endl;
+}
+
+void testDump() {
+    CaptureAppender::ptr cap(new CaptureAppender);
+    Logger::ptr logger = LOGGER_NAME("metrics");
+    logger->clearAppenders();
+    logger->addAppender(cap);
+    Metrics::Dump(logger, true);
+    assert(cap->size() == 1 && cap->last() == Metrics::ToJson());
+
+    Metrics::StartDump(20);
+    Metrics::StartDump(20);
+    usleep(100 * 1000);
+    Metrics::StopDump();
+    size_t n = cap->size();
+    assert(n >= 3);
+    assert(cap->last().find("counter test.counter 800000") != std::string::npos);
+    usleep(50 * 1000);
+    assert(cap->size() == n);
+    std::cout << "testDump ok dumps=" << n - 1 << std::endl;
+}
+
+int main(int argc, char** argv) {
+    testCounterGauge();
+    testHistogram();
+    testRegistry();
+    testDump();
+    return 0;
+}
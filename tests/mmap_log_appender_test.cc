@@ -0,0 +1,167 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cassert>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <yaml-cpp/yaml.h>
+#include "mmap_log_appender.h"
+#include "config.h"
+
+// MmapFileLogAppender 测试：关闭时截断到实际大小、多线程写入跨段切换后每条日志恰好出现一次且各线程内有序、
+// 超长日志丢弃、崩溃报告追加、配置创建
+
+using namespace myserver;
+
+static const std::string FILE_PATH = "/tmp/mmap_log_appender_test.log";
+
+static std::string ReadFile(const std::string& path) {
+    std::ifstream ifs(path);
+    std::stringstream ss;
+    ss << ifs.rdbuf();
+    return ss.str();
+}
+
+static uint64_t FileSize(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? st.st_size : (uint64_t)-1;
+}
+
+static void Cleanup(uint32_t rolled) {
+    unlink(FILE_PATH.c_str());
+    for(uint32_t i = 1; i <= rolled; ++i) {
+        unlink((FILE_PATH + "." + std::to_string(i)).c_str());
+    }
+}
+
+static Logger::ptr NewLogger(LogAppender::ptr appender) {
+    static int s_id = 0;
+    Logger::ptr logger(new Logger("mmap_test_" + std::to_string(s_id++)));
+    appender->setFormatter(LogFormatter::ptr(new LogFormatter("%m%n")));
+    logger->addAppender(appender);
+    return logger;
+}
+
+void testBasic() {
+    MmapFileLogAppender::Options opt;
+    opt.segment_size = 1024 * 1024;
+    MmapFileLogAppender::ptr appender(new MmapFileLogAppender(FILE_PATH, opt));
+    Logger::ptr logger = NewLogger(appender);
+    std::stringstream expected;
+    for(int i = 0; i < 1000; ++i) {
+        LOG_INFO(logger) << "event " << i;
+        expected << "event " << i << "\n";
+    }
+    // 写入期间文件为预分配大小，内容已可见
+    assert(FileSize(FILE_PATH) == opt.segment_size);
+    assert(ReadFile(FILE_PATH).compare(0, expected.str().size(), expected.str()) == 0);
+    logger->clearAppenders();
+    appender.reset();
+    assert(ReadFile(FILE_PATH) == expected.str());
+    Cleanup(0);
+    std::cout << "testBasic ok" << std::endl;
+}
+
+void testRoll() {
+    const int threads = 16;
+    const int per_thread = 2000;
+    MmapFileLogAppender::Options opt;
+    opt.segment_size = 4096;
+    opt.sync_interval = 10;
+    MmapFileLogAppender::ptr appender(new MmapFileLogAppender(FILE_PATH, opt));
+    Logger::ptr logger = NewLogger(appender);
+    std::vector<Thread::ptr> thrs;
+    for(int t = 0; t < threads; ++t) {
+        thrs.push_back(Thread::ptr(new Thread([logger, t]() {
+            for(int i = 0; i < per_thread; ++i) {
+                LOG_INFO(logger) << "t" << t << " " << i;
+            }
+        }, "MMAP_" + std::to_string(t))));
+    }
+    for(auto& t : thrs) {
+        t->join();
+    }
+    logger->clearAppenders();
+    uint32_t rolled = appender->getRolled();
+    assert(appender->getDropped() == 0);
+    appender.reset();
+    assert(rolled > 10);
+    assert(access((FILE_PATH + ".next").c_str(), F_OK) != 0);
+
+    // 按段的先后拼接，每个线程的日志依次出现
+    std::vector<int> next(threads, 0);
+    for(uint32_t i = 1; i <= rolled + 1; ++i) {
+        std::string path = i <= rolled ? FILE_PATH + "." + std::to_string(i) : FILE_PATH;
+        std::string data = ReadFile(path);
+        assert(data.size() <= opt.segment_size);
+        if(i <= rolled) {
+            // 只在放不下下一条时切换
+            assert(data.size() + 16 > opt.segment_size);
+        }
+        std::stringstream ss(data);
+        std::string line;
+        while(std::getline(ss, line)) {
+            int t = -1, n = -1;
+            assert(sscanf(line.c_str(), "t%d %d", &t, &n) == 2);
+            assert(t >= 0 && t < threads && n == next[t]);
+            ++next[t];
+        }
+    }
+    for(int t = 0; t < threads; ++t) {
+        assert(next[t] == per_thread);
+    }
+    Cleanup(rolled);
+    std::cout << "testRoll ok segments=" << rolled + 1 << std::endl;
+}
+
+void testOversize() {
+    MmapFileLogAppender::Options opt;
+    opt.segment_size = 64;
+    MmapFileLogAppender::ptr appender(new MmapFileLogAppender(FILE_PATH, opt));
+    std::string big(100, 'x');
+    assert(!appender->append(big.c_str(), big.size()));
+    assert(appender->append("small\n", 6));
+    assert(appender->getDropped() == 1);
+    std::string report = "*** fatal signal ***\n";
+    appender->crashFlush(report.c_str(), report.size());
+    appender.reset();
+    assert(ReadFile(FILE_PATH) == "small\n" + report);
+    Cleanup(0);
+    std::cout << "testOversize ok" << std::endl;
+}
+
+void testConfig() {
+    YAML::Node root = YAML::Load(
+        "logs:\n"
+        "  - name: mmap_cfg\n"
+        "    level: info\n"
+        "    formatter: '%m%n'\n"
+        "    appenders:\n"
+        "      - type: MmapFileLogAppender\n"
+        "        file: " + FILE_PATH + "\n"
+        "        segment_size: 65536\n"
+        "        sync_interval: 50\n");
+    Config::LoadFromYaml(root);
+    Logger::ptr logger = LOGGER_NAME("mmap_cfg");
+    std::string yaml = logger->toYamlString();
+    assert(yaml.find("type: MmapFileLogAppender") != std::string::npos);
+    assert(yaml.find("segment_size: 65536") != std::string::npos);
+    assert(yaml.find("sync_interval: 50") != std::string::npos);
+    LOG_INFO(logger) << "from config";
+    assert(FileSize(FILE_PATH) == 65536);
+    assert(ReadFile(FILE_PATH).compare(0, 12, "from config\n") == 0);
+    logger->clearAppenders();
+    assert(ReadFile(FILE_PATH) == "from config\n");
+    Cleanup(0);
+    std::cout << "testConfig ok" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    testBasic();
+    testRoll();
+    testOversize();
+    testConfig();
+    return 0;
+}
@@ -0,0 +1,151 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <algorithm>
+#include <cstdlib>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "log.h"
+#include "mmap_log_appender.h"
+#include "thread.h"
+#include "mutex.h"
+
+// MmapFileLogAppender 与 FileLogAppender(std::ofstream) 多线程写文件对比：吞吐(字节/秒)与单次调用耗时分位(ns)，以 JSON 输出
+// FileLogAppender 本身不加锁，多线程写同一个 ofstream 需要外部互斥，基准中以 Mutex 包一层
+// 用法: mmap_log_bench [threads=16] [calls_per_thread=100000] [dir=/tmp]
+
+namespace {
+
+uint64_t NowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+class LockedAppender : public myserver::LogAppender {
+public:
+    LockedAppender(myserver::LogAppender::ptr appender) : m_appender(appender) { }
+    void log(myserver::Logger::ptr logger, myserver::LogEvent::ptr event) override {
+        myserver::Mutex::Lock lock(m_mutex);
+        m_appender->log(logger, event);
+    }
+    std::string toYamlString() override { return m_appender->toYamlString(); }
+private:
+    myserver::Mutex m_mutex;
+    myserver::LogAppender::ptr m_appender;
+};
+
+struct Result {
+    uint64_t elapse;
+    uint64_t p50;
+    uint64_t p99;
+    uint64_t max;
+};
+
+const char* PATTERN = "%d%T%t%T%p%T%m%n";
+
+Result run(myserver::LogAppender::ptr appender, int threads, int calls) {
+    myserver::Logger::ptr logger(new myserver::Logger("mmap_bench"));
+    logger->addAppender(appender);
+    // 每条消息 100 字节左右
+    const std::string payload(64, 'x');
+
+    std::atomic<int> ready(0);
+    std::atomic<bool> start(false);
+    std::vector<std::vector<uint64_t> > lat(threads);
+    std::vector<myserver::Thread::ptr> thrs;
+    for(int t = 0; t < threads; ++t) {
+        thrs.push_back(myserver::Thread::ptr(new myserver::Thread([&, t]() {
+            std::vector<uint64_t>& l = lat[t];
+            l.reserve(calls);
+            ready.fetch_add(1);
+            while(!start.load(std::memory_order_acquire)) {
+                sched_yield();
+            }
+            for(int i = 0; i < calls; ++i) {
+                uint64_t begin = NowNs();
+                LOG_INFO(logger) << payload << " " << i;
+                l.push_back(NowNs() - begin);
+            }
+        }, "MB_" + std::to_string(t))));
+    }
+    while(ready.load() < threads) {
+        sched_yield();
+    }
+    uint64_t begin = NowNs();
+    start.store(true, std::memory_order_release);
+    for(auto& t : thrs) {
+        t->join();
+    }
+    uint64_t elapse = NowNs() - begin;
+
+    std::vector<uint64_t> all;
+    for(auto& l : lat) {
+        all.insert(all.end(), l.begin(), l.end());
+    }
+    std::sort(all.begin(), all.end());
+    Result r;
+    r.elapse = elapse;
+    r.p50 = all[all.size() / 2];
+    r.p99 = all[all.size() * 99 / 100];
+    r.max = all.back();
+    return r;
+}
+
+uint64_t FileSize(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? st.st_size : 0;
+}
+
+// 写入字节数取自关闭后的文件大小
+std::string toJson(const Result& r, uint64_t bytes) {
+    return "{\"bytes_per_sec\":" + std::to_string((uint64_t)(bytes * 1e9 / r.elapse))
+        + ",\"p50_ns\":" + std::to_string(r.p50)
+        + ",\"p99_ns\":" + std::to_string(r.p99)
+        + ",\"max_ns\":" + std::to_string(r.max) + "}";
+}
+
+}
+
+int main(int argc, char** argv) {
+    int threads = argc > 1 ? atoi(argv[1]) : 16;
+    int calls = argc > 2 ? atoi(argv[2]) : 100000;
+    std::string dir = argc > 3 ? argv[3] : "/tmp";
+    std::string ofs_file = dir + "/mmap_log_bench_ofstream.log";
+    std::string mmap_file = dir + "/mmap_log_bench_mmap.log";
+
+    myserver::LogAppender::ptr file_appender(new myserver::FileLogAppender(ofs_file));
+    file_appender->setFormatter(myserver::LogFormatter::ptr(new myserver::LogFormatter(PATTERN)));
+    myserver::LogAppender::ptr ofs_appender(new LockedAppender(file_appender));
+    file_appender.reset();
+    Result ofs = run(ofs_appender, threads, calls);
+    ofs_appender.reset();
+    uint64_t ofs_bytes = FileSize(ofs_file);
+
+    myserver::MmapFileLogAppender::ptr mmap_appender(
+            new myserver::MmapFileLogAppender(mmap_file, myserver::MmapFileLogAppender::Options()));
+    mmap_appender->setFormatter(myserver::LogFormatter::ptr(new myserver::LogFormatter(PATTERN)));
+    Result mm = run(mmap_appender, threads, calls);
+    uint32_t rolled = mmap_appender->getRolled();
+    uint64_t dropped = mmap_appender->getDropped();
+    mmap_appender.reset();
+    uint64_t mmap_bytes = FileSize(mmap_file);
+    for(uint32_t i = 1; i <= rolled; ++i) {
+        mmap_bytes += FileSize(mmap_file + "." + std::to_string(i));
+    }
+
+    std::cout << "{\"threads\":" << threads << ",\"calls_per_thread\":" << calls
+              << ",\"ofstream\":" << toJson(ofs, ofs_bytes)
+              << ",\"mmap\":" << toJson(mm, mmap_bytes)
+              << ",\"mmap_segments\":" << rolled + 1
+              << ",\"mmap_dropped\":" << dropped << "}" << std::endl;
+    unlink(ofs_file.c_str());
+    unlink(mmap_file.c_str());
+    for(uint32_t i = 1; i <= rolled; ++i) {
+        unlink((mmap_file + "." + std::to_string(i)).c_str());
+    }
+    return 0;
+}
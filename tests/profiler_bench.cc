@@ -0,0 +1,51 @@
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <time.h>
+#include "profiler.h"
+#include "config.h"
+
+// 采样开销基准：固定计算量在关闭采样与不同采样频率下的耗时，以 JSON 输出相对开销
+// 用法: profiler_bench [iterations=200000000]
+
+namespace {
+
+uint64_t NowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+__attribute__((noinline)) uint64_t Work(uint64_t n) {
+    volatile uint64_t x = 0;
+    for(uint64_t i = 0; i < n; ++i) {
+        x = x + i * i;
+    }
+    return x;
+}
+
+double run(uint64_t n) {
+    uint64_t begin = NowNs();
+    Work(n);
+    return (NowNs() - begin) / 1e6;
+}
+
+}
+
+int main(int argc, char** argv) {
+    uint64_t n = argc > 1 ? atoll(argv[1]) : 200000000;
+    double base = run(n);
+    std::cout << "{\"iterations\":" << n << ",\"off_ms\":" << base << ",\"results\":[";
+    uint32_t freqs[] = {99, 1000, 4000};
+    for(size_t i = 0; i < sizeof(freqs) / sizeof(freqs[0]); ++i) {
+        myserver::Config::Lookup<uint32_t>("profiler.frequency")->setValue(freqs[i]);
+        myserver::Profiler::Start("/tmp/myserver_profiler_bench.folded");
+        double ms = run(n);
+        myserver::Profiler::Stop();
+        std::cout << (i ? "," : "") << "{\"frequency\":" << freqs[i] << ",\"ms\":" << ms
+                  << ",\"overhead_pct\":" << (ms - base) * 100 / base
+                  << ",\"samples\":" << myserver::Profiler::GetSamples() << "}";
+    }
+    std::cout << "]}" << std::endl;
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <cstdlib>
+#include <time.h>
+#include "profiler.h"
+#include "config.h"
+#include "thread.h"
+
+// Profiler 测试：按线程名称聚合的 folded 输出、帧指针回溯出调用关系、pprof 格式与配置开关
+
+using namespace myserver;
+
+static uint64_t ThreadCpuMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+__attribute__((noinline)) uint64_t BusyLeaf(uint64_t n) {
+    volatile uint64_t x = 0;
+    for(uint64_t i = 0; i < n; ++i) {
+        x = x + i * i;
+    }
+    return x;
+}
+
+// 消耗当前线程 ms 毫秒的 CPU 时间
+__attribute__((noinline)) uint64_t BusyOuter(uint64_t ms) {
+    uint64_t end = ThreadCpuMs() + ms;
+    uint64_t v = 0;
+    while(ThreadCpuMs() < end) {
+        v += BusyLeaf(20000);
+    }
+    return v;
+}
+
+static std::string ReadFile(const std::string& path) {
+    std::ifstream ifs(path, std::ios::binary);
+    std::stringstream ss;
+    ss << ifs.rdbuf();
+    return ss.str();
+}
+
+void testFolded() {
+    Config::Lookup<uint32_t>("profiler.frequency")->setValue(1000);
+    const std::string path = "/tmp/myserver_profiler_test.folded";
+    assert(Profiler::Start(path));
+    assert(!Profiler::Start(path));
+    assert(Profiler::IsRunning());
+    std::vector<Thread::ptr> thrs;
+    std::vector<uint64_t> cpu(2, 0);
+    for(int i = 0; i < 2; ++i) {
+        thrs.push_back(Thread::ptr(new Thread([&cpu, i]() {
+            BusyOuter(200);
+            cpu[i] = ThreadCpuMs();
+        }, "PROF_busy")));
+    }
+    for(auto& t : thrs) {
+        t->join();
+    }
+    BusyOuter(50);
+    Profiler::Stop();
+    assert(!Profiler::IsRunning());
+
+    std::stringstream ss(ReadFile(path));
+    std::string line;
+    uint64_t busy = 0;
+    uint64_t total = 0;
+    bool nested = false;
+    while(std::getline(ss, line)) {
+        size_t sp = line.rfind(' ');
+        assert(sp != std::string::npos);
+        uint64_t n = atoll(line.c_str() + sp + 1);
+        total += n;
+        if(line.compare(0, 10, "PROF_busy;") == 0) {
+            busy += n;
+            size_t outer = line.find("BusyOuter");
+            size_t leaf = line.find("BusyLeaf");
+            if(outer != std::string::npos && leaf != std::string::npos && outer < leaf) {
+                nested = true;
+            }
+        }
+    }
+    assert(total == Profiler::GetSamples());
+    // 按 overrun 计权后，样本数 × 1ms 应接近线程实际消耗的 CPU 时间
+    uint64_t busy_cpu = cpu[0] + cpu[1];
+    assert(busy * 10 >= busy_cpu * 8 && busy * 10 <= busy_cpu * 12);
+    assert(nested);
+    assert(ReadFile(path).find("UNKNOWN;") == 0 || ReadFile(path).find("\nUNKNOWN;") != std::string::npos);
+    std::cout << "testFolded ok samples=" << total << " busy=" << busy << " busy_cpu_ms=" << busy_cpu
+              << " dropped=" << Profiler::GetDropped() << std::endl;
+}
+
+void testPprof() {
+    Config::Lookup<std::string>("profiler.format")->setValue("pprof");
+    const std::string path = "/tmp/myserver_profiler_test.prof";
+    assert(Profiler::Start(path));
+    BusyOuter(100);
+    Profiler::Stop();
+    Config::Lookup<std::string>("profiler.format")->setValue("folded");
+
+    std::string data = ReadFile(path);
+    const uintptr_t* words = (const uintptr_t*)data.data();
+    assert(data.size() > 8 * sizeof(uintptr_t));
+    assert(words[0] == 0 && words[1] == 3 && words[2] == 0 && words[3] == 1000 && words[4] == 0);
+    size_t i = 5;
+    uint64_t samples = 0;
+    while(words[i] != 0) {
+        samples += words[i];
+        i += 2 + words[i + 1];
+    }
+    assert(words[i + 1] == 1 && words[i + 2] == 0);
+    assert(samples == Profiler::GetSamples() && samples > 0);
+    assert(data.find("profiler_test", (i + 3) * sizeof(uintptr_t)) != std::string::npos);
+    std::cout << "testPprof ok samples=" << samples << std::endl;
+}
+
+void testConfig() {
+    Config::Lookup<std::string>("profiler.output")->setValue("/tmp/myserver_profiler_config.folded");
+    Config::Lookup<bool>("profiler.enable")->setValue(true);
+    assert(Profiler::IsRunning());
+    BusyOuter(30);
+    Config::Lookup<bool>("profiler.enable")->setValue(false);
+    assert(!Profiler::IsRunning());
+    assert(ReadFile("/tmp/myserver_profiler_config.folded").find("BusyLeaf") != std::string::npos);
+    std::cout << "testConfig ok" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    testFolded();
+    testPprof();
+    testConfig();
+    return 0;
+}
@@ -0,0 +1,210 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <deque>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <sched.h>
+#include "thread.h"
+#include "mutex.h"
+#include "queue.h"
+
+// 队列吞吐基准：MPMCQueue / MPSCQueue(单条与批量) 对比 Mutex + std::deque
+// 用法: queue_bench [items_per_producer=200000]
+
+namespace {
+
+inline uint64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 对照组：互斥锁保护的 std::deque
+template<class T>
+class LockedDeque {
+public:
+    LockedDeque(size_t capacity = 0) : m_capacity(capacity) {}
+    bool tryPush(const T& v) {
+        myserver::Mutex::Lock lock(m_mutex);
+        if(m_capacity && m_queue.size() >= m_capacity) {
+            return false;
+        }
+        m_queue.push_back(v);
+        return true;
+    }
+    bool tryPop(T& v) {
+        myserver::Mutex::Lock lock(m_mutex);
+        if(m_queue.empty()) {
+            return false;
+        }
+        v = m_queue.front();
+        m_queue.pop_front();
+        return true;
+    }
+    size_t tryPushBatch(const T* items, size_t n) {
+        myserver::Mutex::Lock lock(m_mutex);
+        size_t k = 0;
+        for(; k < n && (!m_capacity || m_queue.size() < m_capacity); ++k) {
+            m_queue.push_back(items[k]);
+        }
+        return k;
+    }
+    size_t tryPopBatch(T* out, size_t n) {
+        myserver::Mutex::Lock lock(m_mutex);
+        size_t k = 0;
+        for(; k < n && !m_queue.empty(); ++k) {
+            out[k] = m_queue.front();
+            m_queue.pop_front();
+        }
+        return k;
+    }
+private:
+    myserver::Mutex m_mutex;
+    std::deque<T> m_queue;
+    size_t m_capacity;
+};
+
+struct Node : public myserver::MPSCNode {
+    uint64_t value = 0;
+};
+
+// 侵入式 MPSC 适配为统一的 tryPush/tryPop 接口，节点预先分配
+class MPSCAdapter {
+public:
+    bool tryPush(Node* n) { m_queue.push(n); return true; }
+    bool tryPop(Node*& n) { return (n = m_queue.pop()) != nullptr; }
+    size_t tryPushBatch(Node* const* items, size_t n) { m_queue.pushBatch(items, n); return n; }
+    size_t tryPopBatch(Node** out, size_t n) { return m_queue.popBatch(out, n); }
+private:
+    myserver::MPSCQueue<Node> m_queue;
+};
+
+const size_t BATCH = 32;
+
+template<class Q, class V>
+std::string run(Q& q, const std::string& name, int producers, int consumers,
+                int per_producer, bool batch, std::vector<std::vector<V> >& input) {
+    std::atomic<int> ready(0);
+    std::atomic<bool> start(false);
+    std::atomic<int64_t> remaining((int64_t)producers * per_producer);
+    std::vector<myserver::Thread::ptr> thrs;
+
+    for(int p = 0; p < producers; ++p) {
+        thrs.push_back(myserver::Thread::ptr(new myserver::Thread([&, p]() {
+            const std::vector<V>& in = input[p];
+            ready.fetch_add(1);
+            while(!start.load(std::memory_order_acquire)) {
+                sched_yield();
+            }
+            for(size_t i = 0; i < in.size();) {
+                size_t k = batch ? q.tryPushBatch(&in[i], std::min(BATCH, in.size() - i))
+                                 : (q.tryPush(in[i]) ? 1 : 0);
+                if(k) {
+                    i += k;
+                } else {
+                    sched_yield();
+                }
+            }
+        }, "QB_P" + std::to_string(p))));
+    }
+    for(int c = 0; c < consumers; ++c) {
+        thrs.push_back(myserver::Thread::ptr(new myserver::Thread([&]() {
+            V buf[BATCH];
+            ready.fetch_add(1);
+            while(!start.load(std::memory_order_acquire)) {
+                sched_yield();
+            }
+            while(remaining.load(std::memory_order_relaxed) > 0) {
+                size_t k = batch ? q.tryPopBatch(buf, BATCH) : (q.tryPop(buf[0]) ? 1 : 0);
+                if(k) {
+                    remaining.fetch_sub(k, std::memory_order_relaxed);
+                } else {
+                    sched_yield();
+                }
+            }
+        }, "QB_C" + std::to_string(c))));
+    }
+
+    while(ready.load() != producers + consumers) {
+        sched_yield();
+    }
+    uint64_t begin = NowNs();
+    start.store(true, std::memory_order_release);
+    for(auto& i : thrs) {
+        i->join();
+    }
+    double sec = (NowNs() - begin) / 1e9;
+    uint64_t total = (uint64_t)producers * per_producer;
+
+    std::stringstream ss;
+    ss << "{\"queue\":\"" << name << "\""
+       << ",\"producers\":" << producers
+       << ",\"consumers\":" << consumers
+       << ",\"batch\":" << (batch ? BATCH : 1)
+       << ",\"items\":" << total
+       << ",\"seconds\":" << sec
+       << ",\"ops_per_sec\":" << (uint64_t)(total / sec) << "}";
+    return ss.str();
+}
+
+}
+
+int main(int argc, char** argv) {
+    int per_producer = argc > 1 ? atoi(argv[1]) : 200000;
+    std::vector<std::string> lines;
+
+    const int configs[][2] = {{1, 1}, {2, 2}, {4, 4}, {4, 1}, {8, 1}};
+    for(auto& cfg : configs) {
+        int producers = cfg[0];
+        int consumers = cfg[1];
+
+        std::vector<std::vector<uint64_t> > values(producers);
+        for(int p = 0; p < producers; ++p) {
+            for(int i = 0; i < per_producer; ++i) {
+                values[p].push_back(i);
+            }
+        }
+        for(bool batch : {false, true}) {
+            {
+                myserver::MPMCQueue<uint64_t> q(4096);
+                lines.push_back(run(q, "MPMCQueue", producers, consumers, per_producer, batch, values));
+            }
+            {
+                LockedDeque<uint64_t> q(4096);
+                lines.push_back(run(q, "Mutex+deque", producers, consumers, per_producer, batch, values));
+            }
+        }
+
+        if(consumers != 1) {
+            continue;
+        }
+        std::vector<std::vector<Node> > nodes(producers, std::vector<Node>(per_producer));
+        std::vector<std::vector<Node*> > ptrs(producers);
+        for(int p = 0; p < producers; ++p) {
+            for(auto& n : nodes[p]) {
+                ptrs[p].push_back(&n);
+            }
+        }
+        for(bool batch : {false, true}) {
+            {
+                MPSCAdapter q;
+                lines.push_back(run(q, "MPSCQueue", producers, consumers, per_producer, batch, ptrs));
+            }
+            {
+                LockedDeque<Node*> q;
+                lines.push_back(run(q, "Mutex+deque(unbounded)", producers, consumers, per_producer, batch, ptrs));
+            }
+        }
+    }
+
+    std::cout << "{\"hardware_threads\":" << std::thread::hardware_concurrency()
+              << ",\"items_per_producer\":" << per_producer
+              << ",\"results\":[" << std::endl;
+    for(size_t i = 0; i < lines.size(); ++i) {
+        std::cout << "  " << lines[i] << (i + 1 < lines.size() ? "," : "") << std::endl;
+    }
+    std::cout << "]}" << std::endl;
+    return 0;
+}
@@ -0,0 +1,180 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <memory>
+#include <cassert>
+#include <sched.h>
+#include "thread.h"
+#include "queue.h"
+
+// MPMCQueue / MPSCQueue 压力测试，可配合 -DMYSERVER_TSAN=ON 构建检查数据竞争
+
+static const int PRODUCERS = 4;
+static const int CONSUMERS = 4;
+static const int PER_PRODUCER = 200000;
+
+// 元素编码：高位为生产者编号，低位为该生产者内的序号
+static inline uint64_t encode(int producer, uint64_t seq) {
+    return ((uint64_t)producer << 40) | seq;
+}
+
+void testMPMCBasic() {
+    myserver::MPMCQueue<std::string> q(3);
+    assert(q.getCapacity() == 4);
+    for(int i = 0; i < 4; ++i) {
+        assert(q.tryPush(std::to_string(i)));
+    }
+    assert(!q.tryPush("full"));
+    std::string v;
+    for(int i = 0; i < 4; ++i) {
+        assert(q.tryPop(v) && v == std::to_string(i));
+    }
+    assert(!q.tryPop(v));
+
+    std::string in[3] = {"a", "b", "c"};
+    std::string out[8];
+    assert(q.tryPushBatch(in, 3) == 3);
+    assert(q.tryPushBatch(in, 3) == 1);     // 仅剩一个空槽
+    assert(q.tryPopBatch(out, 8) == 4);
+    assert(out[0] == "a" && out[2] == "c" && out[3] == "a");
+    assert(q.tryPopBatch(out, 8) == 0);
+
+    // 析构时释放未取出的元素
+    std::shared_ptr<int> sp(new int(1));
+    {
+        myserver::MPMCQueue<std::shared_ptr<int> > q2(4);
+        q2.tryPush(sp);
+        q2.tryPush(sp);
+        assert(sp.use_count() == 3);
+    }
+    assert(sp.use_count() == 1);
+    std::cout << "testMPMCBasic ok" << std::endl;
+}
+
+void testMPMCStress(bool batch) {
+    myserver::MPMCQueue<uint64_t> q(1024);
+    std::atomic<uint64_t> sum(0);
+    std::atomic<int> popped(0);
+    std::vector<myserver::Thread::ptr> thrs;
+
+    for(int p = 0; p < PRODUCERS; ++p) {
+        thrs.push_back(myserver::Thread::ptr(new myserver::Thread([&, p]() {
+            uint64_t buf[16];
+            for(uint64_t i = 0; i < PER_PRODUCER;) {
+                if(batch) {
+                    size_t n = 0;
+                    for(; n < 16 && i + n < PER_PRODUCER; ++n) {
+                        buf[n] = encode(p, i + n);
+                    }
+                    size_t k = q.tryPushBatch(buf, n);
+                    i += k;
+                    if(!k) {
+                        sched_yield();
+                    }
+                } else if(q.tryPush(encode(p, i))) {
+                    ++i;
+                } else {
+                    sched_yield();
+                }
+            }
+        }, "MPMC_P" + std::to_string(p))));
+    }
+    for(int c = 0; c < CONSUMERS; ++c) {
+        thrs.push_back(myserver::Thread::ptr(new myserver::Thread([&]() {
+            // 每个消费者看到的同一生产者的元素必须严格递增
+            std::vector<int64_t> last(PRODUCERS, -1);
+            uint64_t buf[16];
+            uint64_t local = 0;
+            while(popped.load(std::memory_order_relaxed) < PRODUCERS * PER_PRODUCER) {
+                size_t k = batch ? q.tryPopBatch(buf, 16) : (q.tryPop(buf[0]) ? 1 : 0);
+                if(!k) {
+                    sched_yield();
+                    continue;
+                }
+                for(size_t j = 0; j < k; ++j) {
+                    int p = buf[j] >> 40;
+                    int64_t seq = buf[j] & ((1ULL << 40) - 1);
+                    assert(seq > last[p]);
+                    last[p] = seq;
+                    local += seq;
+                }
+                popped.fetch_add(k, std::memory_order_relaxed);
+            }
+            sum.fetch_add(local);
+        }, "MPMC_C" + std::to_string(c))));
+    }
+    for(auto& i : thrs) {
+        i->join();
+    }
+    uint64_t expect = (uint64_t)PRODUCERS * PER_PRODUCER * (PER_PRODUCER - 1) / 2;
+    assert(popped.load() == PRODUCERS * PER_PRODUCER);
+    assert(sum.load() == expect);
+    std::cout << "testMPMCStress batch=" << batch << " ok" << std::endl;
+}
+
+struct Item : public myserver::MPSCNode {
+    int producer = 0;
+    int seq = 0;
+};
+
+void testMPSCStress(bool batch) {
+    myserver::MPSCQueue<Item> q;
+    std::vector<std::vector<Item> > items(PRODUCERS, std::vector<Item>(PER_PRODUCER));
+    std::vector<myserver::Thread::ptr> thrs;
+    assert(q.empty() && !q.pop());
+
+    for(int p = 0; p < PRODUCERS; ++p) {
+        thrs.push_back(myserver::Thread::ptr(new myserver::Thread([&, p]() {
+            Item* buf[8];
+            for(int i = 0; i < PER_PRODUCER;) {
+                if(batch) {
+                    int n = 0;
+                    for(; n < 8 && i < PER_PRODUCER; ++n, ++i) {
+                        items[p][i].producer = p;
+                        items[p][i].seq = i;
+                        buf[n] = &items[p][i];
+                    }
+                    q.pushBatch(buf, n);
+                } else {
+                    items[p][i].producer = p;
+                    items[p][i].seq = i;
+                    q.push(&items[p][i]);
+                    ++i;
+                }
+            }
+        }, "MPSC_P" + std::to_string(p))));
+    }
+
+    // 单消费者：同一生产者的元素严格按入队顺序出队
+    std::vector<int> next(PRODUCERS, 0);
+    int total = 0;
+    Item* buf[32];
+    while(total < PRODUCERS * PER_PRODUCER) {
+        size_t k = q.popBatch(buf, 32);
+        if(!k) {
+            sched_yield();
+            continue;
+        }
+        for(size_t j = 0; j < k; ++j) {
+            assert(buf[j]->seq == next[buf[j]->producer]);
+            ++next[buf[j]->producer];
+        }
+        total += k;
+    }
+    for(auto& i : thrs) {
+        i->join();
+    }
+    assert(!q.pop());
+    assert(q.empty());
+    std::cout << "testMPSCStress batch=" << batch << " ok" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    testMPMCBasic();
+    testMPMCStress(false);
+    testMPMCStress(true);
+    testMPSCStress(false);
+    testMPSCStress(true);
+    return 0;
+}
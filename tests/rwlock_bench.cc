@@ -0,0 +1,182 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <unistd.h>
+#include <sched.h>
+#include "thread.h"
+#include "mutex.h"
+
+// 读多写少场景的读者扩展性基准：RWMutex / BRWMutex / SeqLock
+// 线程数 1..64 倍增，写比例 0% 与 1%，输出每秒读次数、相对单线程的扩展效率和撕裂读次数
+// 用法: rwlock_bench [duration_ms=100] [max_threads=64]
+
+namespace {
+
+inline uint64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 模拟一份小型配置快照，四个字段始终相等，读到不等即为撕裂读
+struct Snapshot {
+    uint64_t a = 0;
+    uint64_t b = 0;
+    uint64_t c = 0;
+    uint64_t d = 0;
+};
+
+inline bool isTorn(const Snapshot& s) {
+    return s.a != s.b || s.b != s.c || s.c != s.d;
+}
+
+inline Snapshot makeSnapshot(uint64_t v) {
+    Snapshot s;
+    s.a = s.b = s.c = s.d = v;
+    return s;
+}
+
+// 被测对象统一接口：read() 返回一份快照，write() 整体替换
+template<class RW>
+class LockedSnapshot {
+public:
+    Snapshot read() {
+        typename RW::ReadLock lock(m_mutex);
+        return m_data;
+    }
+    void write(uint64_t v) {
+        typename RW::WriteLock lock(m_mutex);
+        m_data = makeSnapshot(v);
+    }
+private:
+    RW m_mutex;
+    Snapshot m_data;
+};
+
+class SeqSnapshot {
+public:
+    Snapshot read() { return m_seq.load(); }
+    void write(uint64_t v) { m_seq.store(makeSnapshot(v)); }
+private:
+    myserver::SeqLock<Snapshot> m_seq;
+};
+
+struct Result {
+    std::string name;
+    int threads = 0;
+    int write_pct = 0;
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+    uint64_t torn = 0;
+    double seconds = 0;
+};
+
+struct alignas(128) Counter {
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+    uint64_t torn = 0;
+};
+
+template<class Obj>
+Result run(const std::string& name, int threads, int write_pct, int duration_ms) {
+    Obj obj;
+    std::atomic<int> ready(0);
+    std::atomic<bool> start(false);
+    std::atomic<bool> stop(false);
+    std::vector<Counter> counters(threads);
+    std::vector<myserver::Thread::ptr> thrs;
+
+    for(int t = 0; t < threads; ++t) {
+        Counter* c = &counters[t];
+        thrs.push_back(myserver::Thread::ptr(new myserver::Thread([&, c, t]() {
+            uint64_t rnd = 0x9E3779B97F4A7C15ULL * (t + 1);
+            uint64_t seq = 0;
+            ready.fetch_add(1);
+            while(!start.load(std::memory_order_acquire)) {
+                sched_yield();
+            }
+            while(!stop.load(std::memory_order_relaxed)) {
+                rnd ^= rnd << 13; rnd ^= rnd >> 7; rnd ^= rnd << 17;
+                if((int)(rnd % 100) < write_pct) {
+                    obj.write(++seq);
+                    ++c->writes;
+                } else {
+                    if(isTorn(obj.read())) {
+                        ++c->torn;
+                    }
+                    ++c->reads;
+                }
+            }
+        }, "RWB_" + std::to_string(t))));
+    }
+
+    while(ready.load() != threads) {
+        sched_yield();
+    }
+    uint64_t begin = NowNs();
+    start.store(true, std::memory_order_release);
+    usleep(duration_ms * 1000);
+    stop.store(true);
+    for(auto& i : thrs) {
+        i->join();
+    }
+
+    Result r;
+    r.name = name;
+    r.threads = threads;
+    r.write_pct = write_pct;
+    r.seconds = (NowNs() - begin) / 1e9;
+    for(auto& c : counters) {
+        r.reads += c.reads;
+        r.writes += c.writes;
+        r.torn += c.torn;
+    }
+    return r;
+}
+
+}
+
+int main(int argc, char** argv) {
+    int duration_ms = argc > 1 ? atoi(argv[1]) : 100;
+    int max_threads = argc > 2 ? atoi(argv[2]) : 64;
+
+    std::vector<std::string> lines;
+    for(int write_pct : {0, 1}) {
+#define XX(type, label) {                                                       \
+            double base = 0;                                                    \
+            for(int t = 1; t <= max_threads; t *= 2) {                          \
+                Result r = run<type>(label, t, write_pct, duration_ms);         \
+                double rps = r.reads / r.seconds;                               \
+                if(t == 1) {                                                    \
+                    base = rps;                                                 \
+                }                                                               \
+                std::stringstream ss;                                           \
+                ss << "{\"lock\":\"" << r.name << "\""                          \
+                   << ",\"threads\":" << r.threads                              \
+                   << ",\"write_pct\":" << r.write_pct                          \
+                   << ",\"reads_per_sec\":" << (uint64_t)rps                    \
+                   << ",\"writes_per_sec\":" << (uint64_t)(r.writes / r.seconds) \
+                   << ",\"scaling\":" << (base > 0 ? rps / (base * t) : 0)      \
+                   << ",\"torn_reads\":" << r.torn << "}";                      \
+                lines.push_back(ss.str());                                      \
+            }                                                                   \
+        }
+
+        XX(LockedSnapshot<myserver::RWMutex>, "RWMutex");
+        XX(LockedSnapshot<myserver::BRWMutex>, "BRWMutex");
+        XX(SeqSnapshot, "SeqLock");
+#undef XX
+    }
+
+    std::cout << "{\"hardware_threads\":" << std::thread::hardware_concurrency()
+              << ",\"duration_ms\":" << duration_ms
+              << ",\"results\":[" << std::endl;
+    for(size_t i = 0; i < lines.size(); ++i) {
+        std::cout << "  " << lines[i] << (i + 1 < lines.size() ? "," : "") << std::endl;
+    }
+    std::cout << "]}" << std::endl;
+    return 0;
+}
@@ -0,0 +1,135 @@
+#include <iostream>
+#include <map>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <unistd.h>
+#include "slow_scope.h"
+#include "config.h"
+#include "mutex.h"
+#include "thread.h"
+
+// SLOW_SCOPE 测试：未超阈值不输出、超阈值输出 WARN 及其内容、配置覆盖阈值、日志级别过滤
+
+using namespace myserver;
+
+// 收集日志事件
+class CaptureAppender : public LogAppender {
+public:
+    typedef std::shared_ptr<CaptureAppender> ptr;
+    void log(Logger::ptr logger, LogEvent::ptr event) override {
+        Mutex::Lock lock(m_mutex);
+        m_events.push_back(event);
+    }
+    std::string toYamlString() override { return ""; }
+    std::vector<LogEvent::ptr> events() {
+        Mutex::Lock lock(m_mutex);
+        return m_events;
+    }
+    void clear() {
+        Mutex::Lock lock(m_mutex);
+        m_events.clear();
+    }
+private:
+    Mutex m_mutex;
+    std::vector<LogEvent::ptr> m_events;
+};
+
+static Logger::ptr g_logger = LOGGER_NAME("slow_test");
+static CaptureAppender::ptr g_capture(new CaptureAppender);
+
+static int g_slow_line = 0;
+
+void slowOp(uint64_t sleep_ms) {
+    g_slow_line = __LINE__ + 1;
+    SLOW_SCOPE(g_logger, "test.slow", 10);
+    usleep(sleep_ms * 1000);
+}
+
+void overrideOp(uint64_t sleep_ms) {
+    SLOW_SCOPE(g_logger, "test.override", 1);
+    usleep(sleep_ms * 1000);
+}
+
+void testThreshold() {
+    slowOp(0);
+    assert(g_capture->events().empty());
+    slowOp(20);
+    std::vector<LogEvent::ptr> events = g_capture->events();
+    assert(events.size() == 1);
+    LogEvent::ptr e = events[0];
+    assert(e->getLevel() == LogLevel::WARN);
+    assert(e->getLine() == g_slow_line);
+    std::string content = e->getContent();
+    assert(content.find("slow op=test.slow cost_us=") == 0);
+    assert(content.find(" threshold_ms=10 thread=SLOW_main fiber=0") != std::string::npos);
+    uint64_t cost_us = atoll(content.c_str() + content.find("cost_us=") + 8);
+    assert(cost_us >= 20000 && cost_us < 1000000);
+    g_capture->clear();
+
+    // 多线程各自输出
+    std::vector<Thread::ptr> thrs;
+    for(int i = 0; i < 3; ++i) {
+        thrs.push_back(Thread::ptr(new Thread([]() {
+            slowOp(15);
+            slowOp(0);
+        }, "SLOW_" + std::to_string(i))));
+    }
+    for(auto& t : thrs) {
+        t->join();
+    }
+    events = g_capture->events();
+    assert(events.size() == 3);
+    for(auto& ev : events) {
+        assert(ev->getThreadName().compare(0, 5, "SLOW_") == 0);
+        assert(ev->getContent().find("thread=" + ev->getThreadName()) != std::string::npos);
+    }
+    g_capture->clear();
+    std::cout << "testThreshold ok " << content << std::endl;
+}
+
+void testOverride() {
+    ConfigVar<std::map<std::string, uint64_t> >::ptr thresholds =
+        Config::Lookup<std::map<std::string, uint64_t> >("slow_scope.thresholds");
+    assert(thresholds);
+    // 调用点首次执行前设置的覆盖值同样生效
+    std::map<std::string, uint64_t> v;
+    v["test.override"] = 1000;
+    v["test.slow"] = 1000;
+    thresholds->setValue(v);
+    overrideOp(5);
+    slowOp(20);
+    assert(g_capture->events().empty());
+
+    v["test.override"] = 0;
+    thresholds->setValue(v);
+    overrideOp(0);
+    assert(g_capture->events().size() == 1);
+    assert(g_capture->events()[0]->getContent().find("threshold_ms=0") != std::string::npos);
+    g_capture->clear();
+
+    // 去掉覆盖后恢复代码中的阈值
+    thresholds->setValue(std::map<std::string, uint64_t>());
+    overrideOp(5);
+    slowOp(5);
+    assert(g_capture->events().size() == 1);
+    g_capture->clear();
+    std::cout << "testOverride ok" << std::endl;
+}
+
+void testLevel() {
+    g_logger->setLevel(LogLevel::ERROR);
+    slowOp(20);
+    assert(g_capture->events().empty());
+    g_logger->setLevel(LogLevel::DEBUG);
+    std::cout << "testLevel ok" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    Thread::SetName("SLOW_main");
+    g_logger->addAppender(g_capture);
+    testThreshold();
+    testOverride();
+    testLevel();
+    return 0;
+}
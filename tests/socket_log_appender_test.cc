@@ -0,0 +1,354 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cassert>
+#include <unistd.h>
+#include <yaml-cpp/yaml.h>
+#include "socket_log_appender.h"
+#include "socket.h"
+#include "config.h"
+
+// SocketLogAppender 测试：数据报/流两种本地采集端的批量发送、采集端不可用时落盘与重放、drop/block 策略、配置创建
+
+using namespace myserver;
+
+static const std::string SOCK_PATH = "/tmp/socket_log_appender_test.sock";
+static const std::string SPILL_PATH = "/tmp/socket_log_appender_test.spill";
+
+static Logger::ptr NewLogger(LogAppender::ptr appender) {
+    static int s_id = 0;
+    Logger::ptr logger(new Logger("socket_test_" + std::to_string(s_id++)));
+    appender->setFormatter(LogFormatter::ptr(new LogFormatter("%m%n")));
+    logger->addAppender(appender);
+    return logger;
+}
+
+// 本地采集端替身
+static Socket::ptr NewCollector(bool dgram) {
+    unlink(SOCK_PATH.c_str());
+    Address::ptr addr(new UnixAddress(SOCK_PATH));
+    Socket::ptr sock = dgram ? Socket::CreateUDP(addr) : Socket::CreateUnixTCPSocket();
+    assert(sock->bind(addr));
+    if(!dgram) {
+        assert(sock->listen());
+    }
+    sock->setRecvTimeout(200);
+    return sock;
+}
+
+// 接收直到凑满 n 行，返回每次接收的数据
+static std::vector<std::string> RecvLines(Socket::ptr sock, size_t n, std::string& all) {
+    std::vector<std::string> chunks;
+    char buf[65536];
+    size_t lines = 0;
+    while(lines < n) {
+        int rt = sock->recv(buf, sizeof(buf));
+        if(rt <= 0) {
+            break;
+        }
+        chunks.push_back(std::string(buf, rt));
+        all.append(buf, rt);
+        for(int i = 0; i < rt; ++i) {
+            lines += buf[i] == '\n';
+        }
+    }
+    return chunks;
+}
+
+static std::string Expected(int begin, int end) {
+    std::stringstream ss;
+    for(int i = begin; i < end; ++i) {
+        ss << "event " << i << "\n";
+    }
+    return ss.str();
+}
+
+void testDatagram() {
+    Socket::ptr collector = NewCollector(true);
+    SocketLogAppender::Options opt;
+    opt.batch_size = 256;
+    SocketLogAppender::ptr appender(new SocketLogAppender("unixgram:" + SOCK_PATH, opt));
+    Logger::ptr logger = NewLogger(appender);
+    for(int i = 0; i < 100; ++i) {
+        LOG_INFO(logger) << "event " << i;
+    }
+    assert(appender->flush());
+    std::string all;
+    std::vector<std::string> chunks = RecvLines(collector, 100, all);
+    assert(all == Expected(0, 100));
+    // 多条事件合成一个数据报，且不超过 batch_size，事件不跨数据报
+    assert(chunks.size() > 1 && chunks.size() < 20);
+    for(auto& c : chunks) {
+        assert(c.size() <= 256 && c.back() == '\n');
+    }
+    assert(appender->getSent() == 100);
+    assert(appender->isConnected());
+    std::cout << "testDatagram ok datagrams=" << chunks.size() << std::endl;
+}
+
+void testStream() {
+    Socket::ptr listener = NewCollector(false);
+    SocketLogAppender::Options opt;
+    opt.batch_size = 1024;
+    SocketLogAppender::ptr appender(new SocketLogAppender("unix:" + SOCK_PATH, opt));
+    Logger::ptr logger = NewLogger(appender);
+    LOG_INFO(logger) << "event 0";
+    // 连接在 listen 队列中完成，flush 后再 accept
+    assert(appender->flush());
+    assert(appender->isConnected());
+    Socket::ptr conn = listener->accept();
+    assert(conn);
+    conn->setRecvTimeout(200);
+    for(int i = 1; i < 1000; ++i) {
+        LOG_INFO(logger) << "event " << i;
+    }
+    assert(appender->flush());
+    std::string all;
+    RecvLines(conn, 1000, all);
+    assert(all == Expected(0, 1000));
+    assert(appender->getSent() == 1000);
+    std::cout << "testStream ok" << std::endl;
+}
+
+void testSpill() {
+    unlink(SOCK_PATH.c_str());
+    unlink(SPILL_PATH.c_str());
+    SocketLogAppender::Options opt;
+    opt.spill_file = SPILL_PATH;
+    opt.batch_size = 128;
+    opt.retry_interval = 50;
+    SocketLogAppender::ptr appender(new SocketLogAppender("unixgram:" + SOCK_PATH, opt));
+    Logger::ptr logger = NewLogger(appender);
+    for(int i = 0; i < 50; ++i) {
+        LOG_INFO(logger) << "event " << i;
+    }
+    assert(appender->flush());
+    assert(appender->getSpilled() == 50);
+    assert(appender->getSent() == 0);
+    assert(!appender->isConnected());
+
+    // 采集端恢复后先按顺序重放 spill，再发送新事件
+    Socket::ptr collector = NewCollector(true);
+    usleep(100 * 1000);
+    LOG_INFO(logger) << "event 50";
+    assert(appender->flush());
+    std::string all;
+    RecvLines(collector, 51, all);
+    assert(all == Expected(0, 51));
+    assert(appender->getSent() == 51);
+    assert(appender->getDropped() == 0);
+    std::cout << "testSpill ok" << std::endl;
+    appender.reset();
+    unlink(SPILL_PATH.c_str());
+}
+
+// 流式采集端在批次写到一半时断开：重连后从第一条未完整送达的事件开始，不重发已送达的事件
+void testPartialStream() {
+    Socket::ptr listener = NewCollector(false);
+    unlink(SPILL_PATH.c_str());
+    SocketLogAppender::Options opt;
+    opt.spill_file = SPILL_PATH;
+    opt.batch_size = 1024 * 1024;
+    opt.flush_interval = 10;
+    opt.retry_interval = 20;
+    SocketLogAppender::ptr appender(new SocketLogAppender("unix:" + SOCK_PATH, opt));
+    Logger::ptr logger = NewLogger(appender);
+    LOG_INFO(logger) << "event 0";
+    assert(appender->flush());
+    Socket::ptr conn = listener->accept();
+    assert(conn);
+    conn->setRecvTimeout(200);
+
+    const int count = 2000;
+    std::string pad(500, 'x');
+    for(int i = 1; i <= count; ++i) {
+        LOG_INFO(logger) << "event " << i << " " << pad;
+    }
+    // 只读一部分就断开，发送线程此时阻塞在写入中；读到的数据超过一个写入块，
+    // 断开前至少有一块确认写入成功
+    char buf[65536];
+    size_t received = 0;
+    while(received < 100 * 1024) {
+        int rt = conn->recv(buf, sizeof(buf));
+        assert(rt > 0);
+        received += rt;
+    }
+    conn->close();
+
+    Socket::ptr conn2 = listener->accept();
+    assert(conn2);
+    conn2->setRecvTimeout(200);
+    assert(appender->flush(5000));
+    std::string all;
+    RecvLines(conn2, count, all);
+    // 第二个连接以完整事件开头，依次到最后一条
+    std::stringstream ss(all);
+    std::string line;
+    int first = -1;
+    int next = -1;
+    while(std::getline(ss, line)) {
+        int n = -1;
+        assert(sscanf(line.c_str(), "event %d", &n) == 1);
+        assert(line == "event " + std::to_string(n) + " " + pad);
+        if(first < 0) {
+            first = next = n;
+        }
+        assert(n == next);
+        ++next;
+    }
+    assert(first > 1 && next == count + 1);
+    assert(appender->getSent() == count + 1);
+    assert(appender->getDropped() == 0);
+    std::cout << "testPartialStream ok resumed_at=" << first
+              << " spilled=" << appender->getSpilled() << std::endl;
+    appender.reset();
+    unlink(SPILL_PATH.c_str());
+}
+
+void testSpillLimit() {
+    unlink(SOCK_PATH.c_str());
+    unlink(SPILL_PATH.c_str());
+    SocketLogAppender::Options opt;
+    opt.spill_file = SPILL_PATH;
+    opt.spill_size = 64;
+    opt.batch_size = 16;
+    SocketLogAppender::ptr appender(new SocketLogAppender("unixgram:" + SOCK_PATH, opt));
+    Logger::ptr logger = NewLogger(appender);
+    for(int i = 0; i < 20; ++i) {
+        LOG_INFO(logger) << "event " << i;
+    }
+    assert(appender->flush());
+    // 每批两条事件(8 字节头 + 8 字节结尾偏移 + 16 字节)，64 字节只能容纳 2 批
+    assert(appender->getSpilled() == 4);
+    assert(appender->getDropped() == 16);
+    std::cout << "testSpillLimit ok" << std::endl;
+    appender.reset();
+    unlink(SPILL_PATH.c_str());
+}
+
+void testDrop() {
+    unlink(SOCK_PATH.c_str());
+    SocketLogAppender::Options opt;
+    opt.queue_size = 16;
+    opt.flush_interval = 1000;
+    SocketLogAppender::ptr appender(new SocketLogAppender("unixgram:" + SOCK_PATH, opt));
+    Logger::ptr logger = NewLogger(appender);
+    for(int i = 0; i < 1000; ++i) {
+        LOG_INFO(logger) << "event " << i;
+    }
+    assert(appender->flush());
+    assert(appender->getDropped() == 1000);
+    assert(appender->getSent() == 0);
+    std::cout << "testDrop ok" << std::endl;
+}
+
+void testBlock() {
+    unlink(SOCK_PATH.c_str());
+    SocketLogAppender::Options opt;
+    opt.queue_size = 8;
+    opt.batch_size = 64;
+    opt.flush_interval = 10;
+    opt.retry_interval = 20;
+    opt.policy = SocketLogAppender::BLOCK;
+    SocketLogAppender::ptr appender(new SocketLogAppender("unixgram:" + SOCK_PATH, opt));
+    Logger::ptr logger = NewLogger(appender);
+
+    std::atomic<int> logged(0);
+    Thread::ptr writer(new Thread([&]() {
+        for(int i = 0; i < 100; ++i) {
+            LOG_INFO(logger) << "event " << i;
+            ++logged;
+        }
+    }, "BLOCK_writer"));
+    usleep(200 * 1000);
+    // 采集端不可用且无 spill：写日志的线程被阻塞
+    assert(logged.load() < 100);
+    assert(appender->getDropped() == 0);
+
+    Socket::ptr collector = NewCollector(true);
+    std::string all;
+    RecvLines(collector, 100, all);
+    writer->join();
+    assert(appender->flush());
+    assert(all == Expected(0, 100));
+    assert(appender->getDropped() == 0);
+    assert(appender->getSent() == 100);
+    std::cout << "testBlock ok" << std::endl;
+}
+
+// 崩溃时队列中的事件与报告追加到 spill，下次启动连接后重放
+void testCrashFlush() {
+    unlink(SOCK_PATH.c_str());
+    unlink(SPILL_PATH.c_str());
+    SocketLogAppender::Options opt;
+    opt.spill_file = SPILL_PATH;
+    opt.batch_size = 1024 * 1024;
+    opt.flush_interval = 60 * 1000;
+    SocketLogAppender::ptr appender(new SocketLogAppender("unixgram:" + SOCK_PATH, opt));
+    Logger::ptr logger = NewLogger(appender);
+    for(int i = 0; i < 10; ++i) {
+        LOG_INFO(logger) << "event " << i;
+    }
+    std::string report = "crash report\n";
+    appender->crashFlush(report.c_str(), report.size());
+    logger.reset();
+    appender.reset();
+
+    Socket::ptr collector = NewCollector(true);
+    opt.flush_interval = 100;
+    appender.reset(new SocketLogAppender("unixgram:" + SOCK_PATH, opt));
+    logger = NewLogger(appender);
+    LOG_INFO(logger) << "event 10";
+    // 重放的数据报逐条发送，边收边发避免占满接收队列
+    std::string all;
+    RecvLines(collector, 12, all);
+    assert(appender->flush());
+    assert(all == Expected(0, 10) + report + "event 10\n");
+    std::cout << "testCrashFlush ok" << std::endl;
+    appender.reset();
+    unlink(SPILL_PATH.c_str());
+}
+
+void testConfig() {
+    Socket::ptr collector = NewCollector(true);
+    YAML::Node root = YAML::Load(
+        "logs:\n"
+        "  - name: socket_cfg\n"
+        "    level: info\n"
+        "    formatter: '%m%n'\n"
+        "    appenders:\n"
+        "      - type: SocketLogAppender\n"
+        "        address: unixgram:" + SOCK_PATH + "\n"
+        "        batch_size: 512\n"
+        "        flush_interval: 20\n"
+        "        policy: block\n");
+    Config::LoadFromYaml(root);
+    Logger::ptr logger = LOGGER_NAME("socket_cfg");
+    std::string yaml = logger->toYamlString();
+    assert(yaml.find("type: SocketLogAppender") != std::string::npos);
+    assert(yaml.find("address: unixgram:" + SOCK_PATH) != std::string::npos);
+    assert(yaml.find("policy: block") != std::string::npos);
+    for(int i = 0; i < 10; ++i) {
+        LOG_INFO(logger) << "event " << i;
+    }
+    std::string all;
+    RecvLines(collector, 10, all);
+    assert(all == Expected(0, 10));
+    std::cout << "testConfig ok" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    testDatagram();
+    testStream();
+    testSpill();
+    testPartialStream();
+    testSpillLimit();
+    testDrop();
+    testBlock();
+    testCrashFlush();
+    testConfig();
+    unlink(SOCK_PATH.c_str());
+    return 0;
+}
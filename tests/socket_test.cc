@@ -0,0 +1,244 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <cstring>
+#include <errno.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "address.h"
+#include "socket.h"
+
+// Address / Socket 测试，只使用回环地址与 socketpair
+
+void testAddress() {
+    myserver::IPAddress::ptr addr = myserver::IPAddress::Create("192.168.1.77", 8080);
+    assert(addr && addr->getFamily() == AF_INET);
+    assert(addr->toString() == "192.168.1.77:8080");
+    assert(addr->broadcastAddress(24)->toString() == "192.168.1.255:8080");
+    assert(addr->networkAddress(24)->toString() == "192.168.1.0:8080");
+    assert(addr->subnetMask(20)->toString() == "255.255.240.0:0");
+    assert(addr->networkAddress(32)->toString() == "192.168.1.77:8080");
+    assert(addr->networkAddress(0)->toString() == "0.0.0.0:8080");
+
+    myserver::IPAddress::ptr addr6 = myserver::IPAddress::Create("fe80::1:2", 80);
+    assert(addr6 && addr6->getFamily() == AF_INET6);
+    assert(addr6->toString() == "[fe80::1:2]:80");
+    assert(addr6->networkAddress(64)->toString() == "[fe80::]:80");
+    assert(addr6->subnetMask(68)->toString() == "[ffff:ffff:ffff:ffff:f000::]:0");
+    assert(!myserver::IPAddress::Create("not-an-ip"));
+
+    std::vector<myserver::Address::ptr> addrs;
+    assert(myserver::Address::Lookup(addrs, "127.0.0.1:80", AF_INET, SOCK_STREAM));
+    assert(addrs.size() == 1 && addrs[0]->toString() == "127.0.0.1:80");
+    addrs.clear();
+    assert(myserver::Address::Lookup(addrs, "[::1]:81", AF_INET6, SOCK_STREAM));
+    assert(addrs[0]->toString() == "[::1]:81");
+    assert(myserver::Address::LookupAnyIPAddress("localhost:53", AF_INET));
+
+    myserver::UnixAddress::ptr ua(new myserver::UnixAddress("/tmp/myserver.sock"));
+    assert(ua->getPath() == "/tmp/myserver.sock");
+    assert(*myserver::IPv4Address::Create("127.0.0.1", 1) < *myserver::IPv4Address::Create("127.0.0.1", 2));
+    assert(*myserver::IPv4Address::Create("127.0.0.1", 1) == *myserver::IPv4Address::Create("127.0.0.1", 1));
+    std::cout << "testAddress ok" << std::endl;
+}
+
+// 监听 127.0.0.1 的随机端口
+myserver::Socket::ptr listenLoopback() {
+    myserver::IPv4Address::ptr addr = myserver::IPv4Address::Create("127.0.0.1", 0);
+    myserver::Socket::ptr sock = myserver::Socket::CreateTCP(addr);
+    assert(sock->bind(addr));
+    assert(sock->listen());
+    assert(sock->isNonBlock());
+    return sock;
+}
+
+void testTcp() {
+    myserver::Socket::ptr server = listenLoopback();
+    myserver::Address::ptr addr = server->getLocalAddress();
+    assert(std::dynamic_pointer_cast<myserver::IPAddress>(addr)->getPort() != 0);
+
+    myserver::Socket::ptr client = myserver::Socket::CreateTCP(addr);
+    assert(client->connect(addr, 1000));
+    myserver::Socket::ptr conn = server->accept();
+    assert(conn && conn->isConnected() && conn->isNonBlock());
+    assert(*conn->getRemoteAddress() == *client->getLocalAddress());
+    int nodelay = 0;
+    assert(conn->getOption(IPPROTO_TCP, TCP_NODELAY, nodelay) && nodelay);
+
+    assert(client->send("hello", 5) == 5);
+    char buf[64] = {0};
+    assert(conn->recv(buf, sizeof(buf)) == 5 && strcmp(buf, "hello") == 0);
+
+    iovec iov[2];
+    iov[0].iov_base = (void*)"ab";
+    iov[0].iov_len = 2;
+    iov[1].iov_base = (void*)"cd";
+    iov[1].iov_len = 2;
+    assert(conn->send(iov, 2) == 4);
+    memset(buf, 0, sizeof(buf));
+    int got = 0;
+    while(got < 4) {
+        int rt = client->recv(buf + got, sizeof(buf) - got);
+        assert(rt > 0);
+        got += rt;
+    }
+    assert(strcmp(buf, "abcd") == 0);
+
+    // 接收超时
+    conn->setRecvTimeout(50);
+    assert(conn->recv(buf, sizeof(buf)) == -1 && errno == ETIMEDOUT);
+
+    // 对端关闭
+    client->close();
+    conn->setRecvTimeout(1000);
+    assert(conn->recv(buf, sizeof(buf)) == 0);
+    std::cout << "testTcp ok " << *conn << std::endl;
+}
+
+void testAcceptBatch() {
+    myserver::Socket::ptr server = listenLoopback();
+    myserver::Address::ptr addr = server->getLocalAddress();
+    std::vector<myserver::Socket::ptr> clients;
+    for(int i = 0; i < 8; ++i) {
+        myserver::Socket::ptr c = myserver::Socket::CreateTCP(addr);
+        assert(c->connect(addr, 1000));
+        clients.push_back(c);
+    }
+    server->setRecvTimeout(1000);
+    std::vector<myserver::Socket::ptr> conns;
+    while(conns.size() < 8) {
+        assert(server->acceptBatch(conns, 5) > 0);
+    }
+    assert(conns.size() == 8);
+
+    // 无连接时等待超时返回0
+    server->setRecvTimeout(20);
+    assert(server->acceptBatch(conns, 5) == 0);
+    server->setRecvTimeout(20);
+    assert(!server->accept() && errno == ETIMEDOUT);
+    std::cout << "testAcceptBatch ok" << std::endl;
+}
+
+void testReusePort() {
+    myserver::IPv4Address::ptr any = myserver::IPv4Address::Create("127.0.0.1", 0);
+    myserver::Socket::ptr s1 = myserver::Socket::CreateTCP(any);
+    assert(s1->setReusePort());
+    assert(s1->bind(any) && s1->listen());
+    myserver::Address::ptr addr = s1->getLocalAddress();
+
+    // 开启 SO_REUSEPORT 的 socket 可以绑定同一端口
+    myserver::Socket::ptr s2 = myserver::Socket::CreateTCP(addr);
+    assert(s2->setReusePort());
+    assert(s2->bind(addr) && s2->listen());
+
+    myserver::Socket::ptr s3 = myserver::Socket::CreateTCP(addr);
+    assert(!s3->bind(addr));
+
+    // 连接由内核分发到其中一个监听 socket
+    std::vector<myserver::Socket::ptr> clients;
+    for(int i = 0; i < 16; ++i) {
+        myserver::Socket::ptr c = myserver::Socket::CreateTCP(addr);
+        assert(c->connect(addr, 1000));
+        clients.push_back(c);
+    }
+    std::vector<myserver::Socket::ptr> conns;
+    s1->setRecvTimeout(0);
+    s2->setRecvTimeout(0);
+    s1->acceptBatch(conns, 16);
+    s2->acceptBatch(conns, 16);
+    assert(conns.size() == 16);
+    std::cout << "testReusePort ok" << std::endl;
+}
+
+void testSocketPair() {
+    myserver::Socket::ptr a, b;
+    assert(myserver::Socket::CreatePair(a, b));
+    assert(a->isConnected() && a->isNonBlock());
+    assert(a->send("ping", 4) == 4);
+    char buf[8] = {0};
+    assert(b->recv(buf, sizeof(buf)) == 4 && memcmp(buf, "ping", 4) == 0);
+
+    // 填满发送缓冲区后发送超时
+    a->setSendTimeout(20);
+    std::string big(1 << 20, 'x');
+    int rt;
+    while((rt = a->send(big.data(), big.size())) > 0) {
+    }
+    assert(rt == -1 && errno == ETIMEDOUT);
+    std::cout << "testSocketPair ok" << std::endl;
+}
+
+void testUdpBatch() {
+    myserver::IPv4Address::ptr addr = myserver::IPv4Address::Create("127.0.0.1", 0);
+    myserver::Socket::ptr server = myserver::Socket::CreateUDP(addr);
+    assert(server->bind(addr));
+    myserver::Address::ptr server_addr = server->getLocalAddress();
+    myserver::Socket::ptr client = myserver::Socket::CreateUDP(addr);
+
+    const int N = 16;
+    char out[N][8];
+    iovec out_iov[N];
+    mmsghdr out_msgs[N];
+    memset(out_msgs, 0, sizeof(out_msgs));
+    for(int i = 0; i < N; ++i) {
+        snprintf(out[i], sizeof(out[i]), "msg%d", i);
+        out_iov[i].iov_base = out[i];
+        out_iov[i].iov_len = strlen(out[i]);
+        out_msgs[i].msg_hdr.msg_iov = &out_iov[i];
+        out_msgs[i].msg_hdr.msg_iovlen = 1;
+        out_msgs[i].msg_hdr.msg_name = server_addr->getAddr();
+        out_msgs[i].msg_hdr.msg_namelen = server_addr->getAddrLen();
+    }
+    assert(client->sendBatch(out_msgs, N) == N);
+
+    char in[N][16];
+    iovec in_iov[N];
+    mmsghdr in_msgs[N];
+    memset(in_msgs, 0, sizeof(in_msgs));
+    for(int i = 0; i < N; ++i) {
+        in_iov[i].iov_base = in[i];
+        in_iov[i].iov_len = sizeof(in[i]);
+        in_msgs[i].msg_hdr.msg_iov = &in_iov[i];
+        in_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    server->setRecvTimeout(1000);
+    int got = 0;
+    while(got < N) {
+        int rt = server->recvBatch(in_msgs + got, N - got);
+        assert(rt > 0);
+        for(int i = got; i < got + rt; ++i) {
+            assert(std::string(in[i], in_msgs[i].msg_len) == out[i]);
+        }
+        got += rt;
+    }
+
+    myserver::Address::ptr from(new myserver::IPv4Address);
+    assert(client->sendTo("one", 3, server_addr) == 3);
+    char buf[8];
+    assert(server->recvFrom(buf, sizeof(buf), from) == 3);
+    assert(*from == *client->getLocalAddress() || from->toString().find("127.0.0.1") == 0);
+
+    // Unix 数据报 socket 与 UDP 一样创建后即可 sendTo，无需先 bind/connect
+    std::string path = "/tmp/socket_test_unix_udp.sock";
+    unlink(path.c_str());
+    myserver::Address::ptr unix_addr(new myserver::UnixAddress(path));
+    myserver::Socket::ptr unix_server = myserver::Socket::CreateUnixUDPSocket();
+    assert(unix_server->bind(unix_addr));
+    myserver::Socket::ptr unix_client = myserver::Socket::CreateUnixUDPSocket();
+    assert(unix_client->sendTo("two", 3, unix_addr) == 3);
+    unix_server->setRecvTimeout(1000);
+    assert(unix_server->recv(buf, sizeof(buf)) == 3 && memcmp(buf, "two", 3) == 0);
+    unlink(path.c_str());
+    std::cout << "testUdpBatch ok" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    testAddress();
+    testTcp();
+    testAcceptBatch();
+    testReusePort();
+    testSocketPair();
+    testUdpBatch();
+    return 0;
+}
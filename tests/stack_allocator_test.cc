@@ -0,0 +1,151 @@
+#include <iostream>
+#include <vector>
+#include <cassert>
+#include <cstring>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "thread.h"
+#include "config.h"
+#include "stack_allocator.h"
+
+// StackAllocator 功能测试
+
+static size_t ResidentPages(void* addr, size_t len) {
+    size_t page = sysconf(_SC_PAGESIZE);
+    std::vector<unsigned char> vec(len / page);
+    assert(mincore(addr, len, vec.data()) == 0);
+    size_t n = 0;
+    for(auto c : vec) {
+        n += c & 1;
+    }
+    return n;
+}
+
+void testLazyCommit() {
+    const size_t SIZE = 1024 * 1024;
+    size_t page = sysconf(_SC_PAGESIZE);
+    char* stack = static_cast<char*>(myserver::StackAllocator::Alloc(SIZE));
+    assert(myserver::StackAllocator::GetUsableSize(SIZE) == SIZE);
+    assert(ResidentPages(stack, SIZE) == 0);
+    // 模拟只用到栈顶8KB的协程
+    memset(stack + SIZE - 8192, 1, 8192);
+    size_t resident = ResidentPages(stack, SIZE);
+    assert(resident >= 8192 / page && resident <= 8192 / page + 1);
+    myserver::StackAllocator::Dealloc(stack, SIZE);
+    std::cout << "testLazyCommit ok resident_pages=" << resident << std::endl;
+}
+
+void testReuse() {
+    size_t size = myserver::StackAllocator::GetUsableSize();
+    myserver::StackStats before = myserver::StackAllocator::GetStats();
+    void* a = myserver::StackAllocator::Alloc();
+    myserver::StackAllocator::Dealloc(a, size);
+    void* b = myserver::StackAllocator::Alloc();
+    assert(a == b);
+    myserver::StackStats after = myserver::StackAllocator::GetStats();
+    assert(after.cache_hits >= before.cache_hits + 1);
+
+    // 其它线程的缓存互不共享
+    void* c = nullptr;
+    myserver::Thread::ptr thr(new myserver::Thread([&]() {
+        c = myserver::StackAllocator::Alloc();
+        myserver::StackAllocator::Dealloc(c, size);
+    }, "STACK_T"));
+    thr->join();
+    assert(c != b);
+    myserver::StackAllocator::Dealloc(b, size);
+    // 线程退出后其缓存的栈已解除映射
+    assert(myserver::StackAllocator::GetStats().mapped_stacks == after.mapped_stacks);
+    std::cout << "testReuse ok" << std::endl;
+}
+
+void testMaxCached() {
+    myserver::StackAllocator::ReleaseCache();
+    auto var = myserver::Config::Lookup<uint32_t>("fiber.max_cached_stacks");
+    assert(var);
+    uint32_t old = var->getValue();
+    var->setValue(2);
+    size_t size = myserver::StackAllocator::GetUsableSize();
+    std::vector<void*> stacks;
+    for(int i = 0; i < 5; ++i) {
+        stacks.push_back(myserver::StackAllocator::Alloc());
+    }
+    assert(myserver::StackAllocator::GetStats().mapped_stacks >= 5);
+    for(auto s : stacks) {
+        myserver::StackAllocator::Dealloc(s, size);
+    }
+    myserver::StackStats stats = myserver::StackAllocator::GetStats();
+    assert(stats.cached_stacks == 2);
+    assert(stats.mapped_stacks == 2);
+    myserver::StackAllocator::ReleaseCache();
+    assert(myserver::StackAllocator::GetStats().mapped_stacks == 0);
+    var->setValue(old);
+    std::cout << "testMaxCached ok" << std::endl;
+}
+
+// 分配与释放之间修改 fiber.stack_size，释放时仍按分配时的大小缓存
+void testResizeBetween() {
+    myserver::StackAllocator::ReleaseCache();
+    auto var = myserver::Config::Lookup<uint32_t>("fiber.stack_size");
+    assert(var);
+    uint32_t old = var->getValue();
+    size_t old_size = myserver::StackAllocator::GetUsableSize();
+    void* a = myserver::StackAllocator::Alloc();
+    var->setValue(old * 2);
+    myserver::StackAllocator::Dealloc(a, old_size);
+    uint64_t mapped = myserver::StackAllocator::GetStats().mapped_bytes;
+    assert(mapped == old_size + sysconf(_SC_PAGESIZE));
+    // 新大小不复用旧栈，旧大小可以
+    void* b = myserver::StackAllocator::Alloc();
+    assert(b != a);
+    assert(myserver::StackAllocator::Alloc(old_size) == a);
+    myserver::StackAllocator::Dealloc(a, old_size);
+    myserver::StackAllocator::Dealloc(b, old_size * 2);
+    myserver::StackAllocator::ReleaseCache();
+    assert(myserver::StackAllocator::GetStats().mapped_bytes == 0);
+    var->setValue(old);
+    std::cout << "testResizeBetween ok" << std::endl;
+}
+
+// 越过栈底读取保护页也应触发 SIGSEGV
+void testGuardPage() {
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if(pid == 0) {
+        char* stack = static_cast<char*>(myserver::StackAllocator::Alloc());
+        stack[0] = 1;
+        char c = *(volatile char*)(stack - 1);
+        (void)c;
+        _exit(0);
+    }
+    int status = 0;
+    assert(waitpid(pid, &status, 0) == pid);
+    assert(WIFSIGNALED(status) && WTERMSIG(status) == SIGSEGV);
+    std::cout << "testGuardPage ok" << std::endl;
+}
+
+// size 为0时无法释放映射，应报错终止而不是静默泄漏
+void testDeallocZeroSize() {
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if(pid == 0) {
+        myserver::StackAllocator::Dealloc(myserver::StackAllocator::Alloc(), 0);
+        _exit(0);
+    }
+    int status = 0;
+    assert(waitpid(pid, &status, 0) == pid);
+    assert(WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT);
+    std::cout << "testDeallocZeroSize ok" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    testLazyCommit();
+    testReuse();
+    testMaxCached();
+    testResizeBetween();
+    testGuardPage();
+    testDeallocZeroSize();
+    return 0;
+}
@@ -0,0 +1,218 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "log.h"
+#include "thread.h"
+#include "http/http_server.h"
+#include "http/static_file_servlet.h"
+
+// 静态文件发送压测：StaticFileServlet(fd 缓存 + sendfile) 对比每次 open + fstat + read 进 body 再写出
+// 每个客户端线程一个长连接，逐个请求并丢弃消息体；输出每种文件大小下的每秒请求数与吞吐
+// 用法: static_file_bench [duration_ms=1000] [connections=4] [workers=2]
+
+namespace {
+
+inline uint64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+using namespace myserver::http;
+
+// 对照组：每次请求 open + fstat + read 整个文件到 body
+int32_t ReadServlet(const std::string& root, HttpRequest::ptr req, HttpResponse::ptr rsp) {
+    std::string path = root + req->getPath().substr(3);
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) {
+        rsp->setStatus(HttpStatus::NOT_FOUND);
+        return 0;
+    }
+    struct stat st;
+    fstat(fd, &st);
+    std::string& body = rsp->getBody();
+    body.resize(st.st_size);
+    size_t got = 0;
+    while(got < body.size()) {
+        ssize_t n = read(fd, &body[got], body.size() - got);
+        if(n <= 0) {
+            break;
+        }
+        got += n;
+    }
+    body.resize(got);
+    close(fd);
+    return 0;
+}
+
+struct ClientStat {
+    uint64_t requests = 0;
+    uint64_t bytes = 0;
+    uint64_t errors = 0;
+};
+
+void runClient(myserver::Address::ptr addr, const std::string& uri,
+               std::atomic<bool>& stop, ClientStat& stat) {
+    myserver::Socket::ptr sock = myserver::Socket::CreateTCP(addr);
+    if(!sock->connect(addr, 1000)) {
+        ++stat.errors;
+        return;
+    }
+    sock->setRecvTimeout(5000);
+    std::string req = "GET " + uri + " HTTP/1.1\r\nHost: bench\r\n\r\n";
+    std::vector<char> buf(256 * 1024);
+    size_t len = 0;
+    while(!stop.load(std::memory_order_relaxed)) {
+        if(sock->send(req.c_str(), req.size()) != (int)req.size()) {
+            ++stat.errors;
+            return;
+        }
+        // 读到头部结束，取 Content-Length 后丢弃消息体
+        char* end = nullptr;
+        while(!(end = (char*)memmem(&buf[0], len, "\r\n\r\n", 4))) {
+            int n = sock->recv(&buf[len], buf.size() - len);
+            if(n <= 0) {
+                ++stat.errors;
+                return;
+            }
+            len += n;
+        }
+        const char* cl = (const char*)memmem(&buf[0], end - &buf[0], "Content-Length: ", 16);
+        if(!cl) {
+            ++stat.errors;
+            return;
+        }
+        uint64_t body = strtoull(cl + 16, nullptr, 10);
+        size_t head = end + 4 - &buf[0];
+        uint64_t left = body;
+        size_t have = std::min<uint64_t>(len - head, left);
+        left -= have;
+        len -= head + have;
+        memmove(&buf[0], &buf[head + have], len);
+        while(left > 0) {
+            int n = sock->recv(&buf[0], std::min<uint64_t>(buf.size(), left));
+            if(n <= 0) {
+                ++stat.errors;
+                return;
+            }
+            left -= n;
+        }
+        ++stat.requests;
+        stat.bytes += body;
+    }
+}
+
+std::string run(const std::string& root, const std::string& mode, const std::string& file,
+                size_t workers, size_t connections, uint64_t duration_ms) {
+    HttpServer::ptr server(new HttpServer(true, workers));
+    ServletDispatch::ptr sd = server->getServletDispatch();
+    sd->addGlobServlet("/sf/*", std::make_shared<StaticFileServlet>(root, "/sf"));
+    sd->addGlobServlet("/rw/*", [root](HttpRequest::ptr req, HttpResponse::ptr rsp, myserver::Socket::ptr) {
+        return ReadServlet(root, req, rsp);
+    });
+    if(!server->bind(myserver::IPv4Address::Create("127.0.0.1", 0)) || !server->start()) {
+        std::cerr << "server start fail" << std::endl;
+        exit(1);
+    }
+    myserver::Address::ptr addr = server->getSocks()[0]->getLocalAddress();
+
+    std::atomic<bool> stop(false);
+    std::vector<ClientStat> stats(connections);
+    std::vector<myserver::Thread::ptr> thrs;
+    std::string uri = "/" + mode + "/" + file;
+    for(size_t i = 0; i < connections; ++i) {
+        ClientStat& stat = stats[i];
+        thrs.push_back(myserver::Thread::ptr(new myserver::Thread([&, addr]() {
+            runClient(addr, uri, stop, stat);
+        }, "SFB_C" + std::to_string(i))));
+    }
+    uint64_t begin = NowNs();
+    usleep(duration_ms * 1000);
+    stop = true;
+    for(auto& t : thrs) {
+        t->join();
+    }
+    double sec = (NowNs() - begin) / 1e9;
+    server->stop();
+
+    uint64_t requests = 0;
+    uint64_t bytes = 0;
+    uint64_t errors = 0;
+    for(auto& s : stats) {
+        requests += s.requests;
+        bytes += s.bytes;
+        errors += s.errors;
+    }
+    std::stringstream ss;
+    ss << "{\"mode\":\"" << (mode == "sf" ? "sendfile_cached" : "read_write") << "\""
+       << ",\"file\":\"" << file << "\""
+       << ",\"requests\":" << requests
+       << ",\"errors\":" << errors
+       << ",\"seconds\":" << sec
+       << ",\"requests_per_sec\":" << (uint64_t)(requests / sec)
+       << ",\"mb_per_sec\":" << (uint64_t)(bytes / sec / (1024 * 1024)) << "}";
+    return ss.str();
+}
+
+}
+
+int main(int argc, char** argv) {
+    uint64_t duration_ms = argc > 1 ? atoi(argv[1]) : 1000;
+    size_t connections = argc > 2 ? atoi(argv[2]) : 4;
+    size_t workers = argc > 3 ? atoi(argv[3]) : 2;
+    LOGGER_NAME("system")->setLevel(myserver::LogLevel::WARN);
+
+    char tmpl[] = "/tmp/static_file_bench.XXXXXX";
+    if(!mkdtemp(tmpl)) {
+        std::cerr << "mkdtemp fail" << std::endl;
+        return 1;
+    }
+    std::string root = tmpl;
+    std::vector<std::pair<std::string, size_t> > files = {
+        {"4k.bin", 4 * 1024},
+        {"1m.bin", 1024 * 1024},
+        {"100m.bin", 100 * 1024 * 1024},
+    };
+    std::string chunk(1024 * 1024, 'x');
+    for(auto& f : files) {
+        int fd = open((root + "/" + f.first).c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        for(size_t left = f.second; left > 0;) {
+            size_t n = std::min(left, chunk.size());
+            if(write(fd, chunk.c_str(), n) != (ssize_t)n) {
+                std::cerr << "write fail" << std::endl;
+                return 1;
+            }
+            left -= n;
+        }
+        close(fd);
+    }
+
+    std::vector<std::string> lines;
+    for(auto& f : files) {
+        for(auto& mode : {"rw", "sf"}) {
+            lines.push_back(run(root, mode, f.first, workers, connections, duration_ms));
+        }
+    }
+    for(auto& f : files) {
+        unlink((root + "/" + f.first).c_str());
+    }
+    rmdir(root.c_str());
+
+    std::cout << "{\"hardware_threads\":" << std::thread::hardware_concurrency()
+              << ",\"duration_ms\":" << duration_ms
+              << ",\"connections\":" << connections
+              << ",\"workers\":" << workers
+              << ",\"results\":[" << std::endl;
+    for(size_t i = 0; i < lines.size(); ++i) {
+        std::cout << "  " << lines[i] << (i + 1 < lines.size() ? "," : "") << std::endl;
+    }
+    std::cout << "]}" << std::endl;
+    return 0;
+}
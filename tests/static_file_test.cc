@@ -0,0 +1,208 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cassert>
+#include <cstring>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "file_cache.h"
+#include "http/http_server.h"
+#include "http/static_file_servlet.h"
+
+// StaticFileServlet / FileCache 测试：Range、协商缓存、路径检查、缓存命中与 inotify 失效、sendfile 发送
+
+using namespace myserver::http;
+
+static std::string s_root;
+
+static void writeFile(const std::string& path, const std::string& data) {
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    ofs << data;
+}
+
+static std::string makeData(size_t size) {
+    std::string data(size, 0);
+    for(size_t i = 0; i < size; ++i) {
+        data[i] = 'a' + i % 26;
+    }
+    return data;
+}
+
+// 直接调用 handle，返回响应
+static HttpResponse::ptr call(Servlet::ptr servlet, const std::string& path,
+                              const std::string& key = "", const std::string& val = "") {
+    HttpRequest::ptr req(new HttpRequest(0x11, false));
+    req->setPath(path);
+    if(!key.empty()) {
+        req->setHeader(key, val);
+    }
+    HttpResponse::ptr rsp(new HttpResponse(0x11, false));
+    servlet->handle(req, rsp, nullptr);
+    return rsp;
+}
+
+void testParseRange() {
+    uint64_t off = 0;
+    uint64_t len = 0;
+    assert(StaticFileServlet::ParseRange("bytes=0-9", 100, off, len) == 1 && off == 0 && len == 10);
+    assert(StaticFileServlet::ParseRange("bytes=90-", 100, off, len) == 1 && off == 90 && len == 10);
+    assert(StaticFileServlet::ParseRange("bytes=90-200", 100, off, len) == 1 && off == 90 && len == 10);
+    assert(StaticFileServlet::ParseRange("bytes=-5", 100, off, len) == 1 && off == 95 && len == 5);
+    assert(StaticFileServlet::ParseRange("bytes=-500", 100, off, len) == 1 && off == 0 && len == 100);
+    assert(StaticFileServlet::ParseRange("bytes=100-", 100, off, len) == 0);
+    assert(StaticFileServlet::ParseRange("bytes=-0", 100, off, len) == 0);
+    assert(StaticFileServlet::ParseRange("bytes=5-1", 100, off, len) == -1);
+    assert(StaticFileServlet::ParseRange("bytes=0-1,3-4", 100, off, len) == -1);
+    assert(StaticFileServlet::ParseRange("items=0-1", 100, off, len) == -1);
+    assert(StaticFileServlet::ParseRange("bytes=a-1", 100, off, len) == -1);
+    std::cout << "testParseRange ok" << std::endl;
+}
+
+void testServlet() {
+    std::string data = makeData(1000);
+    writeFile(s_root + "/a.txt", data);
+    mkdir((s_root + "/dir").c_str(), 0755);
+    StaticFileServlet::ptr servlet(new StaticFileServlet(s_root, "/static"));
+
+    HttpResponse::ptr rsp = call(servlet, "/static/a.txt");
+    assert(rsp->getStatus() == HttpStatus::OK);
+    assert(rsp->getFile() && rsp->getFileOffset() == 0 && rsp->getFileLength() == 1000);
+    assert(rsp->getHeader("Content-Type") == "text/plain");
+    assert(rsp->getHeader("Accept-Ranges") == "bytes");
+    std::string etag = rsp->getHeader("ETag");
+    assert(!etag.empty() && !rsp->getHeader("Last-Modified").empty());
+    assert(rsp->toString().find(data) != std::string::npos);
+
+    rsp = call(servlet, "/static/a.txt", "Range", "bytes=10-19");
+    assert(rsp->getStatus() == HttpStatus::PARTIAL_CONTENT);
+    assert(rsp->getFileOffset() == 10 && rsp->getFileLength() == 10);
+    assert(rsp->getHeader("Content-Range") == "bytes 10-19/1000");
+    rsp = call(servlet, "/static/a.txt", "Range", "bytes=-1");
+    assert(rsp->getHeader("Content-Range") == "bytes 999-999/1000");
+    rsp = call(servlet, "/static/a.txt", "Range", "bytes=1000-");
+    assert(rsp->getStatus() == HttpStatus::RANGE_NOT_SATISFIABLE && !rsp->getFile());
+    assert(rsp->getHeader("Content-Range") == "bytes */1000");
+    rsp = call(servlet, "/static/a.txt", "Range", "bytes=1-2,5-6");
+    assert(rsp->getStatus() == HttpStatus::OK && rsp->getFileLength() == 1000);
+
+    rsp = call(servlet, "/static/a.txt", "If-None-Match", etag);
+    assert(rsp->getStatus() == HttpStatus::NOT_MODIFIED && !rsp->getFile());
+
+    assert(call(servlet, "/static/none.txt")->getStatus() == HttpStatus::NOT_FOUND);
+    assert(call(servlet, "/static/dir")->getStatus() == HttpStatus::NOT_FOUND);
+    assert(call(servlet, "/static/../a.txt")->getStatus() == HttpStatus::FORBIDDEN);
+    assert(call(servlet, "/static/%2e%2e/a.txt")->getStatus() == HttpStatus::FORBIDDEN);
+    assert(call(servlet, "/static/a%00.txt")->getStatus() == HttpStatus::FORBIDDEN);
+    assert(call(servlet, "/static/%61.txt")->getStatus() == HttpStatus::OK);
+    assert(call(servlet, "/static/..a.txt")->getStatus() == HttpStatus::NOT_FOUND);
+    std::cout << "testServlet ok" << std::endl;
+}
+
+void testCache() {
+    std::string path = s_root + "/c.txt";
+    writeFile(path, "hello");
+    myserver::FileCache cache(2);
+    myserver::CachedFile::ptr f = cache.open(path);
+    assert(f && f->st.st_size == 5);
+    assert(cache.open(path) == f);
+    myserver::FileCacheStats stats = cache.getStats();
+    assert(stats.hits == 1 && stats.misses == 1 && stats.size == 1);
+
+    int err = 0;
+    assert(!cache.open(s_root + "/none", &err) && err == ENOENT);
+    assert(!cache.open(s_root + "/dir", &err) && err == EISDIR);
+
+    // 修改后由 inotify 失效，重新打开得到新的大小
+    writeFile(path, "hello world");
+    myserver::CachedFile::ptr g;
+    for(int i = 0; i < 100; ++i) {
+        g = cache.open(path);
+        if(g != f) {
+            break;
+        }
+        usleep(10 * 1000);
+    }
+    assert(g != f && g->st.st_size == 11);
+    // 旧的引用仍然可用
+    char c;
+    assert(pread(f->fd, &c, 1, 0) == 1 && c == 'h');
+    assert(cache.getStats().invalidations >= 1);
+
+    writeFile(s_root + "/d.txt", "d");
+    writeFile(s_root + "/e.txt", "e");
+    cache.open(s_root + "/d.txt");
+    cache.open(s_root + "/e.txt");
+    stats = cache.getStats();
+    assert(stats.size == 2 && stats.evictions == 1);
+    cache.invalidate(s_root + "/e.txt");
+    assert(cache.getStats().size == 1);
+    cache.clear();
+    assert(cache.getStats().size == 0);
+
+    // 删除后(IN_DELETE_SELF / IN_IGNORED)移出缓存，再次打开失败
+    assert(cache.open(s_root + "/d.txt"));
+    unlink((s_root + "/d.txt").c_str());
+    for(int i = 0; i < 100 && cache.getStats().size; ++i) {
+        usleep(10 * 1000);
+    }
+    assert(!cache.open(s_root + "/d.txt", &err) && err == ENOENT);
+    std::cout << "testCache ok" << std::endl;
+}
+
+// 通过服务器发送，Connection: close 后读取全部数据
+static std::string fetch(myserver::Address::ptr addr, const std::string& req) {
+    myserver::Socket::ptr sock = myserver::Socket::CreateTCP(addr);
+    assert(sock->connect(addr, 1000));
+    sock->setRecvTimeout(3000);
+    assert(sock->send(req.c_str(), req.size()) == (int)req.size());
+    std::string data;
+    char buf[65536];
+    int n;
+    while((n = sock->recv(buf, sizeof(buf))) > 0) {
+        data.append(buf, n);
+    }
+    return data;
+}
+
+void testServer() {
+    std::string data = makeData(8 * 1024 * 1024 + 3);
+    writeFile(s_root + "/big.bin", data);
+    HttpServer::ptr server(new HttpServer(true, 1));
+    server->getServletDispatch()->addGlobServlet("/static/*",
+            std::make_shared<StaticFileServlet>(s_root, "/static"));
+    assert(server->bind(myserver::IPv4Address::Create("127.0.0.1", 0)));
+    assert(server->start());
+    myserver::Address::ptr addr = server->getSocks()[0]->getLocalAddress();
+
+    // 两个流水线请求：完整文件与范围，文件体夹在内存响应之间
+    std::string rt = fetch(addr, "GET /static/big.bin HTTP/1.1\r\n\r\n"
+            "GET /static/big.bin HTTP/1.1\r\nRange: bytes=5-9\r\n\r\n"
+            "GET /static/none HTTP/1.1\r\nConnection: close\r\n\r\n");
+    size_t pos = rt.find("\r\n\r\n");
+    assert(pos != std::string::npos);
+    assert(rt.find("Content-Length: " + std::to_string(data.size())) < pos);
+    assert(rt.compare(pos + 4, data.size(), data) == 0);
+    std::string rest = rt.substr(pos + 4 + data.size());
+    pos = rest.find("\r\n\r\n");
+    assert(rest.compare(0, 12, "HTTP/1.1 206") == 0);
+    assert(rest.compare(pos + 4, 5, data.substr(5, 5)) == 0);
+    assert(rest.find("HTTP/1.1 404", pos) == pos + 9);
+
+    rt = fetch(addr, "HEAD /static/big.bin HTTP/1.1\r\nConnection: close\r\n\r\n");
+    assert(rt.find("Content-Length: " + std::to_string(data.size())) != std::string::npos);
+    assert(rt.size() == rt.find("\r\n\r\n") + 4);
+    server->stop();
+    std::cout << "testServer ok" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    char tmpl[] = "/tmp/static_file_test.XXXXXX";
+    assert(mkdtemp(tmpl));
+    s_root = tmpl;
+    testParseRange();
+    testServlet();
+    testCache();
+    testServer();
+    std::string cmd = "rm -rf " + s_root;
+    return system(cmd.c_str()) == 0 ? 0 : 1;
+}
@@ -0,0 +1,116 @@
+#include <iostream>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <cassert>
+#include "thread.h"
+#include "mutex.h"
+
+// 基于 futex 的 Semaphore / CountDownLatch / WaitGroup 功能测试
+
+static uint64_t NowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void testSemaphore() {
+    myserver::Semaphore sem(2);
+    assert(sem.tryWait());
+    assert(sem.tryWait());
+    assert(!sem.tryWait());
+
+    uint64_t begin = NowMs();
+    assert(!sem.waitFor(50));
+    assert(NowMs() - begin >= 50);
+
+    // 生产者/消费者 ping-pong
+    const int N = 100000;
+    myserver::Semaphore ping, pong;
+    int value = 0;
+    myserver::Thread::ptr thr(new myserver::Thread([&]() {
+        for(int i = 0; i < N; ++i) {
+            ping.wait();
+            ++value;
+            pong.notify();
+        }
+    }, "SEM_PONG"));
+    for(int i = 0; i < N; ++i) {
+        ping.notify();
+        pong.wait();
+    }
+    thr->join();
+    assert(value == N);
+    std::cout << "testSemaphore ok" << std::endl;
+}
+
+void testCountDownLatch() {
+    const int N = 8;
+    myserver::CountDownLatch latch(N);
+    std::atomic<int> done(0);
+    std::vector<myserver::Thread::ptr> thrs;
+    for(int i = 0; i < N; ++i) {
+        thrs.push_back(myserver::Thread::ptr(new myserver::Thread([&]() {
+            done.fetch_add(1);
+            latch.countDown();
+        }, "LATCH_" + std::to_string(i))));
+    }
+    latch.wait();
+    assert(done.load() == N);
+    assert(latch.getCount() == 0);
+    latch.countDown();      // 归零后再减无效果
+    assert(latch.getCount() == 0);
+    for(auto& i : thrs) {
+        i->join();
+    }
+
+    myserver::CountDownLatch never(1);
+    assert(!never.waitFor(20));
+    never.countDown();
+    assert(never.waitFor(20));
+    std::cout << "testCountDownLatch ok" << std::endl;
+}
+
+void testWaitGroup() {
+    myserver::WaitGroup wg;
+    wg.wait();      // 计数为0立即返回
+
+    // fan-out / fan-in，连续复用两轮
+    for(int round = 0; round < 2; ++round) {
+        const int N = 16;
+        std::atomic<int> sum(0);
+        std::vector<myserver::Thread::ptr> thrs;
+        wg.add(N);
+        for(int i = 0; i < N; ++i) {
+            thrs.push_back(myserver::Thread::ptr(new myserver::Thread([&, i]() {
+                sum.fetch_add(i);
+                wg.done();
+            }, "WG_" + std::to_string(i))));
+        }
+        wg.wait();
+        assert(sum.load() == N * (N - 1) / 2);
+        for(auto& i : thrs) {
+            i->join();
+        }
+    }
+
+    wg.add(1);
+    assert(!wg.waitFor(20));
+    wg.done();
+    assert(wg.waitFor(20));
+
+    bool thrown = false;
+    try {
+        wg.done();
+    } catch(std::logic_error& e) {
+        thrown = true;
+    }
+    assert(thrown);
+    std::cout << "testWaitGroup ok" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    testSemaphore();
+    testCountDownLatch();
+    testWaitGroup();
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <sched.h>
+#include <unistd.h>
+#include "log.h"
+#include "thread.h"
+#include "tcp_server.h"
+
+// TcpServer 回环建连速率基准
+// 服务端每接收一个连接写回1字节后关闭；客户端线程循环 connect -> recv -> close
+// 分别测量 1 / 8 / 32 个工作线程(每线程一个 SO_REUSEPORT 监听socket)
+// 用法: tcp_server_bench [duration_ms=1000] [client_threads=4]
+
+namespace {
+
+inline uint64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class AckServer : public myserver::TcpServer {
+public:
+    AckServer(size_t workers) : myserver::TcpServer(workers) {}
+protected:
+    void handleClient(myserver::Socket::ptr client) override {
+        client->send("k", 1);
+    }
+};
+
+std::string run(size_t workers, int clients, uint64_t duration_ms) {
+    std::shared_ptr<AckServer> server(new AckServer(workers));
+    server->setKeepalive(0);
+    if(!server->bind(myserver::IPv4Address::Create("127.0.0.1", 0)) || !server->start()) {
+        std::cerr << "server start fail" << std::endl;
+        exit(1);
+    }
+    myserver::Address::ptr addr = server->getSocks()[0]->getLocalAddress();
+
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> connects(0);
+    std::atomic<uint64_t> errors(0);
+    std::vector<myserver::Thread::ptr> thrs;
+    for(int i = 0; i < clients; ++i) {
+        thrs.push_back(myserver::Thread::ptr(new myserver::Thread([&]() {
+            char c;
+            while(!stop.load(std::memory_order_relaxed)) {
+                myserver::Socket::ptr sock = myserver::Socket::CreateTCP(addr);
+                sock->setRecvTimeout(1000);
+                if(sock->connect(addr, 1000) && sock->recv(&c, 1) == 1) {
+                    connects.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    errors.fetch_add(1, std::memory_order_relaxed);
+                }
+                // 由客户端先行关闭后 TIME_WAIT 留在客户端一侧，SO_LINGER 0 直接复位避免耗尽端口
+                struct linger lg = {1, 0};
+                sock->setOption(SOL_SOCKET, SO_LINGER, lg);
+            }
+        }, "TSB_C" + std::to_string(i))));
+    }
+
+    uint64_t begin = NowNs();
+    while(NowNs() - begin < duration_ms * 1000000) {
+        usleep(10000);
+    }
+    stop = true;
+    for(auto& t : thrs) {
+        t->join();
+    }
+    double sec = (NowNs() - begin) / 1e9;
+    server->stop();
+
+    std::vector<uint64_t> counts = server->getAcceptCounts();
+    uint64_t min = (uint64_t)-1, max = 0;
+    for(auto n : counts) {
+        min = std::min(min, n);
+        max = std::max(max, n);
+    }
+
+    std::stringstream ss;
+    ss << "{\"workers\":" << workers
+       << ",\"client_threads\":" << clients
+       << ",\"connections\":" << connects
+       << ",\"errors\":" << errors
+       << ",\"seconds\":" << sec
+       << ",\"connections_per_sec\":" << (uint64_t)(connects / sec)
+       << ",\"per_worker_min\":" << min
+       << ",\"per_worker_max\":" << max << "}";
+    return ss.str();
+}
+
+}
+
+int main(int argc, char** argv) {
+    uint64_t duration_ms = argc > 1 ? atoi(argv[1]) : 1000;
+    int clients = argc > 2 ? atoi(argv[2]) : 4;
+    LOGGER_NAME("system")->setLevel(myserver::LogLevel::WARN);
+
+    std::vector<std::string> lines;
+    for(size_t workers : {1, 8, 32}) {
+        lines.push_back(run(workers, clients, duration_ms));
+    }
+    std::cout << "{\"hardware_threads\":" << std::thread::hardware_concurrency()
+              << ",\"duration_ms\":" << duration_ms
+              << ",\"results\":[" << std::endl;
+    for(size_t i = 0; i < lines.size(); ++i) {
+        std::cout << "  " << lines[i] << (i + 1 < lines.size() ? "," : "") << std::endl;
+    }
+    std::cout << "]}" << std::endl;
+    return 0;
+}
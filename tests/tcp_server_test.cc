@@ -0,0 +1,128 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <cstring>
+#include "config.h"
+#include "tcp_server.h"
+
+#include <unistd.h>
+
+// TcpServer 测试：回环地址与 Unix 域地址上的多 acceptor 回显服务
+
+class EchoServer : public myserver::TcpServer {
+public:
+    EchoServer(size_t workers) : myserver::TcpServer(workers) {}
+protected:
+    void handleClient(myserver::Socket::ptr client) override {
+        char buf[256];
+        int n;
+        while((n = client->recv(buf, sizeof(buf))) > 0) {
+            client->send(buf, n);
+        }
+    }
+};
+
+void testEcho() {
+    std::shared_ptr<EchoServer> server(new EchoServer(4));
+    assert(server->getWorkerCount() == 4);
+    assert(server->bind(myserver::IPv4Address::Create("127.0.0.1", 0)));
+    std::vector<myserver::Socket::ptr> socks = server->getSocks();
+    assert(socks.size() == 4);
+    // 所有监听socket绑定同一端口
+    for(auto& s : socks) {
+        assert(*s->getLocalAddress() == *socks[0]->getLocalAddress());
+    }
+    assert(server->start());
+
+    myserver::Address::ptr addr = socks[0]->getLocalAddress();
+    for(int i = 0; i < 32; ++i) {
+        myserver::Socket::ptr c = myserver::Socket::CreateTCP(addr);
+        assert(c->connect(addr, 1000));
+        c->setRecvTimeout(2000);
+        std::string msg = "hello " + std::to_string(i);
+        assert(c->send(msg.c_str(), msg.size()) == (int)msg.size());
+        char buf[64] = {0};
+        assert(c->recv(buf, sizeof(buf)) == (int)msg.size());
+        assert(msg == buf);
+    }
+    server->stop();
+
+    uint64_t total = 0;
+    for(auto n : server->getAcceptCounts()) {
+        total += n;
+    }
+    assert(total == 32);
+    std::cout << "testEcho ok " << server->toString();
+}
+
+void testUnix() {
+    const std::string path = "/tmp/tcp_server_test.sock";
+    myserver::Address::ptr addr(new myserver::UnixAddress(path));
+    // 残留的socket文件
+    myserver::Socket::ptr stale = myserver::Socket::CreateTCP(addr);
+    assert(stale->bind(addr));
+    stale->close();
+    assert(access(path.c_str(), F_OK) == 0);
+
+    std::shared_ptr<EchoServer> server(new EchoServer(3));
+    assert(server->bind(addr));
+    // 全部工作线程共享一个监听socket
+    std::vector<myserver::Socket::ptr> socks = server->getSocks();
+    assert(socks.size() == 3);
+    for(auto& s : socks) {
+        assert(s == socks[0]);
+    }
+    assert(server->start());
+    for(int i = 0; i < 16; ++i) {
+        myserver::Socket::ptr c = myserver::Socket::CreateTCP(addr);
+        assert(c->connect(addr, 1000));
+        c->setRecvTimeout(2000);
+        std::string msg = "unix " + std::to_string(i);
+        assert(c->send(msg.c_str(), msg.size()) == (int)msg.size());
+        char buf[64] = {0};
+        assert(c->recv(buf, sizeof(buf)) == (int)msg.size());
+        assert(msg == buf);
+    }
+    server->stop();
+    uint64_t total = 0;
+    for(auto n : server->getAcceptCounts()) {
+        total += n;
+    }
+    assert(total == 16);
+    server.reset();
+    unlink(path.c_str());
+    std::cout << "testUnix ok" << std::endl;
+}
+
+void testConfig() {
+    auto workers = myserver::Config::Lookup<uint32_t>("tcp_server.workers");
+    auto timeout = myserver::Config::Lookup<uint64_t>("tcp_server.read_timeout");
+    auto address = myserver::Config::Lookup<std::vector<std::string> >("tcp_server.address");
+    assert(workers && timeout && address);
+    workers->setValue(3);
+    timeout->setValue(1234);
+    address->setValue({"127.0.0.1:0"});
+
+    myserver::TcpServer::ptr server(new myserver::TcpServer);
+    assert(server->getWorkerCount() == 3 && server->getReadTimeout() == 1234);
+    std::vector<myserver::Address::ptr> fails;
+    assert(server->bindFromConfig(fails) && fails.empty());
+    assert(server->getSocks().size() == 3);
+
+    // 已被独占的端口绑定失败
+    myserver::Address::ptr addr = server->getSocks()[0]->getLocalAddress();
+    myserver::Socket::ptr other = myserver::Socket::CreateTCP(addr);
+    myserver::TcpServer::ptr server2(new myserver::TcpServer(2));
+    assert(other->bind(myserver::IPv4Address::Create("127.0.0.1", 0)) && other->listen());
+    assert(!server2->bind(other->getLocalAddress()));
+    assert(!server2->start());
+    std::cout << "testConfig ok" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    testEcho();
+    testUnix();
+    testConfig();
+    return 0;
+}
@@ -1,60 +1,18 @@
 #include <iostream>
-#include <pthread.h>
-#include <semaphore.h>
+#include <cassert>
+#include <atomic>
+#include <sys/wait.h>
 #include "thread.h"
 #include "mutex.h"
+#include "log.h"
+#include "util.h"
 
-myserver::Semaphore semaphore;
-int count = 0;
-
-typedef myserver::Mutex LockType;
-// typedef myserver::Spinlock LockType;
-// typedef myserver::RWMutex LockType;
-
-LockType gLock;
-void* addFun(void* arg) {
-    for (int i = 0; i < 100000; ++i) {
-        LockType::Lock lock(gLock);
-        // LockType::ReadLock lock(gLock);
-        // LockType::WriteLock lock(gLock);
-        count++;
-    }
-    return nullptr;
-}
-
-void testMutex() {
-    pthread_t tid1;
-    pthread_t tid2;
-
-    pthread_create(&tid1, nullptr, addFun, nullptr);
-    pthread_create(&tid2, nullptr, addFun, nullptr);
-
-    pthread_join(tid1, nullptr);
-    pthread_join(tid2, nullptr);
-
-    std::cout << count << std::endl;
-}
-
-void testThreadAddFun() { 
-    std::function<void()> cb = []() {
-        for (int i = 0; i < 100000; ++i) {
-            LockType::Lock lock(gLock);
-            count++;
-        }
-    };
-
-    myserver::Thread::ptr thr1(new myserver::Thread(cb, "THREAD_1"));
-    myserver::Thread::ptr thr2(new myserver::Thread(cb, "THREAD_2"));
-
-    thr1->join();
-    thr2->join();
-    std::cout << count << std::endl;
-}
+myserver::Mutex gLock;
 
 void testThreadName() {
     std::function<void()> cb = []() {
         {
-            LockType::Lock lock(gLock);
+            myserver::Mutex::Lock lock(gLock);
             std::cout << myserver::Thread::GetName() << std::endl;
         }
         
@@ -63,7 +21,7 @@ void testThreadName() {
     myserver::Thread::ptr thr2(new myserver::Thread(cb, "THREAD_2"));
 
     {
-        LockType::Lock lock(gLock);
+        myserver::Mutex::Lock lock(gLock);
         std::cout << "线程创建完成" << std::endl;
     }
    
@@ -71,9 +29,55 @@ void testThreadName() {
     thr2->join();
 }
 
+void testThreadContext() {
+    static myserver::Logger::ptr logger = LOGGER_NAME("system");
+    std::function<void()> cb = []() {
+        myserver::ThreadContext& ctx = myserver::ThreadContext::GetThis();
+        assert(ctx.getTid() == syscall(SYS_gettid));
+        assert(ctx.getName() == myserver::Thread::GetThis()->getName());
+        LOG_INFO(logger) << "before rename";
+
+        myserver::Thread::SetName(ctx.getName() + "_RENAMED");
+        assert(myserver::Thread::GetName() == ctx.getName());
+        assert(myserver::Thread::GetThis()->getName() == ctx.getName());
+        LOG_INFO(logger) << "after rename";
+    };
+    myserver::Thread::ptr thr1(new myserver::Thread(cb, "CTX_1"));
+    myserver::Thread::ptr thr2(new myserver::Thread(cb, "CTX_2"));
+    thr1->join();
+    thr2->join();
+    assert(thr1->getName() == "CTX_1_RENAMED");
+}
+
+// fork 后子进程中缓存的线程id随之刷新，驻留锁可用(另一线程持续改名以制造锁竞争)
+void testFork() {
+    std::atomic<bool> stop(false);
+    myserver::Thread::ptr renamer(new myserver::Thread([&stop]() {
+        for(int i = 0; !stop.load(); ++i) {
+            myserver::Thread::SetName("RENAME_" + std::to_string(i % 64));
+        }
+    }, "RENAME"));
+    for(int i = 0; i < 50; ++i) {
+        myserver::GetThreadId();
+        pid_t pid = fork();
+        if(pid == 0) {
+            bool ok = myserver::GetThreadId() == syscall(SYS_gettid);
+            myserver::Thread::SetName("FORK_CHILD");
+            ok = ok && myserver::Thread::GetName() == "FORK_CHILD";
+            _exit(ok ? 0 : 1);
+        }
+        int status = 0;
+        waitpid(pid, &status, 0);
+        assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+    stop = true;
+    renamer->join();
+    std::cout << "testFork ok" << std::endl;
+}
+
 int main(int argc, char** argv) {
-    // testMutex();
-    // testThreadAddFun();
     testThreadName();
+    testThreadContext();
+    testFork();
     return 0;
 }
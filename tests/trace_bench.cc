@@ -0,0 +1,50 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include "trace.h"
+#include "thread.h"
+
+// TRACE_SPAN 开销基准：分别测量关闭与开启采集时每个区间的耗时(ns)，以 JSON 输出
+// 用法: trace_bench [spans=2000000]
+
+namespace {
+
+inline uint64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double run(uint64_t spans) {
+    uint64_t begin = NowNs();
+    for(uint64_t i = 0; i < spans; ++i) {
+        TRACE_SPAN("bench.span");
+        __asm__ __volatile__("" ::: "memory");
+    }
+    return (double)(NowNs() - begin) / spans;
+}
+
+}
+
+int main(int argc, char** argv) {
+    uint64_t spans = argc > 1 ? atoll(argv[1]) : 2000000;
+
+    double disabled = run(spans);
+    myserver::Tracer::Start("/tmp/myserver_trace_bench.json");
+    // 分批记录，避免单批超出缓冲容量而丢弃
+    double enabled = 0;
+    uint64_t batch = 32 * 1024;
+    for(uint64_t done = 0; done < spans; done += batch) {
+        enabled += run(batch) * batch;
+        myserver::Tracer::Flush();
+    }
+    enabled /= (spans + batch - 1) / batch * batch;
+    myserver::Tracer::Stop();
+
+    std::cout << "{\"spans\":" << spans
+              << ",\"disabled_ns\":" << disabled
+              << ",\"enabled_ns\":" << enabled
+              << ",\"written\":" << myserver::Tracer::GetWritten()
+              << ",\"dropped\":" << myserver::Tracer::GetDropped() << "}" << std::endl;
+    return 0;
+}
@@ -0,0 +1,132 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <cstdlib>
+#include <unistd.h>
+#include "trace.h"
+#include "config.h"
+#include "thread.h"
+
+// Tracer 测试：关闭时不记录、多线程嵌套区间写出、时间换算、缓冲溢出计数与配置开关
+
+using namespace myserver;
+
+static std::string ReadFile(const std::string& path) {
+    std::ifstream ifs(path);
+    std::stringstream ss;
+    ss << ifs.rdbuf();
+    return ss.str();
+}
+
+static size_t Count(const std::string& str, const std::string& sub) {
+    size_t n = 0;
+    for(size_t pos = str.find(sub); pos != std::string::npos; pos = str.find(sub, pos + 1)) {
+        ++n;
+    }
+    return n;
+}
+
+// 取第一个名为 name 的区间的 dur(微秒)
+static double FindDur(const std::string& str, const std::string& name) {
+    size_t pos = str.find("{\"name\":\"" + name + "\",\"ph\":\"X\"");
+    assert(pos != std::string::npos);
+    pos = str.find("\"dur\":", pos);
+    return atof(str.c_str() + pos + 6);
+}
+
+void testDisabled() {
+    assert(!Tracer::IsEnabled());
+    for(int i = 0; i < 100; ++i) {
+        TRACE_SPAN("test.disabled");
+    }
+    assert(Tracer::GetWritten() == 0);
+    std::cout << "testDisabled ok" << std::endl;
+}
+
+void testSpans() {
+    const std::string path = "/tmp/myserver_trace_test.json";
+    assert(Tracer::Start(path));
+    assert(!Tracer::Start(path));
+    assert(Tracer::IsEnabled());
+
+    std::vector<Thread::ptr> thrs;
+    for(int i = 0; i < 4; ++i) {
+        thrs.push_back(Thread::ptr(new Thread([]() {
+            for(int k = 0; k < 1000; ++k) {
+                TRACE_SPAN("test.outer");
+                TRACE_SPAN("test.inner");
+            }
+        }, "TT_" + std::to_string(i))));
+    }
+    {
+        TRACE_SPAN("test.sleep");
+        usleep(20 * 1000);
+    }
+    for(auto& t : thrs) {
+        t->join();
+    }
+    Tracer::Flush();
+    Tracer::Stop();
+    assert(!Tracer::IsEnabled());
+    Tracer::Stop();
+
+    std::string str = ReadFile(path);
+    assert(str.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[") == 0);
+    assert(str.substr(str.size() - 4) == "\n]}\n");
+    assert(Count(str, "\"name\":\"test.outer\"") == 4000);
+    assert(Count(str, "\"name\":\"test.inner\"") == 4000);
+    assert(Count(str, "\"ph\":\"M\"") == 5);
+    assert(str.find("\"args\":{\"name\":\"TT_3\"}") != std::string::npos);
+    assert(Tracer::GetWritten() == 8001);
+    double dur = FindDur(str, "test.sleep");
+    assert(dur >= 19000 && dur < 200000);
+    // 关闭后不再记录
+    {
+        TRACE_SPAN("test.after");
+    }
+    Tracer::Flush();
+    assert(Tracer::GetWritten() == 8001);
+    std::cout << "testSpans ok sleep_dur_us=" << dur << std::endl;
+}
+
+void testOverflow() {
+    Config::Lookup<uint32_t>("trace.buffer_size")->setValue(16);
+    Config::Lookup<uint64_t>("trace.flush_interval")->setValue(60 * 1000);
+    uint64_t dropped = Tracer::GetDropped();
+    assert(Tracer::Start("/tmp/myserver_trace_overflow.json"));
+    Thread t([]() {
+        for(int k = 0; k < 100; ++k) {
+            TRACE_SPAN("test.overflow");
+        }
+    }, "TT_overflow");
+    t.join();
+    Tracer::Stop();
+    assert(Tracer::GetDropped() - dropped == 84);
+    assert(Tracer::GetWritten() == 16);
+    std::cout << "testOverflow ok" << std::endl;
+}
+
+void testConfig() {
+    Config::Lookup<std::string>("trace.file")->setValue("/tmp/myserver_trace_config.json");
+    Config::Lookup<bool>("trace.enable")->setValue(true);
+    assert(Tracer::IsEnabled());
+    {
+        TRACE_SPAN("test.config");
+    }
+    Config::Lookup<bool>("trace.enable")->setValue(false);
+    assert(!Tracer::IsEnabled());
+    std::string str = ReadFile("/tmp/myserver_trace_config.json");
+    assert(Count(str, "\"name\":\"test.config\"") == 1);
+    std::cout << "testConfig ok" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    testDisabled();
+    testSpans();
+    testOverflow();
+    testConfig();
+    return 0;
+}